@@ -3,12 +3,18 @@
 
 // Configuration
 const WS_RECONNECT_INTERVAL = 5000;
+const SSE_FALLBACK_AFTER = 3;  // Failed WebSocket attempts before streaming over /events
+const SSE_TOPICS = ['gameState', 'sequence', 'buttonPress', 'multiplayer', 'gameOver', 'playerChange'];
 const API_BASE = window.location.origin;
 
 // Global State
 let ws = null;
 let currentDifficulty = 0;
 let wsReconnectTimer = null;
+let wsEpoch = null;     // Server boot the sequence numbers belong to
+let wsLastSeq = 0;      // Last broadcast sequence number seen
+let wsFailures = 0;     // Consecutive failed connection attempts
+let eventSource = null; // Server-Sent Events fallback while WebSocket is down
 
 // Initialize Application
 document.addEventListener('DOMContentLoaded', () => {
@@ -107,6 +113,19 @@ function initControls() {
 
     // Multiplayer controls
     initMultiplayer();
+
+    // On-screen Simon buttons play on the device
+    document.querySelectorAll('.simon-btn').forEach(btn => {
+        btn.addEventListener('pointerdown', () => sendPress(btn.dataset.color));
+    });
+}
+
+function sendPress(color) {
+    if (!ws || ws.readyState !== WebSocket.OPEN) return;
+
+    // "t" lets the device back-date the press by the network delay
+    ws.send(JSON.stringify({type: 'press', color: color, t: Math.round(performance.now())}));
+    flashButton(color, true);
 }
 
 // ============================================================================
@@ -256,6 +275,15 @@ function connectWebSocket() {
 
     ws.onopen = () => {
         console.log('WebSocket connected');
+        wsFailures = 0;
+        stopEventStream();
+
+        // Displays can limit what they receive, e.g. ?topics=gameState,gameOver
+        const topics = new URLSearchParams(window.location.search).get('topics');
+        if (topics) {
+            ws.send(JSON.stringify({type: 'subscribe', topics: topics.split(',')}));
+        }
+
         updateConnectionStatus('connected');
         if (wsReconnectTimer) {
             clearTimeout(wsReconnectTimer);
@@ -285,6 +313,11 @@ function connectWebSocket() {
 }
 
 function scheduleReconnect() {
+    // Kiosk browsers behind flaky captive networks: keep updating read-only over SSE
+    if (++wsFailures >= SSE_FALLBACK_AFTER) {
+        startEventStream();
+    }
+
     if (!wsReconnectTimer) {
         wsReconnectTimer = setTimeout(() => {
             console.log('Attempting to reconnect...');
@@ -293,6 +326,30 @@ function scheduleReconnect() {
     }
 }
 
+function startEventStream() {
+    if (eventSource || !window.EventSource) return;
+
+    console.log('Falling back to Server-Sent Events');
+    eventSource = new EventSource(`${API_BASE}/events`);
+
+    // Same payloads as the WebSocket; the sequence number is the event id
+    SSE_TOPICS.forEach(topic => {
+        eventSource.addEventListener(topic, (e) => {
+            const data = JSON.parse(e.data);
+            data.seq = parseInt(e.lastEventId);
+            handleWebSocketMessage(data);
+        });
+    });
+    eventSource.addEventListener('snapshot', () => loadInitialData());
+}
+
+function stopEventStream() {
+    if (eventSource) {
+        eventSource.close();
+        eventSource = null;
+    }
+}
+
 function updateConnectionStatus(status) {
     const statusEl = document.getElementById('connectionStatus');
     const dot = statusEl.querySelector('.status-dot');
@@ -327,14 +384,48 @@ function updateConnectionStatus(status) {
 }
 
 function handleWebSocketMessage(data) {
+    // Clock-sync ping: echo the device time with ours so it can measure latency
+    if (data.type === 'ping') {
+        ws.send(JSON.stringify({type: 'pong', s: data.s, c: Math.round(performance.now())}));
+        return;
+    }
+
     console.log('WS Message:', data);
 
+    if (data.seq !== undefined && data.seq > wsLastSeq) {
+        wsLastSeq = data.seq;
+    }
+
     switch(data.type) {
+        case 'hello':
+            // After a reconnect, ask for what we missed
+            if (wsEpoch !== null) {
+                ws.send(JSON.stringify({type: 'resume', epoch: wsEpoch, seq: wsLastSeq}));
+            } else {
+                wsLastSeq = data.seq;
+            }
+            wsEpoch = data.epoch;
+            break;
+        case 'snapshot':
+            // Gap too large to replay: the latest state follows, refetch the rest
+            wsLastSeq = data.seq;
+            loadInitialData();
+            break;
+        case 'resumed':
+            console.log(`Resumed, ${data.replayed} missed events replayed`);
+            break;
+        case 'latency':
+            document.querySelector('#connectionStatus .status-text').textContent =
+                `Connected (${data.srttMs} ms)`;
+            break;
+        case 'error':
+            showToast(data.message, 'error');
+            break;
         case 'gameState':
             updateGameState(data);
             break;
         case 'sequence':
-            animateSequence(data.colors);
+            animateSequence(decodeSequence(data.packed, data.length));
             break;
         case 'buttonPress':
             flashButton(data.color, data.correct);
@@ -357,6 +448,74 @@ function updateGameState(data) {
     document.getElementById('currentScore').textContent = data.score || 0;
     document.getElementById('highScore').textContent = data.highScore || 0;
     document.getElementById('currentDifficulty').textContent = data.difficulty || 'Easy';
+    document.getElementById('currentSeed').textContent = data.seed || '-';
+}
+
+// Colors in firmware enum order (RED=0, GREEN=1, BLUE=2, YELLOW=3)
+const SEQUENCE_COLORS = ['red', 'green', 'blue', 'yellow'];
+
+// Decode a packed sequence: each hex byte holds four 2-bit steps, first step in the low bits
+function decodeSequence(packed, length) {
+    const colors = [];
+    for (let i = 0; i < length; i++) {
+        const byte = parseInt(packed.substr((i >> 2) * 2, 2), 16);
+        colors.push(SEQUENCE_COLORS[(byte >> ((i & 3) * 2)) & 3]);
+    }
+    return colors;
+}
+
+// Port of the firmware SequenceRng (xoshiro128** seeded via splitmix32).
+// The same seed yields the same colors as on the device; both are pinned
+// to test/test_sequence_rng/sequence_rng_vectors.h.
+class SequenceRng {
+    constructor(seed) {
+        this.state = new Uint32Array(4);
+        let z = seed >>> 0;
+        for (let i = 0; i < 4; i++) {
+            z = (z + 0x9E3779B9) >>> 0;
+            let x = z;
+            x = Math.imul(x ^ (x >>> 16), 0x85EBCA6B);
+            x = Math.imul(x ^ (x >>> 13), 0xC2B2AE35);
+            this.state[i] = x ^ (x >>> 16);
+        }
+    }
+
+    static rotl(x, k) {
+        return ((x << k) | (x >>> (32 - k))) >>> 0;
+    }
+
+    next() {
+        const s = this.state;
+        const result = Math.imul(SequenceRng.rotl(Math.imul(s[1], 5) >>> 0, 7), 9) >>> 0;
+        const t = (s[1] << 9) >>> 0;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = SequenceRng.rotl(s[3], 11);
+        return result;
+    }
+
+    nextColor() {
+        return SEQUENCE_COLORS[this.next() >>> 30];
+    }
+}
+
+// Regenerate the first `length` colors of a seeded game
+function generateSequence(seed, length) {
+    const rng = new SequenceRng(seed);
+    return Array.from({ length }, () => rng.nextColor());
+}
+
+// Seed shared by every device for a date (UTC, default today), FNV-1a of YYYY-MM-DD
+function dailySeed(date = new Date()) {
+    const day = date.toISOString().slice(0, 10);
+    let hash = 0x811C9DC5;
+    for (let i = 0; i < day.length; i++) {
+        hash = Math.imul(hash ^ day.charCodeAt(i), 0x01000193) >>> 0;
+    }
+    return hash || 1;
 }
 
 function animateSequence(colors) {
@@ -370,8 +529,9 @@ function animateSequence(colors) {
 function flashButton(color, correct) {
     const btn = document.querySelector(`.simon-btn[data-color="${color}"]`);
     if (btn) {
-        btn.classList.add('active');
-        setTimeout(() => btn.classList.remove('active'), 300);
+        const cls = correct ? 'active' : 'wrong';
+        btn.classList.add(cls);
+        setTimeout(() => btn.classList.remove(cls), correct ? 300 : 600);
     }
 }
 
@@ -388,12 +548,16 @@ function showGameOver(data) {
 
 async function startGame() {
     const difficulty = parseInt(document.getElementById('difficulty').value);
+    const body = { difficulty };
+    if (document.getElementById('dailyChallenge').checked) {
+        body.seed = dailySeed();
+    }
 
     try {
         const response = await fetch(`${API_BASE}/api/game/start`, {
             method: 'POST',
             headers: {'Content-Type': 'application/json'},
-            body: JSON.stringify({ difficulty })
+            body: JSON.stringify(body)
         });
 
         if (response.ok) {
@@ -494,17 +658,113 @@ async function loadRecentGames() {
                         <div class="score-name">${g.playerName}</div>
                         <div class="score-meta">${g.difficulty} • ${formatDate(g.timestamp)}</div>
                     </div>
-                    <div class="score-value">${g.score}</div>
+                    <div class="score-value">
+                        ${g.score}
+                        ${g.replayId ? `<button class="replay-btn" data-replay-id="${g.replayId}" title="Watch replay">▶</button>` : ''}
+                    </div>
                 </div>
             `).join('') :
             '<p class="loading">No games yet</p>';
 
-        document.getElementById('recentGames').innerHTML = html;
+        const container = document.getElementById('recentGames');
+        container.innerHTML = html;
+        container.querySelectorAll('.replay-btn').forEach(btn => {
+            btn.addEventListener('click', () => playReplay(parseInt(btn.dataset.replayId)));
+        });
     } catch (error) {
         console.error('Failed to load recent games:', error);
     }
 }
 
+// ============================================================================
+// Replays
+// ============================================================================
+
+// Replay event types (see game_replay.h)
+const REPLAY_ROUND = 0;
+const REPLAY_PRESS = 1;
+const REPLAY_TIMEOUT = 2;
+
+// Decode a binary replay: 28-byte little-endian header, then 4-byte events
+function decodeReplay(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < 28 || view.getUint32(0, true) !== 0x4C505253) {
+        throw new Error('Not a replay file');
+    }
+
+    const replay = {
+        version: view.getUint8(4),
+        difficulty: view.getUint8(5),
+        flags: view.getUint8(6),
+        id: view.getUint32(8, true),
+        seed: view.getUint32(12, true),
+        timestamp: view.getUint32(16, true),
+        durationMs: view.getUint32(20, true),
+        score: view.getUint16(24, true),
+        events: []
+    };
+
+    const numEvents = Math.min(view.getUint16(26, true), (buffer.byteLength - 28) / 4);
+    for (let i = 0; i < numEvents; i++) {
+        const offset = 28 + i * 4;
+        replay.events.push({
+            type: view.getUint8(offset),
+            color: SEQUENCE_COLORS[view.getUint8(offset + 1) & 3],
+            value: view.getUint16(offset + 2, true)
+        });
+    }
+    return replay;
+}
+
+// Play back a stored game on the sequence display: colors come from the
+// seed, press timing from the recorded reaction times
+async function playReplay(id) {
+    try {
+        const response = await fetch(`${API_BASE}/api/replays/${id}`);
+        if (!response.ok) {
+            showToast('Replay not found', 'error');
+            return;
+        }
+        const replay = decodeReplay(await response.arrayBuffer());
+        const sequence = generateSequence(replay.seed, Math.max(...replay.events
+            .filter(e => e.type === REPLAY_ROUND).map(e => e.value), 0));
+
+        switchTab('game');
+        showToast(`Replaying game #${replay.id} (score ${replay.score})`, 'success');
+
+        let at = 0;
+        let step = 0;
+        let failed = false;
+        replay.events.forEach(e => {
+            if (e.type === REPLAY_ROUND) {
+                const shown = sequence.slice(0, e.value);
+                setTimeout(() => animateSequence(shown), at);
+                at += shown.length * 800;
+                step = 0;
+            } else if (e.type === REPLAY_PRESS) {
+                at += e.value;
+                // Judged like the game does: against the step the player had reached
+                const correct = e.color === sequence[step++];
+                failed = failed || !correct;
+                setTimeout(() => flashButton(e.color, correct), at);
+            } else if (e.type === REPLAY_TIMEOUT) {
+                at += e.value;
+                failed = true;
+            }
+        });
+        setTimeout(() => {
+            if (failed) {
+                showGameOver({ score: replay.score });
+            } else {
+                showToast(`Replay finished: score ${replay.score}`, 'success');
+            }
+        }, at + 500);
+    } catch (error) {
+        console.error('Failed to play replay:', error);
+        showToast('Failed to play replay', 'error');
+    }
+}
+
 function selectDifficultyTab(difficulty) {
     document.querySelectorAll('.difficulty-tab').forEach(btn => {
         btn.classList.toggle('active', parseInt(btn.dataset.difficulty) === difficulty);
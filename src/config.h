@@ -22,11 +22,30 @@
 #define SERIAL_BAUD_RATE 115200
 #define DEBUG_ENABLED true
 
+// Log levels
+#define LOGLEVEL_NONE  0
+#define LOGLEVEL_ERROR 1
+#define LOGLEVEL_WARN  2
+#define LOGLEVEL_INFO  3
+#define LOGLEVEL_DEBUG 4
+
+// LOG_E/W/I/D calls above this level are compiled out
+#define LOG_COMPILE_LEVEL LOGLEVEL_DEBUG
+
+// Initial runtime level for every tag (change per tag via /api/log)
+#define LOG_RUNTIME_DEFAULT_LEVEL LOGLEVEL_DEBUG
+
+// Log ring buffer: messages longer than a slot are truncated, and messages
+// arriving while the ring is full are dropped (and counted)
+#define LOG_RING_SLOTS 32
+#define LOG_SLOT_SIZE 128
+
 // Debug macro
+// Reason: Routed through the async logger so hot paths never block on the UART
 #if DEBUG_ENABLED
-  #define DEBUG_PRINT(x) Serial.print(x)
-  #define DEBUG_PRINTLN(x) Serial.println(x)
-  #define DEBUG_PRINTF(x, ...) Serial.printf(x, __VA_ARGS__)
+  #define DEBUG_PRINT(x) Logger::print(x)
+  #define DEBUG_PRINTLN(x) Logger::println(x)
+  #define DEBUG_PRINTF(x, ...) Logger::printf(x, __VA_ARGS__)
 #else
   #define DEBUG_PRINT(x)
   #define DEBUG_PRINTLN(x)
@@ -38,10 +57,12 @@
 // ============================================================================
 
 // Maximum sequence length across all difficulties
-// Reason: Set to 100 to be effectively unlimited (most players can't reach this)
-#define MAX_SEQUENCE_LENGTH 100
+// Reason: Sequences are packed at 2 bits per step, so 1024 steps take 256 bytes
+// (about the RAM of the old 100-step Color array plus headroom) and leave room
+// for endurance play. Raise further for marathon builds (~0.25 bytes per step).
+#define MAX_SEQUENCE_LENGTH 1024
 
-// Default difficulty mode (0=Easy, 1=Medium, 2=Hard)
+// Default difficulty mode (0=Easy, 1=Medium, 2=Hard, 3=Adaptive, 4=Expert)
 #define DEFAULT_DIFFICULTY 1  // Medium (original Simon timing)
 
 // Timeout for player input (milliseconds)
@@ -121,12 +142,37 @@
 // Web server port
 #define WEB_SERVER_PORT 80
 
-// WebSocket update interval (milliseconds)
+// WebSocket update interval (milliseconds): state updates (gameState,
+// multiplayer) reach each client at most this often, coalesced to the latest
 #define WEBSOCKET_UPDATE_INTERVAL_MS 100
 
-// Maximum number of WebSocket clients
+// Maximum number of WebSocket clients (further connections are refused)
 #define MAX_WEBSOCKET_CLIENTS 4
 
+// Remote play: clients send presses and commands over the WebSocket
+#define WS_PING_INTERVAL_MS 2000       // Clock-sync ping to each client
+#define WS_MAX_LATENCY_COMP_MS 250     // Most network delay credited back to a remote press
+
+// Slow clients (smoothed RTT + 4x jitter above the limit, or no pong for
+// WS_STALE_PINGS pings) get state updates at most once per interval and
+// no transient ones
+#define WS_SLOW_CLIENT_RTT_MS 400
+#define WS_SLOW_CLIENT_INTERVAL_MS 1000
+#define WS_STALE_PINGS 3
+
+// Per-client backpressure: with this many messages still queued a client is
+// treated as slow; at the disconnect depth it is closed so its queue is freed
+#define WS_CLIENT_QUEUE_DOWNGRADE 4
+#define WS_CLIENT_QUEUE_DISCONNECT 16
+
+// Reconnect catch-up: recent broadcast events kept for resuming clients
+#define WS_EVENT_RING_SIZE 32          // Events kept
+#define WS_EVENT_RING_BYTES 3072       // Payload bytes kept
+#define WS_EVENT_MAX_LEN 640           // Largest event that can be replayed
+
+// Server-Sent Events stream (/events) for displays without WebSocket
+#define SSE_RECONNECT_MS 3000          // Browser retry delay sent to clients
+
 // ============================================================================
 // DATA STORAGE SETTINGS
 // ============================================================================
@@ -136,11 +182,66 @@
 #define STORAGE_SETTINGS_FILE "/settings.json"
 #define STORAGE_ANALYTICS_FILE "/analytics.json"
 
+// Write-behind for players/history/scores: a finished game only updates RAM,
+// and the changed files are rewritten together once things are quiet
+#define STORAGE_FLUSH_QUIET_MS 3000    // Idle time after the last change (no game running)
+#define STORAGE_MAX_DIRTY_MS 30000     // Most data a power cut can lose (flushes even mid-game)
+
+// Game history log: one line appended per game, in segments of this many
+// records (~160 bytes each, so a segment stays within one flash block)
+#define STORAGE_HISTORY_DIR "/history"
+#define HISTORY_SEGMENT_RECORDS 20
+
+// Per-game player stats and score-rank counts ride along in the history
+// log; players.json and ranks.json are rewritten once this many games have
+// piled up after their last save (must stay below MAX_GAME_HISTORY, the
+// games the log is sure to keep)
+#define STORAGE_PLAYERS_CHECKPOINT_GAMES 40
+
+// Long-term archive: per-day, per-player rollups of every game (binary,
+// append-only). The open day is batched in RAM and written at most this long
+// after its first game, on a day change, or before deep sleep.
+#define STORAGE_ARCHIVE_FILE "/archive.bin"
+#define STORAGE_ARCHIVE_COMMIT_MS 3600000
+
+// Read-optimized binary copy of the player and high-score tables, in its own
+// raw partition (see partitions.csv). Queries read it in place through a flash
+// mapping. Host builds map a file of the same size instead.
+#define SNAPSHOT_PARTITION_LABEL "snapshot"
+#define SNAPSHOT_HOST_FILE "snapshot.bin"
+#define SNAPSHOT_HOST_SIZE 0x10000
+
+// Flash wear accounting (estimates; LittleFS does not report erases)
+#define STORAGE_BLOCK_SIZE 4096              // LittleFS block = flash sector
+#define STORAGE_FLASH_ENDURANCE 100000       // Erase cycles per sector (datasheet minimum)
+#define STORAGE_WEAR_SAVE_INTERVAL_MS 600000 // Counters saved at most this often, and before sleep
+
 // Maximum number of high scores to store per difficulty
 #define MAX_HIGH_SCORES_PER_DIFFICULTY 10
 
-// Maximum number of analytics records to keep
-#define MAX_ANALYTICS_RECORDS 100
+// Maximum number of per-player analytics records to keep
+// (~150 bytes each in RAM; the least recently active player is evicted)
+#define MAX_ANALYTICS_RECORDS 24
+
+// Minimum interval between analytics saves (only written while no game is running)
+#define ANALYTICS_SAVE_INTERVAL_MS 60000
+
+// Game replays (one binary file per game, oldest evicted first)
+#define STORAGE_REPLAY_DIR "/replays"
+#define REPLAY_MAX_FILES 10
+
+// Finished replays wait in RAM and are written with the other storage
+// changes once things are quiet; a game ending with this many waiting
+// writes the oldest at once
+#define REPLAY_PENDING_MAX 2
+
+// Events buffered per replay (4 bytes each; a score of ~30 needs ~500)
+#define REPLAY_MAX_EVENTS 512
+
+// Pass-and-play Elo ratings (kept in the players file)
+#define RATING_INITIAL 1500.0f         // New players start here
+#define RATING_K_FACTOR 32.0f          // Most a rating moves in one game
+#define RATING_MAX_PLAYERS 4           // Players in one pass-and-play game
 
 // ============================================================================
 // BUTTON DEBOUNCING
@@ -153,6 +254,22 @@
 // Long press threshold (milliseconds)
 #define BUTTON_LONG_PRESS_MS 2000
 
+// Remote presses buffered until the game loop reads them
+#define BUTTON_INJECT_QUEUE_SIZE 8
+
+// Input window grace stays active this long after the last remote press
+#define BUTTON_REMOTE_ACTIVE_MS 30000
+
+// ============================================================================
+// DIAGNOSTICS
+// ============================================================================
+
+// A subsystem update() running longer than this is recorded as a loop stall
+#define LOOP_STALL_THRESHOLD_MS 50
+
+// Interval between loop latency summaries on serial (0 = disabled)
+#define LOOP_REPORT_INTERVAL_MS 60000
+
 // ============================================================================
 // FEATURE FLAGS
 // ============================================================================
@@ -202,3 +319,34 @@
 #define DIFF_EXPERT_DURATION 150
 #define DIFF_EXPERT_MAX_LENGTH 31
 #define DIFF_EXPERT_WINDOW 1000
+
+// Sequence playback speed relative to original Simon timing (percent of Medium)
+// Reason: Applied at compile time to the length-band table in difficulty_modes.h
+#define DIFF_EASY_TIMING_PERCENT 125
+#define DIFF_MEDIUM_TIMING_PERCENT 100
+#define DIFF_HARD_TIMING_PERCENT 75
+#define DIFF_EXPERT_TIMING_PERCENT 55
+
+// Shortest silence between two playback tones
+// Reason: Below ~30ms two identical colors in a row blur into one long tone/flash
+#define PLAYBACK_MIN_GAP_MS 30
+
+// Adaptive mode (see game/adaptive_difficulty.h)
+// Pace runs from 0 (slowest playback) to ADAPTIVE_PACE_MAX (fastest)
+#define ADAPTIVE_PACE_MAX 1000
+#define ADAPTIVE_START_PACE 250           // ~Medium timing for short sequences
+#define ADAPTIVE_STEP_UP 20               // Pace gained per completed round
+#define ADAPTIVE_TARGET_SUCCESS_PERCENT 80 // Share of rounds the player should complete
+
+// Playback timing at pace 0 (Easy, short sequences) and at ADAPTIVE_PACE_MAX
+#define ADAPTIVE_TONE_SLOW_MS 625
+#define ADAPTIVE_TONE_FAST_MS DIFF_EXPERT_DURATION
+#define ADAPTIVE_GAP_SLOW_MS 125
+#define ADAPTIVE_GAP_FAST_MS 50
+
+// Input window = factor x typical press time + margin, clamped to the preset windows
+#define ADAPTIVE_WINDOW_FACTOR 3
+#define ADAPTIVE_WINDOW_MARGIN_MS 300
+
+// Logger declaration for the DEBUG_* / LOG_* macros above
+#include "system/logger.h"
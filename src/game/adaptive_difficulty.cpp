@@ -0,0 +1,94 @@
+/**
+ * Adaptive Difficulty Engine Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "adaptive_difficulty.h"
+
+// Pace lost per failed round at the usual error position
+// Reason: With up-step u and down-step d the staircase settles where
+// p * u = (1 - p) * d, i.e. at success rate p = d / (u + d)
+static const int16_t ADAPTIVE_STEP_DOWN =
+    ADAPTIVE_STEP_UP * ADAPTIVE_TARGET_SUCCESS_PERCENT / (100 - ADAPTIVE_TARGET_SUCCESS_PERCENT);
+
+static_assert(ADAPTIVE_GAP_FAST_MS >= PLAYBACK_MIN_GAP_MS,
+              "Adaptive playback gap must stay above PLAYBACK_MIN_GAP_MS");
+static_assert(ADAPTIVE_START_PACE <= ADAPTIVE_PACE_MAX, "Start pace out of range");
+
+// Moving averages use alpha = 1/8
+#define ADAPTIVE_AVG_SHIFT 3
+
+AdaptiveDifficulty::AdaptiveDifficulty() {
+    reset();
+}
+
+void AdaptiveDifficulty::reset() {
+    pace = ADAPTIVE_START_PACE;
+    pressAvg = 600 * 16;
+    severityAvg = 500;
+    successAvg = ADAPTIVE_TARGET_SUCCESS_PERCENT * 10;
+}
+
+void AdaptiveDifficulty::recordPress(uint32_t elapsedMs) {
+    if (elapsedMs > 0xFFFF) {
+        elapsedMs = 0xFFFF;
+    }
+
+    int32_t delta = (int32_t)(elapsedMs * 16) - (int32_t)pressAvg;
+    pressAvg += delta / (1 << ADAPTIVE_AVG_SHIFT);
+}
+
+void AdaptiveDifficulty::recordRound(bool success, uint16_t errorStep, uint16_t length) {
+    int32_t next = pace;
+
+    if (success) {
+        next += ADAPTIVE_STEP_UP;
+        successAvg += (1000 - successAvg) >> ADAPTIVE_AVG_SHIFT;
+    } else {
+        // Errors early in the sequence are more severe than slips near the end
+        uint16_t severity = length > 0 ? 1000 - (uint32_t)errorStep * 1000 / length : 1000;
+
+        // Scale by severity relative to its average so the expected down-step
+        // (and therefore the target success rate) is unchanged
+        // Reason: Clamped to 0.5x-2x so one outlier can't swing the pace
+        int32_t step = (int32_t)ADAPTIVE_STEP_DOWN * severity / severityAvg;
+        step = constrain(step, ADAPTIVE_STEP_DOWN / 2, ADAPTIVE_STEP_DOWN * 2);
+        next -= step;
+
+        severityAvg += ((int32_t)severity - (int32_t)severityAvg) / (1 << ADAPTIVE_AVG_SHIFT);
+        if (severityAvg == 0) {
+            severityAvg = 1;
+        }
+        successAvg -= successAvg >> ADAPTIVE_AVG_SHIFT;
+    }
+
+    pace = constrain(next, 0, ADAPTIVE_PACE_MAX);
+    LOG_D(LOG_TAG_GAME, "Adaptive pace %d (success %d%%)\n", pace, getSuccessPercent());
+}
+
+uint16_t AdaptiveDifficulty::getPace() const {
+    return pace;
+}
+
+uint16_t AdaptiveDifficulty::getToneDuration() const {
+    return interpolate(ADAPTIVE_TONE_SLOW_MS, ADAPTIVE_TONE_FAST_MS);
+}
+
+uint16_t AdaptiveDifficulty::getToneInterval() const {
+    return interpolate(ADAPTIVE_GAP_SLOW_MS, ADAPTIVE_GAP_FAST_MS);
+}
+
+uint16_t AdaptiveDifficulty::getTimingWindow() const {
+    uint32_t window = ADAPTIVE_WINDOW_FACTOR * (pressAvg / 16) + ADAPTIVE_WINDOW_MARGIN_MS;
+    return constrain(window, (uint32_t)DIFF_EXPERT_WINDOW, (uint32_t)DIFF_EASY_WINDOW);
+}
+
+uint8_t AdaptiveDifficulty::getSuccessPercent() const {
+    return (successAvg + 5) / 10;
+}
+
+uint16_t AdaptiveDifficulty::interpolate(uint16_t slow, uint16_t fast) const {
+    return slow - (int32_t)(slow - fast) * pace / ADAPTIVE_PACE_MAX;
+}
@@ -0,0 +1,103 @@
+/**
+ * Adaptive Difficulty Engine for Simon Says
+ *
+ * Tunes playback speed and the input window to the player while they play.
+ * A single pace value moves on a weighted up/down staircase: up by
+ * ADAPTIVE_STEP_UP after each completed round, down after each failed one by
+ * the step that makes ADAPTIVE_TARGET_SUCCESS_PERCENT the equilibrium.
+ * The down step is scaled by how early in the sequence the error happened
+ * (relative to the player's usual error position), and the input window
+ * follows a moving average of the player's press times.
+ *
+ * All state is a handful of integers updated in O(1) per press and round.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+
+class AdaptiveDifficulty {
+public:
+    /**
+     * Constructor
+     */
+    AdaptiveDifficulty();
+
+    /**
+     * Return to the starting pace and forget the player's history
+     */
+    void reset();
+
+    /**
+     * Record the time a press (or a timeout) took
+     *
+     * Args:
+     *     elapsedMs: Time since playback ended or the previous press
+     */
+    void recordPress(uint32_t elapsedMs);
+
+    /**
+     * Record the outcome of a round
+     *
+     * Args:
+     *     success: true if the whole sequence was repeated
+     *     errorStep: Index of the failed step (ignored on success)
+     *     length: Sequence length of the round
+     */
+    void recordRound(bool success, uint16_t errorStep, uint16_t length);
+
+    /**
+     * Get current pace
+     *
+     * Returns:
+     *     uint16_t: 0 (slowest) to ADAPTIVE_PACE_MAX (fastest)
+     */
+    uint16_t getPace() const;
+
+    /**
+     * Get tone duration for sequence playback
+     *
+     * Returns:
+     *     uint16_t: Tone duration (ms)
+     */
+    uint16_t getToneDuration() const;
+
+    /**
+     * Get silence between tones during playback
+     *
+     * Returns:
+     *     uint16_t: Inter-tone interval (ms)
+     */
+    uint16_t getToneInterval() const;
+
+    /**
+     * Get time allowed for each press
+     *
+     * Returns:
+     *     uint16_t: Input window (ms)
+     */
+    uint16_t getTimingWindow() const;
+
+    /**
+     * Get recent round success rate (exponential moving average)
+     *
+     * Returns:
+     *     uint8_t: Success rate in percent
+     */
+    uint8_t getSuccessPercent() const;
+
+private:
+    int16_t pace;
+    uint32_t pressAvg;      // Moving average press time (ms x 16)
+    uint16_t severityAvg;   // Moving average error severity (permille)
+    uint16_t successAvg;    // Moving average round success (permille)
+
+    /**
+     * Interpolate between the slow and fast end of a timing range
+     */
+    uint16_t interpolate(uint16_t slow, uint16_t fast) const;
+};
@@ -2,6 +2,8 @@
  * Difficulty Modes for Simon Says
  *
  * Defines different difficulty levels with varying speed, timing, and sequence length.
+ * All tables are constexpr: they are built by the compiler and live in flash,
+ * and the playback timing lookup is two array indexes with no float math.
  *
  * Author: Giorgio Gilestro (giorgio@gilest.ro)
  * Date: 2025-11-09
@@ -14,12 +16,16 @@
 
 /**
  * Difficulty level enumeration
+ *
+ * Note: Values are stored in history and scores, so new levels are appended
  */
 enum DifficultyLevel : uint8_t {
     EASY = 0,      // 25% slower than original Simon
     MEDIUM = 1,    // Original Simon timing (default)
     HARD = 2,      // 25% faster than original Simon
-    NUM_DIFFICULTIES = 3
+    ADAPTIVE = 3,  // Timing tuned to the player during play
+    EXPERT = 4,    // 45% faster than original Simon
+    NUM_DIFFICULTIES = 5
 };
 
 /**
@@ -33,6 +39,92 @@ struct DifficultySettings {
     uint16_t timingWindow;     // Time allowed for player input (ms)
 };
 
+/**
+ * Sequence playback timing for one length band
+ */
+struct PlaybackTiming {
+    uint16_t toneMs;           // How long each tone plays
+    uint16_t gapMs;            // Silence before the next tone
+};
+
+// Playback speeds up as the sequence grows (original Simon: at 6 and 14 steps)
+#define TIMING_NUM_BANDS 3
+
+constexpr uint16_t TIMING_BAND_START[TIMING_NUM_BANDS] = {1, 6, 14};
+
+// Medium (original Simon) timing for each band
+constexpr uint16_t TIMING_BASE_TONE_MS[TIMING_NUM_BANDS] = {500, 400, 320};
+constexpr uint16_t TIMING_BASE_GAP_MS[TIMING_NUM_BANDS] = {100, 80, 64};
+
+// Playback speed of each level, in DifficultyLevel order
+// (Adaptive timing comes from AdaptiveDifficulty; its row is only a fallback)
+constexpr uint8_t TIMING_PERCENT[NUM_DIFFICULTIES] = {
+    DIFF_EASY_TIMING_PERCENT,
+    DIFF_MEDIUM_TIMING_PERCENT,
+    DIFF_HARD_TIMING_PERCENT,
+    DIFF_MEDIUM_TIMING_PERCENT,
+    DIFF_EXPERT_TIMING_PERCENT
+};
+
+/**
+ * Compute the playback timing of one level and band (compile time)
+ *
+ * Args:
+ *     level: Difficulty level
+ *     band: Length band (0 to TIMING_NUM_BANDS - 1)
+ *
+ * Returns:
+ *     PlaybackTiming: Base band timing scaled by the level's TIMING_PERCENT
+ */
+constexpr PlaybackTiming scaledTiming(uint8_t level, uint8_t band) {
+    return PlaybackTiming{
+        (uint16_t)((uint32_t)TIMING_BASE_TONE_MS[band] * TIMING_PERCENT[level] / 100),
+        (uint16_t)((uint32_t)TIMING_BASE_GAP_MS[band] * TIMING_PERCENT[level] / 100)
+    };
+}
+
+/**
+ * Find the length band of a sequence length
+ *
+ * Args:
+ *     length: Sequence length
+ *
+ * Returns:
+ *     uint8_t: Band index
+ */
+constexpr uint8_t timingBand(uint16_t length) {
+    return length >= TIMING_BAND_START[2] ? 2 : (length >= TIMING_BAND_START[1] ? 1 : 0);
+}
+
+// Compile-time checks of the timing table (recursive: C++11 constexpr has no loops)
+constexpr bool timingSpeedsUp(uint8_t level, uint8_t band) {
+    return level >= NUM_DIFFICULTIES ? true
+         : band + 1 >= TIMING_NUM_BANDS ? timingSpeedsUp(level + 1, 0)
+         : scaledTiming(level, band + 1).toneMs <= scaledTiming(level, band).toneMs &&
+           scaledTiming(level, band + 1).gapMs <= scaledTiming(level, band).gapMs &&
+           timingSpeedsUp(level, band + 1);
+}
+
+constexpr bool timingGapsAudible(uint8_t level, uint8_t band) {
+    return level >= NUM_DIFFICULTIES ? true
+         : band >= TIMING_NUM_BANDS ? timingGapsAudible(level + 1, 0)
+         : scaledTiming(level, band).gapMs >= PLAYBACK_MIN_GAP_MS &&
+           timingGapsAudible(level, band + 1);
+}
+
+static_assert(timingSpeedsUp(0, 0),
+              "Playback must get faster (or stay equal) as the sequence grows");
+static_assert(timingGapsAudible(0, 0),
+              "Every playback gap must be at least PLAYBACK_MIN_GAP_MS");
+static_assert(TIMING_PERCENT[EASY] > TIMING_PERCENT[MEDIUM] &&
+              TIMING_PERCENT[MEDIUM] > TIMING_PERCENT[HARD] &&
+              TIMING_PERCENT[HARD] > TIMING_PERCENT[EXPERT],
+              "Fixed levels must speed up from Easy to Expert");
+static_assert(DIFF_EASY_WINDOW >= DIFF_MEDIUM_WINDOW &&
+              DIFF_MEDIUM_WINDOW >= DIFF_HARD_WINDOW &&
+              DIFF_HARD_WINDOW >= DIFF_EXPERT_WINDOW,
+              "Input windows must shrink from Easy to Expert");
+
 /**
  * Get difficulty settings for a specific level
  *
@@ -43,10 +135,13 @@ struct DifficultySettings {
  *     DifficultySettings: Settings for the requested difficulty
  */
 inline const DifficultySettings& getDifficultySettings(DifficultyLevel level) {
-    static const DifficultySettings difficulties[NUM_DIFFICULTIES] = {
+    static constexpr DifficultySettings difficulties[NUM_DIFFICULTIES] = {
         {"Easy", DIFF_EASY_SPEED, DIFF_EASY_DURATION, DIFF_EASY_MAX_LENGTH, DIFF_EASY_WINDOW},
         {"Medium", DIFF_MEDIUM_SPEED, DIFF_MEDIUM_DURATION, DIFF_MEDIUM_MAX_LENGTH, DIFF_MEDIUM_WINDOW},
-        {"Hard", DIFF_HARD_SPEED, DIFF_HARD_DURATION, DIFF_HARD_MAX_LENGTH, DIFF_HARD_WINDOW}
+        {"Hard", DIFF_HARD_SPEED, DIFF_HARD_DURATION, DIFF_HARD_MAX_LENGTH, DIFF_HARD_WINDOW},
+        // Adaptive starts from Medium; AdaptiveDifficulty overrides the timing each round
+        {"Adaptive", DIFF_MEDIUM_SPEED, DIFF_MEDIUM_DURATION, DIFF_MEDIUM_MAX_LENGTH, DIFF_MEDIUM_WINDOW},
+        {"Expert", DIFF_EXPERT_SPEED, DIFF_EXPERT_DURATION, DIFF_EXPERT_MAX_LENGTH, DIFF_EXPERT_WINDOW}
     };
 
     if (level < NUM_DIFFICULTIES) {
@@ -55,6 +150,29 @@ inline const DifficultySettings& getDifficultySettings(DifficultyLevel level) {
     return difficulties[DEFAULT_DIFFICULTY];
 }
 
+/**
+ * Get sequence playback timing
+ *
+ * Args:
+ *     level: Difficulty level enum
+ *     length: Current sequence length
+ *
+ * Returns:
+ *     const PlaybackTiming&: Tone and gap duration for this level and length
+ */
+inline const PlaybackTiming& getPlaybackTiming(DifficultyLevel level, uint16_t length) {
+    #define TIMING_ROW(level) {scaledTiming(level, 0), scaledTiming(level, 1), scaledTiming(level, 2)}
+    static constexpr PlaybackTiming timings[NUM_DIFFICULTIES][TIMING_NUM_BANDS] = {
+        TIMING_ROW(EASY), TIMING_ROW(MEDIUM), TIMING_ROW(HARD), TIMING_ROW(ADAPTIVE), TIMING_ROW(EXPERT)
+    };
+    #undef TIMING_ROW
+
+    if (level >= NUM_DIFFICULTIES) {
+        level = (DifficultyLevel)DEFAULT_DIFFICULTY;
+    }
+    return timings[level][timingBand(length)];
+}
+
 /**
  * Get difficulty name as string
  *
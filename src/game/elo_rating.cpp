@@ -0,0 +1,34 @@
+/**
+ * Elo Ratings Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "elo_rating.h"
+
+float EloRating::expected(float rating, float opponent) {
+    return 1.0f / (1.0f + powf(10.0f, (opponent - rating) / 400.0f));
+}
+
+void EloRating::update(float* ratings, const uint16_t* scores, uint8_t count) {
+    if (count < 2 || count > RATING_MAX_PLAYERS) {
+        return;
+    }
+
+    float deltas[RATING_MAX_PLAYERS] = {0};
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = i + 1; j < count; j++) {
+            float result = scores[i] > scores[j] ? 1.0f : (scores[i] < scores[j] ? 0.0f : 0.5f);
+            // Zero-sum: whatever i gains from this pairing, j loses
+            float change = result - expected(ratings[i], ratings[j]);
+            deltas[i] += change;
+            deltas[j] -= change;
+        }
+    }
+
+    float k = RATING_K_FACTOR / (count - 1);
+    for (uint8_t i = 0; i < count; i++) {
+        ratings[i] += k * deltas[i];
+    }
+}
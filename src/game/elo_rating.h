@@ -0,0 +1,46 @@
+/**
+ * Elo Ratings for Pass-and-Play Games
+ *
+ * A pass-and-play game between n players is scored as n(n-1)/2 pairwise
+ * results: whoever reached the higher score beats the other, equal scores
+ * draw. Each player's rating moves by K/(n-1) times the sum over opponents
+ * of (result - expected result), so a four-player game moves a rating no
+ * further than a single head-to-head would.
+ *
+ * Expected result against an opponent:
+ *     E = 1 / (1 + 10^((opponent - rating) / 400))
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+
+class EloRating {
+public:
+    /**
+     * Expected result of a player against an opponent
+     *
+     * Args:
+     *     rating: Player rating
+     *     opponent: Opponent rating
+     *
+     * Returns:
+     *     float: 0 (certain loss) to 1 (certain win)
+     */
+    static float expected(float rating, float opponent);
+
+    /**
+     * Update the ratings of one game's players from their scores
+     * (all deltas come from the ratings before the game)
+     *
+     * Args:
+     *     ratings: Ratings, updated in place
+     *     scores: Final score of each player
+     *     count: Number of players (2 to RATING_MAX_PLAYERS; others are ignored)
+     */
+    static void update(float* ratings, const uint16_t* scores, uint8_t count);
+};
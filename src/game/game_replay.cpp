@@ -0,0 +1,129 @@
+/**
+ * Game Replay Recorder Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "game_replay.h"
+#include "packed_sequence.h"
+#include "sequence_rng.h"
+
+GameReplay::GameReplay() :
+    recording(false) {
+
+    memset(&header, 0, sizeof(header));
+}
+
+void GameReplay::begin(uint32_t seed, DifficultyLevel difficulty) {
+    memset(&header, 0, sizeof(header));
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.difficulty = difficulty;
+    header.seed = seed;
+    recording = true;
+}
+
+void GameReplay::recordRound(uint16_t length) {
+    addEvent(REPLAY_ROUND, 0, length);
+}
+
+void GameReplay::recordPress(Color color, uint32_t reactionMs) {
+    addEvent(REPLAY_PRESS, color, reactionMs);
+}
+
+void GameReplay::recordTimeout(uint32_t waitedMs) {
+    addEvent(REPLAY_TIMEOUT, 0, waitedMs);
+}
+
+void GameReplay::finish(uint16_t score, uint32_t durationMs, uint32_t timestamp) {
+    if (!recording) {
+        return;
+    }
+
+    header.score = score;
+    header.durationMs = durationMs;
+    header.timestamp = timestamp;
+    recording = false;
+
+    // Truncated replays can't be fully re-simulated
+    if (!(header.flags & REPLAY_FLAG_TRUNCATED) && simulateScore() != score) {
+        header.flags |= REPLAY_FLAG_MISMATCH;
+        DEBUG_PRINTF("[GAME] WARNING: Replay simulates to %d, game reported %d\n",
+                    simulateScore(), score);
+    }
+}
+
+uint16_t GameReplay::simulateScore() const {
+    SequenceRng rng(header.seed);
+    PackedSequence sequence;
+    uint16_t roundLength = 0;
+    uint16_t step = 0;
+    uint16_t score = 0;
+
+    for (uint16_t i = 0; i < header.numEvents; i++) {
+        const ReplayEvent& e = events[i];
+
+        switch (e.type) {
+            case REPLAY_ROUND:
+                roundLength = e.value;
+                // Pass-and-play turns restart at length 1 on the same stream,
+                // so only generate colors not seen yet
+                while (sequence.length() < roundLength) {
+                    if (!sequence.append(rng.nextColor())) {
+                        return score;
+                    }
+                }
+                step = 0;
+                break;
+
+            case REPLAY_PRESS:
+                if (!sequence.matches(step, (Color)e.color)) {
+                    return score;
+                }
+                step++;
+                if (step == roundLength) {
+                    score++;
+                }
+                break;
+
+            case REPLAY_TIMEOUT:
+            default:
+                return score;
+        }
+    }
+
+    return score;
+}
+
+bool GameReplay::isRecording() const {
+    return recording;
+}
+
+ReplayHeader& GameReplay::getHeader() {
+    return header;
+}
+
+const ReplayHeader& GameReplay::getHeader() const {
+    return header;
+}
+
+const ReplayEvent* GameReplay::getEvents() const {
+    return events;
+}
+
+void GameReplay::addEvent(ReplayEventType type, uint8_t color, uint32_t value) {
+    if (!recording) {
+        return;
+    }
+
+    if (header.numEvents >= REPLAY_MAX_EVENTS) {
+        header.flags |= REPLAY_FLAG_TRUNCATED;
+        return;
+    }
+
+    ReplayEvent& e = events[header.numEvents++];
+    e.type = type;
+    e.color = color;
+    e.value = value > 0xFFFF ? 0xFFFF : value;
+}
@@ -0,0 +1,158 @@
+/**
+ * Game Replay Recorder for Simon Says
+ *
+ * Records one game (or one pass-and-play turn) as a compact binary replay:
+ * a fixed header holding the sequence seed, followed by 4-byte events for
+ * every round shown and every player press with its reaction time. The
+ * shown colors are not stored; they are regenerated from the seed.
+ *
+ * Binary layout (little-endian):
+ *     ReplayHeader (28 bytes), then header.numEvents x ReplayEvent (4 bytes)
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+#include "../hardware/gpio_config.h"
+#include "difficulty_modes.h"
+
+#define REPLAY_MAGIC 0x4C505253  // "SRPL"
+#define REPLAY_VERSION 1
+
+// Header flags
+#define REPLAY_FLAG_TRUNCATED 0x01  // Event buffer filled before the game ended
+#define REPLAY_FLAG_MISMATCH  0x02  // Re-simulated score differs from recorded score
+
+/**
+ * Replay event types
+ */
+enum ReplayEventType : uint8_t {
+    REPLAY_ROUND = 0,    // Sequence shown; value = round length
+    REPLAY_PRESS,        // Player press; value = ms since the prompt or previous press
+    REPLAY_TIMEOUT       // Input window expired; value = ms since the prompt or previous press
+};
+
+/**
+ * Replay file header
+ */
+struct __attribute__((packed)) ReplayHeader {
+    uint32_t magic;       // REPLAY_MAGIC
+    uint8_t version;      // REPLAY_VERSION
+    uint8_t difficulty;   // DifficultyLevel
+    uint8_t flags;        // REPLAY_FLAG_*
+    uint8_t reserved;
+    uint32_t id;          // Replay ID (assigned by the store)
+    uint32_t seed;        // Sequence seed
+    uint32_t timestamp;   // Unix time the game ended (0 if clock not set)
+    uint32_t durationMs;  // Game duration
+    uint16_t score;       // Final score
+    uint16_t numEvents;   // Number of events that follow
+};
+
+/**
+ * Single replay event
+ */
+struct __attribute__((packed)) ReplayEvent {
+    uint8_t type;         // ReplayEventType
+    uint8_t color;        // Color for REPLAY_PRESS, otherwise 0
+    uint16_t value;       // Round length for REPLAY_ROUND, otherwise ms (saturates at 65535)
+};
+
+class GameReplay {
+public:
+    /**
+     * Constructor
+     */
+    GameReplay();
+
+    /**
+     * Start recording a new game
+     *
+     * Args:
+     *     seed: Sequence seed of the game
+     *     difficulty: Difficulty level
+     */
+    void begin(uint32_t seed, DifficultyLevel difficulty);
+
+    /**
+     * Record a round being shown
+     *
+     * Args:
+     *     length: Length of the sequence shown
+     */
+    void recordRound(uint16_t length);
+
+    /**
+     * Record a player press
+     *
+     * Args:
+     *     color: Color pressed
+     *     reactionMs: Time since the prompt (end of playback) or previous press
+     */
+    void recordPress(Color color, uint32_t reactionMs);
+
+    /**
+     * Record an input timeout
+     *
+     * Args:
+     *     waitedMs: Time since the prompt or previous press
+     */
+    void recordTimeout(uint32_t waitedMs);
+
+    /**
+     * Finish recording and verify the replay against the game rules
+     *
+     * Args:
+     *     score: Final score reported by the game
+     *     durationMs: Game duration
+     *     timestamp: Unix time the game ended
+     */
+    void finish(uint16_t score, uint32_t durationMs, uint32_t timestamp);
+
+    /**
+     * Re-run the game rules over the recorded events
+     *
+     * Regenerates the sequence from the seed and replays every press, so a
+     * replay can be checked without trusting the recorded score.
+     *
+     * Returns:
+     *     uint16_t: Score the recorded presses actually earn
+     */
+    uint16_t simulateScore() const;
+
+    /**
+     * Check whether a game is being recorded
+     *
+     * Returns:
+     *     bool: true between begin() and finish()
+     */
+    bool isRecording() const;
+
+    /**
+     * Get header (id is set by the replay store when saved)
+     *
+     * Returns:
+     *     ReplayHeader&: Replay header
+     */
+    ReplayHeader& getHeader();
+    const ReplayHeader& getHeader() const;
+
+    /**
+     * Get recorded events
+     *
+     * Returns:
+     *     const ReplayEvent*: Event array (getHeader().numEvents entries)
+     */
+    const ReplayEvent* getEvents() const;
+
+private:
+    ReplayHeader header;
+    ReplayEvent events[REPLAY_MAX_EVENTS];
+    bool recording;
+
+    void addEvent(ReplayEventType type, uint8_t color, uint32_t value);
+};
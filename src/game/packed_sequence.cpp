@@ -0,0 +1,70 @@
+/**
+ * Packed Color Sequence Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "packed_sequence.h"
+
+PackedSequence::PackedSequence() {
+    clear();
+}
+
+void PackedSequence::clear() {
+    memset(words, 0, sizeof(words));
+    count = 0;
+}
+
+bool PackedSequence::append(Color color) {
+    if (count >= CAPACITY || color > YELLOW) {
+        return false;
+    }
+
+    // Reason: Words are zeroed by clear(), so OR-ing the new step in is enough
+    words[count / STEPS_PER_WORD] |= (uint32_t)color << ((count % STEPS_PER_WORD) * 2);
+    count++;
+    return true;
+}
+
+bool PackedSequence::matchesPrefix(const PackedSequence& other, uint16_t steps) const {
+    if (steps > count || steps > other.count) {
+        return false;
+    }
+
+    uint16_t fullWords = steps / STEPS_PER_WORD;
+    for (uint16_t i = 0; i < fullWords; i++) {
+        if (words[i] != other.words[i]) {
+            return false;
+        }
+    }
+
+    // Compare the remaining steps of the last, partially used word
+    uint16_t rest = steps % STEPS_PER_WORD;
+    if (rest == 0) {
+        return true;
+    }
+    uint32_t mask = (1UL << (rest * 2)) - 1;
+    return (words[fullWords] & mask) == (other.words[fullWords] & mask);
+}
+
+size_t PackedSequence::toHex(char* out, size_t outSize, uint16_t steps) const {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    if (outSize == 0) {
+        return 0;
+    }
+    if (steps > count) {
+        steps = count;
+    }
+
+    uint16_t numBytes = (steps + 3) / 4;
+    size_t pos = 0;
+    for (uint16_t b = 0; b < numBytes && pos + 2 < outSize; b++) {
+        uint8_t byte = (words[b / 4] >> ((b % 4) * 8)) & 0xFF;
+        out[pos++] = HEX_DIGITS[byte >> 4];
+        out[pos++] = HEX_DIGITS[byte & 0x0F];
+    }
+    out[pos] = '\0';
+    return pos;
+}
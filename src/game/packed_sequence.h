@@ -0,0 +1,116 @@
+/**
+ * Packed Color Sequence for Simon Says
+ *
+ * Stores a sequence of colors at 2 bits per step (16 steps per 32-bit word),
+ * so long endurance sequences fit in a quarter of the RAM of a Color array.
+ * Step i lives in word i / 16 at bit offset (i % 16) * 2.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+#include "../hardware/gpio_config.h"
+
+class PackedSequence {
+public:
+    static const uint16_t STEPS_PER_WORD = 16;
+    static const uint16_t CAPACITY = MAX_SEQUENCE_LENGTH;
+    static const uint16_t NUM_WORDS = (CAPACITY + STEPS_PER_WORD - 1) / STEPS_PER_WORD;
+
+    // Buffer size needed by toHex() (one hex digit per two steps, plus NUL)
+    static const uint16_t HEX_BUFFER_SIZE = NUM_WORDS * 8 + 1;
+
+    /**
+     * Constructor (empty sequence)
+     */
+    PackedSequence();
+
+    /**
+     * Remove all steps
+     */
+    void clear();
+
+    /**
+     * Append one color
+     *
+     * Args:
+     *     color: Color to append (RED..YELLOW)
+     *
+     * Returns:
+     *     bool: false if the sequence is full or color is NONE
+     */
+    bool append(Color color);
+
+    /**
+     * Get color at a step
+     *
+     * Args:
+     *     index: Step index (must be < length())
+     *
+     * Returns:
+     *     Color: Color at that step
+     */
+    inline Color get(uint16_t index) const {
+        return (Color)((words[index / STEPS_PER_WORD] >> ((index % STEPS_PER_WORD) * 2)) & 0x3);
+    }
+
+    /**
+     * Check a single step against a color without unpacking the sequence
+     *
+     * Args:
+     *     index: Step index
+     *     color: Color to compare
+     *
+     * Returns:
+     *     bool: true if index is in range and the step matches
+     */
+    inline bool matches(uint16_t index, Color color) const {
+        return index < count && color <= YELLOW && get(index) == color;
+    }
+
+    /**
+     * Compare the first steps of two sequences a word at a time
+     *
+     * Args:
+     *     other: Sequence to compare against
+     *     steps: Number of leading steps to compare
+     *
+     * Returns:
+     *     bool: true if both sequences hold at least `steps` steps and they are equal
+     */
+    bool matchesPrefix(const PackedSequence& other, uint16_t steps) const;
+
+    /**
+     * Get number of steps
+     *
+     * Returns:
+     *     uint16_t: Sequence length
+     */
+    inline uint16_t length() const {
+        return count;
+    }
+
+    /**
+     * Encode the first steps as hex for the web client
+     *
+     * Each byte holds four steps (first step in the low bits) and is written
+     * as two hex digits, so the client decodes step i from byte i / 4.
+     *
+     * Args:
+     *     out: Output buffer (HEX_BUFFER_SIZE bytes is always enough)
+     *     outSize: Size of output buffer
+     *     steps: Number of steps to encode (clamped to length())
+     *
+     * Returns:
+     *     size_t: Number of hex characters written (excluding NUL)
+     */
+    size_t toHex(char* out, size_t outSize, uint16_t steps) const;
+
+private:
+    uint32_t words[NUM_WORDS];
+    uint16_t count;
+};
@@ -0,0 +1,104 @@
+/**
+ * Replay Driver Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "replay_driver.h"
+
+// Clock step while waiting for the input window to run out
+#define DRIVER_POLL_MS 10
+
+// Updates allowed to reach the next prompt (a round takes three:
+// INPUT_CORRECT, SHOWING_SEQUENCE, WAITING_INPUT)
+#define DRIVER_MAX_UPDATES 16
+
+ReplayDriver::ReplayDriver(SimonGame* game, ButtonHandler* buttons) :
+    game(game),
+    buttons(buttons),
+    score(0),
+    eventsPlayed(0) {
+}
+
+bool ReplayDriver::play(const ReplayHeader& header, const ReplayEvent* events) {
+    score = 0;
+    eventsPlayed = 0;
+
+    if (header.magic != REPLAY_MAGIC || header.difficulty >= NUM_DIFFICULTIES) {
+        return false;
+    }
+
+    game->startGame((DifficultyLevel)header.difficulty, header.seed);
+
+    for (uint16_t i = 0; i < header.numEvents; i++) {
+        const ReplayEvent& e = events[i];
+
+        // Every event answers a prompt; a game that stopped asking has diverged
+        if (!waitForInput()) {
+            break;
+        }
+
+        switch (e.type) {
+            case REPLAY_ROUND:
+                // The game shows its own rounds; the event only marks them
+                break;
+
+            case REPLAY_PRESS:
+                // Reason: Press times are relative to the prompt or the
+                // previous press, which is when the game last reset its window
+                delay(e.value);
+                buttons->injectPress((Color)e.color, millis(), 0);
+                game->update();
+                break;
+
+            case REPLAY_TIMEOUT:
+            default:
+                while (game->getState() == WAITING_INPUT) {
+                    delay(DRIVER_POLL_MS);
+                    game->update();
+                }
+                break;
+        }
+        eventsPlayed++;
+    }
+
+    settle();
+    score = game->getScore();
+
+    if (score != header.score) {
+        DEBUG_PRINTF("[GAME] Replay %u played to %d, recorded %d (%d/%d events)\n",
+                    header.id, score, header.score, eventsPlayed, header.numEvents);
+        return false;
+    }
+    return eventsPlayed == header.numEvents;
+}
+
+uint16_t ReplayDriver::getScore() const {
+    return score;
+}
+
+uint16_t ReplayDriver::getEventsPlayed() const {
+    return eventsPlayed;
+}
+
+bool ReplayDriver::waitForInput() {
+    for (uint8_t i = 0; i < DRIVER_MAX_UPDATES; i++) {
+        GameState state = game->getState();
+        if (state == WAITING_INPUT) {
+            return true;
+        }
+        if (!game->isActive() || state == HIGH_SCORE) {
+            return false;
+        }
+        game->update();
+    }
+    return false;
+}
+
+void ReplayDriver::settle() {
+    // Let a final miss play out to game over
+    for (uint8_t i = 0; i < DRIVER_MAX_UPDATES && game->getState() == INPUT_WRONG; i++) {
+        game->update();
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * Replay Driver for ESP32 Simon Says
+ *
+ * Feeds a recorded replay back through SimonGame: starts a game with the
+ * replay's seed and difficulty, then presses the recorded buttons (as
+ * remote presses) with the recorded timing and lets recorded timeouts run
+ * out. The score the game reaches can be compared with the recorded one.
+ *
+ * Runs the game synchronously and waits with delay(), so on the host
+ * (where delay() only advances a virtual clock) a whole game replays
+ * instantly. Used by the native tests; nothing on the device calls it.
+ *
+ * Adaptive games start from a reset pace, so a replay of anything but a
+ * player's first adaptive game may see a shorter input window than the
+ * original and time out where it did not.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+#include "../hardware/button_handler.h"
+#include "game_replay.h"
+#include "simon_game.h"
+
+class ReplayDriver {
+public:
+    /**
+     * Constructor
+     *
+     * Args:
+     *     game: Game to drive (begin() already called)
+     *     buttons: The game's button handler (presses are injected here)
+     */
+    ReplayDriver(SimonGame* game, ButtonHandler* buttons);
+
+    /**
+     * Play a replay through the game (blocking)
+     *
+     * Args:
+     *     header: Replay header
+     *     events: header.numEvents events
+     *
+     * Returns:
+     *     bool: true if the game ended with the recorded score
+     */
+    bool play(const ReplayHeader& header, const ReplayEvent* events);
+
+    /**
+     * Get the score the game reached in the last play()
+     *
+     * Returns:
+     *     uint16_t: Score
+     */
+    uint16_t getScore() const;
+
+    /**
+     * Get the number of events fed before the game stopped asking for input
+     *
+     * Returns:
+     *     uint16_t: Events played (header.numEvents if the replay ran to its end)
+     */
+    uint16_t getEventsPlayed() const;
+
+private:
+    SimonGame* game;
+    ButtonHandler* buttons;
+    uint16_t score;
+    uint16_t eventsPlayed;
+
+    bool waitForInput();
+    void settle();
+};
@@ -0,0 +1,60 @@
+/**
+ * Deterministic Sequence Generator Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "sequence_rng.h"
+
+SequenceRng::SequenceRng(uint32_t seed) {
+    this->seed(seed);
+}
+
+void SequenceRng::seed(uint32_t seed) {
+    currentSeed = seed;
+
+    // Expand the 32-bit seed into 128 bits of state with splitmix32
+    // Reason: xoshiro must not start from an all-zero state, and nearby
+    // seeds (e.g. consecutive days) should still give unrelated streams
+    uint32_t z = seed;
+    for (uint8_t i = 0; i < 4; i++) {
+        z += 0x9E3779B9;
+        uint32_t x = z;
+        x = (x ^ (x >> 16)) * 0x85EBCA6B;
+        x = (x ^ (x >> 13)) * 0xC2B2AE35;
+        state[i] = x ^ (x >> 16);
+    }
+}
+
+uint32_t SequenceRng::getSeed() const {
+    return currentSeed;
+}
+
+uint32_t SequenceRng::next() {
+    // xoshiro128** 1.1
+    uint32_t result = rotl(state[1] * 5, 7) * 9;
+    uint32_t t = state[1] << 9;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 11);
+
+    return result;
+}
+
+Color SequenceRng::nextColor() {
+    // Top bits are the strongest output bits of xoshiro128**
+    return (Color)(next() >> 30);
+}
+
+uint32_t SequenceRng::randomSeed() {
+    uint32_t seed;
+    do {
+        seed = esp_random();
+    } while (seed == 0);
+    return seed;
+}
@@ -0,0 +1,75 @@
+/**
+ * Deterministic Sequence Generator for Simon Says
+ *
+ * xoshiro128** seeded from a single 32-bit game seed via splitmix32. The
+ * same seed always yields the same color sequence, on the device, in the
+ * browser (see SequenceRng in data/app.js) and on the host, so games can be
+ * reproduced and verified and a daily challenge only needs to share its seed.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../hardware/gpio_config.h"
+
+class SequenceRng {
+public:
+    /**
+     * Constructor
+     *
+     * Args:
+     *     seed: Initial seed
+     */
+    explicit SequenceRng(uint32_t seed = 1);
+
+    /**
+     * Reset the generator to the start of a seed's stream
+     *
+     * Args:
+     *     seed: Game seed
+     */
+    void seed(uint32_t seed);
+
+    /**
+     * Get the seed the generator was last reset with
+     *
+     * Returns:
+     *     uint32_t: Current seed
+     */
+    uint32_t getSeed() const;
+
+    /**
+     * Next raw 32-bit output
+     *
+     * Returns:
+     *     uint32_t: Pseudo-random value
+     */
+    uint32_t next();
+
+    /**
+     * Next sequence color
+     *
+     * Returns:
+     *     Color: RED..YELLOW (taken from the top two output bits)
+     */
+    Color nextColor();
+
+    /**
+     * Generate a fresh non-zero seed from the hardware RNG
+     *
+     * Returns:
+     *     uint32_t: Random seed
+     */
+    static uint32_t randomSeed();
+
+private:
+    uint32_t state[4];
+    uint32_t currentSeed;
+
+    static inline uint32_t rotl(uint32_t x, uint8_t k) {
+        return (x << k) | (x >> (32 - k));
+    }
+};
@@ -8,6 +8,8 @@
 #include "simon_game.h"
 #include "../web/data_storage.h"
 #include "../web/websocket_handler.h"
+#include "../web/replay_store.h"
+#include "../web/reaction_analytics.h"
 
 SimonGame::SimonGame(LEDController* leds, ButtonHandler* buttons, AudioController* audio, DataStorage* stor) :
     led(leds),
@@ -15,6 +17,8 @@ SimonGame::SimonGame(LEDController* leds, ButtonHandler* buttons, AudioControlle
     audio(audio),
     storage(stor),
     wsHandler(nullptr),
+    replayStore(nullptr),
+    analytics(nullptr),
     state(IDLE),
     currentDifficulty(EASY),
     gameMode(SINGLE_PLAYER),
@@ -30,11 +34,6 @@ SimonGame::SimonGame(LEDController* leds, ButtonHandler* buttons, AudioControlle
     currentInputLED(NONE),
     inputLEDEndTime(0) {
 
-    // Initialize sequence array
-    for (uint8_t i = 0; i < MAX_SEQUENCE_LENGTH; i++) {
-        sequence[i] = NONE;
-    }
-
     // Initialize high scores
     for (uint8_t i = 0; i < NUM_DIFFICULTIES; i++) {
         highScores[i] = 0;
@@ -58,10 +57,6 @@ void SimonGame::begin() {
     // Load high scores from storage
     loadHighScores();
 
-    // Seed random number generator
-    // Reason: Use analog read from floating pin for randomness
-    randomSeed(analogRead(0));
-
     // Start in idle state
     setState(IDLE);
 
@@ -109,7 +104,7 @@ void SimonGame::update() {
     }
 }
 
-void SimonGame::startGame(DifficultyLevel difficulty) {
+void SimonGame::startGame(DifficultyLevel difficulty, uint32_t seed) {
     DEBUG_PRINTLN("[GAME] Starting new game!");
 
     // Play fun game start melody
@@ -129,10 +124,13 @@ void SimonGame::startGame(DifficultyLevel difficulty) {
     currentScore = 0;
     gameStartTime = millis();
 
-    // Clear sequence
-    for (uint8_t i = 0; i < MAX_SEQUENCE_LENGTH; i++) {
-        sequence[i] = NONE;
-    }
+    // Clear sequence and restart the generator
+    // Reason: Every color is drawn from the seeded stream, so the seed alone reproduces the game
+    sequence.clear();
+    rng.seed(seed != 0 ? seed : SequenceRng::randomSeed());
+    DEBUG_PRINTF("[GAME] Sequence seed: %u\n", rng.getSeed());
+    replay.begin(rng.getSeed(), currentDifficulty);
+    syncAdaptivePlayer();
 
     // Start first round
     extendSequence();
@@ -152,14 +150,22 @@ GameState SimonGame::getState() const {
     return state;
 }
 
-uint8_t SimonGame::getScore() const {
+uint16_t SimonGame::getScore() const {
     return currentScore;
 }
 
-uint8_t SimonGame::getHighScore() const {
+uint16_t SimonGame::getHighScore() const {
     return highScores[currentDifficulty];
 }
 
+uint32_t SimonGame::getSeed() const {
+    return rng.getSeed();
+}
+
+const AdaptiveDifficulty& SimonGame::getAdaptive() const {
+    return adaptive;
+}
+
 DifficultyLevel SimonGame::getDifficulty() const {
     return currentDifficulty;
 }
@@ -181,13 +187,22 @@ void SimonGame::setWebSocketHandler(WebSocketHandler* handler) {
     DEBUG_PRINTLN("[GAME] WebSocket handler set");
 }
 
+void SimonGame::setReplayStore(ReplayStore* store) {
+    replayStore = store;
+}
+
+void SimonGame::setAnalytics(ReactionAnalytics* analyticsInstance) {
+    analytics = analyticsInstance;
+}
+
 void SimonGame::setCurrentPlayer(const String& playerId) {
     currentPlayerId = playerId;
     DEBUG_PRINTF("[GAME] Current player set to: %s\n", playerId.c_str());
     sendWebSocketUpdate();
 }
 
-void SimonGame::startMultiplayerGame(GameMode mode, const String* playerIds, uint8_t numPlayers_, DifficultyLevel difficulty) {
+void SimonGame::startMultiplayerGame(GameMode mode, const String* playerIds, uint8_t numPlayers_,
+                                     DifficultyLevel difficulty, uint32_t seed) {
     DEBUG_PRINTF("[GAME] Starting multiplayer game! Mode: %d, Players: %d\n", mode, numPlayers_);
 
     if (numPlayers_ < 2 || numPlayers_ > 4) {
@@ -208,14 +223,8 @@ void SimonGame::startMultiplayerGame(GameMode mode, const String* playerIds, uin
         players[i].hasPlayed = false;
 
         // Load player name from storage
-        if (storage) {
-            Player player;
-            if (storage->getPlayer(playerIds[i], player)) {
-                players[i].playerName = player.name;
-            } else {
-                players[i].playerName = "Player " + String(i + 1);
-            }
-        } else {
+        PlayerHandle handle = storage ? storage->findPlayer(playerIds[i].c_str()) : INVALID_PLAYER_HANDLE;
+        if (!storage || !storage->getPlayerName(handle, players[i].playerName)) {
             players[i].playerName = "Player " + String(i + 1);
         }
 
@@ -237,10 +246,13 @@ void SimonGame::startMultiplayerGame(GameMode mode, const String* playerIds, uin
     currentScore = 0;
     gameStartTime = millis();
 
-    // Clear sequence
-    for (uint8_t i = 0; i < MAX_SEQUENCE_LENGTH; i++) {
-        sequence[i] = NONE;
-    }
+    // Clear sequence and restart the generator
+    // Reason: Every color is drawn from the seeded stream, so the seed alone reproduces the game
+    sequence.clear();
+    rng.seed(seed != 0 ? seed : SequenceRng::randomSeed());
+    DEBUG_PRINTF("[GAME] Sequence seed: %u\n", rng.getSeed());
+    replay.begin(rng.getSeed(), currentDifficulty);
+    syncAdaptivePlayer();
 
     // Start first round
     extendSequence();
@@ -293,16 +305,40 @@ void SimonGame::handleShowingSequence() {
 void SimonGame::handleWaitingInput() {
     // Check for timeout (time since LAST input, not since state started)
     // Reason: Each button press should have its own timeout window
-    if ((millis() - lastInputTime) > settings.timingWindow) {
-        DEBUG_PRINTLN("[GAME] Input timeout!");
-        setState(INPUT_WRONG);
+    // Remote presses arrive late by their network delay, so wait that much longer
+    // before giving up; the press time itself is still checked against the window below
+    if ((millis() - lastInputTime) > (uint32_t)settings.timingWindow + btn->getInputGrace()) {
+        handleInputTimeout(millis() - lastInputTime);
         return;
     }
 
     // Check for button press
     Color pressed = btn->getJustPressed();
     if (pressed != NONE) {
-        DEBUG_PRINTF("[GAME] Player pressed %s\n", colorToString(pressed));
+        LOG_D(LOG_TAG_GAME, "Player pressed %s\n", colorToString(pressed));
+
+        // Use when the press happened, not when it was read
+        // Reason: Remote presses are back-dated by their measured network delay
+        uint32_t pressTime = btn->getJustPressedTime();
+        if ((int32_t)(pressTime - lastInputTime) < 0) {
+            pressTime = lastInputTime;
+        }
+        uint32_t elapsed = pressTime - lastInputTime;
+        if (elapsed > settings.timingWindow) {
+            handleInputTimeout(elapsed);
+            return;
+        }
+
+        replay.recordPress(pressed, elapsed);
+
+        // First press of a round is the reaction to playback; later ones are intervals
+        if (analytics) {
+            analytics->recordPress(currentPlayerId.length() > 0 ? currentPlayerId.c_str() : "guest",
+                                   currentDifficulty, currentStep == 0, elapsed);
+        }
+        if (currentDifficulty == ADAPTIVE) {
+            adaptive.recordPress(elapsed);
+        }
 
         // Turn off any currently lit LED from previous button press
         // Reason: Original Simon turns off old LED when new button pressed
@@ -323,7 +359,7 @@ void SimonGame::handleWaitingInput() {
         // Validate input
         bool correct = validateInput(pressed);
         if (correct) {
-            DEBUG_PRINTLN("[GAME] Correct!");
+            LOG_D(LOG_TAG_GAME, "Correct!\n");
             currentStep++;
 
             // Send button press update
@@ -332,26 +368,42 @@ void SimonGame::handleWaitingInput() {
             // Check if sequence is complete
             if (currentStep >= sequenceLength) {
                 DEBUG_PRINTLN("[GAME] Sequence complete!");
+                if (currentDifficulty == ADAPTIVE) {
+                    adaptive.recordRound(true, currentStep, sequenceLength);
+                }
                 setState(INPUT_CORRECT);
             } else {
                 // Reset timeout for next input
-                lastInputTime = millis();
+                lastInputTime = pressTime;
             }
         } else {
             DEBUG_PRINTLN("[GAME] Wrong!");
+            if (currentDifficulty == ADAPTIVE) {
+                adaptive.recordRound(false, currentStep, sequenceLength);
+            }
             sendButtonPressUpdate(pressed, false);
             setState(INPUT_WRONG);
         }
     }
 }
 
+void SimonGame::handleInputTimeout(uint32_t waitedMs) {
+    DEBUG_PRINTLN("[GAME] Input timeout!");
+    replay.recordTimeout(waitedMs);
+    if (currentDifficulty == ADAPTIVE) {
+        adaptive.recordPress(waitedMs);
+        adaptive.recordRound(false, currentStep, sequenceLength);
+    }
+    setState(INPUT_WRONG);
+}
+
 void SimonGame::handleInputCorrect() {
     // No visual/audio feedback - keeps game fast!
     // Reason: User requested no positive feedback to speed up gameplay
 
     // Increment score
     currentScore++;
-    DEBUG_PRINTF("[GAME] Score: %d\n", currentScore);
+    LOG_D(LOG_TAG_GAME, "Score: %d\n", currentScore);
 
     // Update player score in multiplayer
     if (gameMode == PASS_AND_PLAY) {
@@ -400,6 +452,7 @@ void SimonGame::handleInputWrong() {
         // Check if all players have had their turn
         if (allPlayersFinished()) {
             DEBUG_PRINTLN("[GAME] All players finished - game over!");
+            recordMatchResult();
             setState(GAME_OVER);
         } else {
             // Move to next player and reset for their turn
@@ -414,6 +467,8 @@ void SimonGame::handleInputWrong() {
             currentScore = 0;
             currentStep = 0;
             sequenceLength = 1;  // Start from beginning of same sequence
+            replay.begin(rng.getSeed(), currentDifficulty);
+            syncAdaptivePlayer();
 
             setState(SHOWING_SEQUENCE);
         }
@@ -469,35 +524,43 @@ void SimonGame::handleHighScore() {
 // ============================================================================
 
 Color SimonGame::generateRandomColor() {
-    return (Color)random(0, NUM_COLORS);
+    return rng.nextColor();
 }
 
 void SimonGame::extendSequence() {
     if (sequenceLength < MAX_SEQUENCE_LENGTH) {
         // In multiplayer, reuse existing sequence up to masterSequenceLength
         if (gameMode == PASS_AND_PLAY && sequenceLength < masterSequenceLength) {
-            // Just increment - color already exists in sequence array
+            // Just increment - color already exists in the packed sequence
             sequenceLength++;
-            DEBUG_PRINTF("[GAME] Reusing sequence at length %d (master: %d)\n",
+            LOG_D(LOG_TAG_GAME, "Reusing sequence at length %d (master: %d)\n",
                         sequenceLength, masterSequenceLength);
         } else {
             // Generate new random color (single player or extending beyond master)
-            sequence[sequenceLength] = generateRandomColor();
+            sequence.append(generateRandomColor());
             sequenceLength++;
 
             // Update master sequence length in multiplayer
             if (gameMode == PASS_AND_PLAY && sequenceLength > masterSequenceLength) {
                 masterSequenceLength = sequenceLength;
-                DEBUG_PRINTF("[GAME] Master sequence extended to %d\n", masterSequenceLength);
+                LOG_D(LOG_TAG_GAME, "Master sequence extended to %d\n", masterSequenceLength);
             } else {
-                DEBUG_PRINTF("[GAME] Sequence extended to length %d\n", sequenceLength);
+                LOG_D(LOG_TAG_GAME, "Sequence extended to length %d\n", sequenceLength);
             }
         }
     }
 }
 
+void SimonGame::syncAdaptivePlayer() {
+    // Adaptive pace follows one player; start over when someone else plays
+    if (currentPlayerId != adaptivePlayerId) {
+        adaptive.reset();
+        adaptivePlayerId = currentPlayerId;
+    }
+}
+
 void SimonGame::playSequence() {
-    DEBUG_PRINTLN("[GAME] Playing sequence...");
+    LOG_D(LOG_TAG_GAME, "Playing sequence...\n");
 
     // Stop any player input tones that might still be playing
     // Reason: Prevent interference between player tones and sequence playback
@@ -510,45 +573,31 @@ void SimonGame::playSequence() {
 
     // Send sequence update to WebSocket
     sendSequenceUpdate();
+    replay.recordRound(sequenceLength);
 
     // Small delay before starting
     delay(500);
 
-    // Original Simon Says timing with difficulty multiplier
-    // Sequences 1-5: 500ms tone, 100ms interval (MEDIUM)
-    // Sequences 6+:  400ms tone, 80ms interval (MEDIUM)
-    // EASY: 25% slower (multiply by 1.25)
-    // HARD: 25% faster (multiply by 0.75)
-
-    float difficultyMultiplier;
-    switch (currentDifficulty) {
-        case EASY:
-            difficultyMultiplier = 1.25f;  // 25% slower
-            break;
-        case HARD:
-            difficultyMultiplier = 0.75f;  // 25% faster
-            break;
-        case MEDIUM:
-        default:
-            difficultyMultiplier = 1.0f;   // Original timing
-            break;
-    }
-
+    // Original Simon Says timing, sped up at 6 and 14 steps and scaled per
+    // difficulty (table built at compile time in difficulty_modes.h)
     uint16_t toneDuration, toneInterval;
-    if (sequenceLength <= 5) {
-        toneDuration = (uint16_t)(500 * difficultyMultiplier);
-        toneInterval = (uint16_t)(100 * difficultyMultiplier);
-        DEBUG_PRINTF("[GAME] Seq 1-5 timing: %dms tone, %dms interval (difficulty: %s)\n",
-                    toneDuration, toneInterval, settings.name);
+    if (currentDifficulty == ADAPTIVE) {
+        // Reason: Adaptive timing is re-tuned after every round, input window included
+        toneDuration = adaptive.getToneDuration();
+        toneInterval = adaptive.getToneInterval();
+        settings.timingWindow = adaptive.getTimingWindow();
+        LOG_D(LOG_TAG_GAME, "Adaptive timing: %dms tone, %dms interval, %dms window (pace %d)\n",
+                    toneDuration, toneInterval, settings.timingWindow, adaptive.getPace());
     } else {
-        toneDuration = (uint16_t)(400 * difficultyMultiplier);
-        toneInterval = (uint16_t)(80 * difficultyMultiplier);
-        DEBUG_PRINTF("[GAME] Seq 6+ timing: %dms tone, %dms interval (difficulty: %s)\n",
-                    toneDuration, toneInterval, settings.name);
+        const PlaybackTiming& timing = getPlaybackTiming(currentDifficulty, sequenceLength);
+        toneDuration = timing.toneMs;
+        toneInterval = timing.gapMs;
+        LOG_D(LOG_TAG_GAME, "Seq %d timing: %dms tone, %dms interval (difficulty: %s)\n",
+                    sequenceLength, toneDuration, toneInterval, settings.name);
     }
 
     // Play each step in the sequence
-    for (uint8_t i = 0; i < sequenceLength; i++) {
+    for (uint16_t i = 0; i < sequenceLength; i++) {
         playSequenceStep(i, toneDuration);
 
         // Only delay between tones, NOT after the last one
@@ -559,19 +608,21 @@ void SimonGame::playSequence() {
     }
 
     // Reset step counter for input
+    // Reason: Drop remote presses sent during playback - they can't be answers yet
     currentStep = 0;
+    btn->clearAll();
     lastInputTime = millis();
 
-    DEBUG_PRINTLN("[GAME] Sequence complete, waiting for input");
+    LOG_D(LOG_TAG_GAME, "Sequence complete, waiting for input\n");
 }
 
-void SimonGame::playSequenceStep(uint8_t index, uint16_t toneDuration) {
+void SimonGame::playSequenceStep(uint16_t index, uint16_t toneDuration) {
     if (index >= sequenceLength) {
         return;
     }
 
-    Color color = sequence[index];
-    DEBUG_PRINTF("[GAME] Step %d: %s\n", index + 1, colorToString(color));
+    Color color = sequence.get(index);
+    LOG_D(LOG_TAG_GAME, "Step %d: %s\n", index + 1, colorToString(color));
 
     // Light LED and play tone
     led->on(color);
@@ -584,11 +635,11 @@ bool SimonGame::validateInput(Color input) {
         return false;
     }
 
-    return (input == sequence[currentStep]);
+    return sequence.matches(currentStep, input);
 }
 
 void SimonGame::setState(GameState newState) {
-    DEBUG_PRINTF("[GAME] State: %d -> %d\n", state, newState);
+    LOG_D(LOG_TAG_GAME, "State: %d -> %d\n", state, newState);
     state = newState;
     stateStartTime = millis();
 
@@ -664,12 +715,21 @@ void SimonGame::recordGameSession() {
 
     // Create game session
     GameSession session;
-    session.playerId = currentPlayerId.length() > 0 ? currentPlayerId : "guest";
+    // Reason: An empty or unknown ID parses to nil, which is stored as "guest"
+    PlayerId::parse(currentPlayerId.c_str(), session.playerId);
     session.playerName = "Guest"; // Will be filled by storage
     session.score = currentScore;
     session.difficulty = currentDifficulty;
     session.timestamp = millis() / 1000; // Unix timestamp (will be set by storage)
     session.duration = duration;
+    session.seed = rng.getSeed();
+    session.replayId = 0;
+
+    // Store the replay first so the history entry can link to it
+    replay.finish(currentScore, millis() - gameStartTime, storage->getCurrentTimestamp());
+    if (replayStore) {
+        session.replayId = replayStore->save(replay);
+    }
 
     // Save to storage
     if (storage->recordGame(session)) {
@@ -680,12 +740,29 @@ void SimonGame::recordGameSession() {
     }
 }
 
+void SimonGame::recordMatchResult() {
+    if (!storage) {
+        return;
+    }
+
+    PlayerId ids[RATING_MAX_PLAYERS];
+    uint16_t scores[RATING_MAX_PLAYERS];
+    for (uint8_t i = 0; i < numPlayers; i++) {
+        PlayerId::parse(players[i].playerId.c_str(), ids[i]);
+        scores[i] = players[i].score;
+    }
+
+    if (storage->recordMatch(ids, scores, numPlayers)) {
+        DEBUG_PRINTF("[GAME] Ratings updated for %d players\n", numPlayers);
+    }
+}
+
 // ============================================================================
 // WebSocket Update Methods
 // ============================================================================
 
 void SimonGame::sendWebSocketUpdate() {
-    if (!wsHandler) {
+    if (!wsHandler || !wsHandler->wantsTopic(WS_TOPIC_GAME_STATE)) {
         return;
     }
 
@@ -696,28 +773,34 @@ void SimonGame::sendWebSocketUpdate() {
     doc["highScore"] = highScores[currentDifficulty];
     doc["difficulty"] = getDifficultyName(currentDifficulty);
     doc["isActive"] = isActive();
+    doc["seed"] = rng.getSeed();
+    if (currentDifficulty == ADAPTIVE) {
+        doc["pace"] = adaptive.getPace();
+    }
 
-    wsHandler->broadcast(doc);
+    wsHandler->broadcast(doc, WS_TOPIC_GAME_STATE);
 }
 
 void SimonGame::sendSequenceUpdate() {
-    if (!wsHandler) {
+    if (!wsHandler || !wsHandler->wantsTopic(WS_TOPIC_SEQUENCE)) {
         return;
     }
 
-    StaticJsonDocument<512> doc;
-    doc["type"] = "sequence";
+    // Reason: Send the packed form (one hex digit per two steps) so long
+    // sequences don't turn into kilobytes of color names
+    char packed[PackedSequence::HEX_BUFFER_SIZE];
+    sequence.toHex(packed, sizeof(packed), sequenceLength);
 
-    JsonArray colors = doc.createNestedArray("colors");
-    for (uint8_t i = 0; i < sequenceLength; i++) {
-        colors.add(colorToString(sequence[i]));
-    }
+    StaticJsonDocument<128> doc;
+    doc["type"] = "sequence";
+    doc["length"] = sequenceLength;
+    doc["packed"] = (const char*)packed;
 
-    wsHandler->broadcast(doc);
+    wsHandler->broadcast(doc, WS_TOPIC_SEQUENCE);
 }
 
 void SimonGame::sendButtonPressUpdate(Color color, bool correct) {
-    if (!wsHandler) {
+    if (!wsHandler || !wsHandler->wantsTopic(WS_TOPIC_BUTTON_PRESS)) {
         return;
     }
 
@@ -726,20 +809,27 @@ void SimonGame::sendButtonPressUpdate(Color color, bool correct) {
     doc["color"] = colorToString(color);
     doc["correct"] = correct;
 
-    wsHandler->broadcast(doc);
+    wsHandler->broadcast(doc, WS_TOPIC_BUTTON_PRESS);
 }
 
 void SimonGame::sendGameOverUpdate(bool newHighScore) {
-    if (!wsHandler) {
+    if (!wsHandler || !wsHandler->wantsTopic(WS_TOPIC_GAME_OVER)) {
         return;
     }
 
-    StaticJsonDocument<128> doc;
+    StaticJsonDocument<192> doc;
     doc["type"] = "gameOver";
     doc["score"] = currentScore;
     doc["highScore"] = newHighScore;
+    if (storage) {
+        // Where this game stands among every game at this difficulty
+        ScoreRank rank = storage->getScoreRank(currentDifficulty, currentScore);
+        doc["rank"] = rank.rank;
+        doc["totalGames"] = rank.total;
+        doc["percentile"] = rank.percentile;
+    }
 
-    wsHandler->broadcast(doc);
+    wsHandler->broadcast(doc, WS_TOPIC_GAME_OVER);
 }
 
 // ============================================================================
@@ -783,7 +873,8 @@ bool SimonGame::allPlayersFinished() {
 }
 
 void SimonGame::sendMultiplayerUpdate() {
-    if (!wsHandler || gameMode == SINGLE_PLAYER) {
+    if (!wsHandler || gameMode == SINGLE_PLAYER ||
+        !wsHandler->wantsTopic(WS_TOPIC_MULTIPLAYER)) {
         return;
     }
 
@@ -803,5 +894,5 @@ void SimonGame::sendMultiplayerUpdate() {
         playerObj["hasPlayed"] = players[i].hasPlayed;
     }
 
-    wsHandler->broadcast(doc);
+    wsHandler->broadcast(doc, WS_TOPIC_MULTIPLAYER);
 }
@@ -16,10 +16,16 @@
 #include "../hardware/button_handler.h"
 #include "../hardware/audio_controller.h"
 #include "difficulty_modes.h"
+#include "packed_sequence.h"
+#include "sequence_rng.h"
+#include "game_replay.h"
+#include "adaptive_difficulty.h"
 
 // Forward declarations
 class DataStorage;
 class WebSocketHandler;
+class ReplayStore;
+class ReactionAnalytics;
 
 /**
  * Game state enumeration
@@ -48,7 +54,7 @@ enum GameMode {
 struct PlayerScore {
     String playerId;
     String playerName;
-    uint8_t score;
+    uint16_t score;
     bool hasPlayed;    // Has finished their turn
 };
 
@@ -85,8 +91,9 @@ public:
      *
      * Args:
      *     difficulty: Difficulty level to use
+     *     seed: Sequence seed (0 = pick a random one)
      */
-    void startGame(DifficultyLevel difficulty = EASY);
+    void startGame(DifficultyLevel difficulty = EASY, uint32_t seed = 0);
 
     /**
      * Reset game to idle state
@@ -105,17 +112,33 @@ public:
      * Get current score (sequence length reached)
      *
      * Returns:
-     *     uint8_t: Current score
+     *     uint16_t: Current score
      */
-    uint8_t getScore() const;
+    uint16_t getScore() const;
 
     /**
      * Get high score for current difficulty
      *
      * Returns:
-     *     uint8_t: High score
+     *     uint16_t: High score
      */
-    uint8_t getHighScore() const;
+    uint16_t getHighScore() const;
+
+    /**
+     * Get seed of the current (or last) game
+     *
+     * Returns:
+     *     uint32_t: Sequence seed
+     */
+    uint32_t getSeed() const;
+
+    /**
+     * Get adaptive difficulty engine (drives timing when difficulty is ADAPTIVE)
+     *
+     * Returns:
+     *     const AdaptiveDifficulty&: Adaptive engine
+     */
+    const AdaptiveDifficulty& getAdaptive() const;
 
     /**
      * Get current difficulty level
@@ -149,6 +172,22 @@ public:
      */
     void setWebSocketHandler(WebSocketHandler* handler);
 
+    /**
+     * Set replay store for recording finished games
+     *
+     * Args:
+     *     store: Replay store instance
+     */
+    void setReplayStore(ReplayStore* store);
+
+    /**
+     * Set analytics for recording press timing
+     *
+     * Args:
+     *     analytics: Reaction-time analytics instance
+     */
+    void setAnalytics(ReactionAnalytics* analytics);
+
     /**
      * Set current player for game session tracking
      *
@@ -165,8 +204,10 @@ public:
      *     playerIds: Array of player IDs
      *     numPlayers: Number of players
      *     difficulty: Difficulty level
+     *     seed: Sequence seed shared by all players (0 = pick a random one)
      */
-    void startMultiplayerGame(GameMode mode, const String* playerIds, uint8_t numPlayers, DifficultyLevel difficulty = EASY);
+    void startMultiplayerGame(GameMode mode, const String* playerIds, uint8_t numPlayers,
+                              DifficultyLevel difficulty = EASY, uint32_t seed = 0);
 
     /**
      * Get current game mode
@@ -209,6 +250,8 @@ private:
     // Web references
     DataStorage* storage;
     WebSocketHandler* wsHandler;
+    ReplayStore* replayStore;
+    ReactionAnalytics* analytics;
 
     // Game state
     GameState state;
@@ -221,19 +264,28 @@ private:
 
     // Multiplayer support
     GameMode gameMode;
-    PlayerScore players[4];  // Max 4 players
+    PlayerScore players[RATING_MAX_PLAYERS];  // Max 4 players
     uint8_t numPlayers;
     uint8_t currentPlayerIndex;
-    uint8_t masterSequenceLength;  // Max sequence reached by any player
+    uint16_t masterSequenceLength;  // Max sequence reached by any player
 
     // Sequence data
-    Color sequence[MAX_SEQUENCE_LENGTH];
-    uint8_t sequenceLength;
-    uint8_t currentStep;
+    SequenceRng rng;
+    // Reason: Packed at 2 bits per step so MAX_SEQUENCE_LENGTH can be raised for long games
+    PackedSequence sequence;
+    uint16_t sequenceLength;   // Steps played this round (may trail sequence.length() in multiplayer)
+    uint16_t currentStep;
 
     // Score tracking
-    uint8_t currentScore;
-    uint8_t highScores[NUM_DIFFICULTIES];
+    uint16_t currentScore;
+    uint16_t highScores[NUM_DIFFICULTIES];
+
+    // Replay of the game (or pass-and-play turn) in progress
+    GameReplay replay;
+
+    // Adaptive timing and the player it has been tuned to
+    AdaptiveDifficulty adaptive;
+    String adaptivePlayerId;
 
     // Timing
     uint32_t stateStartTime;
@@ -254,6 +306,14 @@ private:
     void handleGameOver();
     void handleHighScore();
 
+    /**
+     * End the round because the player ran out of time
+     *
+     * Args:
+     *     waitedMs: Time since the prompt or previous press
+     */
+    void handleInputTimeout(uint32_t waitedMs);
+
     /**
      * Generate new random color for sequence
      *
@@ -267,6 +327,11 @@ private:
      */
     void extendSequence();
 
+    /**
+     * Restart adaptive tuning if a different player is about to play
+     */
+    void syncAdaptivePlayer();
+
     /**
      * Play the entire sequence for the player
      */
@@ -279,7 +344,7 @@ private:
      *     index: Index of step to play
      *     toneDuration: Duration of the tone in milliseconds
      */
-    void playSequenceStep(uint8_t index, uint16_t toneDuration);
+    void playSequenceStep(uint16_t index, uint16_t toneDuration);
 
     /**
      * Check if player input matches expected color
@@ -330,6 +395,11 @@ private:
      */
     void recordGameSession();
 
+    /**
+     * Rate a finished pass-and-play game (every player's last score)
+     */
+    void recordMatchResult();
+
     /**
      * Send WebSocket update with current game state
      */
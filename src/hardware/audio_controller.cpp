@@ -54,7 +54,7 @@ void AudioController::playColor(Color color, uint16_t duration, bool blocking) {
         duration = TONE_DURATION_MS;
     }
 
-    DEBUG_PRINTF("[AUDIO] Playing %s tone (%d Hz) for %d ms\n",
+    LOG_D(LOG_TAG_AUDIO, "Playing %s tone (%d Hz) for %d ms\n",
                 colorToString(color), freq, duration);
 
     playTone(freq, duration, blocking);
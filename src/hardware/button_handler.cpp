@@ -7,7 +7,17 @@
 
 #include "button_handler.h"
 
-ButtonHandler::ButtonHandler() {
+// Reason: injectPress() runs on the async_tcp task, getJustPressed() on the loop task
+static portMUX_TYPE injectMux = portMUX_INITIALIZER_UNLOCKED;
+
+ButtonHandler::ButtonHandler() :
+    injectHead(0),
+    injectCount(0),
+    remoteLatencyMs(0),
+    lastInjectTime(0),
+    justPressedTime(0),
+    justPressedRemote(false) {
+
     // Initialize all button states to default
     for (uint8_t i = 0; i < NUM_COLORS; i++) {
         buttonStates[i].current = false;
@@ -92,10 +102,63 @@ Color ButtonHandler::getPressed() {
 Color ButtonHandler::getJustPressed() {
     for (uint8_t i = 0; i < NUM_COLORS; i++) {
         if (wasPressed((Color)i)) {
+            justPressedTime = buttonStates[i].lastPressTime;
+            justPressedRemote = false;
             return (Color)i;
         }
     }
-    return NONE;
+
+    // Remote presses are read one per call, after any physical press
+    Color color = NONE;
+    portENTER_CRITICAL(&injectMux);
+    if (injectCount > 0) {
+        color = injectQueue[injectHead].color;
+        justPressedTime = injectQueue[injectHead].pressTime;
+        justPressedRemote = true;
+        injectHead = (injectHead + 1) % BUTTON_INJECT_QUEUE_SIZE;
+        injectCount--;
+    }
+    portEXIT_CRITICAL(&injectMux);
+
+    return color;
+}
+
+uint32_t ButtonHandler::getJustPressedTime() const {
+    return justPressedTime;
+}
+
+bool ButtonHandler::injectPress(Color color, uint32_t pressTime, uint16_t latencyMs) {
+    if (color >= NUM_COLORS) {
+        return false;
+    }
+
+    bool queued = false;
+    portENTER_CRITICAL(&injectMux);
+    if (injectCount < BUTTON_INJECT_QUEUE_SIZE) {
+        uint8_t tail = (injectHead + injectCount) % BUTTON_INJECT_QUEUE_SIZE;
+        injectQueue[tail].color = color;
+        injectQueue[tail].pressTime = pressTime;
+        injectCount++;
+        remoteLatencyMs = latencyMs;
+        lastInjectTime = millis();
+        queued = true;
+    }
+    portEXIT_CRITICAL(&injectMux);
+
+    return queued;
+}
+
+uint16_t ButtonHandler::getInputGrace() const {
+    // Reason: Only a remote player's press arrives late: one already queued,
+    // or the next one of a player whose last press came over the network
+    portENTER_CRITICAL(&injectMux);
+    bool remote = justPressedRemote || injectCount > 0;
+    portEXIT_CRITICAL(&injectMux);
+
+    if (!remote || lastInjectTime == 0 || millis() - lastInjectTime > BUTTON_REMOTE_ACTIVE_MS) {
+        return 0;
+    }
+    return remoteLatencyMs;
 }
 
 Color ButtonHandler::waitForPress(uint32_t timeoutMs) {
@@ -158,6 +221,10 @@ void ButtonHandler::clearAll() {
         buttonStates[i].previous = buttonStates[i].current;
     }
     powerButtonState.previous = powerButtonState.current;
+
+    portENTER_CRITICAL(&injectMux);
+    injectCount = 0;
+    portEXIT_CRITICAL(&injectMux);
 }
 
 uint32_t ButtonHandler::getTimeSincePress(Color color) {
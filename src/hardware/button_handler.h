@@ -3,6 +3,7 @@
  *
  * Provides debounced button input handling with interrupt support.
  * Tracks button states, detects presses/releases, and handles multi-button detection.
+ * Presses from remote players are injected into the same input stream.
  *
  * Author: Giorgio Gilestro (giorgio@gilest.ro)
  * Date: 2025-11-09
@@ -82,6 +83,39 @@ public:
      */
     Color getJustPressed();
 
+    /**
+     * Get when the press last returned by getJustPressed() happened
+     *
+     * Returns:
+     *     uint32_t: millis() timestamp (earlier than now for remote presses)
+     */
+    uint32_t getJustPressedTime() const;
+
+    /**
+     * Queue a press from a remote player (safe to call from any task)
+     *
+     * Args:
+     *     color: Color pressed
+     *     pressTime: Estimated millis() when the player pressed
+     *     latencyMs: Network delay already subtracted from pressTime
+     *
+     * Returns:
+     *     bool: true if queued, false if the queue is full
+     */
+    bool injectPress(Color color, uint32_t pressTime, uint16_t latencyMs);
+
+    /**
+     * Get extra input time needed to compensate for remote play latency
+     *
+     * Only applies while the awaited press is a remote one: a remote press
+     * is queued, or the last press read came from a remote player.
+     *
+     * Returns:
+     *     uint16_t: Latency of the last remote press (ms), or 0 for a local
+     *               player or no remote press in the last BUTTON_REMOTE_ACTIVE_MS
+     */
+    uint16_t getInputGrace() const;
+
     /**
      * Wait for any button press with timeout
      *
@@ -150,6 +184,20 @@ private:
     ButtonState buttonStates[NUM_COLORS];  // State for game buttons
     ButtonState powerButtonState;           // State for power button
 
+    // Remote presses (ring buffer, written by the WebSocket task)
+    struct InjectedPress {
+        Color color;
+        uint32_t pressTime;
+    };
+    InjectedPress injectQueue[BUTTON_INJECT_QUEUE_SIZE];
+    uint8_t injectHead;
+    uint8_t injectCount;
+    uint16_t remoteLatencyMs;
+    uint32_t lastInjectTime;
+
+    uint32_t justPressedTime;
+    bool justPressedRemote;      // Last press read came from the inject queue
+
     /**
      * Read raw button state from GPIO
      *
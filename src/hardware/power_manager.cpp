@@ -103,7 +103,7 @@ void PowerManager::enterDeepSleep() {
     DEBUG_PRINTLN("[POWER] Entering deep sleep mode...");
     DEBUG_PRINTLN("[POWER] Press any button to wake up");
 
-    delay(100);  // Allow serial output to complete
+    Logger::flush();  // Allow buffered log output to complete
 
     // Enter deep sleep (wake on button press)
     esp_deep_sleep_start();
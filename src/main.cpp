@@ -31,6 +31,11 @@
 #include "web/data_storage.h"
 #include "web/wifi_setup.h"
 #include "web/web_server.h"
+#include "web/replay_store.h"
+#include "web/reaction_analytics.h"
+
+// System includes
+#include "system/loop_monitor.h"
 
 // Global hardware objects
 LEDController* ledController;
@@ -48,6 +53,11 @@ SimonGame* game;
 DataStorage* storage;
 WiFiSetup* wifiSetup;
 SimonWebServer* webServer;
+ReplayStore* replayStore;
+ReactionAnalytics* analytics = nullptr;
+
+// Diagnostics
+LoopMonitor* loopMonitor;
 
 /**
  * Setup function - runs once at startup
@@ -59,6 +69,9 @@ void setup() {
     Serial.begin(SERIAL_BAUD_RATE);
     delay(100);
 
+    // Start the background log drain before anything logs heavily
+    Logger::begin();
+
     DEBUG_PRINTLN("\n\n========================================");
     DEBUG_PRINTLN(PROJECT_NAME);
     DEBUG_PRINT("Version: ");
@@ -111,9 +124,23 @@ void setup() {
             DEBUG_PRINTLN("[OK] Storage initialized");
         }
 
+        // Rolling replay store (needs LittleFS mounted by storage)
+        replayStore = new ReplayStore();
+        replayStore->setStorage(storage);
+        replayStore->begin();
+
+        #if FEATURE_ANALYTICS_ENABLED
+            // Reaction-time aggregates (also needs LittleFS)
+            analytics = new ReactionAnalytics();
+            analytics->setStorage(storage);
+            analytics->begin();
+        #endif
+
         // Initialize game
         DEBUG_PRINTLN("[INIT] Initializing game...");
         game = new SimonGame(ledController, buttonHandler, audioController, storage);
+        game->setReplayStore(replayStore);
+        game->setAnalytics(analytics);
         game->begin();
         DEBUG_PRINTLN("[OK] Game initialized");
 
@@ -127,9 +154,15 @@ void setup() {
             wifiSetup->printConnectionInfo();
         }
 
+        // Loop latency and stall monitoring
+        loopMonitor = new LoopMonitor();
+
         // Initialize web server
         DEBUG_PRINTLN("[INIT] Initializing web server...");
         webServer = new SimonWebServer(storage, game);
+        webServer->setLoopMonitor(loopMonitor);
+        webServer->setReplayStore(replayStore);
+        webServer->setAnalytics(analytics);
         if (!webServer->begin()) {
             DEBUG_PRINTLN("[ERROR] Failed to start web server!");
         } else {
@@ -137,6 +170,9 @@ void setup() {
 
             // Pass WebSocket handler to game for real-time updates
             game->setWebSocketHandler(webServer->getWebSocketHandler());
+
+            // Remote presses from web clients go through the button queue
+            webServer->getWebSocketHandler()->setButtonHandler(buttonHandler);
         }
 
         // Play startup animation
@@ -165,30 +201,66 @@ void loop() {
 
     #else
         // Normal game mode loop
+        loopMonitor->beginIteration();
 
         // Update game state (includes button handling)
+        loopMonitor->beginSection(SECTION_GAME);
+        GameState stateBefore = game->getState();
         game->update();
+        loopMonitor->endSection(SECTION_GAME, stateBefore);
 
         // Update web server / WebSocket cleanup
         if (webServer) {
+            loopMonitor->beginSection(SECTION_WEB);
             webServer->update();
+            loopMonitor->endSection(SECTION_WEB);
         }
 
+        // Persist analytics between games, and write batched
+        // player/history/score changes and replays once things are quiet
+        loopMonitor->beginSection(SECTION_STORAGE);
+        if (analytics) {
+            analytics->update(game->isActive());
+        }
+        if (replayStore) {
+            replayStore->update(game->isActive());
+        }
+        storage->update(game->isActive());
+        loopMonitor->endSection(SECTION_STORAGE);
+
         // Update WiFi connection
         if (wifiSetup) {
+            loopMonitor->beginSection(SECTION_WIFI);
             wifiSetup->update();
+            loopMonitor->endSection(SECTION_WIFI);
         }
 
         // Update power management
+        loopMonitor->beginSection(SECTION_POWER);
         powerManager->update();
 
         // Check for deep sleep timeout (when idle)
         if (!game->isActive()) {
+            // Reason: Deep sleep resets the chip, so nothing may stay in RAM
+            if (powerManager->getTimeSinceActivity() >= DEEP_SLEEP_TIMEOUT_MS) {
+                // Analytics and replays first, so the final flush saves their wear counts too
+                if (analytics) {
+                    analytics->flush();
+                }
+                if (replayStore) {
+                    replayStore->flush();
+                }
+                storage->flush(true);
+            }
             powerManager->checkSleepTimeout();
         } else {
             // Reset activity timer when game is active
             powerManager->resetActivityTimer();
         }
+        loopMonitor->endSection(SECTION_POWER);
+
+        loopMonitor->endIteration();
+        loopMonitor->update();
 
         // Small delay to prevent watchdog timer issues
         delay(10);
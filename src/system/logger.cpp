@@ -0,0 +1,298 @@
+/**
+ * Asynchronous Logger Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "logger.h"
+
+// Tag names, indexed by LogTag
+static const char* const TAG_NAMES[NUM_LOG_TAGS] = {
+    "SYSTEM", "GAME", "STORAGE", "WS", "WEB", "BTN",
+    "AUDIO", "LED", "POWER", "WIFI", "LOOP", "METRICS"
+};
+
+static const char* const LEVEL_NAMES[] = {
+    "none", "error", "warn", "info", "debug"
+};
+
+// Drain task poll interval when the ring is empty
+#define LOG_DRAIN_INTERVAL_MS 10
+
+Logger::Slot Logger::ring[LOG_RING_SLOTS];
+uint32_t Logger::writeIndex = 0;
+uint32_t Logger::readIndex = 0;
+uint32_t Logger::dropped = 0;
+uint32_t Logger::written = 0;
+uint8_t Logger::levels[NUM_LOG_TAGS] = {
+    LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL,
+    LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL,
+    LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL,
+    LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL, LOG_RUNTIME_DEFAULT_LEVEL
+};
+TaskHandle_t Logger::drainTask = nullptr;
+
+void Logger::begin() {
+    if (drainTask) {
+        return;
+    }
+
+    // Reason: Same priority as loopTask, so draining shares CPU with loop()
+    // (mostly during its idle delay) instead of preempting game timing
+    xTaskCreatePinnedToCore(drainLoop, "logger", 3072, nullptr,
+                            tskIDLE_PRIORITY + 1, &drainTask, tskNO_AFFINITY);
+}
+
+// ============================================================================
+// Producers
+// ============================================================================
+
+void Logger::log(uint8_t level, LogTag tag, const char* fmt, ...) {
+    if (!enabled(level, tag)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    write(level, tag, true, fmt, args);
+    va_end(args);
+}
+
+void Logger::printf(const char* fmt, ...) {
+    uint8_t level;
+    LogTag tag;
+    parseLegacy(fmt, level, tag);
+    if (!enabled(level, tag)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    write(level, tag, false, fmt, args);
+    va_end(args);
+}
+
+void Logger::print(const char* text) {
+    writeText(text, false);
+}
+
+void Logger::println(const char* text) {
+    writeText(text, true);
+}
+
+void Logger::println(const String& text) {
+    writeText(text.c_str(), true);
+}
+
+void Logger::writeText(const char* text, bool newline) {
+    uint8_t level;
+    LogTag tag;
+    parseLegacy(text, level, tag);
+    if (!enabled(level, tag)) {
+        return;
+    }
+
+    // Reason: Text goes through "%s" so a literal '%' is never treated as a format
+    writeFormatted(level, tag, newline ? "%s\n" : "%s", text);
+}
+
+void Logger::writeFormatted(uint8_t level, LogTag tag, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    write(level, tag, false, fmt, args);
+    va_end(args);
+}
+
+void Logger::write(uint8_t level, LogTag tag, bool addPrefix, const char* fmt, va_list args) {
+    uint32_t index;
+    if (!reserve(index)) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    Slot& slot = ring[index % LOG_RING_SLOTS];
+    const size_t capacity = sizeof(slot.text);
+    size_t pos = 0;
+
+    if (addPrefix) {
+        int n = snprintf(slot.text, capacity, "[%s] ", TAG_NAMES[tag]);
+        pos = (n > 0) ? (size_t)n : 0;
+    }
+
+    int n = vsnprintf(slot.text + pos, capacity - pos, fmt, args);
+    size_t needed = pos + ((n > 0) ? (size_t)n : 0);
+
+    if (needed >= capacity) {
+        // Truncated - mark it and keep the line terminator
+        pos = capacity - 1;
+        size_t fmtLen = strlen(fmt);
+        if (fmtLen > 0 && fmt[fmtLen - 1] == '\n') {
+            memcpy(slot.text + pos - 4, "...\n", 4);
+        } else {
+            memcpy(slot.text + pos - 3, "...", 3);
+        }
+    } else {
+        pos = needed;
+    }
+    slot.length = pos;
+
+    __atomic_fetch_add(&written, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot.ready, 1, __ATOMIC_RELEASE);
+}
+
+bool Logger::reserve(uint32_t& index) {
+    uint32_t w = __atomic_load_n(&writeIndex, __ATOMIC_ACQUIRE);
+    do {
+        // A slot is free only once the drain task has moved readIndex past it
+        uint32_t r = __atomic_load_n(&readIndex, __ATOMIC_ACQUIRE);
+        if (w - r >= LOG_RING_SLOTS) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&writeIndex, &w, w + 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    index = w;
+    return true;
+}
+
+void Logger::parseLegacy(const char* fmt, uint8_t& level, LogTag& tag) {
+    tag = LOG_TAG_SYSTEM;
+    level = LOGLEVEL_INFO;
+
+    if (!fmt) {
+        return;
+    }
+
+    // Skip leading blank lines used for banners
+    const char* p = fmt;
+    while (*p == '\n') {
+        p++;
+    }
+
+    if (*p == '[') {
+        const char* end = strchr(p + 1, ']');
+        if (end) {
+            size_t len = end - (p + 1);
+            for (uint8_t i = 1; i < NUM_LOG_TAGS; i++) {
+                if (strlen(TAG_NAMES[i]) == len && strncmp(p + 1, TAG_NAMES[i], len) == 0) {
+                    tag = (LogTag)i;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (strstr(p, "ERROR") || strstr(p, "CRITICAL") || strstr(p, "Failed")) {
+        level = LOGLEVEL_ERROR;
+    } else if (strstr(p, "WARN")) {
+        level = LOGLEVEL_WARN;
+    }
+}
+
+// ============================================================================
+// Drain Task
+// ============================================================================
+
+bool Logger::drainOne() {
+    uint32_t r = readIndex;
+    if (r == __atomic_load_n(&writeIndex, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    Slot& slot = ring[r % LOG_RING_SLOTS];
+    if (!__atomic_load_n(&slot.ready, __ATOMIC_ACQUIRE)) {
+        // Reserved but the producer is still formatting it
+        return false;
+    }
+
+    Serial.write((const uint8_t*)slot.text, slot.length);
+
+    __atomic_store_n(&slot.ready, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&readIndex, r + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void Logger::drainLoop(void* param) {
+    uint32_t reportedDrops = 0;
+
+    for (;;) {
+        while (drainOne()) {
+        }
+
+        uint32_t drops = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+        if (drops != reportedDrops) {
+            Serial.printf("[LOG] %u messages dropped (ring full)\n", drops - reportedDrops);
+            reportedDrops = drops;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+void Logger::flush(uint32_t timeoutMs) {
+    uint32_t start = millis();
+
+    if (!drainTask) {
+        // No consumer yet - drain synchronously from the caller
+        while (drainOne() && millis() - start < timeoutMs) {
+        }
+    } else {
+        while (__atomic_load_n(&readIndex, __ATOMIC_ACQUIRE) !=
+                   __atomic_load_n(&writeIndex, __ATOMIC_ACQUIRE) &&
+               millis() - start < timeoutMs) {
+            delay(1);
+        }
+    }
+
+    Serial.flush();
+}
+
+// ============================================================================
+// Levels and Stats
+// ============================================================================
+
+void Logger::setLevel(LogTag tag, uint8_t level) {
+    if (tag < NUM_LOG_TAGS) {
+        levels[tag] = level > LOGLEVEL_DEBUG ? LOGLEVEL_DEBUG : level;
+    }
+}
+
+void Logger::setLevel(uint8_t level) {
+    for (uint8_t i = 0; i < NUM_LOG_TAGS; i++) {
+        setLevel((LogTag)i, level);
+    }
+}
+
+uint8_t Logger::getLevel(LogTag tag) {
+    return tag < NUM_LOG_TAGS ? levels[tag] : LOGLEVEL_NONE;
+}
+
+bool Logger::enabled(uint8_t level, LogTag tag) {
+    return level != LOGLEVEL_NONE && tag < NUM_LOG_TAGS && level <= levels[tag];
+}
+
+const char* Logger::tagName(LogTag tag) {
+    return tag < NUM_LOG_TAGS ? TAG_NAMES[tag] : "UNKNOWN";
+}
+
+bool Logger::tagFromName(const char* name, LogTag& tag) {
+    for (uint8_t i = 0; i < NUM_LOG_TAGS; i++) {
+        if (strcmp(name, TAG_NAMES[i]) == 0) {
+            tag = (LogTag)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Logger::levelName(uint8_t level) {
+    return level <= LOGLEVEL_DEBUG ? LEVEL_NAMES[level] : "unknown";
+}
+
+uint32_t Logger::getDropped() {
+    return dropped;
+}
+
+uint32_t Logger::getWritten() {
+    return written;
+}
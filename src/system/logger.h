@@ -0,0 +1,238 @@
+/**
+ * Asynchronous Logger for ESP32 Simon Says
+ *
+ * Log calls format into a fixed ring of message slots and return immediately;
+ * a low-priority FreeRTOS task drains the ring to Serial. At 115200 baud the
+ * UART moves ~11 bytes/ms, so writing synchronously from the game loop or the
+ * async_tcp task stalls it for the whole message. When the ring is full the
+ * message is dropped and counted instead of blocking the caller.
+ *
+ * Messages are filtered twice: LOG_COMPILE_LEVEL removes LOG_D/LOG_I/... calls
+ * at build time, and a runtime level per subsystem tag ([GAME], [STORAGE],
+ * [WS], ...) skips formatting for disabled tags.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "../config.h"
+
+/**
+ * Subsystem tags (printed as the "[TAG]" message prefix)
+ */
+enum LogTag : uint8_t {
+    LOG_TAG_SYSTEM = 0,   // Untagged, [INIT], [OK], [ERROR], [WARN]
+    LOG_TAG_GAME,
+    LOG_TAG_STORAGE,
+    LOG_TAG_WS,
+    LOG_TAG_WEB,
+    LOG_TAG_BTN,
+    LOG_TAG_AUDIO,
+    LOG_TAG_LED,
+    LOG_TAG_POWER,
+    LOG_TAG_WIFI,
+    LOG_TAG_LOOP,
+    LOG_TAG_METRICS,
+    NUM_LOG_TAGS
+};
+
+class Logger {
+public:
+    /**
+     * Start the drain task (call once, after Serial.begin())
+     *
+     * Messages logged before begin() are buffered in the ring.
+     */
+    static void begin();
+
+    /**
+     * Log a printf-style message under an explicit tag
+     *
+     * The "[TAG] " prefix is added automatically.
+     *
+     * Args:
+     *     level: Message level (LOGLEVEL_ERROR .. LOGLEVEL_DEBUG)
+     *     tag: Subsystem tag
+     *     fmt: printf format string
+     */
+    static void log(uint8_t level, LogTag tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    /**
+     * Legacy printf entry point used by DEBUG_PRINTF
+     *
+     * The tag is taken from the "[TAG]" prefix already present in the format
+     * string, and the level from ERROR/WARN/CRITICAL markers in it.
+     *
+     * Args:
+     *     fmt: printf format string
+     */
+    static void printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+    /**
+     * Legacy print/println entry points used by DEBUG_PRINT/DEBUG_PRINTLN
+     *
+     * Args:
+     *     text: Text to log
+     */
+    static void print(const char* text);
+    static void println(const char* text);
+    static void println(const String& text);
+
+    /**
+     * Wait until all buffered messages have been written to Serial
+     *
+     * Call before deep sleep or restart.
+     *
+     * Args:
+     *     timeoutMs: Maximum time to wait
+     */
+    static void flush(uint32_t timeoutMs = 500);
+
+    /**
+     * Set runtime level for one tag
+     *
+     * Args:
+     *     tag: Subsystem tag
+     *     level: Highest level still logged (LOGLEVEL_NONE disables the tag)
+     */
+    static void setLevel(LogTag tag, uint8_t level);
+
+    /**
+     * Set runtime level for all tags
+     *
+     * Args:
+     *     level: Highest level still logged
+     */
+    static void setLevel(uint8_t level);
+
+    /**
+     * Get runtime level of a tag
+     *
+     * Args:
+     *     tag: Subsystem tag
+     *
+     * Returns:
+     *     uint8_t: Current level
+     */
+    static uint8_t getLevel(LogTag tag);
+
+    /**
+     * Check whether a message would be logged (avoids building arguments)
+     *
+     * Args:
+     *     level: Message level
+     *     tag: Subsystem tag
+     *
+     * Returns:
+     *     bool: true if enabled
+     */
+    static bool enabled(uint8_t level, LogTag tag);
+
+    /**
+     * Get tag name without brackets (e.g. "GAME")
+     *
+     * Args:
+     *     tag: Subsystem tag
+     *
+     * Returns:
+     *     const char*: Tag name
+     */
+    static const char* tagName(LogTag tag);
+
+    /**
+     * Look up a tag by name (case-sensitive, without brackets)
+     *
+     * Args:
+     *     name: Tag name
+     *     tag: Output tag
+     *
+     * Returns:
+     *     bool: true if found
+     */
+    static bool tagFromName(const char* name, LogTag& tag);
+
+    /**
+     * Get level name (e.g. "debug")
+     *
+     * Args:
+     *     level: Log level
+     *
+     * Returns:
+     *     const char*: Level name
+     */
+    static const char* levelName(uint8_t level);
+
+    /**
+     * Get number of messages dropped because the ring was full
+     *
+     * Returns:
+     *     uint32_t: Dropped message count since boot
+     */
+    static uint32_t getDropped();
+
+    /**
+     * Get number of messages queued since boot
+     *
+     * Returns:
+     *     uint32_t: Accepted message count
+     */
+    static uint32_t getWritten();
+
+private:
+    /**
+     * Fixed-size message slot
+     *
+     * ready is set by the producer once text is complete and cleared by the
+     * drain task after writing it out.
+     */
+    struct Slot {
+        volatile uint8_t ready;
+        uint8_t length;
+        char text[LOG_SLOT_SIZE - 2];
+    };
+
+    static Slot ring[LOG_RING_SLOTS];
+    static uint32_t writeIndex;     // Next slot to reserve (producers)
+    static uint32_t readIndex;      // Next slot to drain (drain task only)
+    static uint32_t dropped;
+    static uint32_t written;
+    static uint8_t levels[NUM_LOG_TAGS];
+    static TaskHandle_t drainTask;
+
+    static void write(uint8_t level, LogTag tag, bool addPrefix, const char* fmt, va_list args);
+    static void writeFormatted(uint8_t level, LogTag tag, const char* fmt, ...);
+    static void writeText(const char* text, bool newline);
+    static void parseLegacy(const char* fmt, uint8_t& level, LogTag& tag);
+    static bool reserve(uint32_t& index);
+    static bool drainOne();
+    static void drainLoop(void* param);
+};
+
+// Leveled logging macros (compiled out above LOG_COMPILE_LEVEL)
+#if DEBUG_ENABLED && LOG_COMPILE_LEVEL >= LOGLEVEL_ERROR
+  #define LOG_E(tag, fmt, ...) Logger::log(LOGLEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+  #define LOG_E(tag, fmt, ...)
+#endif
+
+#if DEBUG_ENABLED && LOG_COMPILE_LEVEL >= LOGLEVEL_WARN
+  #define LOG_W(tag, fmt, ...) Logger::log(LOGLEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+  #define LOG_W(tag, fmt, ...)
+#endif
+
+#if DEBUG_ENABLED && LOG_COMPILE_LEVEL >= LOGLEVEL_INFO
+  #define LOG_I(tag, fmt, ...) Logger::log(LOGLEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+  #define LOG_I(tag, fmt, ...)
+#endif
+
+#if DEBUG_ENABLED && LOG_COMPILE_LEVEL >= LOGLEVEL_DEBUG
+  #define LOG_D(tag, fmt, ...) Logger::log(LOGLEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+  #define LOG_D(tag, fmt, ...)
+#endif
@@ -0,0 +1,133 @@
+/**
+ * Main Loop Monitor Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "loop_monitor.h"
+#include "metrics.h"
+
+LoopMonitor::LoopMonitor() :
+    iterationStartUs(0),
+    sectionStartUs(0),
+    lastReportTime(0),
+    iterations(0),
+    stallHead(0),
+    numStalls(0) {
+
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    iterationLatency = metrics.histogram("simon_loop_iteration_duration_seconds",
+                                         "Work time of one loop() iteration (excluding idle delay)");
+
+    char labels[METRICS_MAX_LABEL_LENGTH];
+    for (uint8_t i = 0; i < NUM_LOOP_SECTIONS; i++) {
+        snprintf(labels, sizeof(labels), "section=\"%s\"", sectionName((LoopSection)i));
+        sectionLatency[i] = metrics.histogram("simon_loop_section_duration_seconds",
+                                              "Duration of each subsystem update() in loop()", labels);
+        stallCount[i] = metrics.counter("simon_loop_stalls_total",
+                                        "Subsystem updates exceeding the stall threshold", labels);
+    }
+}
+
+void LoopMonitor::beginIteration() {
+    iterationStartUs = micros();
+}
+
+void LoopMonitor::endIteration() {
+    iterationLatency->observe(micros() - iterationStartUs);
+    iterations++;
+}
+
+void LoopMonitor::beginSection(LoopSection section) {
+    sectionStartUs = micros();
+}
+
+void LoopMonitor::endSection(LoopSection section, uint8_t context) {
+    if (section >= NUM_LOOP_SECTIONS) {
+        return;
+    }
+
+    uint32_t elapsedUs = micros() - sectionStartUs;
+    sectionLatency[section]->observe(elapsedUs);
+
+    if (elapsedUs >= (uint32_t)LOOP_STALL_THRESHOLD_MS * 1000) {
+        stallCount[section]->inc();
+
+        LoopStall& stall = stalls[stallHead];
+        stall.section = section;
+        stall.durationMs = elapsedUs / 1000;
+        stall.timestamp = millis();
+        stall.context = context;
+
+        stallHead = (stallHead + 1) % STALL_HISTORY;
+        if (numStalls < STALL_HISTORY) {
+            numStalls++;
+        }
+
+        DEBUG_PRINTF("[LOOP] Stall: %s took %d ms (context %d)\n",
+                    sectionName(section), stall.durationMs, context);
+    }
+}
+
+void LoopMonitor::update() {
+    if (LOOP_REPORT_INTERVAL_MS == 0) {
+        return;
+    }
+
+    uint32_t now = millis();
+    if (now - lastReportTime >= LOOP_REPORT_INTERVAL_MS) {
+        lastReportTime = now;
+        // Reason: Logged rather than printed so the summary never blocks loop() on the UART
+        LOG_I(LOG_TAG_LOOP, "%u iterations, p50=%u us, p99=%u us, max=%u us\n",
+              iterations, iterationLatency->percentile(50),
+              iterationLatency->percentile(99), iterationLatency->getMax());
+        for (uint8_t i = 0; i < NUM_LOOP_SECTIONS; i++) {
+            LOG_I(LOG_TAG_LOOP, "  %-6s p99=%u us, max=%u us, stalls=%u\n",
+                  sectionName((LoopSection)i), sectionLatency[i]->percentile(99),
+                  sectionLatency[i]->getMax(), stallCount[i]->get());
+        }
+    }
+}
+
+void LoopMonitor::toJson(JsonDocument& doc) {
+    doc["iterations"] = iterations;
+    doc["stallThresholdMs"] = LOOP_STALL_THRESHOLD_MS;
+    doc["p50Us"] = iterationLatency->percentile(50);
+    doc["p90Us"] = iterationLatency->percentile(90);
+    doc["p99Us"] = iterationLatency->percentile(99);
+    doc["maxUs"] = iterationLatency->getMax();
+
+    JsonArray sections = doc.createNestedArray("sections");
+    for (uint8_t i = 0; i < NUM_LOOP_SECTIONS; i++) {
+        JsonObject obj = sections.createNestedObject();
+        obj["name"] = sectionName((LoopSection)i);
+        obj["p50Us"] = sectionLatency[i]->percentile(50);
+        obj["p99Us"] = sectionLatency[i]->percentile(99);
+        obj["maxUs"] = sectionLatency[i]->getMax();
+        obj["stalls"] = stallCount[i]->get();
+    }
+
+    // Most recent stall first
+    JsonArray recent = doc.createNestedArray("recentStalls");
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < numStalls; i++) {
+        const LoopStall& stall = stalls[(stallHead + STALL_HISTORY - 1 - i) % STALL_HISTORY];
+        JsonObject obj = recent.createNestedObject();
+        obj["section"] = sectionName(stall.section);
+        obj["durationMs"] = stall.durationMs;
+        obj["ageMs"] = now - stall.timestamp;
+        obj["context"] = stall.context;
+    }
+}
+
+const char* LoopMonitor::sectionName(LoopSection section) {
+    switch (section) {
+        case SECTION_GAME:    return "game";
+        case SECTION_WEB:     return "web";
+        case SECTION_WIFI:    return "wifi";
+        case SECTION_POWER:   return "power";
+        case SECTION_STORAGE: return "storage";
+        default:              return "unknown";
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * Main Loop Monitor for ESP32 Simon Says
+ *
+ * Times every loop() iteration and each subsystem update() inside it.
+ * Iteration and per-section latencies feed the metrics registry, and any
+ * section that runs longer than LOOP_STALL_THRESHOLD_MS is recorded as a
+ * stall (which subsystem, how long, and the game state at the time).
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../config.h"
+
+// Forward declarations
+class Histogram;
+class Counter;
+
+/**
+ * Subsystems timed inside loop()
+ */
+enum LoopSection : uint8_t {
+    SECTION_GAME = 0,   // SimonGame::update() (buttons, audio, state machine)
+    SECTION_WEB,        // SimonWebServer::update()
+    SECTION_WIFI,       // WiFiSetup::update()
+    SECTION_POWER,      // PowerManager::update() (battery sampling, sleep check)
+    SECTION_STORAGE,    // ReactionAnalytics/DataStorage update() (flash writes)
+    NUM_LOOP_SECTIONS
+};
+
+/**
+ * Single stall record
+ */
+struct LoopStall {
+    LoopSection section;   // Subsystem that stalled
+    uint32_t durationMs;   // How long the section ran
+    uint32_t timestamp;    // millis() when the stall ended
+    uint8_t context;       // Caller-supplied context (game state)
+};
+
+class LoopMonitor {
+public:
+    // Number of recent stalls kept for reporting
+    static const uint8_t STALL_HISTORY = 8;
+
+    /**
+     * Constructor
+     */
+    LoopMonitor();
+
+    /**
+     * Mark the start of a loop() iteration
+     */
+    void beginIteration();
+
+    /**
+     * Mark the end of a loop() iteration (call before the idle delay)
+     */
+    void endIteration();
+
+    /**
+     * Mark the start of a subsystem section
+     *
+     * Args:
+     *     section: Section being entered
+     */
+    void beginSection(LoopSection section);
+
+    /**
+     * Mark the end of a subsystem section and check the stall threshold
+     *
+     * Args:
+     *     section: Section being left
+     *     context: Context recorded with a stall (e.g. current GameState)
+     */
+    void endSection(LoopSection section, uint8_t context = 0);
+
+    /**
+     * Log a periodic summary (call once per loop)
+     */
+    void update();
+
+    /**
+     * Fill a JSON document with the current report
+     *
+     * Args:
+     *     doc: Output document
+     */
+    void toJson(JsonDocument& doc);
+
+    /**
+     * Get display name of a section
+     *
+     * Args:
+     *     section: Loop section
+     *
+     * Returns:
+     *     const char*: Section name
+     */
+    static const char* sectionName(LoopSection section);
+
+private:
+    uint32_t iterationStartUs;
+    uint32_t sectionStartUs;
+    uint32_t lastReportTime;
+    uint32_t iterations;
+
+    Histogram* iterationLatency;
+    Histogram* sectionLatency[NUM_LOOP_SECTIONS];
+    Counter* stallCount[NUM_LOOP_SECTIONS];
+
+    LoopStall stalls[STALL_HISTORY];  // Ring buffer of recent stalls
+    uint8_t stallHead;
+    uint8_t numStalls;
+};
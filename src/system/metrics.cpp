@@ -0,0 +1,294 @@
+/**
+ * Metrics Registry Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "metrics.h"
+
+// Reason: Handlers run on the async_tcp task while the game runs on the loop task,
+// so multi-word histogram updates need a short critical section
+static portMUX_TYPE metricsMux = portMUX_INITIALIZER_UNLOCKED;
+
+const uint32_t Histogram::BUCKET_BOUNDS_US[Histogram::NUM_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+    50000, 100000, 250000, 500000, 1000000, 5000000
+};
+
+// ============================================================================
+// Counter / Gauge
+// ============================================================================
+
+void Counter::inc(uint32_t amount) {
+    __atomic_fetch_add(&value, amount, __ATOMIC_RELAXED);
+}
+
+uint32_t Counter::get() const {
+    return value;
+}
+
+void Gauge::set(int32_t v) {
+    value = v;
+}
+
+int32_t Gauge::get() const {
+    return value;
+}
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+void Histogram::observe(uint32_t durationUs, int32_t heapDelta) {
+    uint8_t bucket = NUM_BUCKETS;
+    for (uint8_t i = 0; i < NUM_BUCKETS; i++) {
+        if (durationUs <= BUCKET_BOUNDS_US[i]) {
+            bucket = i;
+            break;
+        }
+    }
+
+    portENTER_CRITICAL(&metricsMux);
+    buckets[bucket]++;
+    count++;
+    sumUs += durationUs;
+    if (durationUs > maxUs) {
+        maxUs = durationUs;
+    }
+    if (heapDelta > maxHeapDelta) {
+        maxHeapDelta = heapDelta;
+    }
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+uint32_t Histogram::getCount() const {
+    return count;
+}
+
+uint32_t Histogram::percentile(uint8_t pct) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    // Rank of the requested percentile (1-based, rounded up)
+    uint32_t rank = ((uint64_t)count * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return BUCKET_BOUNDS_US[i];
+        }
+    }
+    return maxUs;
+}
+
+uint32_t Histogram::getMax() const {
+    return maxUs;
+}
+
+ScopedLatency::ScopedLatency(Histogram* histogram) :
+    hist(histogram),
+    startUs(micros()),
+    startHeap(ESP.getFreeHeap()) {
+}
+
+ScopedLatency::~ScopedLatency() {
+    int32_t heapDelta = (int32_t)startHeap - (int32_t)ESP.getFreeHeap();
+    hist->observe(micros() - startUs, heapDelta);
+}
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::MetricsRegistry() :
+    numCounters(0),
+    numGauges(0),
+    numHistograms(0) {
+
+    memset(counters, 0, sizeof(counters));
+    memset(gauges, 0, sizeof(gauges));
+    memset(histograms, 0, sizeof(histograms));
+
+    heapFree = gauge("simon_heap_free_bytes", "Current free heap");
+    heapMinFree = gauge("simon_heap_min_free_bytes", "Lowest free heap since boot");
+    heapLargestBlock = gauge("simon_heap_largest_free_block_bytes", "Largest allocatable heap block");
+    uptimeSeconds = gauge("simon_uptime_seconds", "Seconds since boot");
+}
+
+Counter* MetricsRegistry::counter(const char* name, const char* help, const char* labels) {
+    portENTER_CRITICAL(&metricsMux);
+    uint8_t slot = numCounters < METRICS_MAX_COUNTERS ? numCounters++ : METRICS_MAX_COUNTERS;
+    portEXIT_CRITICAL(&metricsMux);
+
+    if (slot == METRICS_MAX_COUNTERS) {
+        DEBUG_PRINTF("[METRICS] WARNING: Counter limit reached, dropping %s\n", name);
+        return &counters[slot];
+    }
+
+    Counter* c = &counters[slot];
+    c->name = name;
+    c->help = help;
+    strlcpy(c->labels, labels, sizeof(c->labels));
+    return c;
+}
+
+Gauge* MetricsRegistry::gauge(const char* name, const char* help, const char* labels) {
+    portENTER_CRITICAL(&metricsMux);
+    uint8_t slot = numGauges < METRICS_MAX_GAUGES ? numGauges++ : METRICS_MAX_GAUGES;
+    portEXIT_CRITICAL(&metricsMux);
+
+    if (slot == METRICS_MAX_GAUGES) {
+        DEBUG_PRINTF("[METRICS] WARNING: Gauge limit reached, dropping %s\n", name);
+        return &gauges[slot];
+    }
+
+    Gauge* g = &gauges[slot];
+    g->name = name;
+    g->help = help;
+    strlcpy(g->labels, labels, sizeof(g->labels));
+    return g;
+}
+
+Histogram* MetricsRegistry::histogram(const char* name, const char* help, const char* labels) {
+    portENTER_CRITICAL(&metricsMux);
+    uint8_t slot = numHistograms < METRICS_MAX_HISTOGRAMS ? numHistograms++ : METRICS_MAX_HISTOGRAMS;
+    portEXIT_CRITICAL(&metricsMux);
+
+    if (slot == METRICS_MAX_HISTOGRAMS) {
+        DEBUG_PRINTF("[METRICS] WARNING: Histogram limit reached, dropping %s\n", name);
+        return &histograms[slot];
+    }
+
+    Histogram* h = &histograms[slot];
+    h->name = name;
+    h->help = help;
+    strlcpy(h->labels, labels, sizeof(h->labels));
+    return h;
+}
+
+void MetricsRegistry::render(Print& out) {
+    // Refresh built-in gauges
+    heapFree->set(ESP.getFreeHeap());
+    heapMinFree->set(ESP.getMinFreeHeap());
+    heapLargestBlock->set(ESP.getMaxAllocHeap());
+    uptimeSeconds->set(millis() / 1000);
+
+    // Counters - emit HELP/TYPE once per family, then every labelled instance
+    for (uint8_t i = 0; i < numCounters; i++) {
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = (strcmp(counters[j].name, counters[i].name) == 0);
+        }
+        if (seen) continue;
+
+        renderHeader(out, counters[i].name, counters[i].help, "counter");
+        for (uint8_t j = i; j < numCounters; j++) {
+            if (strcmp(counters[j].name, counters[i].name) != 0) continue;
+            out.print(counters[j].name);
+            renderLabels(out, counters[j].labels);
+            out.printf(" %u\n", counters[j].get());
+        }
+    }
+
+    // Gauges
+    for (uint8_t i = 0; i < numGauges; i++) {
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = (strcmp(gauges[j].name, gauges[i].name) == 0);
+        }
+        if (seen) continue;
+
+        renderHeader(out, gauges[i].name, gauges[i].help, "gauge");
+        for (uint8_t j = i; j < numGauges; j++) {
+            if (strcmp(gauges[j].name, gauges[i].name) != 0) continue;
+            out.print(gauges[j].name);
+            renderLabels(out, gauges[j].labels);
+            out.printf(" %d\n", gauges[j].get());
+        }
+    }
+
+    // Histograms (plus a companion gauge family for retained heap)
+    for (uint8_t i = 0; i < numHistograms; i++) {
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = (strcmp(histograms[j].name, histograms[i].name) == 0);
+        }
+        if (seen) continue;
+
+        renderHeader(out, histograms[i].name, histograms[i].help, "histogram");
+        for (uint8_t j = i; j < numHistograms; j++) {
+            if (strcmp(histograms[j].name, histograms[i].name) != 0) continue;
+
+            // Snapshot under lock so the exposition is self-consistent
+            Histogram snap;
+            portENTER_CRITICAL(&metricsMux);
+            memcpy(&snap, &histograms[j], sizeof(Histogram));
+            portEXIT_CRITICAL(&metricsMux);
+
+            uint32_t cumulative = 0;
+            char le[24];
+            for (uint8_t b = 0; b < Histogram::NUM_BUCKETS; b++) {
+                cumulative += snap.buckets[b];
+                snprintf(le, sizeof(le), "le=\"%g\"", Histogram::BUCKET_BOUNDS_US[b] / 1e6);
+                out.printf("%s_bucket", snap.name);
+                renderLabels(out, snap.labels, le);
+                out.printf(" %u\n", cumulative);
+            }
+            out.printf("%s_bucket", snap.name);
+            renderLabels(out, snap.labels, "le=\"+Inf\"");
+            out.printf(" %u\n", snap.count);
+
+            out.printf("%s_sum", snap.name);
+            renderLabels(out, snap.labels);
+            out.printf(" %.6f\n", snap.sumUs / 1e6);
+
+            out.printf("%s_count", snap.name);
+            renderLabels(out, snap.labels);
+            out.printf(" %u\n", snap.count);
+        }
+    }
+
+    renderHeader(out, "simon_op_heap_retained_bytes_max",
+                 "Largest heap delta observed across one measured operation", "gauge");
+    char family[80];
+    for (uint8_t i = 0; i < numHistograms; i++) {
+        snprintf(family, sizeof(family), "family=\"%s\"", histograms[i].name);
+        out.print("simon_op_heap_retained_bytes_max");
+        renderLabels(out, histograms[i].labels, family);
+        out.printf(" %d\n", histograms[i].maxHeapDelta);
+    }
+}
+
+void MetricsRegistry::renderHeader(Print& out, const char* name, const char* help, const char* type) {
+    out.printf("# HELP %s %s\n", name, help);
+    out.printf("# TYPE %s %s\n", name, type);
+}
+
+void MetricsRegistry::renderLabels(Print& out, const char* labels, const char* extra) {
+    bool hasLabels = labels && labels[0];
+    bool hasExtra = extra && extra[0];
+    if (!hasLabels && !hasExtra) {
+        return;
+    }
+
+    out.print('{');
+    if (hasLabels) {
+        out.print(labels);
+    }
+    if (hasExtra) {
+        if (hasLabels) out.print(',');
+        out.print(extra);
+    }
+    out.print('}');
+}
@@ -0,0 +1,242 @@
+/**
+ * Metrics Registry for ESP32 Simon Says
+ *
+ * Lightweight counters, gauges and fixed-bucket latency histograms used to
+ * instrument web handlers, storage operations and WebSocket broadcasts.
+ * All metric storage is statically allocated and rendered on demand in
+ * Prometheus text exposition format (see /api/metrics).
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Registry capacity (metrics are never freed, so these are hard limits)
+#define METRICS_MAX_COUNTERS 24
+#define METRICS_MAX_GAUGES 16
+#define METRICS_MAX_HISTOGRAMS 56
+#define METRICS_MAX_LABEL_LENGTH 64
+
+/**
+ * Monotonic counter
+ */
+class Counter {
+public:
+    /**
+     * Increment the counter
+     *
+     * Args:
+     *     amount: Value to add (default 1)
+     */
+    void inc(uint32_t amount = 1);
+
+    /**
+     * Get current counter value
+     *
+     * Returns:
+     *     uint32_t: Current value
+     */
+    uint32_t get() const;
+
+private:
+    friend class MetricsRegistry;
+
+    const char* name;
+    const char* help;
+    char labels[METRICS_MAX_LABEL_LENGTH];
+    volatile uint32_t value;
+};
+
+/**
+ * Gauge (value that can go up and down)
+ */
+class Gauge {
+public:
+    /**
+     * Set gauge to an absolute value
+     *
+     * Args:
+     *     v: New value
+     */
+    void set(int32_t v);
+
+    /**
+     * Get current gauge value
+     *
+     * Returns:
+     *     int32_t: Current value
+     */
+    int32_t get() const;
+
+private:
+    friend class MetricsRegistry;
+
+    const char* name;
+    const char* help;
+    char labels[METRICS_MAX_LABEL_LENGTH];
+    volatile int32_t value;
+};
+
+/**
+ * Fixed-bucket latency histogram
+ *
+ * Buckets are cumulative upper bounds in microseconds, chosen to cover the
+ * range from a fast RAM lookup (100us) to a full-file flash rewrite (5s).
+ * Also tracks the largest heap delta observed across a measured operation.
+ */
+class Histogram {
+public:
+    static const uint8_t NUM_BUCKETS = 14;
+    static const uint32_t BUCKET_BOUNDS_US[NUM_BUCKETS];
+
+    /**
+     * Record one observation
+     *
+     * Args:
+     *     durationUs: Measured duration in microseconds
+     *     heapDelta: Bytes of heap retained by the operation (0 if unknown)
+     */
+    void observe(uint32_t durationUs, int32_t heapDelta = 0);
+
+    /**
+     * Get total number of observations
+     *
+     * Returns:
+     *     uint32_t: Observation count
+     */
+    uint32_t getCount() const;
+
+    /**
+     * Estimate a percentile from the bucket counts
+     *
+     * Args:
+     *     pct: Percentile (0-100)
+     *
+     * Returns:
+     *     uint32_t: Upper bound of the bucket holding the percentile (us),
+     *               or the observed maximum if it falls in the overflow bucket
+     */
+    uint32_t percentile(uint8_t pct) const;
+
+    /**
+     * Get the largest single observation
+     *
+     * Returns:
+     *     uint32_t: Maximum duration (us)
+     */
+    uint32_t getMax() const;
+
+private:
+    friend class MetricsRegistry;
+
+    const char* name;
+    const char* help;
+    char labels[METRICS_MAX_LABEL_LENGTH];
+    uint32_t buckets[NUM_BUCKETS + 1];  // Last slot is the +Inf overflow bucket
+    uint32_t count;
+    uint64_t sumUs;
+    uint32_t maxUs;
+    int32_t maxHeapDelta;
+};
+
+/**
+ * Scoped latency measurement
+ *
+ * Records elapsed time and heap delta into a histogram when it goes out of scope.
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(Histogram* histogram);
+    ~ScopedLatency();
+
+private:
+    Histogram* hist;
+    uint32_t startUs;
+    uint32_t startHeap;
+};
+
+/**
+ * Metrics Registry Class
+ *
+ * Process-wide singleton owning all metric instances.
+ */
+class MetricsRegistry {
+public:
+    /**
+     * Get the global registry
+     *
+     * Returns:
+     *     MetricsRegistry&: Singleton instance
+     */
+    static MetricsRegistry& instance();
+
+    /**
+     * Register a counter
+     *
+     * Args:
+     *     name: Metric family name (string literal)
+     *     help: Help text (string literal)
+     *     labels: Prometheus label set without braces, e.g. op="load" (copied)
+     *
+     * Returns:
+     *     Counter*: New counter (never null; a shared sink is returned when full)
+     */
+    Counter* counter(const char* name, const char* help, const char* labels = "");
+
+    /**
+     * Register a gauge
+     *
+     * Args:
+     *     name: Metric family name (string literal)
+     *     help: Help text (string literal)
+     *     labels: Prometheus label set without braces (copied)
+     *
+     * Returns:
+     *     Gauge*: New gauge (never null)
+     */
+    Gauge* gauge(const char* name, const char* help, const char* labels = "");
+
+    /**
+     * Register a latency histogram
+     *
+     * Args:
+     *     name: Metric family name (string literal)
+     *     help: Help text (string literal)
+     *     labels: Prometheus label set without braces (copied)
+     *
+     * Returns:
+     *     Histogram*: New histogram (never null)
+     */
+    Histogram* histogram(const char* name, const char* help, const char* labels = "");
+
+    /**
+     * Render all metrics in Prometheus text format
+     *
+     * Args:
+     *     out: Output sink
+     */
+    void render(Print& out);
+
+private:
+    MetricsRegistry();
+
+    Counter counters[METRICS_MAX_COUNTERS + 1];      // Last slot is the overflow sink
+    Gauge gauges[METRICS_MAX_GAUGES + 1];
+    Histogram histograms[METRICS_MAX_HISTOGRAMS + 1];
+    uint8_t numCounters;
+    uint8_t numGauges;
+    uint8_t numHistograms;
+
+    // Built-in heap gauges, refreshed on every render
+    Gauge* heapFree;
+    Gauge* heapMinFree;
+    Gauge* heapLargestBlock;
+    Gauge* uptimeSeconds;
+
+    void renderHeader(Print& out, const char* name, const char* help, const char* type);
+    void renderLabels(Print& out, const char* labels, const char* extra = nullptr);
+};
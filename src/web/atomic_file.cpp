@@ -0,0 +1,225 @@
+/**
+ * Crash-Safe JSON Files Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "atomic_file.h"
+#include <rom/crc.h>
+
+// "\n#crc32=" + 8 hex digits + "\n"
+#define TRAILER_PREFIX "\n#crc32="
+#define TRAILER_PREFIX_LEN 8
+#define TRAILER_LEN 17
+
+// Chunk size for CRC checks (stack buffer)
+#define CRC_CHUNK_SIZE 128
+
+/**
+ * Print adapter that forwards to a file and keeps a running CRC-32
+ */
+class CrcWriter : public Print {
+public:
+    CrcWriter(File& f) : file(f), crc(0), length(0), shortWrite(false) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size_t n = file.write(buffer, size);
+        crc = crc32_le(crc, buffer, n);
+        length += n;
+        if (n < size) {
+            shortWrite = true;
+        }
+        return n;
+    }
+
+    uint32_t getCrc() const {
+        return crc;
+    }
+
+    size_t getLength() const {
+        return length;
+    }
+
+    // True if any write came up short (e.g. full filesystem)
+    bool failed() const {
+        return shortWrite;
+    }
+
+private:
+    File& file;
+    uint32_t crc;
+    size_t length;
+    bool shortWrite;
+};
+
+static String tempPath(const char* path) {
+    return String(path) + ".tmp";
+}
+
+static String badPath(const char* path) {
+    return String(path) + ".bad";
+}
+
+size_t AtomicFile::write(const char* path, const JsonDocument& doc) {
+    return write(path, [&doc](Print& out) {
+        return serializeJson(doc, out) == measureJson(doc);
+    });
+}
+
+size_t AtomicFile::write(const char* path, const std::function<bool(Print&)>& produce) {
+    String tmp = tempPath(path);
+    File file = LittleFS.open(tmp, "w");
+    if (!file) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to open %s for writing\n", tmp.c_str());
+        return 0;
+    }
+
+    CrcWriter writer(file);
+    bool produced = produce(writer);
+    size_t len = writer.getLength();
+
+    char trailer[TRAILER_LEN + 1];
+    snprintf(trailer, sizeof(trailer), TRAILER_PREFIX "%08x\n", writer.getCrc());
+
+    // A short write (e.g. full filesystem) must not replace the live file
+    bool complete = produced && len > 0 && !writer.failed() &&
+                    file.write((const uint8_t*)trailer, TRAILER_LEN) == TRAILER_LEN;
+    file.close();
+
+    // Reason: Rename is the commit point; until it happens the live file is
+    // untouched, and LittleFS makes the replace itself atomic
+    if (!complete || !LittleFS.rename(tmp, path)) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to write %s\n", path);
+        LittleFS.remove(tmp);
+        return 0;
+    }
+
+    return len;
+}
+
+AtomicFile::Status AtomicFile::open(const char* path, File& file) {
+    // Reason: Opening a missing file for reading logs a VFS error on ESP32
+    if (!LittleFS.exists(path)) {
+        return MISSING;
+    }
+
+    file = LittleFS.open(path, "r");
+    if (!file) {
+        return MISSING;
+    }
+
+    Status status = check(file);
+    if (status == CORRUPT) {
+        DEBUG_PRINTF("[STORAGE] ERROR: %s failed its CRC check\n", path);
+        file.close();
+    }
+    return status;
+}
+
+AtomicFile::Status AtomicFile::verify(const char* path) {
+    File file;
+    Status status = open(path, file);
+    if (status == OK || status == LEGACY) {
+        file.close();
+    }
+    return status;
+}
+
+AtomicFile::Status AtomicFile::recover(const char* path) {
+    Status status = verify(path);
+
+    // A leftover temp file is an interrupted save. The live file still holds
+    // the previous version, so the temp is normally just dropped.
+    String tmp = tempPath(path);
+    if (LittleFS.exists(tmp)) {
+        if ((status == MISSING || status == CORRUPT) && verify(tmp.c_str()) == OK &&
+            LittleFS.rename(tmp, path)) {
+            DEBUG_PRINTF("[STORAGE] Recovered %s from its temp file\n", path);
+            status = OK;
+        } else {
+            DEBUG_PRINTF("[STORAGE] Discarding interrupted save of %s\n", path);
+            LittleFS.remove(tmp);
+        }
+    }
+
+    // Keep a damaged file for inspection, out of the way of the next save
+    if (status == CORRUPT) {
+        String bad = badPath(path);
+        LittleFS.remove(bad);
+        LittleFS.rename(path, bad.c_str());
+        DEBUG_PRINTF("[STORAGE] WARNING: %s is corrupt, moved to %s\n", path, bad.c_str());
+    }
+
+    return status;
+}
+
+void AtomicFile::remove(const char* path) {
+    String tmp = tempPath(path);
+    String bad = badPath(path);
+
+    if (LittleFS.exists(path)) {
+        LittleFS.remove(path);
+    }
+    if (LittleFS.exists(tmp)) {
+        LittleFS.remove(tmp);
+    }
+    if (LittleFS.exists(bad)) {
+        LittleFS.remove(bad);
+    }
+}
+
+const char* AtomicFile::statusName(Status status) {
+    switch (status) {
+        case OK:      return "ok";
+        case LEGACY:  return "legacy";
+        case MISSING: return "missing";
+        case CORRUPT: return "corrupt";
+        default:      return "unknown";
+    }
+}
+
+AtomicFile::Status AtomicFile::check(File& file) {
+    size_t size = file.size();
+    char trailer[TRAILER_LEN + 1];
+
+    // Files without a trailer predate this format
+    if (size < TRAILER_LEN || !file.seek(size - TRAILER_LEN) ||
+        file.read((uint8_t*)trailer, TRAILER_LEN) != TRAILER_LEN ||
+        memcmp(trailer, TRAILER_PREFIX, TRAILER_PREFIX_LEN) != 0) {
+        file.seek(0);
+        return LEGACY;
+    }
+
+    trailer[TRAILER_LEN] = '\0';
+    char* end = nullptr;
+    uint32_t expected = strtoul(trailer + TRAILER_PREFIX_LEN, &end, 16);
+    if (end != trailer + TRAILER_LEN - 1 || *end != '\n') {
+        return CORRUPT;
+    }
+
+    // CRC the JSON part in small chunks so large files need no extra RAM
+    uint8_t chunk[CRC_CHUNK_SIZE];
+    uint32_t crc = 0;
+    size_t remaining = size - TRAILER_LEN;
+    file.seek(0);
+    while (remaining > 0) {
+        size_t n = file.read(chunk, min(remaining, (size_t)CRC_CHUNK_SIZE));
+        if (n == 0) {
+            return CORRUPT;
+        }
+        crc = crc32_le(crc, chunk, n);
+        remaining -= n;
+    }
+
+    if (crc != expected) {
+        return CORRUPT;
+    }
+
+    file.seek(0);
+    return OK;
+}
@@ -0,0 +1,125 @@
+/**
+ * Crash-Safe JSON Files for ESP32 Simon Says
+ *
+ * Saves never touch the live file: the document is written to <path>.tmp
+ * with a CRC-32 trailer, closed, and then renamed over the live file (an
+ * atomic replace on LittleFS). A power cut at any point leaves either the
+ * old or the new file intact; a torn .tmp is discarded by recover().
+ *
+ * File layout:
+ *     <JSON document>\n#crc32=xxxxxxxx\n
+ *
+ * The CRC covers the JSON bytes. deserializeJson() stops at the end of the
+ * document, so the trailer is invisible to readers. Files without a trailer
+ * (written before this format) are accepted as they are.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include "../config.h"
+
+class AtomicFile {
+public:
+    /**
+     * Result of checking a stored file
+     */
+    enum Status : uint8_t {
+        // Readable states come first: status >= MISSING means nothing to parse
+        OK = 0,       // Trailer present and CRC matches
+        LEGACY,       // No trailer (older format); contents unverified
+        MISSING,      // File does not exist
+        CORRUPT       // Trailer or CRC mismatch (torn or damaged write)
+    };
+
+    /**
+     * Write a JSON document crash-safely (temp file, CRC trailer, rename)
+     *
+     * Args:
+     *     path: Live file path
+     *     doc: Document to write
+     *
+     * Returns:
+     *     size_t: JSON bytes written, or 0 on failure (live file untouched)
+     */
+    static size_t write(const char* path, const JsonDocument& doc);
+
+    /**
+     * Write a JSON text produced in pieces crash-safely (for files too large
+     * to hold as one document)
+     *
+     * Args:
+     *     path: Live file path
+     *     produce: Prints the JSON text; returns false if it failed
+     *
+     * Returns:
+     *     size_t: JSON bytes written, or 0 on failure (live file untouched)
+     */
+    static size_t write(const char* path, const std::function<bool(Print&)>& produce);
+
+    /**
+     * Open a file for reading after checking its CRC
+     *
+     * Args:
+     *     path: Live file path
+     *     file: Set to the open file, positioned at the start of the JSON
+     *
+     * Returns:
+     *     Status: OK or LEGACY if the file can be parsed
+     */
+    static Status open(const char* path, File& file);
+
+    /**
+     * Check a file without keeping it open
+     *
+     * Args:
+     *     path: File path
+     *
+     * Returns:
+     *     Status: File status
+     */
+    static Status verify(const char* path);
+
+    /**
+     * Bring a file back to a consistent state after a reset (call from begin())
+     *
+     * Removes a leftover temp file, promoting it first if it is complete and
+     * the live file is not. A corrupt live file is moved aside to <path>.bad
+     * so the next save can start clean.
+     *
+     * Args:
+     *     path: Live file path
+     *
+     * Returns:
+     *     Status: Status of the live file after recovery
+     */
+    static Status recover(const char* path);
+
+    /**
+     * Delete a file along with its temp and .bad companions
+     *
+     * Args:
+     *     path: Live file path
+     */
+    static void remove(const char* path);
+
+    /**
+     * Get a status name for logs and JSON
+     *
+     * Args:
+     *     status: File status
+     *
+     * Returns:
+     *     const char*: Status name
+     */
+    static const char* statusName(Status status);
+
+private:
+    static Status check(File& file);
+};
@@ -6,14 +6,95 @@
  */
 
 #include "data_storage.h"
+#include "atomic_file.h"
+#include "../game/elo_rating.h"
+#include "../system/metrics.h"
 
 // File paths
 const char* DataStorage::PLAYERS_FILE = "/players.json";
-const char* DataStorage::HISTORY_FILE = "/history.json";
+const char* DataStorage::HISTORY_FILE = "/history.json";    // Before the log; imported once
 const char* DataStorage::SCORES_FILE = "/scores.json";
 const char* DataStorage::SETTINGS_FILE = "/settings.json";
+const char* DataStorage::WEAR_FILE = "/wear.json";
+const char* DataStorage::RANKS_FILE = "/ranks.json";
 
-DataStorage::DataStorage() : initialized(false), timeOffsetSeconds(0) {
+// Names of the WEAR_* files in /api/storage and WEAR_FILE
+static const char* WEAR_NAMES[] = {"players", "history", "scores", "settings", "ranks", "archive", "snapshot", "wear",
+                                   "analytics", "replays"};
+static_assert(sizeof(WEAR_NAMES) / sizeof(WEAR_NAMES[0]) == DataStorage::NUM_WEAR_FILES,
+              "Every WEAR_* file needs a name");
+
+// Metric family for all file operations
+static const char* STORAGE_METRIC = "simon_storage_operation_duration_seconds";
+static const char* STORAGE_METRIC_HELP = "LittleFS load/save latency per file";
+
+/**
+ * Holds the (recursive) cache lock for the current scope
+ */
+class CacheGuard {
+public:
+    explicit CacheGuard(SemaphoreHandle_t m) : mutex(m) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+    ~CacheGuard() {
+        xSemaphoreGiveRecursive(mutex);
+    }
+
+private:
+    SemaphoreHandle_t mutex;
+};
+
+/**
+ * Estimate block erases for rewriting a file of the given size
+ * (copy-on-write: every block of the new copy is freshly erased)
+ */
+static uint32_t blocksFor(size_t bytes) {
+    return bytes / STORAGE_BLOCK_SIZE + 1;
+}
+
+static_assert(STORAGE_PLAYERS_CHECKPOINT_GAMES < MAX_GAME_HISTORY,
+              "players.json checkpoint must come before the log drops its games");
+
+DataStorage::DataStorage() :
+    initialized(false),
+    timeOffsetSeconds(0),
+    loadedMask(0),
+    dirtyMask(0),
+    firstDirtyTime(0),
+    lastChangeTime(0),
+    historyPending(0),
+    historySeq(0),
+    playersSeq(0),
+    statsSeq(0),
+    ranksSeq(0),
+    historyLog(STORAGE_HISTORY_DIR, HISTORY_SEGMENT_RECORDS, MAX_GAME_HISTORY),
+    archive(STORAGE_ARCHIVE_FILE),
+    wearGames(0),
+    wearDirty(false),
+    lastWearSave(0) {
+    memset(wear, 0, sizeof(wear));
+
+    // Reason: Recursive so recordGame() can hold it across getPlayer()/updatePlayer()
+    cacheLock = xSemaphoreCreateRecursiveMutex();
+
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    loadPlayersLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"load\",file=\"players\"");
+    savePlayersLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"players\"");
+    loadHistoryLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"load\",file=\"history\"");
+    saveHistoryLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"history\"");
+    loadScoresLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"load\",file=\"scores\"");
+    saveScoresLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"scores\"");
+    loadSettingsLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"load\",file=\"settings\"");
+    saveSettingsLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"settings\"");
+    loadRanksLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"load\",file=\"ranks\"");
+    saveRanksLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"ranks\"");
+    saveSnapshotLatency = metrics.histogram(STORAGE_METRIC, STORAGE_METRIC_HELP, "op=\"save\",file=\"snapshot\"");
+    corruptFiles = metrics.counter("simon_storage_corrupt_files_total",
+                                   "Stored files that failed their CRC check at boot");
+    fileCommits = metrics.counter("simon_storage_file_commits_total",
+                                  "Players/history/scores writes (rewrites or appends)");
+    commitBytes = metrics.counter("simon_storage_commit_bytes_total",
+                                  "Bytes written by players/history/scores writes");
 }
 
 bool DataStorage::begin() {
@@ -34,6 +115,27 @@ bool DataStorage::begin() {
                     total, used, total - used);
     }
 
+    // Finish or discard any save a reset interrupted
+    const char* files[] = {PLAYERS_FILE, HISTORY_FILE, SCORES_FILE, SETTINGS_FILE, WEAR_FILE, RANKS_FILE};
+    for (const char* path : files) {
+        if (AtomicFile::recover(path) == AtomicFile::CORRUPT) {
+            corruptFiles->inc();
+        }
+    }
+
+    loadWear();
+    historyLog.begin();
+    importLegacyHistory();
+    archive.begin();
+    seedArchive();
+
+    // Reason: Built here only when missing or stale (first boot, or a power
+    // cut mid-save); otherwise reads start from the mapped copy
+    if (!snapshot.begin() && snapshot.available()) {
+        CacheGuard guard(cacheLock);
+        writeSnapshot();
+    }
+
     // Initialize default settings file if it doesn't exist
     if (!LittleFS.exists(SETTINGS_FILE)) {
         DEBUG_PRINTLN("[STORAGE] Creating default settings file...");
@@ -72,91 +174,127 @@ String DataStorage::createPlayer(const String& name) {
     if (!initialized) return "";
 
     DEBUG_PRINTF("[STORAGE] Creating player: %s\n", name.c_str());
-
-    // Load existing players
-    std::vector<Player> players = loadPlayers();
+    CacheGuard guard(cacheLock);
+    loadPlayerTable();
 
     // Check if we're at the limit
-    if (players.size() >= MAX_PLAYERS) {
+    if (playerTable.size() >= MAX_PLAYERS) {
         DEBUG_PRINTLN("[STORAGE] ERROR: Maximum players reached");
         return "";
     }
 
-    // Create new player
-    Player newPlayer;
-    newPlayer.id = generateUUID();
-    newPlayer.name = name;
-    newPlayer.gamesPlayed = 0;
-    newPlayer.totalScore = 0;
-    newPlayer.bestScore = 0;
-    newPlayer.wins = 0;
-    newPlayer.created = getCurrentTimestamp();  // Use synced timestamp
-
-    players.push_back(newPlayer);
-
-    if (savePlayers(players)) {
-        DEBUG_PRINTF("[STORAGE] Player created with ID: %s\n", newPlayer.id.c_str());
-
-        // Verify the file was actually written
-        if (LittleFS.exists(PLAYERS_FILE)) {
-            File verifyFile = LittleFS.open(PLAYERS_FILE, "r");
-            if (verifyFile) {
-                DEBUG_PRINTF("[STORAGE] Verified: %s exists, size: %d bytes\n",
-                            PLAYERS_FILE, verifyFile.size());
-                verifyFile.close();
-            }
-        } else {
-            DEBUG_PRINTF("[STORAGE] WARNING: %s was not created!\n", PLAYERS_FILE);
-        }
+    // Create new player (timestamp is synced from the browser)
+    PlayerId id = PlayerId::generate();
+    if (playerTable.add(id, name.c_str(), getCurrentTimestamp()) == INVALID_PLAYER_HANDLE) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to save player!");
+        return "";
+    }
+
+    markDirty(CACHE_PLAYERS);
+    String text = id.toString();
+    DEBUG_PRINTF("[STORAGE] Player created with ID: %s\n", text.c_str());
 
-        return newPlayer.id;
+    // Reason: Profile edits are rare and user-visible; write them through
+    if (!flush()) {
+        DEBUG_PRINTLN("[STORAGE] WARNING: Player kept in RAM, will retry save");
     }
 
-    DEBUG_PRINTLN("[STORAGE] ERROR: Failed to save player!");
-    return "";
+    return text;
+}
+
+PlayerHandle DataStorage::findPlayer(const PlayerId& id) {
+    if (!initialized || id.isNil()) return INVALID_PLAYER_HANDLE;
+
+    CacheGuard guard(cacheLock);
+    loadPlayerTable();
+    return playerTable.find(id);
+}
+
+PlayerHandle DataStorage::findPlayer(const char* id) {
+    PlayerId parsed;
+    if (!PlayerId::parse(id, parsed)) {
+        return INVALID_PLAYER_HANDLE;
+    }
+    return findPlayer(parsed);
 }
 
 bool DataStorage::getPlayer(const String& id, Player& player) {
-    std::vector<Player> players = loadPlayers();
+    if (!initialized) return false;
 
-    for (const auto& p : players) {
-        if (p.id == id) {
-            player = p;
-            return true;
-        }
+    CacheGuard guard(cacheLock);
+    if (snapshotServes(CACHE_PLAYERS)) {
+        PlayerId parsed;
+        return PlayerId::parse(id.c_str(), parsed) && fillPlayer(snapshot.findPlayer(parsed), player);
     }
+    return fillPlayer(findPlayer(id.c_str()), player);
+}
 
-    return false;
+bool DataStorage::getPlayerName(PlayerHandle handle, String& name) {
+    CacheGuard guard(cacheLock);
+    const char* stored = playerTable.name(handle);
+    if (!stored) {
+        return false;
+    }
+    name = stored;
+    return true;
 }
 
 std::vector<Player> DataStorage::getAllPlayers() {
-    return loadPlayers();
+    std::vector<Player> players;
+    if (!initialized) return players;
+
+    CacheGuard guard(cacheLock);
+    if (snapshotServes(CACHE_PLAYERS)) {
+        players.resize(snapshot.playerCount());
+        for (uint8_t i = 0; i < players.size(); i++) {
+            fillPlayer(snapshot.player(i), players[i]);
+        }
+        return players;
+    }
+
+    loadPlayerTable();
+    players.reserve(playerTable.size());
+    for (uint8_t slot = 0; slot < MAX_PLAYERS; slot++) {
+        Player p;
+        if (fillPlayer(playerTable.handleAt(slot), p)) {
+            players.push_back(p);
+        }
+    }
+    return players;
 }
 
 bool DataStorage::updatePlayer(const String& id, const Player& player) {
-    std::vector<Player> players = loadPlayers();
+    if (!initialized) return false;
 
-    for (auto& p : players) {
-        if (p.id == id) {
-            p = player;
-            return savePlayers(players);
-        }
+    CacheGuard guard(cacheLock);
+    PlayerHandle handle = findPlayer(id.c_str());
+    PlayerRecord* rec = playerTable.get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    rec->gamesPlayed = player.gamesPlayed;
+    rec->totalScore = player.totalScore;
+    rec->bestScore = player.bestScore;
+    rec->wins = player.wins;
+    if (player.name != playerTable.name(handle)) {
+        playerTable.rename(handle, player.name.c_str());
     }
 
-    return false;
+    markDirty(CACHE_PLAYERS);
+    return true;
 }
 
 bool DataStorage::deletePlayer(const String& id) {
-    std::vector<Player> players = loadPlayers();
+    if (!initialized) return false;
 
-    for (auto it = players.begin(); it != players.end(); ++it) {
-        if (it->id == id) {
-            players.erase(it);
-            return savePlayers(players);
-        }
+    CacheGuard guard(cacheLock);
+    if (!playerTable.remove(findPlayer(id.c_str()))) {
+        return false;
     }
 
-    return false;
+    markDirty(CACHE_PLAYERS);
+    return flush();
 }
 
 // ============================================================================
@@ -166,16 +304,27 @@ bool DataStorage::deletePlayer(const String& id) {
 bool DataStorage::recordGame(const GameSession& session) {
     if (!initialized) return false;
 
+    // Reason: Held across the history/players/scores updates so a web request
+    // never sees (or interleaves with) a half-recorded game
+    CacheGuard guard(cacheLock);
+
+    // Reason: Loading the table also finds the newest game sequence, which
+    // guest games need too
+    loadPlayerTable();
+
     // Create a mutable copy to fill in missing data
     GameSession gameSession = session;
 
     // Fill in player name if we have a valid player ID
-    if (gameSession.playerId.length() > 0 && gameSession.playerId != "guest") {
-        Player player;
-        if (getPlayer(gameSession.playerId, player)) {
-            gameSession.playerName = player.name;
+    PlayerHandle handle = INVALID_PLAYER_HANDLE;
+    char idText[PLAYER_ID_TEXT_LENGTH];
+    gameSession.playerId.format(idText);
+    if (!gameSession.playerId.isNil()) {
+        handle = findPlayer(gameSession.playerId);
+        if (handle != INVALID_PLAYER_HANDLE) {
+            gameSession.playerName = playerTable.name(handle);
         } else {
-            DEBUG_PRINTF("[STORAGE] WARNING: Player ID %s not found!\n", gameSession.playerId.c_str());
+            DEBUG_PRINTF("[STORAGE] WARNING: Player ID %s not found!\n", idText);
             gameSession.playerName = "Unknown";
         }
     } else {
@@ -186,42 +335,49 @@ bool DataStorage::recordGame(const GameSession& session) {
     gameSession.timestamp = getCurrentTimestamp();
 
     DEBUG_PRINTF("[STORAGE] Recording game: Player=%s (%s), Score=%d, Time=%d\n",
-                gameSession.playerName.c_str(), gameSession.playerId.c_str(),
+                gameSession.playerName.c_str(), idText,
                 gameSession.score, gameSession.timestamp);
 
-    // Load existing history
-    std::vector<GameSession> history = loadHistory();
+    // Reason: Loaded before the append, so counts seeded from the history
+    // (first boot after an upgrade) don't include this game twice
+    loadScoreRanks();
+
+    // Add new session at the beginning of the history
+    historySeq++;
+    if (!appendHistory(gameSession)) {
+        return false;
+    }
 
-    // Add new session at the beginning
-    history.insert(history.begin(), gameSession);
+    wearGames++;
+    wearDirty = true;
 
-    // Keep only the most recent games
-    if (history.size() > MAX_GAME_HISTORY) {
-        history.resize(MAX_GAME_HISTORY);
+    size_t archived = archive.add(gameSession.playerId, gameSession.timestamp,
+                                  gameSession.score, gameSession.duration);
+    if (archived) {
+        recordWrite(WEAR_ARCHIVE, archived, 1);
     }
 
-    // Save history
-    if (!saveHistory(history)) {
-        return false;
+    // Reason: The log line already counts the game for the next boot, so
+    // ranks.json is only checkpointed, like players.json below
+    scoreRanks.add(gameSession.difficulty, gameSession.score);
+    if (historySeq - ranksSeq >= STORAGE_PLAYERS_CHECKPOINT_GAMES) {
+        markDirty(CACHE_RANKS);
     }
 
-    // Update player statistics (only for non-guest players)
-    if (gameSession.playerId.length() > 0 && gameSession.playerId != "guest") {
-        Player player;
-        if (getPlayer(gameSession.playerId, player)) {
-            player.gamesPlayed++;
-            player.totalScore += gameSession.score;
-            if (gameSession.score > player.bestScore) {
-                player.bestScore = gameSession.score;
-            }
-            // Consider a "win" if they reached a certain threshold (e.g., score > 5)
-            if (gameSession.score >= 5) {
-                player.wins++;
-            }
-            updatePlayer(gameSession.playerId, player);
-            DEBUG_PRINTF("[STORAGE] Updated player %s stats: games=%d, best=%d\n",
-                        player.name.c_str(), player.gamesPlayed, player.bestScore);
-        }
+    // Update player statistics in place (only for registered players). The
+    // history line already holds the game, so nothing else is rewritten.
+    if (playerTable.recordGame(handle, gameSession.score, gameSession.difficulty,
+                               gameSession.timestamp)) {
+        const PlayerRecord* player = playerTable.get(handle);
+        statsSeq = historySeq;
+        DEBUG_PRINTF("[STORAGE] Updated player %s stats: games=%d, best=%d, streak=%d\n",
+                    playerTable.name(handle), player->gamesPlayed, player->bestScore, player->streak);
+    }
+
+    // Reason: players.json must catch up before the log drops a game whose
+    // stats it does not hold yet
+    if (statsSeq > playersSeq && historySeq - playersSeq >= STORAGE_PLAYERS_CHECKPOINT_GAMES) {
+        markDirty(CACHE_PLAYERS);
     }
 
     // Check if it's a high score
@@ -241,11 +397,14 @@ std::vector<GameSession> DataStorage::getRecentGames(uint8_t limit) {
 }
 
 std::vector<GameSession> DataStorage::getPlayerGames(const String& playerId, uint8_t limit) {
-    std::vector<GameSession> allGames = loadHistory();
     std::vector<GameSession> playerGames;
+    PlayerId id;
+    // Reason: "guest" (and anything else unparsable) selects the guest games
+    PlayerId::parse(playerId.c_str(), id);
 
+    std::vector<GameSession> allGames = loadHistory();
     for (const auto& game : allGames) {
-        if (game.playerId == playerId) {
+        if (game.playerId == id) {
             playerGames.push_back(game);
             if (playerGames.size() >= limit) break;
         }
@@ -254,14 +413,108 @@ std::vector<GameSession> DataStorage::getPlayerGames(const String& playerId, uin
     return playerGames;
 }
 
+void DataStorage::getTimeline(uint32_t fromDay, uint32_t toDay, const String& playerId,
+                              ArchiveTimeline& out) {
+    PlayerId id;
+    // Reason: "guest" (and anything else unparsable) selects the guest games
+    PlayerId::parse(playerId.c_str(), id);
+
+    CacheGuard guard(cacheLock);
+    archive.timeline(fromDay, toDay, playerId.length() > 0 ? &id : nullptr, out);
+}
+
+// ============================================================================
+// Ratings
+// ============================================================================
+
+bool DataStorage::recordMatch(const PlayerId* ids, const uint16_t* scores, uint8_t count) {
+    if (!initialized) return false;
+
+    CacheGuard guard(cacheLock);
+
+    PlayerHandle handles[RATING_MAX_PLAYERS];
+    float ratings[RATING_MAX_PLAYERS];
+    uint16_t rated[RATING_MAX_PLAYERS];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count && n < RATING_MAX_PLAYERS; i++) {
+        PlayerHandle handle = findPlayer(ids[i]);
+        const PlayerRecord* rec = playerTable.get(handle);
+        if (!rec) {
+            continue;
+        }
+        handles[n] = handle;
+        ratings[n] = rec->rating;
+        rated[n] = scores[i];
+        n++;
+    }
+
+    if (n < 2) {
+        DEBUG_PRINTLN("[STORAGE] Match not rated (fewer than two registered players)");
+        return false;
+    }
+
+    EloRating::update(ratings, rated, n);
+    for (uint8_t i = 0; i < n; i++) {
+        playerTable.get(handles[i])->matches++;
+        playerTable.setRating(handles[i], ratings[i]);
+        DEBUG_PRINTF("[STORAGE] Rating of %s: %.1f\n", playerTable.name(handles[i]), ratings[i]);
+    }
+
+    markDirty(CACHE_PLAYERS);
+    return true;
+}
+
+std::vector<Player> DataStorage::getLeaderboard(uint8_t limit) {
+    std::vector<Player> players;
+    if (!initialized) return players;
+
+    CacheGuard guard(cacheLock);
+    if (snapshotServes(CACHE_PLAYERS)) {
+        for (uint8_t pos = 0; pos < snapshot.playerCount() && players.size() < limit; pos++) {
+            const SnapshotPlayer* p = snapshot.playerByRating(pos);
+            if (p->matches == 0) {
+                continue;
+            }
+            players.resize(players.size() + 1);
+            fillPlayer(p, players.back());
+        }
+        return players;
+    }
+
+    loadPlayerTable();
+    for (uint8_t pos = 0; pos < playerTable.size() && players.size() < limit; pos++) {
+        PlayerHandle handle = playerTable.handleByRating(pos);
+        const PlayerRecord* rec = playerTable.get(handle);
+        if (!rec || rec->matches == 0) {
+            continue;
+        }
+        Player p;
+        fillPlayer(handle, p);
+        players.push_back(p);
+    }
+    return players;
+}
+
 // ============================================================================
 // High Scores
 // ============================================================================
 
 std::vector<HighScore> DataStorage::getHighScores(DifficultyLevel difficulty, uint8_t limit) {
-    std::vector<HighScore> allScores = loadHighScores();
     std::vector<HighScore> filteredScores;
 
+    CacheGuard guard(cacheLock);
+    if (snapshotServes(CACHE_SCORES)) {
+        // Reason: Already grouped and ordered on flash, so only the
+        // returned entries are copied
+        filteredScores.resize(min(snapshot.scoreCount(difficulty), limit));
+        for (uint8_t i = 0; i < filteredScores.size(); i++) {
+            fillHighScore(*snapshot.score(difficulty, i), filteredScores[i]);
+        }
+        return filteredScores;
+    }
+
+    std::vector<HighScore> allScores = loadHighScores();
+
     for (const auto& score : allScores) {
         if (score.difficulty == difficulty) {
             filteredScores.push_back(score);
@@ -282,6 +535,15 @@ std::vector<HighScore> DataStorage::getHighScores(DifficultyLevel difficulty, ui
 }
 
 std::vector<HighScore> DataStorage::getAllTimeHighScores(uint8_t limit) {
+    CacheGuard guard(cacheLock);
+    if (snapshotServes(CACHE_SCORES)) {
+        std::vector<HighScore> topScores(min(snapshot.scoreCount(), limit));
+        for (uint8_t i = 0; i < topScores.size(); i++) {
+            fillHighScore(*snapshot.score(i), topScores[i]);
+        }
+        return topScores;
+    }
+
     std::vector<HighScore> allScores = loadHighScores();
 
     // Sort by score descending
@@ -298,6 +560,7 @@ std::vector<HighScore> DataStorage::getAllTimeHighScores(uint8_t limit) {
 }
 
 bool DataStorage::addHighScore(const GameSession& session) {
+    CacheGuard guard(cacheLock);
     std::vector<HighScore> scores = loadHighScores();
 
     // Create high score entry
@@ -308,14 +571,19 @@ bool DataStorage::addHighScore(const GameSession& session) {
     newScore.difficulty = session.difficulty;
     newScore.timestamp = session.timestamp;
 
-    // Add to list
-    scores.push_back(newScore);
+    // Reason: Most games don't make the table once it is full; skipping the
+    // save then spares a scores.json rewrite
+    if (scores.size() >= MAX_HIGH_SCORES_TOTAL * NUM_DIFFICULTIES &&
+        newScore.score <= scores.back().score) {
+        return false;
+    }
 
-    // Sort by score descending
-    std::sort(scores.begin(), scores.end(),
+    // Insert after any equal scores (stable descending order)
+    auto pos = std::upper_bound(scores.begin(), scores.end(), newScore,
         [](const HighScore& a, const HighScore& b) {
             return a.score > b.score;
         });
+    scores.insert(pos, newScore);
 
     // Keep only top scores
     if (scores.size() > MAX_HIGH_SCORES_TOTAL * NUM_DIFFICULTIES) {
@@ -325,6 +593,14 @@ bool DataStorage::addHighScore(const GameSession& session) {
     return saveHighScores(scores);
 }
 
+ScoreRank DataStorage::getScoreRank(DifficultyLevel difficulty, uint16_t score) {
+    if (!initialized) return ScoreRanks().rankOf(difficulty, score);
+
+    CacheGuard guard(cacheLock);
+    loadScoreRanks();
+    return scoreRanks.rankOf(difficulty, score);
+}
+
 // ============================================================================
 // Settings
 // ============================================================================
@@ -341,8 +617,9 @@ GameSettings DataStorage::loadSettings() {
 
     if (!initialized) return settings;
 
-    File file = LittleFS.open(SETTINGS_FILE, "r");
-    if (!file) {
+    ScopedLatency timer(loadSettingsLatency);
+    File file;
+    if (AtomicFile::open(SETTINGS_FILE, file) >= AtomicFile::MISSING) {
         DEBUG_PRINTLN("[STORAGE] Settings file not found, using defaults");
         return settings;
     }
@@ -362,13 +639,14 @@ GameSettings DataStorage::loadSettings() {
     settings.soundEnabled = doc["soundEnabled"].as<bool>();
     settings.deepSleepEnabled = doc["deepSleepEnabled"].as<bool>();
 
-    DEBUG_PRINTLN("[STORAGE] Settings loaded");
+    LOG_D(LOG_TAG_STORAGE, "Settings loaded\n");
     return settings;
 }
 
 bool DataStorage::saveSettings(const GameSettings& settings) {
     if (!initialized) return false;
 
+    ScopedLatency timer(saveSettingsLatency);
     StaticJsonDocument<512> doc;
 
     doc["difficulty"] = (int)settings.defaultDifficulty;
@@ -377,19 +655,14 @@ bool DataStorage::saveSettings(const GameSettings& settings) {
     doc["soundEnabled"] = settings.soundEnabled;
     doc["deepSleepEnabled"] = settings.deepSleepEnabled;
 
-    File file = LittleFS.open(SETTINGS_FILE, "w");
-    if (!file) {
-        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open settings file for writing");
-        return false;
-    }
-
-    if (serializeJson(doc, file) == 0) {
+    size_t bytesWritten = AtomicFile::write(SETTINGS_FILE, doc);
+    if (bytesWritten == 0) {
         DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write settings");
-        file.close();
         return false;
     }
 
-    file.close();
+    recordWrite(WEAR_SETTINGS, bytesWritten, blocksFor(bytesWritten));
+
     DEBUG_PRINTLN("[STORAGE] Settings saved");
     return true;
 }
@@ -403,10 +676,27 @@ bool DataStorage::factoryReset() {
 
     DEBUG_PRINTLN("[STORAGE] Performing factory reset...");
 
-    LittleFS.remove(PLAYERS_FILE);
-    LittleFS.remove(HISTORY_FILE);
-    LittleFS.remove(SCORES_FILE);
-    LittleFS.remove(SETTINGS_FILE);
+    // Drop unsaved changes too, and start from empty collections
+    CacheGuard guard(cacheLock);
+    snapshot.invalidate();
+    playerTable.clear();
+    historyCache.clear();
+    scoresCache.clear();
+    scoreRanks.clear();
+    ranksSeq = historySeq;
+    loadedMask = CACHE_PLAYERS | CACHE_HISTORY | CACHE_SCORES | CACHE_RANKS;
+    dirtyMask = 0;
+    historyPending = 0;
+
+    // Wear counters describe the flash, not the data, so they are kept
+    AtomicFile::remove(PLAYERS_FILE);
+    historyLog.clear();
+    AtomicFile::remove(HISTORY_FILE);
+    AtomicFile::remove(SCORES_FILE);
+    AtomicFile::remove(SETTINGS_FILE);
+    AtomicFile::remove(RANKS_FILE);
+    archive.clear();
+    writeSnapshot();
 
     DEBUG_PRINTLN("[STORAGE] Factory reset complete");
     return true;
@@ -421,177 +711,702 @@ bool DataStorage::getStorageStats(size_t& totalBytes, size_t& usedBytes) {
     return true;
 }
 
-String DataStorage::generateUUID() {
-    // Simple UUID generation using random numbers
-    // Format: xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
-    String uuid = "";
-    const char* hex = "0123456789abcdef";
+void DataStorage::update(bool gameActive) {
+    // Reason: One append per batch keeps the archive a few bytes per day;
+    // writing it with every flush would add a record per game
+    if (!gameActive && archive.commitDue()) {
+        commitArchive();
+    }
+
+    if (dirtyMask == 0) {
+        return;
+    }
+
+    // Reason: A LittleFS rewrite can take tens of ms, so wait for a pause;
+    // the age bound still applies if games follow each other back to back
+    uint32_t now = millis();
+    bool quiet = !gameActive && now - lastChangeTime >= STORAGE_FLUSH_QUIET_MS;
+    bool overdue = now - firstDirtyTime >= STORAGE_MAX_DIRTY_MS;
+
+    if (quiet || overdue) {
+        flush();
+    }
+}
+
+bool DataStorage::flush(bool final) {
+    if (final && initialized) {
+        commitArchive();
+    }
+
+    if (!initialized || (dirtyMask == 0 && !(final && wearDirty))) {
+        return true;
+    }
+
+    CacheGuard guard(cacheLock);
+    uint8_t failed = 0;
+
+    // Reason: The snapshot must never outlive the files it copies, so it is
+    // marked stale before they are rewritten and rebuilt once both are saved.
+    // Games alone leave it as it is (a sector erase per game otherwise): its
+    // game sequence tells a reload which logged games to replay on top.
+    bool snapshotStale = dirtyMask & (CACHE_PLAYERS | CACHE_SCORES);
+    if (snapshotStale) {
+        snapshot.invalidate();
+    }
+
+    if ((dirtyMask & CACHE_PLAYERS) && !writePlayers()) {
+        failed |= CACHE_PLAYERS;
+    }
+    if ((dirtyMask & CACHE_HISTORY) && !writeHistory()) {
+        failed |= CACHE_HISTORY;
+    }
+    if ((dirtyMask & CACHE_SCORES) && !writeHighScores(scoresCache)) {
+        failed |= CACHE_SCORES;
+    }
+    if ((dirtyMask & CACHE_RANKS) && !writeScoreRanks()) {
+        failed |= CACHE_RANKS;
+    }
+
+    if (snapshotStale && !(failed & (CACHE_PLAYERS | CACHE_SCORES))) {
+        writeSnapshot();
+    }
+
+    LOG_D(LOG_TAG_STORAGE, "Flushed cache (mask 0x%02x, failed 0x%02x)\n", dirtyMask, failed);
+
+    // Failed files stay dirty and are retried after another quiet period
+    dirtyMask = failed;
+    if (failed) {
+        firstDirtyTime = lastChangeTime = millis();
+    }
+
+    // Reason: The counters are estimates, so they are saved rarely rather
+    // than adding a rewrite to every flush
+    if (wearDirty && (final || millis() - lastWearSave >= STORAGE_WEAR_SAVE_INTERVAL_MS)) {
+        saveWear();
+    }
+
+    return failed == 0;
+}
+
+void DataStorage::wearToJson(JsonObject obj) {
+    uint32_t totalErases = 0;
+    JsonArray files = obj.createNestedArray("files");
+    for (uint8_t i = 0; i < NUM_WEAR_FILES; i++) {
+        JsonObject f = files.createNestedObject();
+        f["file"] = WEAR_NAMES[i];
+        f["commits"] = wear[i].commits;
+        f["bytes"] = wear[i].bytes;
+        f["erases"] = wear[i].erases;
+        // The snapshot partition has its own sectors, outside this budget
+        if (i != WEAR_SNAPSHOT) {
+            totalErases += wear[i].erases;
+        }
+    }
+
+    // Reason: LittleFS levels wear dynamically across the partition, so the
+    // budget assumes erases end up spread evenly over every block
+    size_t total = initialized ? LittleFS.totalBytes() : 0;
+    uint32_t blocks = total / STORAGE_BLOCK_SIZE;
+    uint64_t budget = (uint64_t)blocks * STORAGE_FLASH_ENDURANCE;
+
+    obj["blockSize"] = STORAGE_BLOCK_SIZE;
+    obj["blocks"] = blocks;
+    obj["enduranceCycles"] = STORAGE_FLASH_ENDURANCE;
+    obj["erases"] = totalErases;
+    obj["games"] = wearGames;
+    obj["lifeUsedPercent"] = budget ? (float)totalErases * 100.0f / budget : 0.0f;
+
+    if (wearGames > 0 && totalErases > 0 && budget > totalErases) {
+        float perGame = (float)totalErases / wearGames;
+        obj["erasesPerGame"] = perGame;
+        obj["gamesRemaining"] = (uint32_t)min((float)(budget - totalErases) / perGame, 4e9f);
+    }
+}
+
+void DataStorage::countWrite(WearFile file, size_t bytes) {
+    CacheGuard guard(cacheLock);
+    recordWrite(file, bytes, blocksFor(bytes));
+}
+
+void DataStorage::recordWrite(uint8_t file, size_t bytes, uint32_t erases) {
+    wear[file].commits++;
+    wear[file].bytes += bytes;
+    wear[file].erases += erases;
+    wearDirty = true;
+
+    if (file != WEAR_SETTINGS) {
+        fileCommits->inc();
+        commitBytes->inc(bytes);
+    }
+}
+
+void DataStorage::commitArchive() {
+    CacheGuard guard(cacheLock);
+    size_t bytesWritten = archive.commit();
+    if (bytesWritten) {
+        recordWrite(WEAR_ARCHIVE, bytesWritten, 1);
+    }
+}
+
+void DataStorage::seedArchive() {
+    if (archive.fileSize() > 0 || historyLog.empty()) {
+        return;
+    }
+
+    // Oldest first, so each day is closed before the next one starts
+    std::vector<GameSession> history = loadHistory();
+    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+        size_t bytesWritten = archive.add(it->playerId, it->timestamp, it->score, it->duration);
+        if (bytesWritten) {
+            recordWrite(WEAR_ARCHIVE, bytesWritten, 1);
+        }
+    }
+    commitArchive();
+    DEBUG_PRINTF("[STORAGE] Archive seeded from %d games\n", history.size());
+}
+
+void DataStorage::writeSnapshot() {
+    if (!snapshot.available()) {
+        return;
+    }
+
+    loadPlayerTable();
+    loadHighScores();
+
+    ScopedLatency timer(saveSnapshotLatency);
+    uint8_t count = min(scoresCache.size(), (size_t)SNAPSHOT_MAX_SCORES);
+    std::vector<SnapshotScoreInput> scores(count);
+    for (uint8_t i = 0; i < count; i++) {
+        const HighScore& hs = scoresCache[i];
+        scores[i].playerId = hs.playerId;
+        scores[i].playerName = hs.playerName.c_str();
+        scores[i].score = hs.score;
+        scores[i].difficulty = hs.difficulty;
+        scores[i].timestamp = hs.timestamp;
+    }
+
+    size_t bytesWritten = snapshot.write(playerTable, scores.data(), count, historySeq, playersSeq);
+    if (bytesWritten == 0) {
+        DEBUG_PRINTLN("[STORAGE] WARNING: Snapshot not written, reading the JSON files");
+        return;
+    }
+
+    recordWrite(WEAR_SNAPSHOT, bytesWritten, blocksFor(bytesWritten));
+    DEBUG_PRINTF("[STORAGE] Snapshot written (%d players, %d scores, %d bytes)\n",
+                playerTable.size(), count, bytesWritten);
+}
+
+bool DataStorage::snapshotServes(uint8_t bit) const {
+    // Reason: Player stats move on with every game but the snapshot only at
+    // checkpoints; until then the table in RAM is the current copy
+    if (bit == CACHE_PLAYERS && snapshot.gameSequence() < statsSeq) {
+        return false;
+    }
+    return snapshot.valid() && !(dirtyMask & bit);
+}
+
+void DataStorage::loadScoreRanks() {
+    if (!(loadedMask & CACHE_RANKS)) {
+        readScoreRanks();
+        loadedMask |= CACHE_RANKS;
+    }
+}
+
+void DataStorage::markDirty(uint8_t bit) {
+    uint32_t now = millis();
+    if (dirtyMask == 0) {
+        firstDirtyTime = now;
+    }
+    lastChangeTime = now;
+    dirtyMask |= bit;
+}
+
+// ============================================================================
+// Write-Behind Caches
+// ============================================================================
+
+void DataStorage::loadPlayerTable() {
+    if (!(loadedMask & CACHE_PLAYERS)) {
+        uint32_t applied;
+        // Reason: A live snapshot holds the same players and needs no parsing
+        if (snapshot.loadPlayers(playerTable)) {
+            applied = snapshot.gameSequence();
+            playersSeq = snapshot.playersSequence();
+        } else {
+            readPlayers();
+            applied = playersSeq;
+        }
+        loadedMask |= CACHE_PLAYERS;
+
+        // Reason: A snapshot may hold games players.json does not, and they
+        // must reach it before the log drops them
+        statsSeq = applied;
+        replayPlayerStats(applied);
+    }
+}
+
+bool DataStorage::fillPlayer(PlayerHandle handle, Player& player) {
+    const PlayerRecord* rec = playerTable.get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    player.id = rec->id;
+    player.name = playerTable.name(handle);
+    player.gamesPlayed = rec->gamesPlayed;
+    player.totalScore = rec->totalScore;
+    player.bestScore = rec->bestScore;
+    player.wins = rec->wins;
+    player.created = rec->created;
+    player.lastPlayed = rec->lastPlayed;
+    player.scoreMean = rec->scoreMean;
+    player.scoreVariance = rec->scoreVariance();
+    player.streak = rec->streak;
+    memcpy(player.bestByDifficulty, rec->bestByDifficulty, sizeof(player.bestByDifficulty));
+    memcpy(player.rankByDifficulty, rec->rankByDifficulty, sizeof(player.rankByDifficulty));
+    player.rating = rec->rating;
+    player.matches = rec->matches;
+    return true;
+}
+
+bool DataStorage::fillPlayer(const SnapshotPlayer* p, Player& player) {
+    if (!p) {
+        return false;
+    }
+
+    player.id = p->id;
+    player.name = snapshot.name(p->nameOffset);
+    player.gamesPlayed = p->gamesPlayed;
+    player.totalScore = p->totalScore;
+    player.bestScore = p->bestScore;
+    player.wins = p->wins;
+    player.created = p->created;
+    player.lastPlayed = p->lastPlayed;
+    player.scoreMean = p->scoreMean;
+    player.scoreVariance = p->scoreVariance();
+    player.streak = p->streak;
+    memcpy(player.bestByDifficulty, p->bestByDifficulty, sizeof(player.bestByDifficulty));
+    memcpy(player.rankByDifficulty, p->rankByDifficulty, sizeof(player.rankByDifficulty));
+    player.rating = p->rating;
+    player.matches = p->matches;
+    return true;
+}
+
+void DataStorage::fillHighScore(const SnapshotScore& s, HighScore& score) {
+    score.playerId = s.playerId;
+    score.playerName = snapshot.name(s.nameOffset);
+    score.score = s.score;
+    score.difficulty = (DifficultyLevel)s.difficulty;
+    score.timestamp = s.timestamp;
+}
+
+std::vector<GameSession> DataStorage::loadHistory() {
+    if (!initialized) return std::vector<GameSession>();
+
+    CacheGuard guard(cacheLock);
+    if (!(loadedMask & CACHE_HISTORY)) {
+        historyCache = readHistory();
+        loadedMask |= CACHE_HISTORY;
+    }
+    return historyCache;
+}
+
+bool DataStorage::appendHistory(const GameSession& session) {
+    if (!initialized) return false;
+
+    CacheGuard guard(cacheLock);
+    if (!(loadedMask & CACHE_HISTORY)) {
+        historyCache = readHistory();
+        loadedMask |= CACHE_HISTORY;
+    }
+    historyCache.insert(historyCache.begin(), session);
+
+    // Keep only the most recent games
+    if (historyCache.size() > MAX_GAME_HISTORY) {
+        historyCache.resize(MAX_GAME_HISTORY);
+    }
+
+    if (historyPending < MAX_GAME_HISTORY) {
+        historyPending++;
+    }
+    markDirty(CACHE_HISTORY);
+    return true;
+}
 
-    for (int i = 0; i < 36; i++) {
-        if (i == 8 || i == 13 || i == 18 || i == 23) {
-            uuid += "-";
+std::vector<HighScore> DataStorage::loadHighScores() {
+    if (!initialized) return std::vector<HighScore>();
+
+    CacheGuard guard(cacheLock);
+    if (!(loadedMask & CACHE_SCORES)) {
+        if (snapshot.valid()) {
+            // Reason: A live snapshot holds the same scores and needs no parsing
+            scoresCache.resize(snapshot.scoreCount());
+            for (uint8_t i = 0; i < scoresCache.size(); i++) {
+                fillHighScore(*snapshot.score(i), scoresCache[i]);
+            }
         } else {
-            uuid += hex[random(0, 16)];
+            scoresCache = readHighScores();
         }
+        loadedMask |= CACHE_SCORES;
     }
+    return scoresCache;
+}
+
+bool DataStorage::saveHighScores(const std::vector<HighScore>& scores) {
+    if (!initialized) return false;
 
-    return uuid;
+    CacheGuard guard(cacheLock);
+    scoresCache = scores;
+    loadedMask |= CACHE_SCORES;
+    markDirty(CACHE_SCORES);
+    return true;
 }
 
 // ============================================================================
-// Private Load/Save Methods
+// Private File I/O
 // ============================================================================
 
-std::vector<Player> DataStorage::loadPlayers() {
-    std::vector<Player> players;
+void DataStorage::readPlayers() {
+    playerTable.clear();
+    playersSeq = 0;
 
-    if (!initialized) return players;
+    if (!initialized) return;
 
-    File file = LittleFS.open(PLAYERS_FILE, "r");
-    if (!file) {
+    ScopedLatency timer(loadPlayersLatency);
+    File file;
+    if (AtomicFile::open(PLAYERS_FILE, file) >= AtomicFile::MISSING) {
         DEBUG_PRINTLN("[STORAGE] Players file not found");
-        return players;
+        return;
     }
 
-    DynamicJsonDocument doc(4096);
+    DynamicJsonDocument doc(PLAYERS_JSON_CAPACITY);
     DeserializationError error = deserializeJson(doc, file);
     file.close();
 
     if (error) {
         DEBUG_PRINTF("[STORAGE] ERROR: Failed to parse players: %s\n", error.c_str());
-        return players;
+        return;
     }
 
+    // Files from before the stats were logged are a bare array that already
+    // holds every game (their history lines carry no sequence)
     JsonArray array = doc.as<JsonArray>();
+    if (array.isNull()) {
+        playersSeq = doc["seq"].as<uint32_t>();
+        array = doc["players"];
+    }
+
+    std::vector<PlayerHandle> legacy;
     for (JsonVariant v : array) {
-        Player p;
-        p.id = v["id"].as<String>();
-        p.name = v["name"].as<String>();
-        p.gamesPlayed = v["gamesPlayed"].as<uint32_t>();
-        p.totalScore = v["totalScore"].as<uint32_t>();
-        p.bestScore = v["bestScore"].as<uint16_t>();
-        p.wins = v["wins"].as<uint16_t>();
-        p.created = v["created"].as<uint32_t>();
-        players.push_back(p);
+        const char* text = v["id"] | "";
+        PlayerId id;
+        PlayerHandle handle = INVALID_PLAYER_HANDLE;
+        if (PlayerId::parse(text, id)) {
+            handle = playerTable.add(id, v["name"] | "", v["created"].as<uint32_t>());
+        }
+        PlayerRecord* rec = playerTable.get(handle);
+        if (!rec) {
+            DEBUG_PRINTF("[STORAGE] WARNING: Skipping player %s\n", text);
+            continue;
+        }
+        rec->gamesPlayed = v["gamesPlayed"].as<uint32_t>();
+        rec->totalScore = v["totalScore"].as<uint32_t>();
+        rec->bestScore = v["bestScore"].as<uint16_t>();
+        rec->wins = v["wins"].as<uint16_t>();
+        rec->rating = v["rating"] | RATING_INITIAL;
+        rec->matches = v["matches"].as<uint16_t>();
+
+        if (v["mean"].isNull()) {
+            legacy.push_back(handle);
+            continue;
+        }
+        rec->lastPlayed = v["lastPlayed"].as<uint32_t>();
+        rec->scoreMean = v["mean"].as<float>();
+        rec->scoreM2 = v["m2"].as<float>();
+        rec->streak = v["streak"].as<uint16_t>();
+        JsonArray best = v["best"];
+        for (uint8_t d = 0; d < NUM_DIFFICULTIES && d < best.size(); d++) {
+            rec->bestByDifficulty[d] = best[d].as<uint16_t>();
+        }
     }
 
-    DEBUG_PRINTF("[STORAGE] Loaded %d players\n", players.size());
-    return players;
+    if (!legacy.empty()) {
+        backfillStats(legacy);
+    }
+    // Ranks follow from the bests, so they are never stored
+    playerTable.rebuildRanks();
+    playerTable.rebuildRatingOrder();
+
+    LOG_D(LOG_TAG_STORAGE, "Loaded %d players\n", playerTable.size());
+}
+
+void DataStorage::backfillStats(const std::vector<PlayerHandle>& handles) {
+    // Only the retained history is left to rebuild from: bests, last game and
+    // streak come out exact if they fall inside it, the variance is estimated
+    std::vector<GameSession> history = loadHistory();
+
+    for (PlayerHandle handle : handles) {
+        PlayerRecord* rec = playerTable.get(handle);
+        if (!rec) {
+            continue;
+        }
+
+        rec->scoreMean = rec->gamesPlayed > 0 ? (float)rec->totalScore / rec->gamesPlayed : 0;
+
+        uint32_t seen = 0;
+        float sum = 0;
+        float sumSquares = 0;
+        bool streakOpen = true;
+        for (const auto& game : history) {      // Newest first
+            if (game.playerId != rec->id) {
+                continue;
+            }
+            if (seen == 0) {
+                rec->lastPlayed = game.timestamp;
+            }
+            if (streakOpen && game.score >= PLAYER_WIN_SCORE) {
+                rec->streak++;
+            } else {
+                streakOpen = false;
+            }
+            if (game.difficulty < NUM_DIFFICULTIES &&
+                game.score > rec->bestByDifficulty[game.difficulty]) {
+                rec->bestByDifficulty[game.difficulty] = game.score;
+            }
+            seen++;
+            sum += game.score;
+            sumSquares += (float)game.score * game.score;
+        }
+
+        if (seen > 1) {
+            float mean = sum / seen;
+            rec->scoreM2 = (sumSquares / seen - mean * mean) * rec->gamesPlayed;
+        }
+    }
+
+    markDirty(CACHE_PLAYERS);
+    DEBUG_PRINTF("[STORAGE] Backfilled stats of %d players from history\n", handles.size());
 }
 
-bool DataStorage::savePlayers(const std::vector<Player>& players) {
+bool DataStorage::writePlayers() {
     if (!initialized) {
         DEBUG_PRINTLN("[STORAGE] ERROR: Storage not initialized!");
         return false;
     }
 
-    DynamicJsonDocument doc(4096);
-    JsonArray array = doc.to<JsonArray>();
+    ScopedLatency timer(savePlayersLatency);
+    DynamicJsonDocument doc(PLAYERS_JSON_CAPACITY);
+    doc["seq"] = historySeq;
+    JsonArray array = doc.createNestedArray("players");
+
+    for (uint8_t slot = 0; slot < MAX_PLAYERS; slot++) {
+        PlayerHandle handle = playerTable.handleAt(slot);
+        const PlayerRecord* p = playerTable.get(handle);
+        if (!p) {
+            continue;
+        }
 
-    for (const auto& p : players) {
+        // Names point into the table (held under cacheLock); only the ID text
+        // is copied (ArduinoJson duplicates a non-const char*)
+        char id[PLAYER_ID_TEXT_LENGTH];
+        p->id.format(id);
         JsonObject obj = array.createNestedObject();
-        obj["id"] = p.id;
-        obj["name"] = p.name;
-        obj["gamesPlayed"] = p.gamesPlayed;
-        obj["totalScore"] = p.totalScore;
-        obj["bestScore"] = p.bestScore;
-        obj["wins"] = p.wins;
-        obj["created"] = p.created;
-    }
-
-    DEBUG_PRINTF("[STORAGE] Opening %s for writing...\n", PLAYERS_FILE);
-    File file = LittleFS.open(PLAYERS_FILE, "w");
-    if (!file) {
-        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open players file for writing");
-        return false;
+        obj["id"] = id;
+        obj["name"] = playerTable.name(handle);
+        obj["gamesPlayed"] = p->gamesPlayed;
+        obj["totalScore"] = p->totalScore;
+        obj["bestScore"] = p->bestScore;
+        obj["wins"] = p->wins;
+        obj["created"] = p->created;
+        obj["lastPlayed"] = p->lastPlayed;
+        obj["mean"] = p->scoreMean;
+        obj["m2"] = p->scoreM2;
+        obj["streak"] = p->streak;
+        JsonArray best = obj.createNestedArray("best");
+        for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+            best.add(p->bestByDifficulty[d]);
+        }
+        obj["rating"] = p->rating;
+        obj["matches"] = p->matches;
     }
 
-    size_t bytesWritten = serializeJson(doc, file);
-    file.close();
-
+    LOG_D(LOG_TAG_STORAGE, "Opening %s for writing...\n", PLAYERS_FILE);
+    size_t bytesWritten = AtomicFile::write(PLAYERS_FILE, doc);
     if (bytesWritten == 0) {
         DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write players (0 bytes written)");
         return false;
     }
 
-    DEBUG_PRINTF("[STORAGE] Saved %d players (%d bytes written to %s)\n",
-                players.size(), bytesWritten, PLAYERS_FILE);
+    recordWrite(WEAR_PLAYERS, bytesWritten, blocksFor(bytesWritten));
+    playersSeq = historySeq;
+
+    DEBUG_PRINTF("[STORAGE] Saved %d players up to game %u (%d bytes written to %s)\n",
+                playerTable.size(), playersSeq, bytesWritten, PLAYERS_FILE);
     return true;
 }
 
-std::vector<GameSession> DataStorage::loadHistory() {
+/**
+ * Fill a JSON object from a game session
+ */
+static void sessionToJson(const GameSession& s, JsonObject obj) {
+    obj["playerId"] = s.playerId.toString();
+    obj["playerName"] = s.playerName;
+    obj["score"] = s.score;
+    obj["difficulty"] = (int)s.difficulty;
+    obj["timestamp"] = s.timestamp;
+    obj["duration"] = s.duration;
+    obj["seed"] = s.seed;
+    if (s.replayId) {
+        obj["replayId"] = s.replayId;
+    }
+}
+
+/**
+ * Read a game session from a JSON object
+ */
+static GameSession sessionFromJson(JsonVariant v) {
+    GameSession s;
+    PlayerId::parse(v["playerId"] | "", s.playerId);
+    s.playerName = v["playerName"].as<String>();
+    s.score = v["score"].as<uint16_t>();
+    s.difficulty = (DifficultyLevel)v["difficulty"].as<int>();
+    s.timestamp = v["timestamp"].as<uint32_t>();
+    s.duration = v["duration"].as<uint32_t>();
+    s.seed = v["seed"].as<uint32_t>();
+    s.replayId = v["replayId"].as<uint32_t>();
+    return s;
+}
+
+std::vector<GameSession> DataStorage::readHistory() {
     std::vector<GameSession> history;
 
     if (!initialized) return history;
 
-    File file = LittleFS.open(HISTORY_FILE, "r");
-    if (!file) {
-        return history;
-    }
-
-    DynamicJsonDocument doc(8192);
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    ScopedLatency timer(loadHistoryLatency);
 
-    if (error) {
-        DEBUG_PRINTF("[STORAGE] ERROR: Failed to parse history: %s\n", error.c_str());
-        return history;
-    }
+    // The log runs oldest to newest; the cache is newest first
+    historyLog.forEach([&history](const char* record, size_t len) {
+        StaticJsonDocument<512> doc;
+        if (!deserializeJson(doc, record, len)) {
+            history.push_back(sessionFromJson(doc.as<JsonVariant>()));
+        }
+    });
+    std::reverse(history.begin(), history.end());
 
-    JsonArray array = doc.as<JsonArray>();
-    for (JsonVariant v : array) {
-        GameSession s;
-        s.playerId = v["playerId"].as<String>();
-        s.playerName = v["playerName"].as<String>();
-        s.score = v["score"].as<uint16_t>();
-        s.difficulty = (DifficultyLevel)v["difficulty"].as<int>();
-        s.timestamp = v["timestamp"].as<uint32_t>();
-        s.duration = v["duration"].as<uint32_t>();
-        history.push_back(s);
+    if (history.size() > MAX_GAME_HISTORY) {
+        history.resize(MAX_GAME_HISTORY);
     }
 
     return history;
 }
 
-bool DataStorage::saveHistory(const std::vector<GameSession>& history) {
-    if (!initialized) return false;
+void DataStorage::replayPlayerStats(uint32_t applied) {
+    if (!initialized) return;
 
-    DynamicJsonDocument doc(8192);
-    JsonArray array = doc.to<JsonArray>();
+    // Lines without a sequence predate it and are already in the table
+    uint32_t replayed = 0;
+    historyLog.forEach([this, applied, &replayed](const char* record, size_t len) {
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, record, len)) {
+            return;
+        }
+        uint32_t seq = doc["seq"].as<uint32_t>();
+        historySeq = max(historySeq, seq);
+        if (seq <= applied) {
+            return;
+        }
 
-    for (const auto& s : history) {
-        JsonObject obj = array.createNestedObject();
-        obj["playerId"] = s.playerId;
-        obj["playerName"] = s.playerName;
-        obj["score"] = s.score;
-        obj["difficulty"] = (int)s.difficulty;
-        obj["timestamp"] = s.timestamp;
-        obj["duration"] = s.duration;
+        GameSession game = sessionFromJson(doc.as<JsonVariant>());
+        if (playerTable.recordGame(playerTable.find(game.playerId), game.score,
+                                   game.difficulty, game.timestamp)) {
+            statsSeq = seq;
+            replayed++;
+        }
+    });
+    historySeq = max(historySeq, applied);
+
+    if (replayed > 0) {
+        DEBUG_PRINTF("[STORAGE] Replayed %u logged games into player stats\n", replayed);
     }
+}
 
-    File file = LittleFS.open(HISTORY_FILE, "w");
-    if (!file) {
-        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open history file for writing");
-        return false;
+bool DataStorage::writeHistory() {
+    if (!initialized) return false;
+    if (historyPending == 0) return true;
+
+    ScopedLatency timer(saveHistoryLatency);
+    uint8_t pending = min((size_t)historyPending, historyCache.size());
+
+    // Append the unsaved games oldest first, one line each; the newest is
+    // game historySeq and each older one is numbered one less
+    std::vector<String> records;
+    records.reserve(pending);
+    for (int i = pending - 1; i >= 0; i--) {
+        StaticJsonDocument<512> doc;
+        sessionToJson(historyCache[i], doc.to<JsonObject>());
+        doc["seq"] = historySeq - i;
+        String record;
+        serializeJson(doc, record);
+        records.push_back(record);
     }
 
-    if (serializeJson(doc, file) == 0) {
+    size_t bytesWritten = historyLog.append(records);
+    if (bytesWritten == 0) {
         DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write history");
-        file.close();
         return false;
     }
 
-    file.close();
+    // Reason: An append copies only the partly filled tail block
+    recordWrite(WEAR_HISTORY, bytesWritten, 1 + bytesWritten / STORAGE_BLOCK_SIZE);
+    historyPending = 0;
     return true;
 }
 
-std::vector<HighScore> DataStorage::loadHighScores() {
+void DataStorage::importLegacyHistory() {
+    File file;
+    if (AtomicFile::open(HISTORY_FILE, file) >= AtomicFile::MISSING) {
+        return;
+    }
+
+    DynamicJsonDocument doc(10240);
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+
+    if (error) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to parse old history: %s\n", error.c_str());
+        return;
+    }
+
+    // A previous import finished but was reset before the file was removed
+    if (!historyLog.empty()) {
+        AtomicFile::remove(HISTORY_FILE);
+        return;
+    }
+
+    // history.json is newest first; the log wants oldest first
+    JsonArray array = doc.as<JsonArray>();
+    std::vector<String> records;
+    for (int i = (int)array.size() - 1; i >= 0; i--) {
+        String record;
+        serializeJson(array[i], record);
+        records.push_back(record);
+    }
+
+    if (records.empty() || historyLog.append(records) > 0) {
+        AtomicFile::remove(HISTORY_FILE);
+        DEBUG_PRINTF("[STORAGE] Moved %d games from %s to the history log\n",
+                    records.size(), HISTORY_FILE);
+    }
+}
+
+std::vector<HighScore> DataStorage::readHighScores() {
     std::vector<HighScore> scores;
 
     if (!initialized) return scores;
 
-    File file = LittleFS.open(SCORES_FILE, "r");
-    if (!file) {
+    ScopedLatency timer(loadScoresLatency);
+    File file;
+    if (AtomicFile::open(SCORES_FILE, file) >= AtomicFile::MISSING) {
         return scores;
     }
 
@@ -607,7 +1422,7 @@ std::vector<HighScore> DataStorage::loadHighScores() {
     JsonArray array = doc.as<JsonArray>();
     for (JsonVariant v : array) {
         HighScore hs;
-        hs.playerId = v["playerId"].as<String>();
+        PlayerId::parse(v["playerId"] | "", hs.playerId);
         hs.playerName = v["playerName"].as<String>();
         hs.score = v["score"].as<uint16_t>();
         hs.difficulty = (DifficultyLevel)v["difficulty"].as<int>();
@@ -618,33 +1433,159 @@ std::vector<HighScore> DataStorage::loadHighScores() {
     return scores;
 }
 
-bool DataStorage::saveHighScores(const std::vector<HighScore>& scores) {
+bool DataStorage::writeHighScores(const std::vector<HighScore>& scores) {
     if (!initialized) return false;
 
+    ScopedLatency timer(saveScoresLatency);
     DynamicJsonDocument doc(4096);
     JsonArray array = doc.to<JsonArray>();
 
     for (const auto& hs : scores) {
         JsonObject obj = array.createNestedObject();
-        obj["playerId"] = hs.playerId;
+        obj["playerId"] = hs.playerId.toString();
         obj["playerName"] = hs.playerName;
         obj["score"] = hs.score;
         obj["difficulty"] = (int)hs.difficulty;
         obj["timestamp"] = hs.timestamp;
     }
 
-    File file = LittleFS.open(SCORES_FILE, "w");
-    if (!file) {
-        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open scores file for writing");
+    size_t bytesWritten = AtomicFile::write(SCORES_FILE, doc);
+    if (bytesWritten == 0) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write scores");
         return false;
     }
 
-    if (serializeJson(doc, file) == 0) {
-        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write scores");
-        file.close();
+    recordWrite(WEAR_SCORES, bytesWritten, blocksFor(bytesWritten));
+    return true;
+}
+
+void DataStorage::readScoreRanks() {
+    scoreRanks.clear();
+
+    ScopedLatency timer(loadRanksLatency);
+    File file;
+    if (AtomicFile::open(RANKS_FILE, file) >= AtomicFile::MISSING) {
+        // Reason: Older firmware kept no counts; the retained history is the
+        // best starting point (later games are all counted)
+        std::vector<GameSession> history = loadHistory();
+        for (const auto& game : history) {
+            scoreRanks.add(game.difficulty, game.score);
+        }
+        if (!history.empty()) {
+            markDirty(CACHE_RANKS);
+            DEBUG_PRINTF("[STORAGE] Score ranks seeded from %d games\n", history.size());
+        }
+        return;
+    }
+
+    DynamicJsonDocument doc(SCORE_RANKS_JSON_CAPACITY);
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+
+    if (error) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to parse score ranks: %s\n", error.c_str());
+        return;
+    }
+
+    // Files from before the checkpoints are a bare array rewritten after
+    // every game, so they already count every logged game
+    JsonArray bins = doc.as<JsonArray>();
+    if (bins.isNull()) {
+        ranksSeq = doc["seq"].as<uint32_t>();
+        bins = doc["bins"];
+    } else {
+        ranksSeq = historySeq;
+    }
+    scoreRanks.fromJson(bins);
+    replayScoreRanks();
+}
+
+void DataStorage::replayScoreRanks() {
+    uint32_t replayed = 0;
+    historyLog.forEach([this, &replayed](const char* record, size_t len) {
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, record, len) || doc["seq"].as<uint32_t>() <= ranksSeq) {
+            return;
+        }
+
+        GameSession game = sessionFromJson(doc.as<JsonVariant>());
+        scoreRanks.add(game.difficulty, game.score);
+        replayed++;
+    });
+
+    if (replayed > 0) {
+        DEBUG_PRINTF("[STORAGE] Counted %u logged games into score ranks\n", replayed);
+    }
+}
+
+bool DataStorage::writeScoreRanks() {
+    if (!initialized) return false;
+
+    // Layout: {"seq":N,"bins":[[...],...]}; games after N are in the log
+    ScopedLatency timer(saveRanksLatency);
+    DynamicJsonDocument doc(SCORE_RANKS_JSON_CAPACITY);
+    doc["seq"] = historySeq;
+    scoreRanks.toJson(doc.createNestedArray("bins"));
+
+    size_t bytesWritten = AtomicFile::write(RANKS_FILE, doc);
+    if (bytesWritten == 0) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write score ranks");
         return false;
     }
 
+    recordWrite(WEAR_RANKS, bytesWritten, blocksFor(bytesWritten));
+    ranksSeq = historySeq;
+    return true;
+}
+
+void DataStorage::loadWear() {
+    File file;
+    if (AtomicFile::open(WEAR_FILE, file) >= AtomicFile::MISSING) {
+        return;
+    }
+
+    StaticJsonDocument<1024> doc;
+    DeserializationError error = deserializeJson(doc, file);
     file.close();
+
+    if (error) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to parse wear counters: %s\n", error.c_str());
+        return;
+    }
+
+    wearGames = doc["games"].as<uint32_t>();
+    JsonObject files = doc["files"];
+    for (uint8_t i = 0; i < NUM_WEAR_FILES; i++) {
+        JsonArray counts = files[WEAR_NAMES[i]];
+        wear[i].commits = counts[0].as<uint32_t>();
+        wear[i].bytes = counts[1].as<uint32_t>();
+        wear[i].erases = counts[2].as<uint32_t>();
+    }
+}
+
+bool DataStorage::saveWear() {
+    // Layout: {"games":N,"files":{"players":[commits,bytes,erases],...}}
+    StaticJsonDocument<1024> doc;
+    doc["games"] = wearGames;
+    JsonObject files = doc.createNestedObject("files");
+    for (uint8_t i = 0; i < NUM_WEAR_FILES; i++) {
+        JsonArray counts = files.createNestedArray(WEAR_NAMES[i]);
+        counts.add(wear[i].commits);
+        counts.add(wear[i].bytes);
+        counts.add(wear[i].erases);
+    }
+
+    size_t bytesWritten = AtomicFile::write(WEAR_FILE, doc);
+    lastWearSave = millis();
+    if (bytesWritten == 0) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write wear counters");
+        return false;
+    }
+
+    // Counted without marking dirty again; it is saved with the next change
+    wearDirty = false;
+    wear[WEAR_META].commits++;
+    wear[WEAR_META].bytes += bytesWritten;
+    wear[WEAR_META].erases += blocksFor(bytesWritten);
     return true;
 }
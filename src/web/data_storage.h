@@ -16,42 +16,67 @@
 #include <vector>
 #include "../config.h"
 #include "../game/difficulty_modes.h"
+#include "record_log.h"
+#include "player_table.h"
+#include "score_ranks.h"
+#include "history_archive.h"
+#include "score_snapshot.h"
+
+// Forward declarations
+class Histogram;
+class Counter;
 
 // Maximum limits for data storage
-#define MAX_PLAYERS 20
 #define MAX_GAME_HISTORY 50
 #define MAX_HIGH_SCORES_TOTAL 10
 
+// Players file parse/serialize buffer (MAX_PLAYERS records with stats)
+#define PLAYERS_JSON_CAPACITY 12288
+
+// Score ranks file buffer (every bin of every difficulty in use)
+#define SCORE_RANKS_JSON_CAPACITY (JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(NUM_DIFFICULTIES) + \
+                                   NUM_DIFFICULTIES * JSON_ARRAY_SIZE(SCORE_RANK_BINS))
+
 /**
  * Player profile structure
  */
 struct Player {
-    String id;              // Unique UUID
+    PlayerId id;            // Unique UUID
     String name;            // Player display name
     uint32_t gamesPlayed;   // Total games played
     uint32_t totalScore;    // Sum of all scores (for average)
     uint16_t bestScore;     // Personal best score
     uint16_t wins;          // Games completed successfully
     uint32_t created;       // Timestamp when created
+    uint32_t lastPlayed;    // Timestamp of the latest game (0 = never)
+    float scoreMean;        // Mean score
+    float scoreVariance;    // Score variance
+    uint16_t streak;        // Consecutive wins up to the latest game
+    uint16_t bestByDifficulty[NUM_DIFFICULTIES];
+    uint8_t rankByDifficulty[NUM_DIFFICULTIES];  // 1 = top, 0 = not played
+    float rating;           // Pass-and-play Elo rating
+    uint16_t matches;       // Rated pass-and-play games
 };
 
 /**
  * Game session record
  */
 struct GameSession {
-    String playerId;        // Player who played this game
+    PlayerId playerId;      // Player who played this game (nil = guest)
     String playerName;      // Player name (denormalized for easy display)
     uint16_t score;         // Score achieved
     DifficultyLevel difficulty;  // Difficulty level
     uint32_t timestamp;     // When the game was played
-    uint32_t duration;      // How long the game lasted (ms)
+    uint32_t duration;      // How long the game lasted (s)
+    uint32_t seed;          // Sequence seed (replays the exact same game)
+    uint32_t replayId;      // Stored replay (0 = none)
 };
 
 /**
  * High score entry
  */
 struct HighScore {
-    String playerId;
+    PlayerId playerId;      // Nil = guest
     String playerName;
     uint16_t score;
     DifficultyLevel difficulty;
@@ -69,11 +94,35 @@ struct GameSettings {
     bool deepSleepEnabled;
 };
 
+/**
+ * Write and estimated flash-erase counts of one stored file
+ */
+struct FileWear {
+    uint32_t commits;       // Rewrites or appends
+    uint32_t bytes;         // Bytes written
+    uint32_t erases;        // Estimated STORAGE_BLOCK_SIZE erases
+};
+
 /**
  * Data Storage Manager Class
  */
 class DataStorage {
 public:
+    // Files with flash wear accounting (see wearToJson())
+    enum WearFile : uint8_t {
+        WEAR_PLAYERS = 0,
+        WEAR_HISTORY,
+        WEAR_SCORES,
+        WEAR_SETTINGS,
+        WEAR_RANKS,
+        WEAR_ARCHIVE,
+        WEAR_SNAPSHOT,           // Own partition, outside LittleFS
+        WEAR_META,               // WEAR_FILE itself
+        WEAR_ANALYTICS,          // Saved by ReactionAnalytics
+        WEAR_REPLAYS,            // Saved by ReplayStore
+        NUM_WEAR_FILES
+    };
+
     /**
      * Constructor
      */
@@ -130,6 +179,41 @@ public:
      */
     bool getPlayer(const String& id, Player& player);
 
+    /**
+     * Find a player by ID without allocating
+     *
+     * Args:
+     *     id: Player ID
+     *
+     * Returns:
+     *     PlayerHandle: Handle, or INVALID_PLAYER_HANDLE if not found
+     */
+    PlayerHandle findPlayer(const PlayerId& id);
+
+    /**
+     * Find a player by UUID text (as received from the web API)
+     *
+     * Args:
+     *     id: Player UUID text
+     *
+     * Returns:
+     *     PlayerHandle: Handle, or INVALID_PLAYER_HANDLE if not found or
+     *                   the text is not a UUID
+     */
+    PlayerHandle findPlayer(const char* id);
+
+    /**
+     * Get a player's name by handle
+     *
+     * Args:
+     *     handle: Player handle from findPlayer()
+     *     name: Output name
+     *
+     * Returns:
+     *     bool: false if the handle is stale (player deleted)
+     */
+    bool getPlayerName(PlayerHandle handle, String& name);
+
     /**
      * Get all players
      *
@@ -199,6 +283,45 @@ public:
      */
     std::vector<GameSession> getPlayerGames(const String& playerId, uint8_t limit = 20);
 
+    /**
+     * Roll up every game ever played over a range of days, from the archive
+     *
+     * Args:
+     *     fromDay: First day (Unix day number)
+     *     toDay: Last day, inclusive
+     *     playerId: Only this player's games ("guest" for guests), or empty
+     *     out: Filled timeline
+     */
+    void getTimeline(uint32_t fromDay, uint32_t toDay, const String& playerId, ArchiveTimeline& out);
+
+    // ========================================================================
+    // Ratings
+    // ========================================================================
+
+    /**
+     * Rate a finished pass-and-play game (Elo, pairwise between players)
+     *
+     * Args:
+     *     ids: Player of each turn (guests and unknown IDs are left out)
+     *     scores: Final score of each turn
+     *     count: Number of turns (at most RATING_MAX_PLAYERS)
+     *
+     * Returns:
+     *     bool: true if at least two registered players were rated
+     */
+    bool recordMatch(const PlayerId* ids, const uint16_t* scores, uint8_t count);
+
+    /**
+     * Get rated players, highest rating first (kept in order, not sorted here)
+     *
+     * Args:
+     *     limit: Maximum number of players
+     *
+     * Returns:
+     *     std::vector<Player>: Players with at least one rated game
+     */
+    std::vector<Player> getLeaderboard(uint8_t limit = MAX_PLAYERS);
+
     // ========================================================================
     // High Scores
     // ========================================================================
@@ -237,6 +360,18 @@ public:
      */
     bool addHighScore(const GameSession& session);
 
+    /**
+     * Rank a score against every game ever played at a difficulty
+     *
+     * Args:
+     *     difficulty: Difficulty level
+     *     score: Score to rank
+     *
+     * Returns:
+     *     ScoreRank: Rank, game count and percentile
+     */
+    ScoreRank getScoreRank(DifficultyLevel difficulty, uint16_t score);
+
     // ========================================================================
     // Settings
     // ========================================================================
@@ -284,6 +419,47 @@ public:
      */
     bool getStorageStats(size_t& totalBytes, size_t& usedBytes);
 
+    /**
+     * Write cached changes once the device has been quiet
+     * Call repeatedly in loop()
+     *
+     * Changes are flushed STORAGE_FLUSH_QUIET_MS after the last one while no
+     * game runs, and in any case STORAGE_MAX_DIRTY_MS after the first one.
+     *
+     * Args:
+     *     gameActive: true while a game runs (flushing is deferred)
+     */
+    void update(bool gameActive);
+
+    /**
+     * Write all cached changes now (e.g. before deep sleep)
+     *
+     * Args:
+     *     final: true to also persist the wear counters (before power-down)
+     *
+     * Returns:
+     *     bool: true if nothing is left unsaved
+     */
+    bool flush(bool final = false);
+
+    /**
+     * Add flash wear accounting (per-file writes and estimated erases,
+     * partition erase budget and projected life) to a JSON object
+     *
+     * Args:
+     *     obj: JSON object to fill
+     */
+    void wearToJson(JsonObject obj);
+
+    /**
+     * Count a whole-file rewrite made outside DataStorage for wear accounting
+     *
+     * Args:
+     *     file: WEAR_* file
+     *     bytes: Bytes written
+     */
+    void countWrite(WearFile file, size_t bytes);
+
 private:
     bool initialized;
     uint32_t timeOffsetSeconds;  // Offset to convert millis() to Unix timestamp
@@ -293,36 +469,123 @@ private:
     static const char* HISTORY_FILE;
     static const char* SCORES_FILE;
     static const char* SETTINGS_FILE;
+    static const char* WEAR_FILE;
+    static const char* RANKS_FILE;
+
+    // Latency metrics for each file operation
+    Histogram* loadPlayersLatency;
+    Histogram* savePlayersLatency;
+    Histogram* loadHistoryLatency;
+    Histogram* saveHistoryLatency;
+    Histogram* loadScoresLatency;
+    Histogram* saveScoresLatency;
+    Histogram* loadSettingsLatency;
+    Histogram* saveSettingsLatency;
+    Histogram* loadRanksLatency;
+    Histogram* saveRanksLatency;
+    Histogram* saveSnapshotLatency;
+    Counter* corruptFiles;     // Files moved aside by recovery at boot
+    Counter* fileCommits;      // Full-file rewrites (each erases flash blocks)
+    Counter* commitBytes;      // JSON bytes written by those rewrites
+
+    // Write-behind caches of the per-game collections. Changes stay in RAM
+    // until update() or flush() writes them, at most STORAGE_MAX_DIRTY_MS later.
+    enum CacheBit : uint8_t {
+        CACHE_PLAYERS = 1,
+        CACHE_HISTORY = 2,
+        CACHE_SCORES = 4,
+        CACHE_RANKS = 8
+    };
+    PlayerTable playerTable;
+    std::vector<GameSession> historyCache;
+    std::vector<HighScore> scoresCache;
+    ScoreRanks scoreRanks;       // Every game ever played, by score
+    uint8_t loadedMask;          // CACHE_* bits read from flash
+    volatile uint8_t dirtyMask;  // CACHE_* bits not yet written
+    uint32_t firstDirtyTime;     // When the oldest unsaved change was made
+    uint32_t lastChangeTime;     // When the newest unsaved change was made
+    uint8_t historyPending;      // Newest historyCache entries not yet appended
+    uint32_t historySeq;         // Sequence number of the newest recorded game
+    uint32_t playersSeq;         // Newest game folded into the saved players.json
+    uint32_t statsSeq;           // Newest game that changed a player's stats
+    uint32_t ranksSeq;           // Newest game counted in the saved ranks.json
+
+    // History is an append-only log: a game adds one line instead of
+    // rewriting every stored game. Its lines carry the game sequence, so the
+    // player stats they changed are replayed on load rather than rewritten.
+    RecordLog historyLog;
+
+    // Rollups of every game, kept after the history drops them
+    HistoryArchive archive;
+
+    // Mapped copy of players and high scores; read while it matches the caches
+    ScoreSnapshot snapshot;
+
+    // Flash wear accounting, persisted to WEAR_FILE
+    FileWear wear[NUM_WEAR_FILES];
+    uint32_t wearGames;          // Games recorded since accounting started
+    bool wearDirty;
+    uint32_t lastWearSave;
+    SemaphoreHandle_t cacheLock; // Recursive; web handlers and the game share the caches
 
     /**
-     * Generate unique UUID for players
+     * Read players into the table on first use (call with cacheLock held)
+     */
+    void loadPlayerTable();
+
+    /**
+     * Copy a table entry into a Player (call with cacheLock held)
+     *
+     * Args:
+     *     handle: Player handle
+     *     player: Output player structure
      *
      * Returns:
-     *     String: UUID string
+     *     bool: false if the handle is stale
      */
-    String generateUUID();
+    bool fillPlayer(PlayerHandle handle, Player& player);
 
     /**
-     * Load players from file
+     * Copy a snapshot player into a Player (call with cacheLock held)
+     *
+     * Args:
+     *     p: Snapshot player, or nullptr
+     *     player: Output player structure
      *
      * Returns:
-     *     std::vector<Player>: List of players
+     *     bool: false if p is nullptr
      */
-    std::vector<Player> loadPlayers();
+    bool fillPlayer(const SnapshotPlayer* p, Player& player);
 
     /**
-     * Save players to file
+     * Copy a snapshot high score into a HighScore (call with cacheLock held)
      *
      * Args:
-     *     players: List of players to save
+     *     s: Snapshot score
+     *     score: Output high score
+     */
+    void fillHighScore(const SnapshotScore& s, HighScore& score);
+
+    /**
+     * Check whether a collection can be read from the snapshot
+     *
+     * Args:
+     *     bit: CACHE_PLAYERS or CACHE_SCORES
      *
      * Returns:
-     *     bool: true if successful
+     *     bool: true if a live snapshot exists, the cache has no unsaved
+     *           changes and, for players, no game has changed stats since
+     */
+    bool snapshotServes(uint8_t bit) const;
+
+    /**
+     * Rebuild the snapshot from the players and high scores (call with
+     * cacheLock held, after both are saved)
      */
-    bool savePlayers(const std::vector<Player>& players);
+    void writeSnapshot();
 
     /**
-     * Load game history from file
+     * Get game history (cached; read from file on first use)
      *
      * Returns:
      *     std::vector<GameSession>: Game history
@@ -330,18 +593,18 @@ private:
     std::vector<GameSession> loadHistory();
 
     /**
-     * Save game history to file
+     * Add a game to the front of the cached history and schedule its append
      *
      * Args:
-     *     history: Game history to save
+     *     session: Finished game
      *
      * Returns:
      *     bool: true if successful
      */
-    bool saveHistory(const std::vector<GameSession>& history);
+    bool appendHistory(const GameSession& session);
 
     /**
-     * Load high scores from file
+     * Get high scores (cached; read from file on first use)
      *
      * Returns:
      *     std::vector<HighScore>: High scores
@@ -349,7 +612,7 @@ private:
     std::vector<HighScore> loadHighScores();
 
     /**
-     * Save high scores to file
+     * Replace the cached high scores and schedule a write
      *
      * Args:
      *     scores: High scores to save
@@ -358,4 +621,75 @@ private:
      *     bool: true if successful
      */
     bool saveHighScores(const std::vector<HighScore>& scores);
+
+    /**
+     * Write the archive's open batch (takes cacheLock)
+     */
+    void commitArchive();
+
+    /**
+     * Seed an empty archive from the retained history (first boot after
+     * the archive was added)
+     */
+    void seedArchive();
+
+    /**
+     * Read the score ranks on first use (call with cacheLock held)
+     */
+    void loadScoreRanks();
+
+    /**
+     * Mark a cached collection as changed (call with cacheLock held)
+     *
+     * Args:
+     *     bit: CACHE_* bit of the collection
+     */
+    void markDirty(uint8_t bit);
+
+    /**
+     * Count a write for wear accounting
+     *
+     * Args:
+     *     file: WEAR_* file
+     *     bytes: Bytes written
+     *     erases: Estimated block erases
+     */
+    void recordWrite(uint8_t file, size_t bytes, uint32_t erases);
+
+    /**
+     * Rebuild the aggregates of players stored before they were tracked,
+     * from the retained history (call with cacheLock held)
+     *
+     * Args:
+     *     handles: Players to rebuild
+     */
+    void backfillStats(const std::vector<PlayerHandle>& handles);
+
+    /**
+     * Fold the logged games newer than the loaded player table into it
+     * (call with cacheLock held)
+     *
+     * Args:
+     *     applied: Newest game the loaded table already includes
+     */
+    void replayPlayerStats(uint32_t applied);
+
+    /**
+     * Count the logged games newer than the loaded ranks.json in scoreRanks
+     * (call with cacheLock held)
+     */
+    void replayScoreRanks();
+
+    // File I/O behind the caches
+    void readPlayers();
+    bool writePlayers();
+    std::vector<GameSession> readHistory();
+    bool writeHistory();
+    void importLegacyHistory();
+    std::vector<HighScore> readHighScores();
+    bool writeHighScores(const std::vector<HighScore>& scores);
+    void readScoreRanks();
+    bool writeScoreRanks();
+    void loadWear();
+    bool saveWear();
 };
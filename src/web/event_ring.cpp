@@ -0,0 +1,86 @@
+/**
+ * Broadcast Event Ring Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "event_ring.h"
+
+EventRing::EventRing() {
+    clear(1);
+}
+
+void EventRing::clear(uint32_t nextSeq) {
+    first = 0;
+    numEntries = 0;
+    usedBytes = 0;
+    oldestSeq = nextSeq;
+}
+
+void EventRing::push(uint32_t seq, uint8_t topic, const char* payload, uint16_t len) {
+    if (len > WS_EVENT_MAX_LEN) {
+        clear(seq + 1);
+        return;
+    }
+
+    while (numEntries > 0 && (numEntries == WS_EVENT_RING_SIZE || usedBytes + len > WS_EVENT_RING_BYTES)) {
+        evictOldest();
+    }
+
+    // Payloads follow each other; an empty ring restarts at the beginning
+    uint16_t offset = 0;
+    if (numEntries > 0) {
+        offset = (entries[first].offset + usedBytes) % WS_EVENT_RING_BYTES;
+    }
+
+    // Copy in up to two pieces when the payload wraps past the end
+    uint16_t part = min((uint16_t)(WS_EVENT_RING_BYTES - offset), len);
+    memcpy(data + offset, payload, part);
+    memcpy(data, payload + part, len - part);
+
+    Entry& e = entries[(first + numEntries) % WS_EVENT_RING_SIZE];
+    e.seq = seq;
+    e.offset = offset;
+    e.len = len;
+    e.topic = topic;
+    numEntries++;
+    usedBytes += len;
+}
+
+bool EventRing::covers(uint32_t lastSeq) const {
+    return lastSeq + 1 >= oldestSeq;
+}
+
+bool EventRing::next(uint32_t afterSeq, uint8_t topicMask, uint32_t& seq, uint8_t& topic, char* out, size_t outSize) const {
+    for (uint8_t i = 0; i < numEntries; i++) {
+        const Entry& e = entries[(first + i) % WS_EVENT_RING_SIZE];
+        if (e.seq <= afterSeq || !(topicMask & (1 << e.topic))) {
+            continue;
+        }
+        if (e.len >= outSize) {
+            return false;
+        }
+
+        uint16_t part = min((uint16_t)(WS_EVENT_RING_BYTES - e.offset), e.len);
+        memcpy(out, data + e.offset, part);
+        memcpy(out + part, data, e.len - part);
+        out[e.len] = '\0';
+        seq = e.seq;
+        topic = e.topic;
+        return true;
+    }
+    return false;
+}
+
+uint8_t EventRing::count() const {
+    return numEntries;
+}
+
+void EventRing::evictOldest() {
+    const Entry& e = entries[first];
+    oldestSeq = e.seq + 1;
+    usedBytes -= e.len;
+    first = (first + 1) % WS_EVENT_RING_SIZE;
+    numEntries--;
+}
@@ -0,0 +1,99 @@
+/**
+ * Broadcast Event Ring for ESP32 Simon Says
+ *
+ * Keeps the most recent broadcast events, each tagged with its sequence
+ * number, so a reconnecting client can be sent exactly what it missed.
+ * Payloads live back to back in one fixed byte ring (wrapping at the end);
+ * the oldest events are evicted when either the bytes or the entry slots
+ * run out. Not thread-safe: the owner serializes access.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+
+class EventRing {
+public:
+    /**
+     * Constructor (empty ring)
+     */
+    EventRing();
+
+    /**
+     * Remove all events
+     *
+     * Args:
+     *     nextSeq: Sequence number the next pushed event will have
+     */
+    void clear(uint32_t nextSeq);
+
+    /**
+     * Store an event, evicting the oldest ones to make room
+     *
+     * An event larger than WS_EVENT_MAX_LEN can't be kept; the ring is then
+     * emptied so no later resume silently skips it.
+     *
+     * Args:
+     *     seq: Sequence number (must be higher than any stored)
+     *     topic: Topic number (0-7), for filtering in next()
+     *     data: Payload
+     *     len: Payload length
+     */
+    void push(uint32_t seq, uint8_t topic, const char* data, uint16_t len);
+
+    /**
+     * Check whether every event after a sequence number is still stored
+     *
+     * Args:
+     *     lastSeq: Last sequence number the client saw
+     *
+     * Returns:
+     *     bool: true if the client can be caught up from the ring
+     */
+    bool covers(uint32_t lastSeq) const;
+
+    /**
+     * Copy the first stored event after a sequence number
+     *
+     * Args:
+     *     afterSeq: Sequence number to continue after
+     *     topicMask: Bit per topic to include
+     *     seq: Set to the event's sequence number
+     *     topic: Set to the event's topic
+     *     out: Buffer for the payload (NUL-terminated)
+     *     outSize: Buffer size (at least WS_EVENT_MAX_LEN + 1)
+     *
+     * Returns:
+     *     bool: false if there is no later event
+     */
+    bool next(uint32_t afterSeq, uint8_t topicMask, uint32_t& seq, uint8_t& topic, char* out, size_t outSize) const;
+
+    /**
+     * Get number of stored events
+     *
+     * Returns:
+     *     uint8_t: Event count
+     */
+    uint8_t count() const;
+
+private:
+    struct Entry {
+        uint32_t seq;
+        uint16_t offset;  // Start of the payload in data
+        uint16_t len;
+        uint8_t topic;
+    };
+
+    char data[WS_EVENT_RING_BYTES];
+    Entry entries[WS_EVENT_RING_SIZE];
+    uint8_t first;        // Index of the oldest entry
+    uint8_t numEntries;
+    uint16_t usedBytes;
+    uint32_t oldestSeq;   // Every event from here on is stored
+
+    void evictOldest();
+};
@@ -0,0 +1,475 @@
+/**
+ * Long-Term Game Archive Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "history_archive.h"
+#include <rom/crc.h>
+
+#define ARCHIVE_CRC_BYTES 2
+#define VARINT_MAX_BYTES 5
+
+/**
+ * Append a LEB128 varint
+ */
+static uint8_t* putVarint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+/**
+ * Read a LEB128 varint
+ *
+ * Returns:
+ *     bool: false if it runs past end or is too long
+ */
+static bool getVarint(const uint8_t*& in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 7 * VARINT_MAX_BYTES; shift += 7) {
+        if (in >= end) {
+            return false;
+        }
+        uint8_t byte = *in++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t crc16Of(const uint8_t* data, size_t length) {
+    return (uint16_t)crc32_le(0, data, length);
+}
+
+HistoryArchive::HistoryArchive(const char* path) :
+    path(path),
+    dictionarySize(1),
+    definedCount(1),
+    lastDay(0),
+    bytesStored(0),
+    batchSize(0),
+    batchDay(0),
+    batchStarted(0) {
+    dictionary[0] = PlayerId();
+}
+
+bool HistoryArchive::begin() {
+    dictionarySize = definedCount = 1;
+    lastDay = 0;
+    bytesStored = 0;
+
+    if (!LittleFS.exists(path)) {
+        return true;
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to open %s\n", path);
+        return false;
+    }
+
+    // Replay the records for their day deltas and player definitions
+    uint8_t payload[ARCHIVE_MAX_RECORD];
+    ReadState state = {0, 1};
+    size_t valid = 0;
+    uint32_t records = 0;
+    size_t length;
+    while (readRecord(file, payload, length)) {
+        if (!decodeRecord(payload, length, state, true, nullptr)) {
+            break;
+        }
+        valid = file.position();
+        records++;
+    }
+    bool torn = valid < file.size();
+    file.close();
+
+    lastDay = state.day;
+    bytesStored = valid;
+    if (torn) {
+        DEBUG_PRINTF("[STORAGE] WARNING: %s has a torn record, keeping %d bytes\n", path, valid);
+        keepPrefix(valid);
+    }
+
+    DEBUG_PRINTF("[STORAGE] Archive: %u records, %d players, %d bytes\n",
+                records, dictionarySize - 1, bytesStored);
+    return true;
+}
+
+size_t HistoryArchive::add(const PlayerId& player, uint32_t timestamp, uint16_t score,
+                           uint32_t playSeconds) {
+    uint32_t day = timestamp / SECONDS_PER_DAY;
+    size_t written = 0;
+
+    if (batchSize > 0 && day != batchDay) {
+        written += commit();
+        if (batchSize > 0) {
+            // Reason: A batch holds one day; keeping it would file these games under the wrong one
+            dropBatch();
+        }
+    }
+
+    uint8_t index = playerIndex(player);
+    ArchiveEntry* entry = nullptr;
+    for (uint8_t i = 0; i < batchSize; i++) {
+        if (batch[i].player == index) {
+            entry = &batch[i];
+            break;
+        }
+    }
+
+    if (!entry) {
+        if (batchSize >= ARCHIVE_BATCH_ENTRIES) {
+            written += commit();
+            if (batchSize > 0) {
+                dropBatch();
+                // The index may have been one of the dropped ones
+                index = playerIndex(player);
+            }
+        }
+        if (batchSize == 0) {
+            batchDay = day;
+            batchStarted = millis();
+        }
+        entry = &batch[batchSize++];
+        memset(entry, 0, sizeof(ArchiveEntry));
+        entry->player = index;
+    }
+
+    entry->games++;
+    entry->playSeconds += playSeconds;
+    entry->scoreSum += score;
+    if (score > entry->best) {
+        entry->best = score;
+    }
+    entry->buckets[bucketFor(score)]++;
+    return written;
+}
+
+bool HistoryArchive::commitDue() const {
+    return batchSize > 0 && millis() - batchStarted >= STORAGE_ARCHIVE_COMMIT_MS;
+}
+
+size_t HistoryArchive::commit() {
+    if (batchSize == 0) {
+        return 0;
+    }
+
+    uint8_t record[VARINT_MAX_BYTES + ARCHIVE_MAX_RECORD + ARCHIVE_CRC_BYTES];
+    uint8_t payload[ARCHIVE_MAX_RECORD];
+    size_t length = encodeBatch(payload);
+
+    uint8_t* out = putVarint(record, length);
+    memcpy(out, payload, length);
+    out += length;
+    uint16_t crc = crc16Of(payload, length);
+    *out++ = crc & 0xFF;
+    *out++ = crc >> 8;
+    size_t size = out - record;
+
+    File file = LittleFS.open(path, "a");
+    if (!file) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to open %s for appending\n", path);
+        return 0;
+    }
+    size_t written = file.write(record, size);
+    file.close();
+
+    if (written != size) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Short write to %s\n", path);
+        // Reason: Later appends would follow the torn record and be unreadable
+        keepPrefix(bytesStored);
+        return 0;
+    }
+
+    bytesStored += size;
+    if (batchDay > lastDay) {
+        lastDay = batchDay;   // Matches the clamped delta in encodeBatch()
+    }
+    // Reason: Not dictionarySize; add() may have handed out an index for a
+    // game that goes into the next batch
+    for (uint8_t i = 0; i < batchSize; i++) {
+        if (batch[i].player >= definedCount) {
+            definedCount = batch[i].player + 1;
+        }
+    }
+    batchSize = 0;
+    DEBUG_PRINTF("[STORAGE] Archived day %u (%d bytes)\n", batchDay, size);
+    return size;
+}
+
+void HistoryArchive::timeline(uint32_t fromDay, uint32_t toDay, const PlayerId* player,
+                              ArchiveTimeline& out) {
+    memset(&out, 0, sizeof(out));
+    if (toDay < fromDay) {
+        toDay = fromDay;
+    }
+
+    uint32_t days = toDay - fromDay + 1;
+    out.fromDay = fromDay;
+    out.toDay = toDay;
+    out.bucketDays = (days + ARCHIVE_TIMELINE_POINTS - 1) / ARCHIVE_TIMELINE_POINTS;
+    out.numPoints = (days + out.bucketDays - 1) / out.bucketDays;
+
+    // Reason: A player the dictionary has never seen has no games
+    int16_t wanted = -1;
+    if (player) {
+        for (uint8_t i = 0; i < dictionarySize; i++) {
+            if (dictionary[i] == *player) {
+                wanted = i;
+                break;
+            }
+        }
+        if (wanted < 0) {
+            return;
+        }
+    }
+
+    forEachEntry([&](uint32_t day, const ArchiveEntry& entry) {
+        if (day < fromDay || day > toDay || (wanted >= 0 && entry.player != wanted)) {
+            return;
+        }
+        merge(out.points[(day - fromDay) / out.bucketDays], entry);
+        merge(out.total, entry);
+    });
+}
+
+void HistoryArchive::clear() {
+    LittleFS.remove(path);
+    dictionarySize = definedCount = 1;
+    lastDay = 0;
+    bytesStored = 0;
+    batchSize = 0;
+}
+
+size_t HistoryArchive::fileSize() const {
+    return bytesStored;
+}
+
+void HistoryArchive::dropBatch() {
+    DEBUG_PRINTLN("[STORAGE] WARNING: Archive batch dropped (write failed)");
+    batchSize = 0;
+    // Reason: Indexes handed out since the last write never had their ID
+    // written; keeping them would leave a gap the next definition can't fill
+    dictionarySize = definedCount;
+}
+
+uint8_t HistoryArchive::playerIndex(const PlayerId& player) {
+    if (player.isNil()) {
+        return 0;
+    }
+    for (uint8_t i = 1; i < dictionarySize; i++) {
+        if (dictionary[i] == player) {
+            return i;
+        }
+    }
+    if (dictionarySize >= ARCHIVE_MAX_PLAYERS) {
+        return 0;  // Dictionary full: archived with the guests
+    }
+    dictionary[dictionarySize] = player;
+    return dictionarySize++;
+}
+
+size_t HistoryArchive::encodeBatch(uint8_t* out) const {
+    uint8_t* start = out;
+    // Reason: Days only move forward within one clock, but the first sync
+    // from the browser can jump back to an earlier day than the last record
+    uint32_t delta = batchDay >= lastDay ? batchDay - lastDay : 0;
+    out = putVarint(out, delta);
+    out = putVarint(out, batchSize);
+
+    uint8_t defined = definedCount;
+    for (uint8_t i = 0; i < batchSize; i++) {
+        const ArchiveEntry& e = batch[i];
+        out = putVarint(out, e.player);
+        // Indexes are handed out in order, so a new one is always the next
+        if (e.player == defined) {
+            for (int8_t shift = 56; shift >= 0; shift -= 8) {
+                *out++ = (uint8_t)(dictionary[e.player].hi >> shift);
+            }
+            for (int8_t shift = 56; shift >= 0; shift -= 8) {
+                *out++ = (uint8_t)(dictionary[e.player].lo >> shift);
+            }
+            defined++;
+        }
+        out = putVarint(out, e.games);
+        out = putVarint(out, e.playSeconds);
+        out = putVarint(out, e.scoreSum);
+        out = putVarint(out, e.best);
+
+        uint8_t mask = 0;
+        for (uint8_t b = 0; b < ARCHIVE_SCORE_BUCKETS; b++) {
+            if (e.buckets[b]) {
+                mask |= 1 << b;
+            }
+        }
+        *out++ = mask;
+        for (uint8_t b = 0; b < ARCHIVE_SCORE_BUCKETS; b++) {
+            if (e.buckets[b]) {
+                out = putVarint(out, e.buckets[b]);
+            }
+        }
+    }
+    return out - start;
+}
+
+bool HistoryArchive::readRecord(File& file, uint8_t* payload, size_t& length) {
+    uint8_t header[VARINT_MAX_BYTES];
+    uint8_t n = 0;
+    int c;
+    do {
+        c = file.read();
+        if (c < 0 || n >= VARINT_MAX_BYTES) {
+            return false;
+        }
+        header[n++] = (uint8_t)c;
+    } while (c & 0x80);
+
+    const uint8_t* in = header;
+    uint32_t value;
+    if (!getVarint(in, header + n, value) || value > ARCHIVE_MAX_RECORD) {
+        return false;
+    }
+    length = value;
+
+    uint8_t crc[ARCHIVE_CRC_BYTES];
+    if (file.read(payload, length) != length ||
+        file.read(crc, ARCHIVE_CRC_BYTES) != ARCHIVE_CRC_BYTES) {
+        return false;
+    }
+    return crc16Of(payload, length) == (uint16_t)(crc[0] | (crc[1] << 8));
+}
+
+bool HistoryArchive::decodeRecord(const uint8_t* payload, size_t length, ReadState& state,
+                                  bool learnIds, const EntryFn& fn) {
+    const uint8_t* in = payload;
+    const uint8_t* end = payload + length;
+    uint32_t delta, count;
+    if (!getVarint(in, end, delta) || !getVarint(in, end, count)) {
+        return false;
+    }
+    uint32_t day = state.day + delta;
+
+    for (uint32_t i = 0; i < count; i++) {
+        ArchiveEntry e;
+        memset(&e, 0, sizeof(e));
+        uint32_t player, games, playSeconds, scoreSum, best;
+        if (!getVarint(in, end, player) || player > state.defined ||
+            player >= ARCHIVE_MAX_PLAYERS) {
+            return false;
+        }
+        if (player == state.defined) {
+            if (end - in < 16) {
+                return false;
+            }
+            PlayerId id = {0, 0};
+            for (uint8_t b = 0; b < 8; b++) {
+                id.hi = (id.hi << 8) | *in++;
+            }
+            for (uint8_t b = 0; b < 8; b++) {
+                id.lo = (id.lo << 8) | *in++;
+            }
+            if (learnIds) {
+                dictionary[player] = id;
+                dictionarySize = definedCount = player + 1;
+            }
+            state.defined++;
+        }
+        if (!getVarint(in, end, games) || !getVarint(in, end, playSeconds) ||
+            !getVarint(in, end, scoreSum) || !getVarint(in, end, best) || in >= end) {
+            return false;
+        }
+        e.player = player;
+        e.games = games;
+        e.playSeconds = playSeconds;
+        e.scoreSum = scoreSum;
+        e.best = best;
+
+        uint8_t mask = *in++;
+        for (uint8_t b = 0; b < ARCHIVE_SCORE_BUCKETS; b++) {
+            if ((mask & (1 << b)) && !getVarint(in, end, e.buckets[b])) {
+                return false;
+            }
+        }
+        if (fn) {
+            fn(day, e);
+        }
+    }
+
+    state.day = day;
+    return in == end;
+}
+
+void HistoryArchive::forEachEntry(const EntryFn& fn) {
+    File file = LittleFS.open(path, "r");
+    if (file) {
+        uint8_t payload[ARCHIVE_MAX_RECORD];
+        ReadState state = {0, 1};
+        size_t length;
+        while (file.position() < bytesStored && readRecord(file, payload, length) &&
+               decodeRecord(payload, length, state, false, fn)) {
+        }
+        file.close();
+    }
+
+    // Pending games count too, so answers are current before the next write
+    for (uint8_t i = 0; i < batchSize; i++) {
+        fn(batchDay, batch[i]);
+    }
+}
+
+void HistoryArchive::keepPrefix(size_t bytes) {
+    // LittleFS files can't be truncated through the Arduino API, so copy
+    String tmpPath = String(path) + ".tmp";
+    File in = LittleFS.open(path, "r");
+    File out = LittleFS.open(tmpPath, "w");
+    if (!in || !out) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to repair %s\n", path);
+        return;
+    }
+
+    uint8_t buffer[256];
+    size_t left = bytes;
+    while (left > 0) {
+        size_t n = in.read(buffer, min(left, sizeof(buffer)));
+        if (n == 0 || out.write(buffer, n) != n) {
+            break;
+        }
+        left -= n;
+    }
+    in.close();
+    out.close();
+
+    if (left == 0 && LittleFS.rename(tmpPath, path)) {
+        return;
+    }
+    LittleFS.remove(tmpPath);
+    DEBUG_PRINTF("[STORAGE] ERROR: Failed to repair %s\n", path);
+}
+
+uint8_t HistoryArchive::bucketFor(uint16_t score) {
+    uint8_t bucket = ARCHIVE_SCORE_BUCKETS - 1;
+    while (bucket > 0 && score < ARCHIVE_BUCKET_START[bucket]) {
+        bucket--;
+    }
+    return bucket;
+}
+
+void HistoryArchive::merge(ArchiveEntry& into, const ArchiveEntry& from) {
+    into.games += from.games;
+    into.playSeconds += from.playSeconds;
+    into.scoreSum += from.scoreSum;
+    if (from.best > into.best) {
+        into.best = from.best;
+    }
+    for (uint8_t b = 0; b < ARCHIVE_SCORE_BUCKETS; b++) {
+        into.buckets[b] += from.buckets[b];
+    }
+}
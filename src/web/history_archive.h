@@ -0,0 +1,185 @@
+/**
+ * Long-Term Game Archive for ESP32 Simon Says
+ *
+ * The history log keeps only the last MAX_GAME_HISTORY games. The archive
+ * keeps rollups of every game instead. There is one entry per player per
+ * day (UTC), holding the game count, play time, score sum, best score and
+ * a coarse score histogram. Timelines are answered from these rollups, so
+ * years of play fit in a few KB and a query never touches raw sessions.
+ *
+ * Entries are batched in RAM. A batch is appended as one binary record
+ * when the day changes, when it fills up, when it gets old, or before
+ * deep sleep. A power cut loses at most the open batch.
+ *
+ * File layout (append-only, all integers LEB128 varints):
+ *     record  := length payload crc16
+ *     payload := dayDelta entryCount entry...
+ *     entry   := player [id] games playSeconds scoreSum best bucketMask count...
+ *
+ * - dayDelta is counted from the previous record's day (the first record
+ *   holds the absolute day). Several records may share a day; readers
+ *   sum them.
+ * - player is an index into a dictionary of player IDs. A new index is
+ *   followed once by its 16-byte ID. Index 0 is the guest.
+ * - bucketMask has one bit per non-empty histogram bucket, and a count
+ *   follows for each set bit.
+ * - crc16 is the low 16 bits of the payload's CRC-32, little-endian.
+ *   A torn last record is cut off by begin().
+ *
+ * Not thread-safe: the owner serializes access.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include "../config.h"
+#include "player_id.h"
+
+#define ARCHIVE_SCORE_BUCKETS 8      // Histogram buckets (see ARCHIVE_BUCKET_START)
+#define ARCHIVE_BATCH_ENTRIES 8      // Player-days held in RAM before a write
+#define ARCHIVE_MAX_PLAYERS 64       // Player IDs the dictionary remembers (guest included)
+#define ARCHIVE_MAX_RECORD 640       // Largest encoded record (a full batch of new players)
+#define ARCHIVE_TIMELINE_POINTS 31   // Most points in one timeline answer
+
+#define SECONDS_PER_DAY 86400UL
+
+// Lowest score of each histogram bucket (widening, as scores thin out)
+constexpr uint16_t ARCHIVE_BUCKET_START[ARCHIVE_SCORE_BUCKETS] = {0, 1, 3, 5, 8, 12, 18, 26};
+
+/**
+ * One player's games on one day (or, summed, any set of games)
+ */
+struct ArchiveEntry {
+    uint8_t player;          // Dictionary index (0 = guest)
+    uint32_t games;
+    uint32_t playSeconds;
+    uint32_t scoreSum;
+    uint16_t best;
+    uint32_t buckets[ARCHIVE_SCORE_BUCKETS];
+};
+
+/**
+ * Rollups over a range of days, grouped into equal buckets of days
+ */
+struct ArchiveTimeline {
+    uint32_t fromDay;
+    uint32_t toDay;          // Inclusive
+    uint16_t bucketDays;     // Days per point
+    uint8_t numPoints;
+    ArchiveEntry points[ARCHIVE_TIMELINE_POINTS];
+    ArchiveEntry total;      // Whole range, histogram included
+};
+
+class HistoryArchive {
+public:
+    /**
+     * Constructor
+     *
+     * Args:
+     *     path: Archive file
+     */
+    explicit HistoryArchive(const char* path);
+
+    /**
+     * Load the player dictionary and cut off a torn last record
+     * (call after LittleFS is mounted)
+     *
+     * Returns:
+     *     bool: true if successful
+     */
+    bool begin();
+
+    /**
+     * Roll a finished game into the open batch (writes the batch first if
+     * the game starts a new day or the batch is full)
+     *
+     * Args:
+     *     player: Player ID (nil = guest)
+     *     timestamp: When the game was played (Unix seconds)
+     *     score: Score achieved
+     *     playSeconds: Game duration
+     *
+     * Returns:
+     *     size_t: Bytes written by a forced write (0 if none)
+     */
+    size_t add(const PlayerId& player, uint32_t timestamp, uint16_t score, uint32_t playSeconds);
+
+    /**
+     * Check whether the open batch should be written now
+     *
+     * Returns:
+     *     bool: true if it is older than STORAGE_ARCHIVE_COMMIT_MS
+     */
+    bool commitDue() const;
+
+    /**
+     * Append the open batch to the file
+     *
+     * Returns:
+     *     size_t: Bytes written (0 if nothing was pending or on failure)
+     */
+    size_t commit();
+
+    /**
+     * Roll up a range of days, written and pending games alike
+     *
+     * Args:
+     *     fromDay: First day (Unix day number)
+     *     toDay: Last day, inclusive
+     *     player: Only this player, or nullptr for everyone
+     *     out: Filled timeline (days are grouped so the range fits
+     *          ARCHIVE_TIMELINE_POINTS points)
+     */
+    void timeline(uint32_t fromDay, uint32_t toDay, const PlayerId* player, ArchiveTimeline& out);
+
+    /**
+     * Delete the archive and forget every player
+     */
+    void clear();
+
+    /**
+     * Get the archive file size
+     *
+     * Returns:
+     *     size_t: Bytes on flash
+     */
+    size_t fileSize() const;
+
+private:
+    const char* path;
+    PlayerId dictionary[ARCHIVE_MAX_PLAYERS];
+    uint8_t dictionarySize;      // Indexes in use
+    uint8_t definedCount;        // Indexes whose ID is already in the file
+    uint32_t lastDay;            // Day of the last written record
+    size_t bytesStored;
+
+    ArchiveEntry batch[ARCHIVE_BATCH_ENTRIES];
+    uint8_t batchSize;
+    uint32_t batchDay;
+    uint32_t batchStarted;       // millis() of the first game in the batch
+
+    typedef std::function<void(uint32_t day, const ArchiveEntry& entry)> EntryFn;
+
+    // Position while reading the file from the start
+    struct ReadState {
+        uint32_t day;            // Day of the last record read
+        uint8_t defined;         // Dictionary indexes defined so far
+    };
+
+    uint8_t playerIndex(const PlayerId& player);
+    void dropBatch();
+    size_t encodeBatch(uint8_t* out) const;
+    static bool readRecord(File& file, uint8_t* payload, size_t& length);
+    bool decodeRecord(const uint8_t* payload, size_t length, ReadState& state,
+                      bool learnIds, const EntryFn& fn);
+    void forEachEntry(const EntryFn& fn);
+    void keepPrefix(size_t bytes);
+
+    static uint8_t bucketFor(uint16_t score);
+    static void merge(ArchiveEntry& into, const ArchiveEntry& from);
+};
@@ -0,0 +1,90 @@
+/**
+ * Binary Player IDs Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "player_id.h"
+
+// Positions of the dashes in UUID text
+static bool isDash(uint8_t pos) {
+    return pos == 8 || pos == 13 || pos == 18 || pos == 23;
+}
+
+PlayerId PlayerId::generate() {
+    PlayerId id;
+    id.hi = ((uint64_t)esp_random() << 32) | esp_random();
+    id.lo = ((uint64_t)esp_random() << 32) | esp_random();
+
+    // RFC 4122: version 4 (random), variant 10xx
+    id.hi = (id.hi & ~0xF000ULL) | 0x4000ULL;
+    id.lo = (id.lo & ~(0xC000ULL << 48)) | (0x8000ULL << 48);
+    return id;
+}
+
+bool PlayerId::parse(const char* text, PlayerId& out) {
+    out.hi = 0;
+    out.lo = 0;
+
+    uint64_t words[2] = {0, 0};
+    uint8_t digits = 0;
+    for (uint8_t pos = 0; pos < PLAYER_ID_TEXT_LENGTH - 1; pos++) {
+        char c = text[pos];
+        if (isDash(pos)) {
+            if (c != '-') {
+                return false;
+            }
+            continue;
+        }
+
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else {
+            return false;  // Also stops at a short string's NUL
+        }
+
+        uint64_t& word = words[digits / 16];
+        word = (word << 4) | nibble;
+        digits++;
+    }
+
+    if (text[PLAYER_ID_TEXT_LENGTH - 1] != '\0') {
+        return false;
+    }
+
+    out.hi = words[0];
+    out.lo = words[1];
+    return true;
+}
+
+void PlayerId::format(char* out) const {
+    if (isNil()) {
+        strcpy(out, GUEST_PLAYER_TEXT);
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    uint8_t digit = 0;
+    for (uint8_t pos = 0; pos < PLAYER_ID_TEXT_LENGTH - 1; pos++) {
+        if (isDash(pos)) {
+            out[pos] = '-';
+            continue;
+        }
+        uint64_t word = digit < 16 ? hi : lo;
+        out[pos] = hex[(word >> (60 - 4 * (digit % 16))) & 0xF];
+        digit++;
+    }
+    out[PLAYER_ID_TEXT_LENGTH - 1] = '\0';
+}
+
+String PlayerId::toString() const {
+    char text[PLAYER_ID_TEXT_LENGTH];
+    format(text);
+    return String(text);
+}
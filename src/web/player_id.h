@@ -0,0 +1,74 @@
+/**
+ * Binary Player IDs for ESP32 Simon Says
+ *
+ * A player ID is a 128-bit UUID held as two 64-bit words, so comparing two
+ * IDs is two integer compares and storing one takes 16 bytes. IDs are only
+ * turned into the usual 36-char text (xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx)
+ * where they cross into JSON.
+ *
+ * The nil ID (all zero) stands for a guest and is written as "guest", as
+ * the stored history and score files always have.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define PLAYER_ID_TEXT_LENGTH 37     // UUID text + NUL
+#define GUEST_PLAYER_TEXT "guest"
+
+struct PlayerId {
+    uint64_t hi;
+    uint64_t lo;
+
+    /**
+     * Generate a random (version 4) UUID from the hardware RNG
+     *
+     * Returns:
+     *     PlayerId: New ID
+     */
+    static PlayerId generate();
+
+    /**
+     * Parse UUID text (either case)
+     *
+     * Args:
+     *     text: 36-char UUID text
+     *     out: Set to the ID, or to nil if the text is not a UUID
+     *
+     * Returns:
+     *     bool: true if the text was a UUID
+     */
+    static bool parse(const char* text, PlayerId& out);
+
+    /**
+     * Format as lowercase UUID text ("guest" for the nil ID)
+     *
+     * Args:
+     *     out: Buffer of at least PLAYER_ID_TEXT_LENGTH chars
+     */
+    void format(char* out) const;
+
+    /**
+     * Format as a String (for JSON; see format())
+     *
+     * Returns:
+     *     String: UUID text
+     */
+    String toString() const;
+
+    bool isNil() const {
+        return (hi | lo) == 0;
+    }
+
+    bool operator==(const PlayerId& other) const {
+        return hi == other.hi && lo == other.lo;
+    }
+
+    bool operator!=(const PlayerId& other) const {
+        return !(*this == other);
+    }
+};
@@ -0,0 +1,373 @@
+/**
+ * Player Table Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "player_table.h"
+
+#define PLAYER_SLOT_MASK ((1 << PLAYER_SLOT_BITS) - 1)
+#define PLAYER_GENERATION_MASK (0xFFFF >> PLAYER_SLOT_BITS)
+
+static_assert(MAX_PLAYERS <= PLAYER_SLOT_MASK, "MAX_PLAYERS must fit in the handle slot bits");
+static_assert((PLAYER_INDEX_SIZE & (PLAYER_INDEX_SIZE - 1)) == 0, "PLAYER_INDEX_SIZE must be a power of two");
+static_assert(PLAYER_INDEX_SIZE > MAX_PLAYERS, "Hash index needs a free slot to end each probe");
+
+PlayerTable::PlayerTable() {
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        slots[i].generation = 0;
+        slots[i].used = false;
+    }
+    clear();
+}
+
+void PlayerTable::clear() {
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (slots[i].used) {
+            slots[i].generation++;
+        }
+        slots[i].used = false;
+    }
+    memset(index, 0, sizeof(index));
+    namesUsed = 0;
+    count = 0;
+}
+
+PlayerHandle PlayerTable::add(const PlayerId& id, const char* name, uint32_t created) {
+    if (count >= MAX_PLAYERS || id.isNil()) {
+        return INVALID_PLAYER_HANDLE;
+    }
+
+    uint8_t pos = probeFor(id);
+    if (index[pos] != 0) {
+        return INVALID_PLAYER_HANDLE;
+    }
+
+    uint8_t slot = 0;
+    while (slots[slot].used) {
+        slot++;
+    }
+
+    PlayerRecord& rec = slots[slot];
+    rec.id = id;
+    rec.nameOffset = intern(name);
+    rec.gamesPlayed = 0;
+    rec.totalScore = 0;
+    rec.bestScore = 0;
+    rec.wins = 0;
+    rec.created = created;
+    rec.lastPlayed = 0;
+    rec.scoreMean = 0;
+    rec.scoreM2 = 0;
+    rec.streak = 0;
+    memset(rec.bestByDifficulty, 0, sizeof(rec.bestByDifficulty));
+    memset(rec.rankByDifficulty, 0, sizeof(rec.rankByDifficulty));
+    rec.rating = RATING_INITIAL;
+    rec.matches = 0;
+    rec.used = true;
+
+    index[pos] = slot + 1;
+    ratingOrder[count] = slot;
+    reorder(count);
+    count++;
+    return ((rec.generation & PLAYER_GENERATION_MASK) << PLAYER_SLOT_BITS) | slot;
+}
+
+PlayerHandle PlayerTable::find(const PlayerId& id) const {
+    uint8_t pos = probeFor(id);
+    if (index[pos] == 0) {
+        return INVALID_PLAYER_HANDLE;
+    }
+    return handleAt(index[pos] - 1);
+}
+
+bool PlayerTable::recordGame(PlayerHandle handle, uint16_t score, DifficultyLevel difficulty,
+                             uint32_t timestamp) {
+    PlayerRecord* rec = get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    rec->gamesPlayed++;
+    rec->totalScore += score;
+    if (score > rec->bestScore) {
+        rec->bestScore = score;
+    }
+
+    // Welford: stable without keeping the scores
+    float delta = score - rec->scoreMean;
+    rec->scoreMean += delta / rec->gamesPlayed;
+    rec->scoreM2 += delta * (score - rec->scoreMean);
+
+    if (score >= PLAYER_WIN_SCORE) {
+        rec->wins++;
+        rec->streak++;
+    } else {
+        rec->streak = 0;
+    }
+    rec->lastPlayed = timestamp;
+
+    if (difficulty < NUM_DIFFICULTIES && score > rec->bestByDifficulty[difficulty]) {
+        raiseBest(handle & PLAYER_SLOT_MASK, difficulty, score);
+    }
+    return true;
+}
+
+bool PlayerTable::setRating(PlayerHandle handle, float rating) {
+    PlayerRecord* rec = get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    rec->rating = rating;
+    uint8_t slot = handle & PLAYER_SLOT_MASK;
+    for (uint8_t pos = 0; pos < count; pos++) {
+        if (ratingOrder[pos] == slot) {
+            reorder(pos);
+            break;
+        }
+    }
+    return true;
+}
+
+PlayerHandle PlayerTable::handleByRating(uint8_t position) const {
+    if (position >= count) {
+        return INVALID_PLAYER_HANDLE;
+    }
+    return handleAt(ratingOrder[position]);
+}
+
+void PlayerTable::rebuildRatingOrder() {
+    // Insertion sort; the table is tiny and this only runs at load
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (!slots[i].used) {
+            continue;
+        }
+        uint8_t pos = n++;
+        while (pos > 0 && slots[ratingOrder[pos - 1]].rating < slots[i].rating) {
+            ratingOrder[pos] = ratingOrder[pos - 1];
+            pos--;
+        }
+        ratingOrder[pos] = i;
+    }
+}
+
+void PlayerTable::rebuildRanks() {
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+            if (!slots[i].used || slots[i].bestByDifficulty[d] == 0) {
+                if (slots[i].used) {
+                    slots[i].rankByDifficulty[d] = 0;
+                }
+                continue;
+            }
+            uint8_t rank = 1;
+            for (uint8_t j = 0; j < MAX_PLAYERS; j++) {
+                if (slots[j].used && slots[j].bestByDifficulty[d] > slots[i].bestByDifficulty[d]) {
+                    rank++;
+                }
+            }
+            slots[i].rankByDifficulty[d] = rank;
+        }
+    }
+}
+
+PlayerRecord* PlayerTable::get(PlayerHandle handle) {
+    uint8_t slot = handle & PLAYER_SLOT_MASK;
+    if (slot >= MAX_PLAYERS || !slots[slot].used ||
+        (slots[slot].generation & PLAYER_GENERATION_MASK) != (handle >> PLAYER_SLOT_BITS)) {
+        return nullptr;
+    }
+    return &slots[slot];
+}
+
+const PlayerRecord* PlayerTable::get(PlayerHandle handle) const {
+    return const_cast<PlayerTable*>(this)->get(handle);
+}
+
+const char* PlayerTable::name(PlayerHandle handle) const {
+    const PlayerRecord* rec = get(handle);
+    return rec ? names + rec->nameOffset : nullptr;
+}
+
+bool PlayerTable::rename(PlayerHandle handle, const char* name) {
+    PlayerRecord* rec = get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    // Reason: Released first so a compaction inside intern() drops the old name
+    rec->used = false;
+    rec->nameOffset = intern(name);
+    rec->used = true;
+    return true;
+}
+
+bool PlayerTable::remove(PlayerHandle handle) {
+    PlayerRecord* rec = get(handle);
+    if (!rec) {
+        return false;
+    }
+
+    // Everyone this player was ahead of moves up one place
+    uint8_t slot = handle & PLAYER_SLOT_MASK;
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+            if (i != slot && slots[i].used && slots[i].rankByDifficulty[d] != 0 &&
+                slots[i].bestByDifficulty[d] < rec->bestByDifficulty[d]) {
+                slots[i].rankByDifficulty[d]--;
+            }
+        }
+    }
+
+    for (uint8_t pos = 0; pos < count; pos++) {
+        if (ratingOrder[pos] == slot) {
+            memmove(ratingOrder + pos, ratingOrder + pos + 1, count - pos - 1);
+            break;
+        }
+    }
+
+    rec->used = false;
+    rec->generation++;
+    count--;
+
+    // Linear probing can't just blank an entry; the table is tiny, so rehash
+    rebuildIndex();
+    return true;
+}
+
+PlayerHandle PlayerTable::handleAt(uint8_t slot) const {
+    if (slot >= MAX_PLAYERS || !slots[slot].used) {
+        return INVALID_PLAYER_HANDLE;
+    }
+    return ((slots[slot].generation & PLAYER_GENERATION_MASK) << PLAYER_SLOT_BITS) | slot;
+}
+
+uint8_t PlayerTable::size() const {
+    return count;
+}
+
+void PlayerTable::raiseBest(uint8_t slot, uint8_t difficulty, uint16_t best) {
+    // Rank = 1 + players with a strictly higher best. Only the players this
+    // one overtakes (old best <= theirs < new best) drop a place.
+    uint16_t oldBest = slots[slot].bestByDifficulty[difficulty];
+    uint8_t rank = 1;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        PlayerRecord& other = slots[i];
+        if (i == slot || !other.used || other.rankByDifficulty[difficulty] == 0) {
+            continue;
+        }
+        uint16_t theirs = other.bestByDifficulty[difficulty];
+        if (theirs > best) {
+            rank++;
+        } else if (theirs < best && theirs >= oldBest) {
+            other.rankByDifficulty[difficulty]++;
+        }
+    }
+
+    slots[slot].bestByDifficulty[difficulty] = best;
+    slots[slot].rankByDifficulty[difficulty] = rank;
+}
+
+void PlayerTable::reorder(uint8_t position) {
+    // Only the moved player is out of place, so one shift in either direction
+    // restores the order (ties keep their current order)
+    uint8_t slot = ratingOrder[position];
+    float rating = slots[slot].rating;
+    while (position > 0 && slots[ratingOrder[position - 1]].rating < rating) {
+        ratingOrder[position] = ratingOrder[position - 1];
+        position--;
+    }
+    while (position + 1 < count && slots[ratingOrder[position + 1]].rating > rating) {
+        ratingOrder[position] = ratingOrder[position + 1];
+        position++;
+    }
+    ratingOrder[position] = slot;
+}
+
+uint32_t PlayerTable::hash(const PlayerId& id) {
+    // Random v4 IDs are already uniform; fold both words so every bit counts
+    uint64_t h = id.hi ^ id.lo;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+uint8_t PlayerTable::probeFor(const PlayerId& id) const {
+    uint8_t pos = hash(id) & (PLAYER_INDEX_SIZE - 1);
+    while (index[pos] != 0 && slots[index[pos] - 1].id != id) {
+        pos = (pos + 1) & (PLAYER_INDEX_SIZE - 1);
+    }
+    return pos;
+}
+
+uint16_t PlayerTable::intern(const char* name) {
+    size_t len = min(strlen(name), (size_t)PLAYER_NAME_MAX);
+
+    // Reuse an identical stored name
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (!slots[i].used) {
+            continue;
+        }
+        const char* stored = names + slots[i].nameOffset;
+        if (strncmp(stored, name, len) == 0 && stored[len] == '\0') {
+            return slots[i].nameOffset;
+        }
+    }
+
+    // The pool holds MAX_PLAYERS full-length names, so compacting always makes room
+    if (namesUsed + len + 1 > PLAYER_NAME_POOL_BYTES) {
+        compactNames();
+    }
+
+    uint16_t offset = namesUsed;
+    memcpy(names + offset, name, len);
+    names[offset + len] = '\0';
+    namesUsed += len + 1;
+    return offset;
+}
+
+void PlayerTable::compactNames() {
+    char packed[PLAYER_NAME_POOL_BYTES];
+    uint16_t packedUsed = 0;
+    uint16_t newOffsets[MAX_PLAYERS];
+
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (!slots[i].used) {
+            continue;
+        }
+
+        // Players sharing an interned name keep sharing it
+        newOffsets[i] = 0xFFFF;
+        for (uint8_t j = 0; j < i; j++) {
+            if (slots[j].used && slots[j].nameOffset == slots[i].nameOffset) {
+                newOffsets[i] = newOffsets[j];
+                break;
+            }
+        }
+
+        if (newOffsets[i] == 0xFFFF) {
+            size_t len = strlen(names + slots[i].nameOffset) + 1;
+            memcpy(packed + packedUsed, names + slots[i].nameOffset, len);
+            newOffsets[i] = packedUsed;
+            packedUsed += len;
+        }
+    }
+
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (slots[i].used) {
+            slots[i].nameOffset = newOffsets[i];
+        }
+    }
+    memcpy(names, packed, packedUsed);
+    namesUsed = packedUsed;
+}
+
+void PlayerTable::rebuildIndex() {
+    memset(index, 0, sizeof(index));
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        if (slots[i].used) {
+            index[probeFor(slots[i].id)] = i + 1;
+        }
+    }
+}
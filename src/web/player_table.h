@@ -0,0 +1,241 @@
+/**
+ * Player Table for ESP32 Simon Says
+ *
+ * Fixed-size table of player profiles with an open-addressing hash index
+ * from player ID to slot, so lookups take no allocations and O(1) probes.
+ * Names are interned in one shared pool (identical names are stored once).
+ *
+ * Players are referred to by 16-bit handles: the slot number plus a
+ * generation that changes whenever the slot is reused, so a handle kept
+ * across a delete is rejected instead of reaching another player.
+ *
+ * Each record also carries aggregates that recordGame() keeps up to date
+ * (running mean/variance, per-difficulty best and rank, streak), so a
+ * player's stats never need a history scan. Slots are also kept sorted by
+ * rating, so the leaderboard is read in order instead of sorted per request.
+ * Not thread-safe: the owner serializes access.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+#include "../game/difficulty_modes.h"
+#include "player_id.h"
+
+#define MAX_PLAYERS 20
+#define PLAYER_NAME_MAX 32           // Longer names are cut
+#define PLAYER_NAME_POOL_BYTES (MAX_PLAYERS * (PLAYER_NAME_MAX + 1))  // Interned names
+#define PLAYER_INDEX_SIZE 32         // Hash slots (power of two, > MAX_PLAYERS)
+
+// A game at or above this score counts as a win (and extends the streak)
+#define PLAYER_WIN_SCORE 5
+
+// Slot in the low bits, generation above
+#define PLAYER_SLOT_BITS 5
+
+typedef uint16_t PlayerHandle;
+#define INVALID_PLAYER_HANDLE 0xFFFF
+
+/**
+ * One stored player
+ */
+struct PlayerRecord {
+    PlayerId id;
+    uint16_t nameOffset;     // Start of the name in the pool
+    uint16_t generation;     // Bumped each time the slot is freed
+    uint32_t gamesPlayed;
+    uint32_t totalScore;
+    uint16_t bestScore;
+    uint16_t wins;
+    uint32_t created;
+    uint32_t lastPlayed;     // Timestamp of the latest game (0 = never)
+    float scoreMean;         // Running mean (Welford)
+    float scoreM2;           // Sum of squared deviations (Welford)
+    uint16_t streak;         // Consecutive wins up to the latest game
+    uint16_t bestByDifficulty[NUM_DIFFICULTIES];
+    uint8_t rankByDifficulty[NUM_DIFFICULTIES];  // 1 = top, 0 = not played
+    float rating;            // Pass-and-play Elo rating
+    uint16_t matches;        // Rated pass-and-play games
+    bool used;
+
+    /**
+     * Get the score variance (population)
+     *
+     * Returns:
+     *     float: Variance, 0 with fewer than two games
+     */
+    float scoreVariance() const {
+        return gamesPlayed > 1 ? scoreM2 / gamesPlayed : 0;
+    }
+};
+
+class PlayerTable {
+public:
+    /**
+     * Constructor (empty table)
+     */
+    PlayerTable();
+
+    /**
+     * Remove all players
+     */
+    void clear();
+
+    /**
+     * Add a player with zeroed statistics
+     *
+     * Args:
+     *     id: Player ID (not nil)
+     *     name: Display name
+     *     created: Creation timestamp
+     *
+     * Returns:
+     *     PlayerHandle: New handle, or INVALID_PLAYER_HANDLE if the table is
+     *                   full or the ID exists
+     */
+    PlayerHandle add(const PlayerId& id, const char* name, uint32_t created);
+
+    /**
+     * Find a player by ID
+     *
+     * Args:
+     *     id: Player ID
+     *
+     * Returns:
+     *     PlayerHandle: Handle, or INVALID_PLAYER_HANDLE if not found
+     */
+    PlayerHandle find(const PlayerId& id) const;
+
+    /**
+     * Fold a finished game into a player's aggregates and ranks
+     *
+     * Args:
+     *     handle: Player handle
+     *     score: Score achieved
+     *     difficulty: Difficulty played
+     *     timestamp: When the game was played
+     *
+     * Returns:
+     *     bool: false if the handle is stale
+     */
+    bool recordGame(PlayerHandle handle, uint16_t score, DifficultyLevel difficulty,
+                    uint32_t timestamp);
+
+    /**
+     * Set a player's rating and move them to their place in rating order
+     *
+     * Args:
+     *     handle: Player handle
+     *     rating: New rating
+     *
+     * Returns:
+     *     bool: false if the handle is stale
+     */
+    bool setRating(PlayerHandle handle, float rating);
+
+    /**
+     * Get the player at a position in rating order
+     *
+     * Args:
+     *     position: 0 (highest rating) to size() - 1
+     *
+     * Returns:
+     *     PlayerHandle: Handle, or INVALID_PLAYER_HANDLE past the end
+     */
+    PlayerHandle handleByRating(uint8_t position) const;
+
+    /**
+     * Re-sort the rating order (after loading ratings from storage)
+     */
+    void rebuildRatingOrder();
+
+    /**
+     * Recompute every per-difficulty rank (after loading bests from storage)
+     */
+    void rebuildRanks();
+
+    /**
+     * Get a player's record
+     *
+     * Args:
+     *     handle: Player handle
+     *
+     * Returns:
+     *     PlayerRecord*: Record, or nullptr if the handle is stale
+     */
+    PlayerRecord* get(PlayerHandle handle);
+    const PlayerRecord* get(PlayerHandle handle) const;
+
+    /**
+     * Get a player's name
+     *
+     * Args:
+     *     handle: Player handle
+     *
+     * Returns:
+     *     const char*: Name (valid until the table changes), or nullptr
+     */
+    const char* name(PlayerHandle handle) const;
+
+    /**
+     * Change a player's name
+     *
+     * Args:
+     *     handle: Player handle
+     *     name: New display name
+     *
+     * Returns:
+     *     bool: false if the handle is stale
+     */
+    bool rename(PlayerHandle handle, const char* name);
+
+    /**
+     * Delete a player
+     *
+     * Args:
+     *     handle: Player handle
+     *
+     * Returns:
+     *     bool: false if the handle is stale
+     */
+    bool remove(PlayerHandle handle);
+
+    /**
+     * Get the handle of a slot, for iterating over the table
+     *
+     * Args:
+     *     slot: Slot index (0 to MAX_PLAYERS - 1)
+     *
+     * Returns:
+     *     PlayerHandle: Handle, or INVALID_PLAYER_HANDLE if the slot is free
+     */
+    PlayerHandle handleAt(uint8_t slot) const;
+
+    /**
+     * Get number of players
+     *
+     * Returns:
+     *     uint8_t: Player count
+     */
+    uint8_t size() const;
+
+private:
+    PlayerRecord slots[MAX_PLAYERS];
+    uint8_t index[PLAYER_INDEX_SIZE];   // Slot + 1, 0 = empty
+    uint8_t ratingOrder[MAX_PLAYERS];   // Used slots, highest rating first
+    char names[PLAYER_NAME_POOL_BYTES];
+    uint16_t namesUsed;
+    uint8_t count;
+
+    static uint32_t hash(const PlayerId& id);
+    uint8_t probeFor(const PlayerId& id) const;
+    uint16_t intern(const char* name);
+    void compactNames();
+    void rebuildIndex();
+    void raiseBest(uint8_t slot, uint8_t difficulty, uint16_t best);
+    void reorder(uint8_t position);
+};
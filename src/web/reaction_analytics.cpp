@@ -0,0 +1,397 @@
+/**
+ * Reaction-Time Analytics Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "reaction_analytics.h"
+#include "atomic_file.h"
+#include "data_storage.h"
+
+// Reason: Presses are recorded on the loop task while /api/analytics reads
+// on the async_tcp task, so entries are only touched inside this lock
+static portMUX_TYPE analyticsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Fine resolution where human reaction times cluster, coarse beyond
+const uint16_t ReactionStats::BUCKET_BOUNDS_MS[ANALYTICS_NUM_BUCKETS - 1] = {
+    150, 200, 250, 300, 350, 400, 450, 500,
+    600, 700, 800, 1000, 1250, 1500, 2000, 3000
+};
+
+// ============================================================================
+// ReactionStats
+// ============================================================================
+
+void ReactionStats::reset() {
+    count = 0;
+    mean = 0.0f;
+    m2 = 0.0f;
+    minMs = 0;
+    maxMs = 0;
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void ReactionStats::add(uint32_t ms) {
+    uint16_t sample = ms > 0xFFFF ? 0xFFFF : ms;
+
+    // Welford's online mean/variance
+    count++;
+    float delta = sample - mean;
+    mean += delta / count;
+    m2 += delta * (sample - mean);
+
+    if (count == 1 || sample < minMs) {
+        minMs = sample;
+    }
+    if (sample > maxMs) {
+        maxMs = sample;
+    }
+
+    uint8_t bucket = ANALYTICS_NUM_BUCKETS - 1;
+    for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS - 1; i++) {
+        if (sample <= BUCKET_BOUNDS_MS[i]) {
+            bucket = i;
+            break;
+        }
+    }
+
+    // Halve all buckets when one would overflow
+    // Reason: Keeps the distribution shape in 16-bit counters
+    if (buckets[bucket] == 0xFFFF) {
+        for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS; i++) {
+            buckets[i] = (buckets[i] + 1) >> 1;
+        }
+    }
+    buckets[bucket]++;
+}
+
+float ReactionStats::stddev() const {
+    if (count < 2) {
+        return 0.0f;
+    }
+    return sqrtf(m2 / (count - 1));
+}
+
+uint16_t ReactionStats::percentile(uint8_t pct) const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS; i++) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the requested percentile (1-based, rounded up)
+    uint32_t rank = ((uint64_t)total * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint16_t bound = BUCKET_BOUNDS_MS[i];
+            if (bound > maxMs) {
+                return maxMs;
+            }
+            return bound < minMs ? minMs : bound;
+        }
+    }
+    return maxMs;
+}
+
+// ============================================================================
+// ReactionAnalytics
+// ============================================================================
+
+ReactionAnalytics::ReactionAnalytics() :
+    activityCounter(0),
+    lastSaveTime(0),
+    dirty(false),
+    storage(nullptr) {
+
+    for (uint8_t i = 0; i < NUM_DIFFICULTIES; i++) {
+        resetEntry(difficulties[i]);
+    }
+    for (uint8_t i = 0; i < MAX_ANALYTICS_RECORDS; i++) {
+        resetEntry(players[i]);
+    }
+}
+
+bool ReactionAnalytics::begin() {
+    // Finish or discard a save a reset interrupted
+    AtomicFile::Status status = AtomicFile::recover(STORAGE_ANALYTICS_FILE);
+    if (status == AtomicFile::MISSING) {
+        DEBUG_PRINTLN("[STORAGE] No analytics file yet");
+        return true;
+    }
+
+    // A corrupt file has been moved aside, so this fails and we start empty
+    File file;
+    if (AtomicFile::open(STORAGE_ANALYTICS_FILE, file) >= AtomicFile::MISSING) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open analytics file");
+        return false;
+    }
+
+    // Parse one entry at a time
+    // Reason: A single document for every player would need ~20KB of heap
+    uint8_t loaded = 0;
+    if (file.find("\"difficulties\":[")) {
+        do {
+            StaticJsonDocument<1024> doc;
+            if (deserializeJson(doc, file) != DeserializationError::Ok) {
+                break;
+            }
+            uint8_t d = doc["difficulty"] | 0xFF;
+            if (d < NUM_DIFFICULTIES) {
+                statsFromJson(doc["reaction"], difficulties[d].reaction);
+                statsFromJson(doc["interval"], difficulties[d].interval);
+            }
+        } while (file.findUntil(",", "]"));
+    }
+
+    if (file.find("\"players\":[")) {
+        do {
+            StaticJsonDocument<1024> doc;
+            if (deserializeJson(doc, file) != DeserializationError::Ok) {
+                break;
+            }
+            const char* id = doc["id"];
+            if (!id || loaded >= MAX_ANALYTICS_RECORDS) {
+                continue;
+            }
+            AnalyticsEntry& entry = players[loaded++];
+            strlcpy(entry.id, id, sizeof(entry.id));
+            entry.lastSeen = doc["seen"] | 0;
+            statsFromJson(doc["reaction"], entry.reaction);
+            statsFromJson(doc["interval"], entry.interval);
+            if (entry.lastSeen > activityCounter) {
+                activityCounter = entry.lastSeen;
+            }
+        } while (file.findUntil(",", "]"));
+    }
+
+    file.close();
+    DEBUG_PRINTF("[STORAGE] Loaded analytics for %d players\n", loaded);
+    return true;
+}
+
+void ReactionAnalytics::recordPress(const char* playerId, DifficultyLevel difficulty,
+                                    bool firstOfRound, uint32_t elapsedMs) {
+    if (difficulty >= NUM_DIFFICULTIES) {
+        return;
+    }
+
+    portENTER_CRITICAL(&analyticsMux);
+    AnalyticsEntry* player = playerSlot(playerId);
+    if (firstOfRound) {
+        difficulties[difficulty].reaction.add(elapsedMs);
+        player->reaction.add(elapsedMs);
+    } else {
+        difficulties[difficulty].interval.add(elapsedMs);
+        player->interval.add(elapsedMs);
+    }
+    player->lastSeen = ++activityCounter;
+    dirty = true;
+    portEXIT_CRITICAL(&analyticsMux);
+}
+
+void ReactionAnalytics::update(bool gameActive) {
+    // Reason: A LittleFS write can take tens of ms, too long mid-sequence
+    if (!dirty || gameActive) {
+        return;
+    }
+
+    if (millis() - lastSaveTime < ANALYTICS_SAVE_INTERVAL_MS) {
+        return;
+    }
+
+    lastSaveTime = millis();
+    save();
+}
+
+bool ReactionAnalytics::flush() {
+    if (!dirty) {
+        return true;
+    }
+
+    lastSaveTime = millis();
+    return save();
+}
+
+bool ReactionAnalytics::save() {
+    // Cleared before copying so presses during the save mark it dirty again
+    dirty = false;
+
+    // Stream one entry at a time, copying each under the lock
+    size_t bytesWritten = AtomicFile::write(STORAGE_ANALYTICS_FILE, [this](Print& out) {
+        bool ok = out.print("{\"version\":1,\"difficulties\":[") > 0;
+        AnalyticsEntry entry;
+        for (uint8_t d = 0; d < NUM_DIFFICULTIES && ok; d++) {
+            snapshotDifficulty((DifficultyLevel)d, entry);
+
+            StaticJsonDocument<1024> doc;
+            doc["difficulty"] = d;
+            statsToJson(entry.reaction, doc.createNestedObject("reaction"));
+            statsToJson(entry.interval, doc.createNestedObject("interval"));
+
+            if (d > 0) {
+                out.print(",");
+            }
+            ok = serializeJson(doc, out) > 0;
+        }
+
+        ok = ok && out.print("],\"players\":[") > 0;
+        bool first = true;
+        for (uint8_t i = 0; i < MAX_ANALYTICS_RECORDS && ok; i++) {
+            if (!snapshotPlayer(i, entry)) {
+                continue;
+            }
+
+            StaticJsonDocument<1024> doc;
+            doc["id"] = entry.id;
+            doc["seen"] = entry.lastSeen;
+            statsToJson(entry.reaction, doc.createNestedObject("reaction"));
+            statsToJson(entry.interval, doc.createNestedObject("interval"));
+
+            if (!first) {
+                out.print(",");
+            }
+            first = false;
+            ok = serializeJson(doc, out) > 0;
+        }
+
+        return ok && out.print("]}") > 0;
+    });
+
+    if (bytesWritten == 0) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to write analytics");
+        dirty = true;
+        return false;
+    }
+
+    if (storage) {
+        storage->countWrite(DataStorage::WEAR_ANALYTICS, bytesWritten);
+    }
+    LOG_D(LOG_TAG_STORAGE, "Analytics saved (%d bytes)\n", bytesWritten);
+    return true;
+}
+
+void ReactionAnalytics::clear() {
+    portENTER_CRITICAL(&analyticsMux);
+    for (uint8_t i = 0; i < NUM_DIFFICULTIES; i++) {
+        resetEntry(difficulties[i]);
+    }
+    for (uint8_t i = 0; i < MAX_ANALYTICS_RECORDS; i++) {
+        resetEntry(players[i]);
+    }
+    activityCounter = 0;
+    dirty = false;
+    portEXIT_CRITICAL(&analyticsMux);
+
+    AtomicFile::remove(STORAGE_ANALYTICS_FILE);
+    DEBUG_PRINTLN("[STORAGE] Analytics cleared");
+}
+
+void ReactionAnalytics::snapshotDifficulty(DifficultyLevel difficulty, AnalyticsEntry& out) {
+    if (difficulty >= NUM_DIFFICULTIES) {
+        resetEntry(out);
+        return;
+    }
+
+    portENTER_CRITICAL(&analyticsMux);
+    out = difficulties[difficulty];
+    portEXIT_CRITICAL(&analyticsMux);
+}
+
+bool ReactionAnalytics::snapshotPlayer(uint8_t slot, AnalyticsEntry& out) {
+    if (slot >= MAX_ANALYTICS_RECORDS) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&analyticsMux);
+    out = players[slot];
+    portEXIT_CRITICAL(&analyticsMux);
+
+    return out.id[0] != '\0';
+}
+
+void ReactionAnalytics::summaryToJson(const AnalyticsEntry& entry, JsonObject obj) {
+    const ReactionStats* stats[2] = {&entry.reaction, &entry.interval};
+    const char* names[2] = {"reaction", "interval"};
+
+    for (uint8_t i = 0; i < 2; i++) {
+        JsonObject s = obj.createNestedObject(names[i]);
+        s["count"] = stats[i]->count;
+        s["meanMs"] = (uint32_t)(stats[i]->mean + 0.5f);
+        s["stddevMs"] = (uint32_t)(stats[i]->stddev() + 0.5f);
+        s["minMs"] = stats[i]->minMs;
+        s["maxMs"] = stats[i]->maxMs;
+        s["p50"] = stats[i]->percentile(50);
+        s["p90"] = stats[i]->percentile(90);
+        s["p99"] = stats[i]->percentile(99);
+    }
+}
+
+AnalyticsEntry* ReactionAnalytics::playerSlot(const char* playerId) {
+    AnalyticsEntry* freeSlot = nullptr;
+    AnalyticsEntry* oldest = &players[0];
+
+    for (uint8_t i = 0; i < MAX_ANALYTICS_RECORDS; i++) {
+        if (players[i].id[0] == '\0') {
+            if (!freeSlot) {
+                freeSlot = &players[i];
+            }
+        } else if (strcmp(players[i].id, playerId) == 0) {
+            return &players[i];
+        } else if (players[i].lastSeen < oldest->lastSeen) {
+            oldest = &players[i];
+        }
+    }
+
+    // Evict the least recently active player when the table is full
+    AnalyticsEntry* slot = freeSlot ? freeSlot : oldest;
+    resetEntry(*slot);
+    strlcpy(slot->id, playerId, sizeof(slot->id));
+    return slot;
+}
+
+void ReactionAnalytics::resetEntry(AnalyticsEntry& entry) {
+    entry.id[0] = '\0';
+    entry.lastSeen = 0;
+    entry.reaction.reset();
+    entry.interval.reset();
+}
+
+void ReactionAnalytics::statsToJson(const ReactionStats& stats, JsonObject obj) {
+    obj["n"] = stats.count;
+    obj["mean"] = stats.mean;
+    obj["m2"] = stats.m2;
+    obj["min"] = stats.minMs;
+    obj["max"] = stats.maxMs;
+
+    JsonArray buckets = obj.createNestedArray("buckets");
+    for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS; i++) {
+        buckets.add(stats.buckets[i]);
+    }
+}
+
+void ReactionAnalytics::statsFromJson(JsonObjectConst obj, ReactionStats& stats) {
+    stats.reset();
+    if (obj.isNull()) {
+        return;
+    }
+
+    stats.count = obj["n"] | 0;
+    stats.mean = obj["mean"] | 0.0f;
+    stats.m2 = obj["m2"] | 0.0f;
+    stats.minMs = obj["min"] | 0;
+    stats.maxMs = obj["max"] | 0;
+
+    JsonArrayConst buckets = obj["buckets"];
+    for (uint8_t i = 0; i < ANALYTICS_NUM_BUCKETS && i < buckets.size(); i++) {
+        stats.buckets[i] = buckets[i] | 0;
+    }
+}
@@ -0,0 +1,207 @@
+/**
+ * Reaction-Time Analytics for ESP32 Simon Says
+ *
+ * Keeps streaming aggregates of player timing, per player and per difficulty:
+ *     reaction: time from the end of playback to the first press of a round
+ *     interval: time between consecutive presses within a round
+ *
+ * Each aggregate holds count, mean and variance (Welford) plus a fixed-bucket
+ * histogram for percentiles, so memory stays constant however many games are
+ * played. Aggregates are saved crash-safely (AtomicFile) to
+ * STORAGE_ANALYTICS_FILE and served by /api/analytics without touching the
+ * game history.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "../config.h"
+#include "../game/difficulty_modes.h"
+
+// Buckets of the timing histogram (last bucket catches everything slower)
+#define ANALYTICS_NUM_BUCKETS 17
+
+// Forward declarations
+class DataStorage;
+
+// Player ID buffer (UUID plus terminator)
+#define ANALYTICS_ID_LENGTH 40
+
+/**
+ * Streaming timing aggregate
+ */
+struct ReactionStats {
+    uint32_t count;
+    float mean;          // Running mean (ms)
+    float m2;            // Sum of squared deviations from the mean (Welford)
+    uint16_t minMs;
+    uint16_t maxMs;
+    uint16_t buckets[ANALYTICS_NUM_BUCKETS];
+
+    static const uint16_t BUCKET_BOUNDS_MS[ANALYTICS_NUM_BUCKETS - 1];
+
+    /**
+     * Clear all samples
+     */
+    void reset();
+
+    /**
+     * Add one sample
+     *
+     * Args:
+     *     ms: Sample in milliseconds (saturates at 65535)
+     */
+    void add(uint32_t ms);
+
+    /**
+     * Get sample standard deviation
+     *
+     * Returns:
+     *     float: Standard deviation in ms (0 with fewer than 2 samples)
+     */
+    float stddev() const;
+
+    /**
+     * Estimate a percentile from the bucket counts
+     *
+     * Args:
+     *     pct: Percentile (1-100)
+     *
+     * Returns:
+     *     uint16_t: Upper bound of the bucket holding the percentile (ms),
+     *               clamped to the observed min/max
+     */
+    uint16_t percentile(uint8_t pct) const;
+};
+
+/**
+ * Aggregates for one player or one difficulty
+ */
+struct AnalyticsEntry {
+    char id[ANALYTICS_ID_LENGTH];  // Player ID (empty for difficulty entries / free slots)
+    uint32_t lastSeen;             // Activity stamp used for eviction
+    ReactionStats reaction;
+    ReactionStats interval;
+};
+
+class ReactionAnalytics {
+public:
+    /**
+     * Constructor
+     */
+    ReactionAnalytics();
+
+    /**
+     * Load saved aggregates (call after LittleFS is mounted)
+     *
+     * Returns:
+     *     bool: true if loaded or no file exists yet
+     */
+    bool begin();
+
+    /**
+     * Set the storage that counts analytics saves for wear accounting
+     *
+     * Args:
+     *     dataStorage: Storage instance (may be nullptr)
+     */
+    void setStorage(DataStorage* dataStorage) {
+        storage = dataStorage;
+    }
+
+    /**
+     * Record one player press
+     *
+     * Args:
+     *     playerId: Player who pressed
+     *     difficulty: Difficulty of the game
+     *     firstOfRound: true if this is the first press after playback
+     *     elapsedMs: Time since playback ended or the previous press
+     */
+    void recordPress(const char* playerId, DifficultyLevel difficulty,
+                     bool firstOfRound, uint32_t elapsedMs);
+
+    /**
+     * Save aggregates if they changed and the save interval has passed
+     * Call repeatedly in loop()
+     *
+     * Args:
+     *     gameActive: true while a game runs (saving is deferred)
+     */
+    void update(bool gameActive);
+
+    /**
+     * Save aggregates now if they changed (e.g. before deep sleep)
+     *
+     * Returns:
+     *     bool: true if nothing is left unsaved
+     */
+    bool flush();
+
+    /**
+     * Write aggregates to STORAGE_ANALYTICS_FILE
+     *
+     * Returns:
+     *     bool: true if successful
+     */
+    bool save();
+
+    /**
+     * Delete all aggregates and the saved file
+     */
+    void clear();
+
+    /**
+     * Copy the aggregates of one difficulty
+     *
+     * Args:
+     *     difficulty: Difficulty level
+     *     out: Receives a consistent copy
+     */
+    void snapshotDifficulty(DifficultyLevel difficulty, AnalyticsEntry& out);
+
+    /**
+     * Copy the aggregates of one player slot
+     *
+     * Args:
+     *     slot: Slot index (0 to MAX_ANALYTICS_RECORDS - 1)
+     *     out: Receives a consistent copy
+     *
+     * Returns:
+     *     bool: true if the slot is in use
+     */
+    bool snapshotPlayer(uint8_t slot, AnalyticsEntry& out);
+
+    /**
+     * Add a summary of an entry (count, mean, stddev, min, max, p50/p90/p99
+     * for reaction and interval) to a JSON object
+     *
+     * Args:
+     *     entry: Entry to summarize
+     *     obj: JSON object to fill
+     */
+    static void summaryToJson(const AnalyticsEntry& entry, JsonObject obj);
+
+private:
+    AnalyticsEntry difficulties[NUM_DIFFICULTIES];
+    AnalyticsEntry players[MAX_ANALYTICS_RECORDS];
+    uint32_t activityCounter;
+    uint32_t lastSaveTime;
+    bool dirty;
+    DataStorage* storage;
+
+    /**
+     * Find a player slot, claiming the least recently active one if needed
+     * (call inside the critical section)
+     */
+    AnalyticsEntry* playerSlot(const char* playerId);
+
+    static void resetEntry(AnalyticsEntry& entry);
+    static void statsToJson(const ReactionStats& stats, JsonObject obj);
+    static void statsFromJson(JsonObjectConst obj, ReactionStats& stats);
+};
@@ -0,0 +1,194 @@
+/**
+ * Append-Only Record Log Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "record_log.h"
+#include <rom/crc.h>
+
+// "#" + 8 hex digits
+#define RECORD_CRC_LEN 9
+
+RecordLog::RecordLog(const char* dir, uint8_t segmentRecords, uint16_t keepRecords) :
+    dir(dir),
+    segmentRecords(segmentRecords),
+    // Enough whole segments for keepRecords, plus the one being filled
+    maxSegments((keepRecords + segmentRecords - 1) / segmentRecords + 1),
+    oldestSegment(0),
+    newestSegment(0),
+    newestCount(0),
+    initialized(false) {
+}
+
+bool RecordLog::begin() {
+    if (!LittleFS.exists(dir) && !LittleFS.mkdir(dir)) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to create %s\n", dir);
+        return false;
+    }
+
+    File root = LittleFS.open(dir);
+    if (!root || !root.isDirectory()) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to open %s\n", dir);
+        return false;
+    }
+
+    // Segment numbers are the file names, so the range is recovered by scanning
+    File file = root.openNextFile();
+    while (file) {
+        uint32_t segment = strtoul(file.name(), nullptr, 10);
+        if (segment > 0) {
+            if (oldestSegment == 0 || segment < oldestSegment) {
+                oldestSegment = segment;
+            }
+            if (segment > newestSegment) {
+                newestSegment = segment;
+            }
+        }
+        file = root.openNextFile();
+    }
+
+    if (newestSegment > 0) {
+        File newest = LittleFS.open(pathFor(newestSegment), "r");
+        // Reason: Appending after a torn line would corrupt the next record too
+        if (!newest || !scanSegment(newest, newestCount)) {
+            newestCount = segmentRecords;
+        }
+    }
+
+    initialized = true;
+    DEBUG_PRINTF("[STORAGE] %s: segments %u-%u, %d records in newest\n",
+                dir, oldestSegment, newestSegment, newestCount);
+    return true;
+}
+
+size_t RecordLog::append(const std::vector<String>& records) {
+    if (!initialized || records.empty()) {
+        return 0;
+    }
+
+    size_t written = 0;
+    size_t i = 0;
+    while (i < records.size()) {
+        if (newestSegment == 0 || newestCount >= segmentRecords) {
+            newestSegment++;
+            newestCount = 0;
+            if (oldestSegment == 0) {
+                oldestSegment = newestSegment;
+            }
+        }
+
+        File file = LittleFS.open(pathFor(newestSegment), "a");
+        if (!file) {
+            DEBUG_PRINTF("[STORAGE] ERROR: Failed to open %s for appending\n", dir);
+            return 0;
+        }
+
+        // Fill this segment, then continue in the next one
+        for (; i < records.size() && newestCount < segmentRecords; i++) {
+            const String& record = records[i];
+            char crc[RECORD_CRC_LEN + 2];
+            snprintf(crc, sizeof(crc), "#%08x\n",
+                     crc32_le(0, (const uint8_t*)record.c_str(), record.length()));
+
+            size_t n = file.write((const uint8_t*)record.c_str(), record.length());
+            n += file.write((const uint8_t*)crc, RECORD_CRC_LEN + 1);
+            if (n != record.length() + RECORD_CRC_LEN + 1) {
+                DEBUG_PRINTF("[STORAGE] ERROR: Short write to %s\n", dir);
+                file.close();
+                // Leave the torn segment behind; the next append starts a new one
+                newestCount = segmentRecords;
+                return 0;
+            }
+            written += n;
+            newestCount++;
+        }
+        file.close();
+    }
+
+    // Evict whole segments beyond what keepRecords needs
+    while (newestSegment - oldestSegment + 1 > maxSegments) {
+        LittleFS.remove(pathFor(oldestSegment));
+        oldestSegment++;
+    }
+
+    return written;
+}
+
+void RecordLog::forEach(const std::function<void(const char* record, size_t len)>& fn) {
+    if (!initialized || oldestSegment == 0) {
+        return;
+    }
+
+    char line[RECORD_LOG_MAX_LINE];
+    for (uint32_t segment = oldestSegment; segment <= newestSegment; segment++) {
+        File file = LittleFS.open(pathFor(segment), "r");
+        if (!file) {
+            continue;
+        }
+
+        size_t len = 0;
+        bool overflow = false;
+        int c;
+        while ((c = file.read()) >= 0) {
+            if (c != '\n') {
+                if (len < sizeof(line) - 1) {
+                    line[len++] = (char)c;
+                } else {
+                    overflow = true;
+                }
+                continue;
+            }
+
+            // Check "<record>#crc" and hand out <record>
+            if (!overflow && len > RECORD_CRC_LEN && line[len - RECORD_CRC_LEN] == '#') {
+                line[len] = '\0';
+                size_t recordLen = len - RECORD_CRC_LEN;
+                char* end = nullptr;
+                uint32_t expected = strtoul(line + recordLen + 1, &end, 16);
+                if (end == line + len &&
+                    crc32_le(0, (const uint8_t*)line, recordLen) == expected) {
+                    line[recordLen] = '\0';
+                    fn(line, recordLen);
+                }
+            }
+            len = 0;
+            overflow = false;
+        }
+        file.close();
+    }
+}
+
+void RecordLog::clear() {
+    if (oldestSegment != 0) {
+        for (uint32_t segment = oldestSegment; segment <= newestSegment; segment++) {
+            LittleFS.remove(pathFor(segment));
+        }
+    }
+    // Numbering carries on, so the next append starts a fresh segment
+    oldestSegment = 0;
+    newestCount = segmentRecords;
+}
+
+bool RecordLog::empty() const {
+    return oldestSegment == 0;
+}
+
+String RecordLog::pathFor(uint32_t segment) const {
+    return String(dir) + "/" + String(segment) + ".log";
+}
+
+bool RecordLog::scanSegment(File& file, uint8_t& count) {
+    count = 0;
+    int last = '\n';
+    int c;
+    while ((c = file.read()) >= 0) {
+        if (c == '\n') {
+            count++;
+        }
+        last = c;
+    }
+    file.close();
+    return last == '\n';
+}
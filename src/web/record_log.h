@@ -0,0 +1,96 @@
+/**
+ * Append-Only Record Log for ESP32 Simon Says
+ *
+ * Keeps short text records (one JSON object per line) in numbered segment
+ * files (<dir>/<n>.log). New records are appended to the newest segment
+ * instead of rewriting a whole file, so a save costs one tail-block copy on
+ * LittleFS rather than a fresh copy of every block the data spans. A segment
+ * is closed after a fixed number of records, and the oldest segments are
+ * deleted once the newer ones hold enough records.
+ *
+ * Line layout:
+ *     <record>#xxxxxxxx\n      (CRC-32 of <record>, hex)
+ *
+ * A line cut short by a reset fails its CRC and is skipped; the next append
+ * then starts a new segment so no later record is glued onto it.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include <vector>
+#include "../config.h"
+
+// Longest record line accepted on read (record + CRC + newline)
+#define RECORD_LOG_MAX_LINE 320
+
+class RecordLog {
+public:
+    /**
+     * Constructor
+     *
+     * Args:
+     *     dir: Directory holding the segments
+     *     segmentRecords: Records per segment before a new one is started
+     *     keepRecords: Records that must survive segment eviction
+     */
+    RecordLog(const char* dir, uint8_t segmentRecords, uint16_t keepRecords);
+
+    /**
+     * Create the directory and find the stored segments
+     * (call after LittleFS is mounted)
+     *
+     * Returns:
+     *     bool: true if successful
+     */
+    bool begin();
+
+    /**
+     * Append records in one write, oldest first
+     *
+     * Args:
+     *     records: Record texts (no newlines)
+     *
+     * Returns:
+     *     size_t: Bytes written, or 0 on failure
+     */
+    size_t append(const std::vector<String>& records);
+
+    /**
+     * Call a function for every intact record, oldest first
+     *
+     * Args:
+     *     fn: Receives each record (NUL-terminated) and its length
+     */
+    void forEach(const std::function<void(const char* record, size_t len)>& fn);
+
+    /**
+     * Delete all segments
+     */
+    void clear();
+
+    /**
+     * Check whether the log holds no segments
+     *
+     * Returns:
+     *     bool: true if empty
+     */
+    bool empty() const;
+
+private:
+    const char* dir;
+    uint8_t segmentRecords;
+    uint8_t maxSegments;
+    uint32_t oldestSegment;   // 0 = no segments
+    uint32_t newestSegment;
+    uint8_t newestCount;      // Records in the newest segment
+    bool initialized;
+
+    String pathFor(uint32_t segment) const;
+    static bool scanSegment(File& file, uint8_t& count);
+};
@@ -0,0 +1,330 @@
+/**
+ * Replay Store Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "replay_store.h"
+#include <algorithm>
+#include "atomic_file.h"
+#include "data_storage.h"
+
+/**
+ * Holds the store lock for the lifetime of the guard
+ */
+class StoreGuard {
+public:
+    explicit StoreGuard(SemaphoreHandle_t m) : mutex(m) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~StoreGuard() {
+        xSemaphoreGive(mutex);
+    }
+
+private:
+    SemaphoreHandle_t mutex;
+};
+
+// Reason: Queued replays must never fall out of the rolling window before
+// they are written, or eviction would have to reach into the queue
+static_assert(REPLAY_PENDING_MAX > 0 && REPLAY_PENDING_MAX < REPLAY_MAX_FILES,
+              "REPLAY_PENDING_MAX must be below REPLAY_MAX_FILES");
+
+ReplayStore::ReplayStore() :
+    oldestId(0),
+    nextId(1),
+    initialized(false),
+    storage(nullptr),
+    firstPendingTime(0),
+    lastSaveTime(0) {
+
+    lock = xSemaphoreCreateMutex();
+}
+
+bool ReplayStore::begin() {
+    StoreGuard guard(lock);
+
+    if (!LittleFS.exists(STORAGE_REPLAY_DIR) && !LittleFS.mkdir(STORAGE_REPLAY_DIR)) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to create replay directory");
+        return false;
+    }
+
+    File dir = LittleFS.open(STORAGE_REPLAY_DIR);
+    if (!dir || !dir.isDirectory()) {
+        DEBUG_PRINTLN("[STORAGE] ERROR: Failed to open replay directory");
+        return false;
+    }
+
+    // Replay IDs are the file names, so the range is recovered by scanning.
+    // Temp and .bad companions count too, so recover() below can settle them.
+    std::vector<uint32_t> ids;
+    File file = dir.openNextFile();
+    while (file) {
+        char* end = nullptr;
+        uint32_t id = strtoul(file.name(), &end, 10);
+        if (id > 0 && strncmp(end, ".rpl", 4) == 0 &&
+            std::find(ids.begin(), ids.end(), id) == ids.end()) {
+            ids.push_back(id);
+        }
+        file = dir.openNextFile();
+    }
+    dir.close();
+
+    // Reason: Files are not renamed or removed while the directory is being
+    // read, so an interrupted write is settled only after the scan
+    uint8_t count = 0;
+    for (uint32_t id : ids) {
+        String path = pathFor(id);
+        if (AtomicFile::recover(path.c_str()) >= AtomicFile::MISSING) {
+            AtomicFile::remove(path.c_str());
+            continue;
+        }
+        if (oldestId == 0 || id < oldestId) {
+            oldestId = id;
+        }
+        if (id >= nextId) {
+            nextId = id + 1;
+        }
+        count++;
+    }
+
+    initialized = true;
+    DEBUG_PRINTF("[STORAGE] Replay store: %d replays, next ID %u\n", count, nextId);
+    return true;
+}
+
+uint32_t ReplayStore::save(GameReplay& replay) {
+    // Reason: Held until nextId has moved on, so a concurrent list() or
+    // clear() never sees the new ID without its queue entry
+    StoreGuard guard(lock);
+    if (!initialized) {
+        return 0;
+    }
+
+    // Reason: Back-to-back games can keep update() from ever finding a quiet
+    // moment; the queue stays bounded by writing its oldest entry here
+    if (pending.size() >= REPLAY_PENDING_MAX) {
+        writeOldest();
+    }
+
+    ReplayHeader& header = replay.getHeader();
+    header.id = nextId;
+
+    PendingReplay entry;
+    entry.header = header;
+    entry.events.assign(replay.getEvents(), replay.getEvents() + header.numEvents);
+
+    uint32_t now = millis();
+    if (pending.empty()) {
+        firstPendingTime = now;
+    }
+    lastSaveTime = now;
+    pending.push_back(std::move(entry));
+
+    nextId++;
+    if (oldestId == 0) {
+        oldestId = header.id;
+    }
+
+    DEBUG_PRINTF("[STORAGE] Queued replay %u (%d events)\n", header.id, header.numEvents);
+    return header.id;
+}
+
+void ReplayStore::update(bool gameActive) {
+    StoreGuard guard(lock);
+    if (pending.empty()) {
+        return;
+    }
+
+    // Same schedule as DataStorage::update(): wait for a pause, but never
+    // keep a replay in RAM for longer than STORAGE_MAX_DIRTY_MS
+    uint32_t now = millis();
+    bool quiet = !gameActive && now - lastSaveTime >= STORAGE_FLUSH_QUIET_MS;
+    bool overdue = now - firstPendingTime >= STORAGE_MAX_DIRTY_MS;
+
+    if (quiet || overdue) {
+        while (!pending.empty()) {
+            writeOldest();
+        }
+    }
+}
+
+bool ReplayStore::flush() {
+    StoreGuard guard(lock);
+    bool success = true;
+    while (!pending.empty()) {
+        success = writeOldest() && success;
+    }
+    return success;
+}
+
+std::vector<ReplayHeader> ReplayStore::list() {
+    StoreGuard guard(lock);
+    std::vector<ReplayHeader> headers;
+    if (!initialized || oldestId == 0) {
+        return headers;
+    }
+
+    for (uint32_t id = nextId - 1; id >= firstId(); id--) {
+        ReplayHeader header;
+        const PendingReplay* queued = findPending(id);
+        if (queued) {
+            headers.push_back(queued->header);
+        } else if (readHeader(id, header)) {
+            headers.push_back(header);
+        }
+    }
+
+    return headers;
+}
+
+bool ReplayStore::load(uint32_t id, ReplayHeader& header, std::vector<ReplayEvent>& events) {
+    StoreGuard guard(lock);
+    if (!initialized || id < firstId() || id >= nextId) {
+        return false;
+    }
+
+    const PendingReplay* queued = findPending(id);
+    if (queued) {
+        header = queued->header;
+        events = queued->events;
+        return true;
+    }
+
+    File file;
+    String path = pathFor(id);
+    if (AtomicFile::open(path.c_str(), file) >= AtomicFile::MISSING) {
+        return false;
+    }
+
+    size_t n = file.read((uint8_t*)&header, sizeof(header));
+    if (n != sizeof(header) || header.magic != REPLAY_MAGIC || header.numEvents > REPLAY_MAX_EVENTS) {
+        file.close();
+        return false;
+    }
+
+    size_t eventBytes = header.numEvents * sizeof(ReplayEvent);
+    events.resize(header.numEvents);
+    n = eventBytes > 0 ? file.read((uint8_t*)events.data(), eventBytes) : 0;
+    file.close();
+
+    return n == eventBytes;
+}
+
+bool ReplayStore::open(uint32_t id, File& file) {
+    // Reason: Opened under the lock so a save cannot evict the file between
+    // the range check and the open; an open file stays readable until closed
+    StoreGuard guard(lock);
+    if (!initialized || id < firstId() || id >= nextId) {
+        return false;
+    }
+
+    // A download is the one reader that needs the file itself
+    while (!pending.empty() && pending.front().header.id <= id) {
+        writeOldest();
+    }
+
+    String path = pathFor(id);
+    return AtomicFile::open(path.c_str(), file) < AtomicFile::MISSING;
+}
+
+bool ReplayStore::exists(uint32_t id) {
+    StoreGuard guard(lock);
+    return initialized && id >= firstId() && id < nextId &&
+           (findPending(id) != nullptr || LittleFS.exists(pathFor(id)));
+}
+
+String ReplayStore::pathFor(uint32_t id) const {
+    return String(STORAGE_REPLAY_DIR) + "/" + String(id) + ".rpl";
+}
+
+void ReplayStore::clear() {
+    StoreGuard guard(lock);
+    pending.clear();
+    if (oldestId != 0) {
+        for (uint32_t id = oldestId; id < nextId; id++) {
+            AtomicFile::remove(pathFor(id).c_str());
+        }
+    }
+    oldestId = 0;
+    DEBUG_PRINTLN("[STORAGE] Replays cleared");
+}
+
+bool ReplayStore::writeReplay(const PendingReplay& replay) {
+    const ReplayHeader& header = replay.header;
+    size_t eventBytes = header.numEvents * sizeof(ReplayEvent);
+
+    String path = pathFor(header.id);
+    size_t bytesWritten = AtomicFile::write(path.c_str(), [&replay, eventBytes](Print& out) {
+        size_t n = out.write((const uint8_t*)&replay.header, sizeof(replay.header));
+        if (eventBytes > 0) {
+            n += out.write((const uint8_t*)replay.events.data(), eventBytes);
+        }
+        return n == sizeof(replay.header) + eventBytes;
+    });
+
+    if (bytesWritten == 0) {
+        DEBUG_PRINTF("[STORAGE] ERROR: Failed to write replay %u\n", header.id);
+        return false;
+    }
+
+    if (storage) {
+        storage->countWrite(DataStorage::WEAR_REPLAYS, bytesWritten);
+    }
+
+    // Evict oldest replays beyond the rolling limit (never a queued one,
+    // see the static_assert above)
+    while (nextId - oldestId > REPLAY_MAX_FILES) {
+        AtomicFile::remove(pathFor(oldestId).c_str());
+        oldestId++;
+    }
+
+    DEBUG_PRINTF("[STORAGE] Saved replay %u (%d events, %d bytes)\n",
+                header.id, header.numEvents, bytesWritten);
+    return true;
+}
+
+bool ReplayStore::writeOldest() {
+    bool written = writeReplay(pending.front());
+    if (!written) {
+        // Reason: Retrying a failing write (e.g. full flash) every loop would
+        // stall the game; the replay is lost but the score is still recorded
+        DEBUG_PRINTF("[STORAGE] ERROR: Dropped replay %u\n", pending.front().header.id);
+    }
+    pending.erase(pending.begin());
+    return written;
+}
+
+const ReplayStore::PendingReplay* ReplayStore::findPending(uint32_t id) const {
+    for (const PendingReplay& replay : pending) {
+        if (replay.header.id == id) {
+            return &replay;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t ReplayStore::firstId() const {
+    // Reason: Between a save and the write that evicts, the newest
+    // REPLAY_MAX_FILES IDs are the store even if older files linger
+    if (oldestId == 0) {
+        return nextId;
+    }
+    if (nextId - oldestId > REPLAY_MAX_FILES) {
+        return nextId - REPLAY_MAX_FILES;
+    }
+    return oldestId;
+}
+
+bool ReplayStore::readHeader(uint32_t id, ReplayHeader& header) {
+    File file = LittleFS.open(pathFor(id), "r");
+    if (!file) {
+        return false;
+    }
+
+    size_t n = file.read((uint8_t*)&header, sizeof(header));
+    file.close();
+
+    return n == sizeof(header) && header.magic == REPLAY_MAGIC;
+}
@@ -0,0 +1,174 @@
+/**
+ * Replay Store for ESP32 Simon Says
+ *
+ * Rolling store of binary game replays in LittleFS. Each replay is one file
+ * (STORAGE_REPLAY_DIR/<id>.rpl); once REPLAY_MAX_FILES are stored, writing a
+ * new replay deletes the oldest.
+ *
+ * Saved replays wait in RAM and are written by update() on the same quiet /
+ * overdue schedule as DataStorage, so a game ending never waits on flash.
+ * Files are written through AtomicFile: the events are followed by its CRC
+ * trailer, which readers skip because the header gives the event count.
+ *
+ * Thread-safe: the game saves replays on the loop task while web handlers
+ * list and read them on the async_tcp task.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+#include "../config.h"
+#include "../game/game_replay.h"
+
+class DataStorage;
+
+class ReplayStore {
+public:
+    /**
+     * Constructor
+     */
+    ReplayStore();
+
+    /**
+     * Create the replay directory and find the stored ID range
+     * (call after LittleFS is mounted)
+     *
+     * Returns:
+     *     bool: true if successful
+     */
+    bool begin();
+
+    /**
+     * Set the storage that counts replay writes for wear accounting
+     *
+     * Args:
+     *     dataStorage: Storage instance (may be nullptr)
+     */
+    void setStorage(DataStorage* dataStorage) {
+        storage = dataStorage;
+    }
+
+    /**
+     * Queue a finished replay for writing
+     *
+     * The replay is readable at once; it reaches flash with the next
+     * update() or flush(). If REPLAY_PENDING_MAX replays already wait, the
+     * oldest of them is written now.
+     *
+     * Args:
+     *     replay: Replay to save (its header id is assigned here)
+     *
+     * Returns:
+     *     uint32_t: Replay ID, or 0 on failure
+     */
+    uint32_t save(GameReplay& replay);
+
+    /**
+     * Write queued replays once the device has been quiet
+     * Call repeatedly in loop()
+     *
+     * Args:
+     *     gameActive: true while a game runs (writing is deferred)
+     */
+    void update(bool gameActive);
+
+    /**
+     * Write all queued replays now (e.g. before deep sleep)
+     *
+     * Returns:
+     *     bool: true if nothing is left unsaved
+     */
+    bool flush();
+
+    /**
+     * Get headers of all stored replays, newest first
+     *
+     * Returns:
+     *     std::vector<ReplayHeader>: Replay headers
+     */
+    std::vector<ReplayHeader> list();
+
+    /**
+     * Read a stored replay
+     *
+     * Args:
+     *     id: Replay ID
+     *     header: Set to the replay header
+     *     events: Set to the replay events
+     *
+     * Returns:
+     *     bool: true if the replay was read completely
+     */
+    bool load(uint32_t id, ReplayHeader& header, std::vector<ReplayEvent>& events);
+
+    /**
+     * Open a stored replay for streaming (a queued replay is written first)
+     *
+     * Args:
+     *     id: Replay ID
+     *     file: Set to the open file, positioned at the header
+     *
+     * Returns:
+     *     bool: true if the replay is stored and open
+     */
+    bool open(uint32_t id, File& file);
+
+    /**
+     * Check whether a replay exists
+     *
+     * Args:
+     *     id: Replay ID
+     *
+     * Returns:
+     *     bool: true if stored
+     */
+    bool exists(uint32_t id);
+
+    /**
+     * Get the file path of a replay
+     *
+     * Args:
+     *     id: Replay ID
+     *
+     * Returns:
+     *     String: LittleFS path
+     */
+    String pathFor(uint32_t id) const;
+
+    /**
+     * Delete all stored and queued replays
+     */
+    void clear();
+
+private:
+    /**
+     * A saved replay that has not been written yet
+     */
+    struct PendingReplay {
+        ReplayHeader header;
+        std::vector<ReplayEvent> events;
+    };
+
+    uint32_t oldestId;   // Lowest stored or queued ID (0 if empty)
+    uint32_t nextId;     // ID for the next saved replay
+    bool initialized;
+    SemaphoreHandle_t lock;   // Guards the ID range, the queue and the files
+    DataStorage* storage;
+
+    // Write-behind queue, oldest first
+    std::vector<PendingReplay> pending;
+    uint32_t firstPendingTime;   // millis() when the queue became non-empty
+    uint32_t lastSaveTime;       // millis() of the latest save()
+
+    // All of these expect the lock to be held
+    bool writeReplay(const PendingReplay& replay);
+    bool writeOldest();
+    const PendingReplay* findPending(uint32_t id) const;
+    uint32_t firstId() const;
+    bool readHeader(uint32_t id, ReplayHeader& header);
+};
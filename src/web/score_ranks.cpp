@@ -0,0 +1,103 @@
+/**
+ * Score Ranks Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "score_ranks.h"
+
+static_assert((SCORE_RANK_BINS & (SCORE_RANK_BINS - 1)) == 0, "SCORE_RANK_BINS must be a power of two");
+
+ScoreRanks::ScoreRanks() {
+    clear();
+}
+
+void ScoreRanks::clear() {
+    memset(tree, 0, sizeof(tree));
+    memset(totals, 0, sizeof(totals));
+}
+
+void ScoreRanks::add(DifficultyLevel difficulty, uint16_t score) {
+    if (difficulty >= NUM_DIFFICULTIES) {
+        return;
+    }
+
+    for (uint16_t i = binFor(score) + 1; i <= SCORE_RANK_BINS; i += i & -i) {
+        tree[difficulty][i]++;
+    }
+    totals[difficulty]++;
+}
+
+ScoreRank ScoreRanks::rankOf(DifficultyLevel difficulty, uint16_t score) const {
+    ScoreRank result = {1, 0, 0.0f};
+    if (difficulty >= NUM_DIFFICULTIES) {
+        return result;
+    }
+
+    uint8_t bin = binFor(score);
+    uint32_t total = totals[difficulty];
+    uint32_t below = bin > 0 ? countUpTo(difficulty, bin - 1) : 0;
+    uint32_t above = total - countUpTo(difficulty, bin);
+
+    result.rank = above + 1;
+    result.total = total;
+    result.percentile = total > 0 ? below * 100.0f / total : 0.0f;
+    return result;
+}
+
+void ScoreRanks::toJson(JsonArray array) const {
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        JsonArray counts = array.createNestedArray();
+
+        // Each bin is its prefix sum minus the previous one
+        uint32_t counted[SCORE_RANK_BINS];
+        uint8_t used = 0;
+        uint32_t previous = 0;
+        for (uint8_t bin = 0; bin < SCORE_RANK_BINS; bin++) {
+            uint32_t upTo = countUpTo(d, bin);
+            counted[bin] = upTo - previous;
+            previous = upTo;
+            if (counted[bin] > 0) {
+                used = bin + 1;
+            }
+        }
+
+        for (uint8_t bin = 0; bin < used; bin++) {
+            counts.add(counted[bin]);
+        }
+    }
+}
+
+void ScoreRanks::fromJson(JsonArray array) {
+    clear();
+
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES && d < array.size(); d++) {
+        JsonArray counts = array[d];
+        for (uint8_t bin = 0; bin < SCORE_RANK_BINS && bin < counts.size(); bin++) {
+            uint32_t count = counts[bin].as<uint32_t>();
+            tree[d][bin + 1] = count;
+            totals[d] += count;
+        }
+
+        // Build the tree in place in O(n): push each node into its parent
+        for (uint16_t i = 1; i <= SCORE_RANK_BINS; i++) {
+            uint16_t parent = i + (i & -i);
+            if (parent <= SCORE_RANK_BINS) {
+                tree[d][parent] += tree[d][i];
+            }
+        }
+    }
+}
+
+uint8_t ScoreRanks::binFor(uint16_t score) {
+    return score < SCORE_RANK_BINS - 1 ? score : SCORE_RANK_BINS - 1;
+}
+
+uint32_t ScoreRanks::countUpTo(uint8_t difficulty, uint8_t bin) const {
+    uint32_t sum = 0;
+    for (uint16_t i = bin + 1; i > 0; i -= i & -i) {
+        sum += tree[difficulty][i];
+    }
+    return sum;
+}
@@ -0,0 +1,94 @@
+/**
+ * Score Ranks for ESP32 Simon Says
+ *
+ * Counts every game ever played, per difficulty, in one Fenwick (binary
+ * indexed) tree over the score, so "how many games beat this score" is an
+ * O(log n) prefix sum and recording a game is an O(log n) update. Only the
+ * top few scores are kept individually elsewhere (high scores); this is what
+ * lets a player see where an ordinary score stands.
+ *
+ * Scores from 0 to SCORE_RANK_BINS - 2 each have their own bin; anything
+ * higher shares the last one and ranks as a tie with the other scores there.
+ *
+ * Stored layout (per-bin counts, trailing zeros trimmed):
+ *     [[easy counts...],[medium counts...],...]
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../config.h"
+#include "../game/difficulty_modes.h"
+
+#define SCORE_RANK_BINS 64           // Power of two keeps the tree walk simple
+
+/**
+ * Where a score stands among all games at its difficulty
+ */
+struct ScoreRank {
+    uint32_t rank;          // 1 + games with a higher score
+    uint32_t total;         // Games played at this difficulty
+    float percentile;       // Percent of games with a lower score
+};
+
+class ScoreRanks {
+public:
+    /**
+     * Constructor (no games)
+     */
+    ScoreRanks();
+
+    /**
+     * Forget all games
+     */
+    void clear();
+
+    /**
+     * Count a finished game
+     *
+     * Args:
+     *     difficulty: Difficulty played
+     *     score: Score achieved
+     */
+    void add(DifficultyLevel difficulty, uint16_t score);
+
+    /**
+     * Rank a score against all games at a difficulty
+     *
+     * Args:
+     *     difficulty: Difficulty level
+     *     score: Score to rank (need not have been played)
+     *
+     * Returns:
+     *     ScoreRank: Rank, game count and percentile
+     */
+    ScoreRank rankOf(DifficultyLevel difficulty, uint16_t score) const;
+
+    /**
+     * Write the per-bin counts
+     *
+     * Args:
+     *     array: Receives one array of counts per difficulty
+     */
+    void toJson(JsonArray array) const;
+
+    /**
+     * Replace all counts with stored ones
+     *
+     * Args:
+     *     array: Layout written by toJson()
+     */
+    void fromJson(JsonArray array);
+
+private:
+    // 1-based Fenwick trees: tree[d][i] sums the bins (i - lowbit(i), i]
+    uint32_t tree[NUM_DIFFICULTIES][SCORE_RANK_BINS + 1];
+    uint32_t totals[NUM_DIFFICULTIES];
+
+    static uint8_t binFor(uint16_t score);
+    uint32_t countUpTo(uint8_t difficulty, uint8_t bin) const;
+};
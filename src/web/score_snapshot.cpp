@@ -0,0 +1,474 @@
+/**
+ * Score Snapshot Implementation
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include "score_snapshot.h"
+#include <vector>
+
+#ifdef ESP_PLATFORM
+#include <rom/crc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_LIVE 0xFFFFFFFFUL
+
+#define PLAYER_SLOT_MASK ((1 << PLAYER_SLOT_BITS) - 1)
+
+static uint32_t roundToSector(uint32_t bytes) {
+    return (bytes + SNAPSHOT_SECTOR_SIZE - 1) / SNAPSHOT_SECTOR_SIZE * SNAPSHOT_SECTOR_SIZE;
+}
+
+static bool idLess(const PlayerId& a, const PlayerId& b) {
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+/**
+ * Add a name to the pool, reusing an identical one
+ *
+ * Returns:
+ *     uint16_t: Offset of the name
+ */
+static uint16_t poolName(std::vector<char>& pool, const char* name) {
+    // Reason: High scores mostly repeat the players' names
+    for (size_t at = 0; at < pool.size(); at += strlen(&pool[at]) + 1) {
+        if (strcmp(&pool[at], name) == 0) {
+            return at;
+        }
+    }
+    size_t at = pool.size();
+    pool.insert(pool.end(), name, name + strlen(name) + 1);
+    return at;
+}
+
+ScoreSnapshot::ScoreSnapshot() :
+#ifdef ESP_PLATFORM
+    partition(nullptr),
+    mapHandle(0),
+#else
+    fd(-1),
+#endif
+    base(nullptr),
+    capacity(0),
+    current(nullptr),
+    currentOffset(0),
+    nextOffset(0),
+    lastSequence(0),
+    players(nullptr),
+    scores(nullptr),
+    byId(nullptr),
+    byRating(nullptr),
+    byDifficulty(nullptr),
+    names(nullptr),
+    namesSize(0) {
+}
+
+ScoreSnapshot::~ScoreSnapshot() {
+    unmap();
+#ifndef ESP_PLATFORM
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+bool ScoreSnapshot::begin() {
+#ifdef ESP_PLATFORM
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         SNAPSHOT_PARTITION_LABEL);
+    if (!partition) {
+        DEBUG_PRINTLN("[SNAPSHOT] No snapshot partition (old partition table?)");
+        return false;
+    }
+    capacity = partition->size;
+#else
+    fd = open(SNAPSHOT_HOST_FILE, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        DEBUG_PRINTF("[SNAPSHOT] ERROR: Cannot open %s\n", SNAPSHOT_HOST_FILE);
+        return false;
+    }
+    capacity = SNAPSHOT_HOST_SIZE;
+    if ((uint32_t)info.st_size < capacity &&
+        (ftruncate(fd, capacity) != 0 || !eraseRange(0, capacity))) {
+        DEBUG_PRINTF("[SNAPSHOT] ERROR: Cannot size %s\n", SNAPSHOT_HOST_FILE);
+        return false;
+    }
+#endif
+
+    if (!map()) {
+        DEBUG_PRINTLN("[SNAPSHOT] ERROR: Failed to map the partition");
+        return false;
+    }
+
+    scan();
+    if (current) {
+        DEBUG_PRINTF("[SNAPSHOT] Mapped snapshot %u: %d players, %d scores\n",
+                    current->sequence, current->playerCount, current->scoreCount);
+    }
+    return current != nullptr;
+}
+
+size_t ScoreSnapshot::write(const PlayerTable& table, const SnapshotScoreInput* input,
+                            uint8_t scoreCount, uint32_t gameSequence, uint32_t playersSequence) {
+    invalidate();
+    if (!base) {
+        return 0;
+    }
+
+    uint8_t playerCount = table.size();
+    size_t fixedSize = sizeof(SnapshotHeader) + sectionsSize(playerCount, scoreCount);
+    std::vector<uint8_t> image(fixedSize, 0);
+    std::vector<char> pool;
+
+    SnapshotHeader* header = (SnapshotHeader*)image.data();
+    SnapshotPlayer* outPlayers = (SnapshotPlayer*)(header + 1);
+    SnapshotScore* outScores = (SnapshotScore*)(outPlayers + playerCount);
+    uint8_t* outById = (uint8_t*)(outScores + scoreCount);
+    uint8_t* outByRating = outById + playerCount;
+    uint8_t* outByDifficulty = outByRating + playerCount;
+
+    // Players in slot order
+    uint8_t indexOfSlot[MAX_PLAYERS];
+    uint8_t n = 0;
+    for (uint8_t slot = 0; slot < MAX_PLAYERS && n < playerCount; slot++) {
+        PlayerHandle handle = table.handleAt(slot);
+        const PlayerRecord* rec = table.get(handle);
+        if (!rec) {
+            continue;
+        }
+        SnapshotPlayer& p = outPlayers[n];
+        p.id = rec->id;
+        p.gamesPlayed = rec->gamesPlayed;
+        p.totalScore = rec->totalScore;
+        p.created = rec->created;
+        p.lastPlayed = rec->lastPlayed;
+        p.scoreMean = rec->scoreMean;
+        p.scoreM2 = rec->scoreM2;
+        p.rating = rec->rating;
+        p.bestScore = rec->bestScore;
+        p.wins = rec->wins;
+        p.streak = rec->streak;
+        p.matches = rec->matches;
+        p.nameOffset = poolName(pool, table.name(handle));
+        memcpy(p.bestByDifficulty, rec->bestByDifficulty, sizeof(p.bestByDifficulty));
+        memcpy(p.rankByDifficulty, rec->rankByDifficulty, sizeof(p.rankByDifficulty));
+        indexOfSlot[slot] = n++;
+    }
+
+    // ID order (insertion sort; at most MAX_PLAYERS)
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t j = i;
+        for (; j > 0 && idLess(outPlayers[i].id, outPlayers[outById[j - 1]].id); j--) {
+            outById[j] = outById[j - 1];
+        }
+        outById[j] = i;
+    }
+
+    for (uint8_t pos = 0; pos < n; pos++) {
+        outByRating[pos] = indexOfSlot[table.handleByRating(pos) & PLAYER_SLOT_MASK];
+    }
+
+    // Scores in the given (all-time) order, then grouped by difficulty
+    for (uint8_t i = 0; i < scoreCount; i++) {
+        SnapshotScore& s = outScores[i];
+        s.playerId = input[i].playerId;
+        s.timestamp = input[i].timestamp;
+        s.score = input[i].score;
+        s.difficulty = input[i].difficulty;
+        s.nameOffset = poolName(pool, input[i].playerName ? input[i].playerName : "");
+    }
+    uint8_t grouped = 0;
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        header->scoreStart[d] = grouped;
+        for (uint8_t i = 0; i < scoreCount; i++) {
+            if (outScores[i].difficulty == d) {
+                outByDifficulty[grouped++] = i;
+            }
+        }
+    }
+    header->scoreStart[NUM_DIFFICULTIES] = grouped;
+
+    header->magic = SNAPSHOT_MAGIC;
+    header->live = SNAPSHOT_LIVE;
+    header->sequence = lastSequence + 1;
+    header->gameSequence = gameSequence;
+    header->playersSequence = playersSequence;
+    header->version = SNAPSHOT_VERSION;
+    header->playerCount = n;
+    header->scoreCount = scoreCount;
+    image.insert(image.end(), pool.begin(), pool.end());
+    // Reason: insert() may have moved the image
+    header = (SnapshotHeader*)image.data();
+    header->size = image.size() - sizeof(SnapshotHeader);
+    header->crc = crcOf(image.data() + sizeof(SnapshotHeader), header->size);
+
+    uint32_t span = roundToSector(image.size());
+    if (span > capacity) {
+        DEBUG_PRINTF("[SNAPSHOT] ERROR: %d bytes do not fit the partition\n", image.size());
+        return 0;
+    }
+    uint32_t offset = nextOffset + span <= capacity ? nextOffset : 0;
+
+    // Reason: Remapped after writing, so no stale cache lines are read back
+    unmap();
+    bool ok = eraseRange(offset, span) &&
+              writeAt(offset + sizeof(SnapshotHeader), image.data() + sizeof(SnapshotHeader),
+                      header->size) &&
+              writeAt(offset, header, sizeof(SnapshotHeader));
+    map();
+
+    lastSequence = header->sequence;
+    nextOffset = offset + span < capacity ? offset + span : 0;
+    if (!ok || !base || !select(offset)) {
+        DEBUG_PRINTLN("[SNAPSHOT] ERROR: Failed to write snapshot");
+        return 0;
+    }
+
+    LOG_D(LOG_TAG_STORAGE, "Snapshot %u written at 0x%05x (%d bytes)\n",
+          lastSequence, offset, image.size());
+    return image.size();
+}
+
+void ScoreSnapshot::invalidate() {
+    if (!current) {
+        return;
+    }
+
+    current = nullptr;
+    uint32_t cleared = 0;
+    unmap();
+    if (!writeAt(currentOffset + offsetof(SnapshotHeader, live), &cleared, sizeof(cleared))) {
+        DEBUG_PRINTLN("[SNAPSHOT] ERROR: Failed to mark snapshot stale");
+    }
+    map();
+}
+
+bool ScoreSnapshot::loadPlayers(PlayerTable& table) const {
+    if (!current) {
+        return false;
+    }
+
+    table.clear();
+    for (uint8_t i = 0; i < current->playerCount; i++) {
+        const SnapshotPlayer& p = players[i];
+        PlayerRecord* rec = table.get(table.add(p.id, name(p.nameOffset), p.created));
+        if (!rec) {
+            continue;
+        }
+        rec->gamesPlayed = p.gamesPlayed;
+        rec->totalScore = p.totalScore;
+        rec->bestScore = p.bestScore;
+        rec->wins = p.wins;
+        rec->lastPlayed = p.lastPlayed;
+        rec->scoreMean = p.scoreMean;
+        rec->scoreM2 = p.scoreM2;
+        rec->streak = p.streak;
+        memcpy(rec->bestByDifficulty, p.bestByDifficulty, sizeof(rec->bestByDifficulty));
+        rec->rating = p.rating;
+        rec->matches = p.matches;
+    }
+    table.rebuildRanks();
+    table.rebuildRatingOrder();
+    return true;
+}
+
+const SnapshotPlayer* ScoreSnapshot::player(uint8_t index) const {
+    return index < playerCount() ? &players[index] : nullptr;
+}
+
+const SnapshotPlayer* ScoreSnapshot::findPlayer(const PlayerId& id) const {
+    uint8_t low = 0;
+    uint8_t high = playerCount();
+    while (low < high) {
+        uint8_t mid = (low + high) / 2;
+        const SnapshotPlayer& p = players[byId[mid]];
+        if (p.id == id) {
+            return &p;
+        }
+        if (idLess(p.id, id)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+const SnapshotPlayer* ScoreSnapshot::playerByRating(uint8_t position) const {
+    return position < playerCount() ? &players[byRating[position]] : nullptr;
+}
+
+uint8_t ScoreSnapshot::scoreCount(DifficultyLevel difficulty) const {
+    if (!current || difficulty >= NUM_DIFFICULTIES) {
+        return 0;
+    }
+    return current->scoreStart[difficulty + 1] - current->scoreStart[difficulty];
+}
+
+const SnapshotScore* ScoreSnapshot::score(uint8_t index) const {
+    return index < scoreCount() ? &scores[index] : nullptr;
+}
+
+const SnapshotScore* ScoreSnapshot::score(DifficultyLevel difficulty, uint8_t index) const {
+    if (index >= scoreCount(difficulty)) {
+        return nullptr;
+    }
+    return &scores[byDifficulty[current->scoreStart[difficulty] + index]];
+}
+
+const char* ScoreSnapshot::name(uint16_t offset) const {
+    return offset < namesSize ? names + offset : "";
+}
+
+void ScoreSnapshot::scan() {
+    current = nullptr;
+    bool found = false;
+    uint32_t newest = 0;
+
+    for (uint32_t offset = 0; offset + sizeof(SnapshotHeader) <= capacity;
+         offset += SNAPSHOT_SECTOR_SIZE) {
+        const SnapshotHeader* h = (const SnapshotHeader*)(base + offset);
+        if (h->magic != SNAPSHOT_MAGIC || h->version != SNAPSHOT_VERSION ||
+            h->size > capacity - offset - sizeof(SnapshotHeader) ||
+            h->size < sectionsSize(h->playerCount, h->scoreCount) ||
+            crcOf(base + offset + sizeof(SnapshotHeader), h->size) != h->crc) {
+            continue;
+        }
+        if (!found || (int32_t)(h->sequence - lastSequence) > 0) {
+            found = true;
+            newest = offset;
+            lastSequence = h->sequence;
+        }
+    }
+
+    if (!found) {
+        nextOffset = 0;
+        return;
+    }
+
+    const SnapshotHeader* h = (const SnapshotHeader*)(base + newest);
+    uint32_t end = newest + roundToSector(sizeof(SnapshotHeader) + h->size);
+    nextOffset = end < capacity ? end : 0;
+
+    // Reason: Only the newest snapshot may be used; an older live one
+    // predates changes made since
+    if (h->live == SNAPSHOT_LIVE) {
+        select(newest);
+    } else {
+        DEBUG_PRINTLN("[SNAPSHOT] Newest snapshot is stale");
+    }
+}
+
+bool ScoreSnapshot::select(uint32_t offset) {
+    const SnapshotHeader* h = (const SnapshotHeader*)(base + offset);
+    if (h->magic != SNAPSHOT_MAGIC || h->live != SNAPSHOT_LIVE ||
+        h->scoreStart[NUM_DIFFICULTIES] > h->scoreCount) {
+        return false;
+    }
+
+    size_t fixedSize = sectionsSize(h->playerCount, h->scoreCount);
+    players = (const SnapshotPlayer*)(h + 1);
+    scores = (const SnapshotScore*)(players + h->playerCount);
+    byId = (const uint8_t*)(scores + h->scoreCount);
+    byRating = byId + h->playerCount;
+    byDifficulty = byRating + h->playerCount;
+    names = (const char*)byDifficulty + h->scoreCount;
+    namesSize = h->size - fixedSize;
+
+    // Every name must end inside the pool
+    if (namesSize > 0 && names[namesSize - 1] != '\0') {
+        return false;
+    }
+
+    current = h;
+    currentOffset = offset;
+    return true;
+}
+
+size_t ScoreSnapshot::sectionsSize(uint8_t playerCount, uint8_t scoreCount) {
+    return playerCount * (sizeof(SnapshotPlayer) + 2) + scoreCount * (sizeof(SnapshotScore) + 1);
+}
+
+#ifdef ESP_PLATFORM
+
+bool ScoreSnapshot::map() {
+    const void* ptr = nullptr;
+    if (!partition || esp_partition_mmap(partition, 0, capacity, SPI_FLASH_MMAP_DATA,
+                                         &ptr, &mapHandle) != ESP_OK) {
+        base = nullptr;
+        return false;
+    }
+    base = (const uint8_t*)ptr;
+    return true;
+}
+
+void ScoreSnapshot::unmap() {
+    if (base) {
+        spi_flash_munmap(mapHandle);
+        base = nullptr;
+    }
+}
+
+bool ScoreSnapshot::eraseRange(uint32_t offset, uint32_t length) {
+    return esp_partition_erase_range(partition, offset, length) == ESP_OK;
+}
+
+bool ScoreSnapshot::writeAt(uint32_t offset, const void* data, uint32_t length) {
+    return esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+uint32_t ScoreSnapshot::crcOf(const uint8_t* data, size_t length) {
+    return crc32_le(0, data, length);
+}
+
+#else
+
+bool ScoreSnapshot::map() {
+    void* ptr = fd >= 0 ? mmap(nullptr, capacity, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    base = ptr != MAP_FAILED ? (const uint8_t*)ptr : nullptr;
+    return base != nullptr;
+}
+
+void ScoreSnapshot::unmap() {
+    if (base) {
+        munmap((void*)base, capacity);
+        base = nullptr;
+    }
+}
+
+bool ScoreSnapshot::eraseRange(uint32_t offset, uint32_t length) {
+    // Erased flash reads as all ones
+    uint8_t ones[256];
+    memset(ones, 0xFF, sizeof(ones));
+    for (uint32_t done = 0; done < length; done += sizeof(ones)) {
+        if (!writeAt(offset + done, ones, min((uint32_t)sizeof(ones), length - done))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ScoreSnapshot::writeAt(uint32_t offset, const void* data, uint32_t length) {
+    return pwrite(fd, data, length, offset) == (ssize_t)length;
+}
+
+uint32_t ScoreSnapshot::crcOf(const uint8_t* data, size_t length) {
+    // Same result as the ESP32 ROM's crc32_le(0, ...)
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,350 @@
+/**
+ * Score Snapshot for ESP32 Simon Says
+ *
+ * Read-optimized binary copy of the player table and the high scores,
+ * kept in its own raw data partition. The partition is mapped into the
+ * address space once, and queries read the records in place. No JSON is
+ * parsed and nothing is allocated. players.json and scores.json stay the
+ * portable copies; the snapshot is rewritten only after they change.
+ *
+ * Layout of one snapshot (little-endian, fixed-size records):
+ *     SnapshotHeader
+ *     SnapshotPlayer players[playerCount]   Table slot order
+ *     SnapshotScore scores[scoreCount]      Highest score first (all-time order)
+ *     uint8_t byId[playerCount]             Players sorted by ID (binary search)
+ *     uint8_t byRating[playerCount]         Players, highest rating first
+ *     uint8_t byDifficulty[scoreCount]      Scores grouped by difficulty, each
+ *                                           group in all-time order
+ *     char names[]                          NUL-terminated, shared by both tables
+ *
+ * Each snapshot starts on a flash sector. A new one is written after the
+ * previous one and wraps around, so rewrites are spread over the whole
+ * partition. The header is written last, and the newest header with a
+ * good CRC wins. Before players.json or scores.json is rewritten, the
+ * current snapshot is marked stale by clearing its "live" word. Clearing
+ * bits needs no erase. A power cut then leaves no live snapshot, and the
+ * JSON files are read instead.
+ *
+ * Per-game player stats reach the snapshot without a players.json rewrite
+ * (they are folded into the history log), so the header records the newest
+ * game the stats include; later games are replayed from the log on load.
+ *
+ * Host builds map a file (SNAPSHOT_HOST_FILE) with the same layout.
+ *
+ * Not thread-safe: the owner serializes access. Record pointers stay valid
+ * until the next write() or invalidate().
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "../config.h"
+#include "../game/difficulty_modes.h"
+#include "player_id.h"
+#include "player_table.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_partition.h>
+#endif
+
+#define SNAPSHOT_MAGIC 0x50534E53    // "SNSP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_SECTOR_SIZE 4096    // Erase unit; snapshots start on one
+#define SNAPSHOT_MAX_SCORES 255      // Score indexes are one byte
+
+/**
+ * Snapshot header (first bytes of its first sector)
+ */
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t live;             // All ones as written; cleared once stale
+    uint32_t sequence;         // Higher = newer
+    uint32_t size;             // Bytes after the header
+    uint32_t crc;              // CRC-32 of those bytes
+    uint32_t gameSequence;     // Newest history game folded into the player stats
+    uint32_t playersSequence;  // Newest game folded into players.json when written
+    uint16_t version;
+    uint8_t playerCount;
+    uint8_t scoreCount;
+    uint8_t scoreStart[NUM_DIFFICULTIES + 1];  // Range of each difficulty in byDifficulty
+    uint8_t reserved[2];
+};
+
+/**
+ * One player (mirrors PlayerRecord, with the name as a pool offset)
+ */
+struct SnapshotPlayer {
+    PlayerId id;
+    uint32_t gamesPlayed;
+    uint32_t totalScore;
+    uint32_t created;
+    uint32_t lastPlayed;
+    float scoreMean;
+    float scoreM2;
+    float rating;
+    uint16_t bestScore;
+    uint16_t wins;
+    uint16_t streak;
+    uint16_t matches;
+    uint16_t nameOffset;
+    uint16_t bestByDifficulty[NUM_DIFFICULTIES];
+    uint8_t rankByDifficulty[NUM_DIFFICULTIES];
+    uint8_t reserved[3];
+
+    float scoreVariance() const {
+        return gamesPlayed > 1 ? scoreM2 / gamesPlayed : 0;
+    }
+};
+
+/**
+ * One high score
+ */
+struct SnapshotScore {
+    PlayerId playerId;       // Nil = guest
+    uint32_t timestamp;
+    uint16_t score;
+    uint16_t nameOffset;
+    uint8_t difficulty;
+    uint8_t reserved[7];
+};
+
+// Reason: The same bytes are read on the ESP32 and on the host, so the
+// layout must not depend on the compiler
+static_assert(sizeof(SnapshotHeader) == 40, "SnapshotHeader layout changed");
+static_assert(sizeof(SnapshotPlayer) == 72, "SnapshotPlayer layout changed");
+static_assert(sizeof(SnapshotScore) == 32, "SnapshotScore layout changed");
+
+/**
+ * A high score to write (see ScoreSnapshot::write())
+ */
+struct SnapshotScoreInput {
+    PlayerId playerId;
+    const char* playerName;
+    uint16_t score;
+    uint8_t difficulty;
+    uint32_t timestamp;
+};
+
+class ScoreSnapshot {
+public:
+    /**
+     * Constructor (nothing mapped until begin())
+     */
+    ScoreSnapshot();
+
+    ~ScoreSnapshot();
+
+    /**
+     * Map the partition and find the newest live snapshot
+     *
+     * Returns:
+     *     bool: true if a live snapshot was found
+     */
+    bool begin();
+
+    /**
+     * Check whether the partition exists and is mapped
+     *
+     * Returns:
+     *     bool: true if snapshots can be written
+     */
+    bool available() const {
+        return base != nullptr;
+    }
+
+    /**
+     * Check whether a live snapshot is mapped
+     *
+     * Returns:
+     *     bool: true if the query functions can be used
+     */
+    bool valid() const {
+        return current != nullptr;
+    }
+
+    /**
+     * Write a new snapshot after the current one
+     *
+     * Args:
+     *     players: Player table
+     *     scores: High scores, highest first
+     *     scoreCount: Number of scores (at most SNAPSHOT_MAX_SCORES)
+     *     gameSequence: Newest history game folded into the player stats
+     *     playersSequence: Newest game folded into players.json
+     *
+     * Returns:
+     *     size_t: Bytes written (0 on failure, leaving no live snapshot)
+     */
+    size_t write(const PlayerTable& players, const SnapshotScoreInput* scores, uint8_t scoreCount,
+                 uint32_t gameSequence, uint32_t playersSequence);
+
+    /**
+     * Mark the current snapshot stale (before its source files change)
+     */
+    void invalidate();
+
+    /**
+     * Fill a player table from the snapshot
+     *
+     * Args:
+     *     table: Table to fill (cleared first)
+     *
+     * Returns:
+     *     bool: false if no live snapshot is mapped
+     */
+    bool loadPlayers(PlayerTable& table) const;
+
+    /**
+     * Get the newest history game folded into the snapshot's player stats
+     *
+     * Returns:
+     *     uint32_t: Game sequence number (0 if no live snapshot)
+     */
+    uint32_t gameSequence() const {
+        return current ? current->gameSequence : 0;
+    }
+
+    /**
+     * Get the newest game players.json held when the snapshot was written
+     *
+     * Returns:
+     *     uint32_t: Game sequence number (0 if no live snapshot)
+     */
+    uint32_t playersSequence() const {
+        return current ? current->playersSequence : 0;
+    }
+
+    /**
+     * Get the number of players
+     *
+     * Returns:
+     *     uint8_t: Player count
+     */
+    uint8_t playerCount() const {
+        return current ? current->playerCount : 0;
+    }
+
+    /**
+     * Get a player in table slot order
+     *
+     * Args:
+     *     index: 0 to playerCount() - 1
+     *
+     * Returns:
+     *     const SnapshotPlayer*: Player, or nullptr past the end
+     */
+    const SnapshotPlayer* player(uint8_t index) const;
+
+    /**
+     * Find a player by ID (binary search)
+     *
+     * Args:
+     *     id: Player ID
+     *
+     * Returns:
+     *     const SnapshotPlayer*: Player, or nullptr if not found
+     */
+    const SnapshotPlayer* findPlayer(const PlayerId& id) const;
+
+    /**
+     * Get a player in rating order
+     *
+     * Args:
+     *     position: 0 (highest rating) to playerCount() - 1
+     *
+     * Returns:
+     *     const SnapshotPlayer*: Player, or nullptr past the end
+     */
+    const SnapshotPlayer* playerByRating(uint8_t position) const;
+
+    /**
+     * Get the number of high scores
+     *
+     * Returns:
+     *     uint8_t: Score count
+     */
+    uint8_t scoreCount() const {
+        return current ? current->scoreCount : 0;
+    }
+
+    /**
+     * Get the number of high scores at one difficulty
+     *
+     * Args:
+     *     difficulty: Difficulty level
+     *
+     * Returns:
+     *     uint8_t: Score count
+     */
+    uint8_t scoreCount(DifficultyLevel difficulty) const;
+
+    /**
+     * Get a high score in all-time order
+     *
+     * Args:
+     *     index: 0 (highest) to scoreCount() - 1
+     *
+     * Returns:
+     *     const SnapshotScore*: Score, or nullptr past the end
+     */
+    const SnapshotScore* score(uint8_t index) const;
+
+    /**
+     * Get a high score at one difficulty
+     *
+     * Args:
+     *     difficulty: Difficulty level
+     *     index: 0 (highest) to scoreCount(difficulty) - 1
+     *
+     * Returns:
+     *     const SnapshotScore*: Score, or nullptr past the end
+     */
+    const SnapshotScore* score(DifficultyLevel difficulty, uint8_t index) const;
+
+    /**
+     * Get a name from the pool
+     *
+     * Args:
+     *     offset: nameOffset of a player or score
+     *
+     * Returns:
+     *     const char*: Name (in mapped flash)
+     */
+    const char* name(uint16_t offset) const;
+
+private:
+#ifdef ESP_PLATFORM
+    const esp_partition_t* partition;
+    spi_flash_mmap_handle_t mapHandle;
+#else
+    int fd;
+#endif
+    const uint8_t* base;             // Mapped partition
+    uint32_t capacity;               // Partition size
+    const SnapshotHeader* current;   // Live snapshot, or nullptr
+    uint32_t currentOffset;          // Its offset in the partition
+    uint32_t nextOffset;             // First sector after the newest snapshot
+    uint32_t lastSequence;           // Newest sequence seen, live or not
+
+    // Section pointers of the current snapshot
+    const SnapshotPlayer* players;
+    const SnapshotScore* scores;
+    const uint8_t* byId;
+    const uint8_t* byRating;
+    const uint8_t* byDifficulty;
+    const char* names;
+    uint32_t namesSize;
+
+    bool map();
+    void unmap();
+    bool eraseRange(uint32_t offset, uint32_t length);
+    bool writeAt(uint32_t offset, const void* data, uint32_t length);
+
+    void scan();
+    bool select(uint32_t offset);
+    static size_t sectionsSize(uint8_t playerCount, uint8_t scoreCount);
+    static uint32_t crcOf(const uint8_t* data, size_t length);
+};
@@ -6,15 +6,25 @@
  */
 
 #include "web_server.h"
+#include <new>
 #include "../game/simon_game.h"
+#include "../system/metrics.h"
+#include "../system/loop_monitor.h"
+#include "replay_store.h"
+#include "reaction_analytics.h"
 
 SimonWebServer::SimonWebServer(DataStorage* stor, SimonGame* gm) :
     server(WEB_SERVER_PORT),
     ws("/ws"),
+    eventSource("/events"),
     storage(stor),
-    game(gm) {
+    game(gm),
+    loopMonitor(nullptr),
+    replayStore(nullptr),
+    analytics(nullptr) {
 
     wsHandler = new WebSocketHandler(&ws);
+    wsHandler->setGame(game);
 }
 
 bool SimonWebServer::begin() {
@@ -32,6 +42,13 @@ bool SimonWebServer::begin() {
     // Add WebSocket to server
     server.addHandler(&ws);
 
+    // Same broadcasts as Server-Sent Events, for displays where WebSocket is unreliable
+    eventSource.onConnect([this](AsyncEventSourceClient *client) {
+        wsHandler->onEventSourceConnect(client);
+    });
+    wsHandler->setEventSource(&eventSource);
+    server.addHandler(&eventSource);
+
     // Setup routes
     setupRoutes();
     setupStaticFiles();
@@ -49,103 +66,167 @@ bool SimonWebServer::begin() {
 }
 
 void SimonWebServer::update() {
-    // Clean up disconnected WebSocket clients
-    wsHandler->cleanupClients();
+    // Clean up clients, ping for latency and run remote commands
+    wsHandler->update();
 }
 
 WebSocketHandler* SimonWebServer::getWebSocketHandler() {
     return wsHandler;
 }
 
+void SimonWebServer::setLoopMonitor(LoopMonitor* monitor) {
+    loopMonitor = monitor;
+}
+
+void SimonWebServer::setReplayStore(ReplayStore* store) {
+    replayStore = store;
+}
+
+void SimonWebServer::setAnalytics(ReactionAnalytics* analyticsInstance) {
+    analytics = analyticsInstance;
+}
+
 void SimonWebServer::setupRoutes() {
     // Player endpoints
-    server.on("/api/players", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/players", HTTP_GET, timedRoute("GET", "/api/players", [this](AsyncWebServerRequest *request) {
         handleGetPlayers(request);
-    });
+    }));
 
     server.on("/api/players", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/players", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleCreatePlayer(request, data, len);
-    });
+    }));
 
-    server.on("^\\/api\\/players\\/([a-z0-9\\-]+)$", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("^\\/api\\/players\\/([a-z0-9\\-]+)$", HTTP_GET, timedRoute("GET", "/api/players/{id}", [this](AsyncWebServerRequest *request) {
         handleGetPlayer(request);
-    });
+    }));
 
-    server.on("^\\/api\\/players\\/([a-z0-9\\-]+)$", HTTP_DELETE, [this](AsyncWebServerRequest *request) {
+    server.on("^\\/api\\/players\\/([a-z0-9\\-]+)$", HTTP_DELETE, timedRoute("DELETE", "/api/players/{id}", [this](AsyncWebServerRequest *request) {
         handleDeletePlayer(request);
-    });
+    }));
 
     // Game control endpoints
-    server.on("/api/game/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/game/status", HTTP_GET, timedRoute("GET", "/api/game/status", [this](AsyncWebServerRequest *request) {
         handleGetGameStatus(request);
-    });
+    }));
 
     server.on("/api/game/start", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/game/start", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleStartGame(request, data, len);
-    });
+    }));
 
-    server.on("/api/game/stop", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    server.on("/api/game/stop", HTTP_POST, timedRoute("POST", "/api/game/stop", [this](AsyncWebServerRequest *request) {
         handleStopGame(request);
-    });
+    }));
 
     server.on("/api/game/player", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/game/player", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleSetPlayer(request, data, len);
-    });
+    }));
 
     server.on("/api/game/multiplayer/start", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/game/multiplayer/start", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleStartMultiplayer(request, data, len);
-    });
+    }));
 
     // Score endpoints
-    server.on("/api/scores/high", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/scores/high", HTTP_GET, timedRoute("GET", "/api/scores/high", [this](AsyncWebServerRequest *request) {
         handleGetHighScores(request);
-    });
+    }));
 
-    server.on("^\\/api\\/scores\\/difficulty\\/([0-3])$", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("^\\/api\\/scores\\/difficulty\\/([0-4])$", HTTP_GET, timedRoute("GET", "/api/scores/difficulty/{difficulty}", [this](AsyncWebServerRequest *request) {
         handleGetDifficultyScores(request);
-    });
+    }));
+
+    server.on("^\\/api\\/scores\\/rank\\/([0-4])\\/([0-9]+)$", HTTP_GET, timedRoute("GET", "/api/scores/rank/{difficulty}/{score}", [this](AsyncWebServerRequest *request) {
+        handleGetScoreRank(request);
+    }));
 
-    server.on("/api/scores/recent", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/scores/recent", HTTP_GET, timedRoute("GET", "/api/scores/recent", [this](AsyncWebServerRequest *request) {
         handleGetRecentGames(request);
-    });
+    }));
 
-    server.on("^\\/api\\/scores\\/player\\/([a-z0-9\\-]+)$", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("^\\/api\\/scores\\/player\\/([a-z0-9\\-]+)$", HTTP_GET, timedRoute("GET", "/api/scores/player/{id}", [this](AsyncWebServerRequest *request) {
         handleGetPlayerStats(request);
-    });
+    }));
+
+    server.on("/api/leaderboard", HTTP_GET, timedRoute("GET", "/api/leaderboard", [this](AsyncWebServerRequest *request) {
+        handleGetLeaderboard(request);
+    }));
+
+    // Replay endpoints
+    // Reason: Register the ID route first - plain "/api/replays" also matches "/api/replays/<id>"
+    server.on("^\\/api\\/replays\\/([0-9]+)$", HTTP_GET, timedRoute("GET", "/api/replays/{id}", [this](AsyncWebServerRequest *request) {
+        handleGetReplay(request);
+    }));
+
+    server.on("/api/replays", HTTP_GET, timedRoute("GET", "/api/replays", [this](AsyncWebServerRequest *request) {
+        handleListReplays(request);
+    }));
+
+    // Reaction-time analytics (streaming aggregates, no history scan)
+    server.on("/api/analytics", HTTP_GET, timedRoute("GET", "/api/analytics", [this](AsyncWebServerRequest *request) {
+        handleGetAnalytics(request);
+    }));
+
+    server.on("/api/stats/timeline", HTTP_GET, timedRoute("GET", "/api/stats/timeline", [this](AsyncWebServerRequest *request) {
+        handleGetTimeline(request);
+    }));
 
     // Settings endpoints
-    server.on("/api/settings", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/settings", HTTP_GET, timedRoute("GET", "/api/settings", [this](AsyncWebServerRequest *request) {
         handleGetSettings(request);
-    });
+    }));
 
     server.on("/api/settings", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/settings", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleUpdateSettings(request, data, len);
-    });
+    }));
 
     // Utility endpoints
-    server.on("/api/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    server.on("/api/reset", HTTP_POST, timedRoute("POST", "/api/reset", [this](AsyncWebServerRequest *request) {
         handleFactoryReset(request);
-    });
+    }));
 
-    server.on("/api/storage", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/storage", HTTP_GET, timedRoute("GET", "/api/storage", [this](AsyncWebServerRequest *request) {
         handleGetStorageStats(request);
-    });
+    }));
 
     // Debug endpoint to list files in LittleFS
-    server.on("/api/files", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    server.on("/api/files", HTTP_GET, timedRoute("GET", "/api/files", [this](AsyncWebServerRequest *request) {
         handleListFiles(request);
-    });
+    }));
+
+    // Metrics endpoint (Prometheus text format)
+    server.on("/api/metrics", HTTP_GET, timedRoute("GET", "/api/metrics", [this](AsyncWebServerRequest *request) {
+        handleGetMetrics(request);
+    }));
+
+    // Main loop latency and stall report
+    server.on("/api/loop", HTTP_GET, timedRoute("GET", "/api/loop", [this](AsyncWebServerRequest *request) {
+        handleGetLoopStats(request);
+    }));
+
+    // WebSocket client RTT, jitter and clock offset
+    server.on("/api/admin/clients", HTTP_GET, timedRoute("GET", "/api/admin/clients", [this](AsyncWebServerRequest *request) {
+        handleGetClients(request);
+    }));
+
+    // Logger levels and drop counters
+    server.on("/api/log", HTTP_GET, timedRoute("GET", "/api/log", [this](AsyncWebServerRequest *request) {
+        handleGetLogConfig(request);
+    }));
+
+    server.on("/api/log", HTTP_POST, [](AsyncWebServerRequest *request) {},
+        NULL, timedBody("POST", "/api/log", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        handleSetLogLevel(request, data, len);
+    }));
 
     // Time sync endpoint
     server.on("/api/time", HTTP_POST, [](AsyncWebServerRequest *request) {},
-        NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        NULL, timedBody("POST", "/api/time", [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
         handleSetTime(request, data, len);
-    });
+    }));
 }
 
 void SimonWebServer::setupStaticFiles() {
@@ -181,6 +262,27 @@ void SimonWebServer::setupStaticFiles() {
 // Player Endpoints
 // ============================================================================
 
+/**
+ * Add a player's aggregates (kept up to date by storage) to a JSON object
+ */
+static void playerStatsToJson(const Player& p, JsonObject obj) {
+    obj["avgScore"] = p.scoreMean;
+    obj["stdDev"] = sqrtf(p.scoreVariance);
+    obj["streak"] = p.streak;
+    obj["lastPlayed"] = p.lastPlayed;
+
+    JsonArray byDifficulty = obj.createNestedArray("byDifficulty");
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        if (p.rankByDifficulty[d] == 0) {
+            continue;  // Never played at this level
+        }
+        JsonObject entry = byDifficulty.createNestedObject();
+        entry["difficulty"] = getDifficultyName((DifficultyLevel)d);
+        entry["best"] = p.bestByDifficulty[d];
+        entry["rank"] = p.rankByDifficulty[d];
+    }
+}
+
 void SimonWebServer::handleGetPlayers(AsyncWebServerRequest *request) {
     std::vector<Player> players = storage->getAllPlayers();
 
@@ -189,12 +291,14 @@ void SimonWebServer::handleGetPlayers(AsyncWebServerRequest *request) {
 
     for (const auto& p : players) {
         JsonObject obj = array.createNestedObject();
-        obj["id"] = p.id;
+        obj["id"] = p.id.toString();
         obj["name"] = p.name;
         obj["gamesPlayed"] = p.gamesPlayed;
-        obj["avgScore"] = p.gamesPlayed > 0 ? (float)p.totalScore / p.gamesPlayed : 0;
+        obj["avgScore"] = p.scoreMean;
         obj["bestScore"] = p.bestScore;
         obj["wins"] = p.wins;
+        obj["streak"] = p.streak;
+        obj["lastPlayed"] = p.lastPlayed;
         obj["created"] = p.created;
     }
 
@@ -239,14 +343,14 @@ void SimonWebServer::handleGetPlayer(AsyncWebServerRequest *request) {
         return;
     }
 
-    StaticJsonDocument<512> doc;
-    doc["id"] = player.id;
+    StaticJsonDocument<1024> doc;
+    doc["id"] = player.id.toString();
     doc["name"] = player.name;
     doc["gamesPlayed"] = player.gamesPlayed;
-    doc["avgScore"] = player.gamesPlayed > 0 ? (float)player.totalScore / player.gamesPlayed : 0;
     doc["bestScore"] = player.bestScore;
     doc["wins"] = player.wins;
     doc["created"] = player.created;
+    playerStatsToJson(player, doc.as<JsonObject>());
 
     sendJson(request, doc);
 }
@@ -278,6 +382,17 @@ void SimonWebServer::handleGetGameStatus(AsyncWebServerRequest *request) {
     doc["highScore"] = game->getHighScore();
     doc["difficulty"] = getDifficultyName(game->getDifficulty());
     doc["isActive"] = game->isActive();
+    doc["seed"] = game->getSeed();
+
+    if (game->getDifficulty() == ADAPTIVE) {
+        const AdaptiveDifficulty& adaptive = game->getAdaptive();
+        JsonObject obj = doc.createNestedObject("adaptive");
+        obj["pace"] = adaptive.getPace();
+        obj["toneMs"] = adaptive.getToneDuration();
+        obj["intervalMs"] = adaptive.getToneInterval();
+        obj["windowMs"] = adaptive.getTimingWindow();
+        obj["successPercent"] = adaptive.getSuccessPercent();
+    }
 
     sendJson(request, doc);
 }
@@ -296,11 +411,15 @@ void SimonWebServer::handleStartGame(AsyncWebServerRequest *request, uint8_t *da
         difficulty = EASY;
     }
 
-    game->startGame(difficulty);
+    // Optional seed replays a known sequence (0 or missing = random)
+    uint32_t seed = doc["seed"].as<uint32_t>();
+
+    game->startGame(difficulty, seed);
 
     StaticJsonDocument<128> response;
     response["success"] = true;
     response["message"] = "Game started";
+    response["seed"] = game->getSeed();
 
     sendJson(request, response);
 }
@@ -328,8 +447,7 @@ void SimonWebServer::handleSetPlayer(AsyncWebServerRequest *request, uint8_t *da
 
     // Verify player exists (unless empty for guest mode)
     if (playerId.length() > 0) {
-        Player player;
-        if (!storage->getPlayer(playerId, player)) {
+        if (storage->findPlayer(playerId.c_str()) == INVALID_PLAYER_HANDLE) {
             sendError(request, "Player not found", 404);
             return;
         }
@@ -379,16 +497,18 @@ void SimonWebServer::handleStartMultiplayer(AsyncWebServerRequest *request, uint
         playerIds[i] = playerIdsArray[i].as<String>();
 
         // Verify player exists
-        Player player;
-        if (!storage->getPlayer(playerIds[i], player)) {
+        if (storage->findPlayer(playerIds[i].c_str()) == INVALID_PLAYER_HANDLE) {
             String errorMsg = "Player not found: " + playerIds[i];
             sendError(request, errorMsg.c_str(), 404);
             return;
         }
     }
 
+    // Optional shared seed (0 or missing = random)
+    uint32_t seed = doc["seed"].as<uint32_t>();
+
     // Start multiplayer game
-    game->startMultiplayerGame(mode, playerIds, numPlayers, difficulty);
+    game->startMultiplayerGame(mode, playerIds, numPlayers, difficulty, seed);
 
     StaticJsonDocument<256> response;
     response["success"] = true;
@@ -410,7 +530,7 @@ void SimonWebServer::handleGetHighScores(AsyncWebServerRequest *request) {
 
     for (const auto& hs : scores) {
         JsonObject obj = array.createNestedObject();
-        obj["playerId"] = hs.playerId;
+        obj["playerId"] = hs.playerId.toString();
         obj["playerName"] = hs.playerName;
         obj["score"] = hs.score;
         obj["difficulty"] = getDifficultyName(hs.difficulty);
@@ -436,7 +556,7 @@ void SimonWebServer::handleGetDifficultyScores(AsyncWebServerRequest *request) {
 
     for (const auto& hs : scores) {
         JsonObject obj = array.createNestedObject();
-        obj["playerId"] = hs.playerId;
+        obj["playerId"] = hs.playerId.toString();
         obj["playerName"] = hs.playerName;
         obj["score"] = hs.score;
         obj["timestamp"] = hs.timestamp;
@@ -445,6 +565,27 @@ void SimonWebServer::handleGetDifficultyScores(AsyncWebServerRequest *request) {
     sendJson(request, doc);
 }
 
+void SimonWebServer::handleGetScoreRank(AsyncWebServerRequest *request) {
+    DifficultyLevel difficulty = (DifficultyLevel)request->pathArg(0).toInt();
+    long score = request->pathArg(1).toInt();
+
+    if (difficulty >= NUM_DIFFICULTIES || score > MAX_SEQUENCE_LENGTH) {
+        sendError(request, "Invalid difficulty or score");
+        return;
+    }
+
+    ScoreRank rank = storage->getScoreRank(difficulty, score);
+
+    StaticJsonDocument<192> doc;
+    doc["difficulty"] = getDifficultyName(difficulty);
+    doc["score"] = score;
+    doc["rank"] = rank.rank;
+    doc["total"] = rank.total;
+    doc["percentile"] = rank.percentile;
+
+    sendJson(request, doc);
+}
+
 void SimonWebServer::handleGetRecentGames(AsyncWebServerRequest *request) {
     std::vector<GameSession> games = storage->getRecentGames(MAX_GAME_HISTORY);
 
@@ -453,12 +594,33 @@ void SimonWebServer::handleGetRecentGames(AsyncWebServerRequest *request) {
 
     for (const auto& g : games) {
         JsonObject obj = array.createNestedObject();
-        obj["playerId"] = g.playerId;
+        obj["playerId"] = g.playerId.toString();
         obj["playerName"] = g.playerName;
         obj["score"] = g.score;
         obj["difficulty"] = getDifficultyName(g.difficulty);
         obj["timestamp"] = g.timestamp;
         obj["duration"] = g.duration;
+        obj["seed"] = g.seed;
+    }
+
+    sendJson(request, doc);
+}
+
+void SimonWebServer::handleGetLeaderboard(AsyncWebServerRequest *request) {
+    // Reason: Storage keeps players in rating order, so this is a straight read
+    std::vector<Player> players = storage->getLeaderboard();
+
+    DynamicJsonDocument doc(4096);
+    JsonArray array = doc.to<JsonArray>();
+
+    uint8_t rank = 1;
+    for (const auto& p : players) {
+        JsonObject obj = array.createNestedObject();
+        obj["rank"] = rank++;
+        obj["id"] = p.id.toString();
+        obj["name"] = p.name;
+        obj["rating"] = (int)roundf(p.rating);
+        obj["matches"] = p.matches;
     }
 
     sendJson(request, doc);
@@ -477,12 +639,12 @@ void SimonWebServer::handleGetPlayerStats(AsyncWebServerRequest *request) {
     std::vector<GameSession> games = storage->getPlayerGames(playerId, 20);
 
     StaticJsonDocument<4096> doc;
-    doc["id"] = player.id;
+    doc["id"] = player.id.toString();
     doc["name"] = player.name;
     doc["gamesPlayed"] = player.gamesPlayed;
-    doc["avgScore"] = player.gamesPlayed > 0 ? (float)player.totalScore / player.gamesPlayed : 0;
     doc["bestScore"] = player.bestScore;
     doc["wins"] = player.wins;
+    playerStatsToJson(player, doc.as<JsonObject>());
 
     JsonArray recentGames = doc.createNestedArray("recentGames");
     for (const auto& g : games) {
@@ -495,6 +657,178 @@ void SimonWebServer::handleGetPlayerStats(AsyncWebServerRequest *request) {
     sendJson(request, doc);
 }
 
+// ============================================================================
+// Replay Endpoints
+// ============================================================================
+
+void SimonWebServer::handleListReplays(AsyncWebServerRequest *request) {
+    if (!replayStore) {
+        sendError(request, "Replays not available", 503);
+        return;
+    }
+
+    std::vector<ReplayHeader> replays = replayStore->list();
+
+    DynamicJsonDocument doc(2048);
+    JsonArray array = doc.to<JsonArray>();
+
+    for (const auto& r : replays) {
+        JsonObject obj = array.createNestedObject();
+        obj["id"] = r.id;
+        obj["seed"] = r.seed;
+        obj["score"] = r.score;
+        obj["difficulty"] = getDifficultyName((DifficultyLevel)r.difficulty);
+        obj["timestamp"] = r.timestamp;
+        obj["durationMs"] = r.durationMs;
+        obj["events"] = r.numEvents;
+        obj["truncated"] = (r.flags & REPLAY_FLAG_TRUNCATED) != 0;
+        obj["verified"] = (r.flags & (REPLAY_FLAG_TRUNCATED | REPLAY_FLAG_MISMATCH)) == 0;
+    }
+
+    sendJson(request, doc);
+}
+
+void SimonWebServer::handleGetReplay(AsyncWebServerRequest *request) {
+    uint32_t id = request->pathArg(0).toInt();
+
+    File file;
+    if (!replayStore || !replayStore->open(id, file)) {
+        sendError(request, "Replay not found", 404);
+        return;
+    }
+
+    // Reason: Stream the binary file as-is; the browser decodes it (see decodeReplay in app.js).
+    // The response takes the already open file, so no path lookup happens outside the store lock.
+    request->send(file, replayStore->pathFor(id), "application/octet-stream");
+}
+
+// ============================================================================
+// Analytics Endpoints
+// ============================================================================
+
+/**
+ * Fill a JSON object from an archive rollup
+ */
+static void rollupToJson(const ArchiveEntry& e, JsonObject obj) {
+    obj["games"] = e.games;
+    obj["playTime"] = e.playSeconds;
+    obj["avgScore"] = e.games > 0 ? (float)e.scoreSum / e.games : 0;
+    obj["best"] = e.best;
+}
+
+void SimonWebServer::handleGetTimeline(AsyncWebServerRequest *request) {
+    // ?from=&to= are Unix seconds (default: the last 30 days); ?player=<id>
+    uint32_t now = storage->getCurrentTimestamp();
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : now;
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt()
+                                              : (to > 29 * SECONDS_PER_DAY ? to - 29 * SECONDS_PER_DAY : 0);
+    String player;
+    if (request->hasParam("player")) {
+        player = request->getParam("player")->value();
+    }
+    if (to < from) {
+        sendError(request, "'to' is before 'from'");
+        return;
+    }
+
+    // Reason: ~1.7 KB; kept off the async_tcp task stack
+    ArchiveTimeline* timeline = new (std::nothrow) ArchiveTimeline;
+    if (!timeline) {
+        sendError(request, "Out of memory", 503);
+        return;
+    }
+    storage->getTimeline(from / SECONDS_PER_DAY, to / SECONDS_PER_DAY, player, *timeline);
+
+    // Reason: Serialize one point at a time rather than one document for the range
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->printf("{\"from\":%lu,\"to\":%lu,\"bucketDays\":%u,\"points\":[",
+                     (unsigned long)(timeline->fromDay * SECONDS_PER_DAY),
+                     (unsigned long)(timeline->toDay * SECONDS_PER_DAY),
+                     timeline->bucketDays);
+    for (uint8_t i = 0; i < timeline->numPoints; i++) {
+        StaticJsonDocument<192> doc;
+        JsonObject point = doc.to<JsonObject>();
+        point["date"] = (timeline->fromDay + i * timeline->bucketDays) * SECONDS_PER_DAY;
+        rollupToJson(timeline->points[i], point);
+        if (i > 0) {
+            response->print(",");
+        }
+        serializeJson(doc, *response);
+    }
+
+    StaticJsonDocument<512> doc;
+    JsonObject total = doc.to<JsonObject>();
+    rollupToJson(timeline->total, total);
+    JsonArray bucketStart = total.createNestedArray("bucketStart");
+    JsonArray histogram = total.createNestedArray("histogram");
+    for (uint8_t b = 0; b < ARCHIVE_SCORE_BUCKETS; b++) {
+        bucketStart.add(ARCHIVE_BUCKET_START[b]);
+        histogram.add(timeline->total.buckets[b]);
+    }
+    response->print("],\"total\":");
+    serializeJson(doc, *response);
+    response->print("}");
+
+    delete timeline;
+    request->send(response);
+}
+
+void SimonWebServer::handleGetAnalytics(AsyncWebServerRequest *request) {
+    if (!analytics) {
+        sendError(request, "Analytics not available", 503);
+        return;
+    }
+
+    // Optional ?player=<id> limits the player list to one entry
+    String playerFilter;
+    if (request->hasParam("player")) {
+        playerFilter = request->getParam("player")->value();
+    }
+
+    // Reason: Serialize one entry at a time rather than one document for every player
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    AnalyticsEntry entry;
+
+    response->print("{\"difficulties\":[");
+    for (uint8_t d = 0; d < NUM_DIFFICULTIES; d++) {
+        analytics->snapshotDifficulty((DifficultyLevel)d, entry);
+
+        StaticJsonDocument<512> doc;
+        doc["difficulty"] = d;
+        doc["name"] = getDifficultyName((DifficultyLevel)d);
+        ReactionAnalytics::summaryToJson(entry, doc.as<JsonObject>());
+
+        if (d > 0) {
+            response->print(",");
+        }
+        serializeJson(doc, *response);
+    }
+
+    response->print("],\"players\":[");
+    bool first = true;
+    for (uint8_t i = 0; i < MAX_ANALYTICS_RECORDS; i++) {
+        if (!analytics->snapshotPlayer(i, entry)) {
+            continue;
+        }
+        if (playerFilter.length() > 0 && playerFilter != entry.id) {
+            continue;
+        }
+
+        StaticJsonDocument<512> doc;
+        doc["playerId"] = entry.id;
+        ReactionAnalytics::summaryToJson(entry, doc.as<JsonObject>());
+
+        if (!first) {
+            response->print(",");
+        }
+        first = false;
+        serializeJson(doc, *response);
+    }
+    response->print("]}");
+
+    request->send(response);
+}
+
 // ============================================================================
 // Settings Endpoints
 // ============================================================================
@@ -547,6 +881,12 @@ void SimonWebServer::handleUpdateSettings(AsyncWebServerRequest *request, uint8_
 
 void SimonWebServer::handleFactoryReset(AsyncWebServerRequest *request) {
     storage->factoryReset();
+    if (replayStore) {
+        replayStore->clear();
+    }
+    if (analytics) {
+        analytics->clear();
+    }
 
     StaticJsonDocument<128> doc;
     doc["success"] = true;
@@ -559,11 +899,12 @@ void SimonWebServer::handleGetStorageStats(AsyncWebServerRequest *request) {
     size_t total, used;
     storage->getStorageStats(total, used);
 
-    StaticJsonDocument<256> doc;
+    DynamicJsonDocument doc(1536);
     doc["totalBytes"] = total;
     doc["usedBytes"] = used;
     doc["freeBytes"] = total - used;
     doc["usedPercent"] = (float)used / total * 100;
+    storage->wearToJson(doc.createNestedObject("wear"));
 
     sendJson(request, doc);
 }
@@ -627,10 +968,125 @@ void SimonWebServer::handleSetTime(AsyncWebServerRequest *request, uint8_t *data
     sendJson(request, response);
 }
 
+void SimonWebServer::handleGetMetrics(AsyncWebServerRequest *request) {
+    // Reason: Stream straight into the response instead of building one large String
+    AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+    MetricsRegistry::instance().render(*response);
+    request->send(response);
+}
+
+void SimonWebServer::handleGetLoopStats(AsyncWebServerRequest *request) {
+    if (!loopMonitor) {
+        sendError(request, "Loop monitor not available", 503);
+        return;
+    }
+
+    DynamicJsonDocument doc(2048);
+    loopMonitor->toJson(doc);
+
+    sendJson(request, doc);
+}
+
+void SimonWebServer::handleGetClients(AsyncWebServerRequest *request) {
+    DynamicJsonDocument doc(512 * MAX_WEBSOCKET_CLIENTS);
+    doc["pingIntervalMs"] = WS_PING_INTERVAL_MS;
+    doc["slowRttMs"] = WS_SLOW_CLIENT_RTT_MS;
+    wsHandler->clientsToJson(doc);
+
+    sendJson(request, doc);
+}
+
+void SimonWebServer::handleGetLogConfig(AsyncWebServerRequest *request) {
+    StaticJsonDocument<768> doc;
+    doc["written"] = Logger::getWritten();
+    doc["dropped"] = Logger::getDropped();
+    doc["compileLevel"] = Logger::levelName(LOG_COMPILE_LEVEL);
+
+    JsonObject levels = doc.createNestedObject("levels");
+    for (uint8_t i = 0; i < NUM_LOG_TAGS; i++) {
+        levels[Logger::tagName((LogTag)i)] = Logger::levelName(Logger::getLevel((LogTag)i));
+    }
+
+    sendJson(request, doc);
+}
+
+void SimonWebServer::handleSetLogLevel(AsyncWebServerRequest *request, uint8_t *data, size_t len) {
+    StaticJsonDocument<128> doc;
+    DeserializationError error = deserializeJson(doc, data, len);
+
+    if (error) {
+        sendError(request, "Invalid JSON");
+        return;
+    }
+
+    // Level may be given by name ("debug") or number (0-4)
+    uint8_t level = LOGLEVEL_DEBUG + 1;
+    if (doc["level"].is<const char*>()) {
+        for (uint8_t i = LOGLEVEL_NONE; i <= LOGLEVEL_DEBUG; i++) {
+            if (strcmp(doc["level"].as<const char*>(), Logger::levelName(i)) == 0) {
+                level = i;
+            }
+        }
+    } else if (doc["level"].is<int>()) {
+        level = doc["level"].as<int>();
+    }
+
+    if (level > LOGLEVEL_DEBUG) {
+        sendError(request, "Invalid level");
+        return;
+    }
+
+    // Without a tag the level applies to every subsystem
+    const char* tagName = doc["tag"];
+    if (tagName) {
+        LogTag tag;
+        if (!Logger::tagFromName(tagName, tag)) {
+            sendError(request, "Unknown tag");
+            return;
+        }
+        Logger::setLevel(tag, level);
+    } else {
+        Logger::setLevel(level);
+    }
+
+    StaticJsonDocument<128> response;
+    response["success"] = true;
+    response["message"] = "Log level updated";
+
+    sendJson(request, response);
+}
+
 // ============================================================================
 // Helper Methods
 // ============================================================================
 
+ArRequestHandlerFunction SimonWebServer::timedRoute(const char* method, const char* route,
+                                                    ArRequestHandlerFunction handler) {
+    Histogram* latency = routeLatency(method, route);
+    return [latency, handler](AsyncWebServerRequest *request) {
+        ScopedLatency timer(latency);
+        handler(request);
+    };
+}
+
+ArBodyHandlerFunction SimonWebServer::timedBody(const char* method, const char* route,
+                                                ArBodyHandlerFunction handler) {
+    Histogram* latency = routeLatency(method, route);
+    return [latency, handler](AsyncWebServerRequest *request, uint8_t *data, size_t len,
+                              size_t index, size_t total) {
+        ScopedLatency timer(latency);
+        handler(request, data, len, index, total);
+    };
+}
+
+Histogram* SimonWebServer::routeLatency(const char* method, const char* route) {
+    char labels[METRICS_MAX_LABEL_LENGTH];
+    snprintf(labels, sizeof(labels), "method=\"%s\",route=\"%s\"", method, route);
+    return MetricsRegistry::instance().histogram("simon_http_request_duration_seconds",
+                                                 "HTTP API handler latency", labels);
+}
+
+
 void SimonWebServer::sendJson(AsyncWebServerRequest *request, const JsonDocument& doc, int statusCode) {
     String json;
     serializeJson(doc, json);
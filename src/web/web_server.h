@@ -18,6 +18,10 @@
 
 // Forward declarations
 class SimonGame;
+class Histogram;
+class LoopMonitor;
+class ReplayStore;
+class ReactionAnalytics;
 
 class SimonWebServer {
 public:
@@ -51,12 +55,40 @@ public:
      */
     WebSocketHandler* getWebSocketHandler();
 
+    /**
+     * Set loop monitor for the /api/loop diagnostics endpoint
+     *
+     * Args:
+     *     monitor: Loop monitor instance
+     */
+    void setLoopMonitor(LoopMonitor* monitor);
+
+    /**
+     * Set replay store for the /api/replays endpoints
+     *
+     * Args:
+     *     store: Replay store instance
+     */
+    void setReplayStore(ReplayStore* store);
+
+    /**
+     * Set reaction-time analytics for the /api/analytics endpoint
+     *
+     * Args:
+     *     analytics: Reaction-time analytics instance
+     */
+    void setAnalytics(ReactionAnalytics* analytics);
+
 private:
     AsyncWebServer server;
     AsyncWebSocket ws;
+    AsyncEventSource eventSource;
     DataStorage* storage;
     SimonGame* game;
     WebSocketHandler* wsHandler;
+    LoopMonitor* loopMonitor;
+    ReplayStore* replayStore;
+    ReactionAnalytics* analytics;
 
     /**
      * Setup all API routes
@@ -88,8 +120,10 @@ private:
     // Score endpoints
     void handleGetHighScores(AsyncWebServerRequest *request);
     void handleGetDifficultyScores(AsyncWebServerRequest *request);
+    void handleGetScoreRank(AsyncWebServerRequest *request);
     void handleGetRecentGames(AsyncWebServerRequest *request);
     void handleGetPlayerStats(AsyncWebServerRequest *request);
+    void handleGetLeaderboard(AsyncWebServerRequest *request);
 
     // Settings endpoints
     void handleGetSettings(AsyncWebServerRequest *request);
@@ -100,6 +134,53 @@ private:
     void handleGetStorageStats(AsyncWebServerRequest *request);
     void handleListFiles(AsyncWebServerRequest *request);
     void handleSetTime(AsyncWebServerRequest *request, uint8_t *data, size_t len);
+    void handleGetMetrics(AsyncWebServerRequest *request);
+    void handleGetLoopStats(AsyncWebServerRequest *request);
+    void handleGetClients(AsyncWebServerRequest *request);
+    void handleGetLogConfig(AsyncWebServerRequest *request);
+    void handleListReplays(AsyncWebServerRequest *request);
+    void handleGetReplay(AsyncWebServerRequest *request);
+    void handleGetAnalytics(AsyncWebServerRequest *request);
+    void handleGetTimeline(AsyncWebServerRequest *request);
+    void handleSetLogLevel(AsyncWebServerRequest *request, uint8_t *data, size_t len);
+
+    /**
+     * Wrap a request handler so its latency is recorded in /api/metrics
+     *
+     * Args:
+     *     method: HTTP method label
+     *     route: Route label (path template, not the concrete URL)
+     *     handler: Handler to wrap
+     *
+     * Returns:
+     *     ArRequestHandlerFunction: Instrumented handler
+     */
+    ArRequestHandlerFunction timedRoute(const char* method, const char* route, ArRequestHandlerFunction handler);
+
+    /**
+     * Wrap a body handler so its latency is recorded in /api/metrics
+     *
+     * Args:
+     *     method: HTTP method label
+     *     route: Route label (path template, not the concrete URL)
+     *     handler: Body handler to wrap
+     *
+     * Returns:
+     *     ArBodyHandlerFunction: Instrumented body handler
+     */
+    ArBodyHandlerFunction timedBody(const char* method, const char* route, ArBodyHandlerFunction handler);
+
+    /**
+     * Register the latency histogram for a route
+     *
+     * Args:
+     *     method: HTTP method label
+     *     route: Route label
+     *
+     * Returns:
+     *     Histogram*: Histogram for this route
+     */
+    Histogram* routeLatency(const char* method, const char* route);
 
     /**
      * Send JSON response
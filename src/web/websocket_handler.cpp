@@ -6,34 +6,224 @@
  */
 
 #include "websocket_handler.h"
+#include "../system/metrics.h"
+#include "../game/simon_game.h"
+#include "../hardware/button_handler.h"
+#include "../game/sequence_rng.h"
+#include <ESPAsyncWebServer.h>
 
-WebSocketHandler::WebSocketHandler(AsyncWebSocket* ws) : webSocket(ws) {
+// Reason: Messages arrive on the async_tcp task; update() runs on the loop task
+static portMUX_TYPE linkMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Pongs slower than this are stale (e.g. a backgrounded tab) and ignored
+#define WS_MAX_VALID_RTT_MS 5000
+
+// Close code for clients refused or dropped under load (1013 = Try Again Later)
+#define WS_CLOSE_TRY_AGAIN 1013
+
+// Coalescing slot of a state broadcast class, or -1 for other classes
+static inline int8_t stateSlot(BroadcastClass cls) {
+    return cls >= WS_MSG_GAME_STATE ? (int8_t)(cls - WS_MSG_GAME_STATE) : -1;
+}
+
+// Minimum spacing of state updates to one client
+static inline uint32_t stateInterval(bool slow) {
+    return slow ? WS_SLOW_CLIENT_INTERVAL_MS : WEBSOCKET_UPDATE_INTERVAL_MS;
+}
+
+// Topic names (as used in subscribe messages) and how each topic's
+// broadcasts are thinned out
+static const char* const TOPIC_NAMES[WS_NUM_TOPICS] = {
+    "gameState", "sequence", "buttonPress", "multiplayer", "gameOver", "playerChange"
+};
+static const BroadcastClass TOPIC_CLASSES[WS_NUM_TOPICS] = {
+    WS_MSG_GAME_STATE, WS_MSG_EVENT, WS_MSG_TRANSIENT,
+    WS_MSG_MULTIPLAYER_STATE, WS_MSG_EVENT, WS_MSG_EVENT
+};
+
+// Topic of each state slot
+static const WsTopic SLOT_TOPICS[WS_NUM_STATE_SLOTS] = {
+    WS_TOPIC_GAME_STATE, WS_TOPIC_MULTIPLAYER
+};
+
+static_assert(MAX_WEBSOCKET_CLIENTS <= 8, "topicMembers holds one bit per client slot");
+static_assert(WS_NUM_TOPICS <= 8, "ClientLink::topics holds one bit per topic");
+
+// Room "seq" adds in front of a payload
+#define WS_SEQ_TAG_LEN 24
+
+// Insert the sequence number into a serialized object: {"seq":N,...}
+static void tagWithSeq(char* out, size_t outSize, uint32_t seq, const char* payload) {
+    snprintf(out, outSize, "{\"seq\":%u,%s", seq, payload + 1);
+}
+
+WebSocketHandler::WebSocketHandler(AsyncWebSocket* ws) :
+    webSocket(ws),
+    eventSource(nullptr),
+    game(nullptr),
+    buttons(nullptr),
+    lastPingTime(0),
+    lastQueueCheck(0),
+    pendingCommand(REMOTE_CMD_NONE),
+    pendingDifficulty(EASY),
+    pendingSeed(0) {
+
+    memset(links, 0, sizeof(links));
+    memset(lastState, 0, sizeof(lastState));
+    memset(lastStateSeq, 0, sizeof(lastStateSeq));
+
+    // Reason: SSE resumes by a bare sequence number (no epoch), so each boot
+    // numbers from a random base; a stale Last-Event-ID then falls outside
+    // the ring and gets a snapshot instead of a wrong replay
+    epoch = SequenceRng::randomSeed();
+    lastSeq = epoch >> 1;
+    events.clear(lastSeq + 1);
+    eventSkipped = false;
+    skippedAt = 0;
+
+    memset(topicMembers, 0, sizeof(topicMembers));
+    lingerTopics = 0;
+    lingerUntil = 0;
+
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    broadcastLatency = metrics.histogram("simon_ws_broadcast_duration_seconds",
+                                         "Serialize + enqueue time for one WebSocket broadcast");
+    broadcastMessages = metrics.counter("simon_ws_broadcast_messages_total", "WebSocket messages broadcast");
+    broadcastBytes = metrics.counter("simon_ws_broadcast_bytes_total", "WebSocket payload bytes broadcast");
+    remotePresses = metrics.counter("simon_ws_remote_presses_total", "Button presses received from web clients");
+    droppedMessages = metrics.counter("simon_ws_dropped_messages_total", "Broadcasts skipped for slow clients");
+    coalescedMessages = metrics.counter("simon_ws_coalesced_messages_total", "State broadcasts superseded before being sent");
+    laggingDisconnects = metrics.counter("simon_ws_lagging_disconnects_total", "Clients closed for a full send queue");
+    rejectedClients = metrics.counter("simon_ws_rejected_clients_total", "Connections refused at MAX_WEBSOCKET_CLIENTS");
 }
 
 void WebSocketHandler::begin() {
     DEBUG_PRINTLN("[WS] WebSocket handler initialized");
 }
 
+void WebSocketHandler::update() {
+    cleanupClients();
+
+    // Run the latest queued command on the loop task
+    // Reason: The game state machine must not be driven from the async_tcp task
+    portENTER_CRITICAL(&linkMux);
+    RemoteCommand command = pendingCommand;
+    DifficultyLevel difficulty = pendingDifficulty;
+    uint32_t seed = pendingSeed;
+    pendingCommand = REMOTE_CMD_NONE;
+    portEXIT_CRITICAL(&linkMux);
+
+    if (game && command == REMOTE_CMD_START) {
+        DEBUG_PRINTLN("[WS] Remote start");
+        game->startGame(difficulty, seed);
+    } else if (game && command == REMOTE_CMD_STOP) {
+        DEBUG_PRINTLN("[WS] Remote stop");
+        game->reset();
+    }
+
+    uint32_t now = millis();
+
+    // Queues only grow when we send, so sampling once per update interval is enough
+    if (now - lastQueueCheck >= WEBSOCKET_UPDATE_INTERVAL_MS) {
+        lastQueueCheck = now;
+        checkBackpressure();
+    }
+
+    flushOwedStates(now);
+
+    // Periodic clock-sync ping; the client echoes "s" with its own clock in "c"
+    if (now - lastPingTime < WS_PING_INTERVAL_MS) {
+        return;
+    }
+    lastPingTime = now;
+
+    char ping[40];
+    snprintf(ping, sizeof(ping), "{\"type\":\"ping\",\"s\":%u}", now);
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        uint32_t id = links[i].clientId;
+        if (id != 0 && !links[i].closing) {
+            webSocket->text(id, ping, strlen(ping));
+        }
+    }
+}
+
+void WebSocketHandler::setGame(SimonGame* gameInstance) {
+    game = gameInstance;
+}
+
+void WebSocketHandler::setButtonHandler(ButtonHandler* buttonHandler) {
+    buttons = buttonHandler;
+}
+
+void WebSocketHandler::setEventSource(AsyncEventSource* source) {
+    eventSource = source;
+}
+
 void WebSocketHandler::onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
                                AwsEventType type, void *arg, uint8_t *data, size_t len) {
     switch (type) {
-        case WS_EVT_CONNECT:
+        case WS_EVT_CONNECT: {
             DEBUG_PRINTF("[WS] Client #%u connected from %s\n",
                         client->id(), client->remoteIP().toString().c_str());
+            portENTER_CRITICAL(&linkMux);
+            ClientLink* link = findLink(client->id(), true);
+            if (link) {
+                // Everything until the client subscribes
+                link->remoteIp = (uint32_t)client->remoteIP();
+                link->topics = WS_ALL_TOPICS;
+                rebuildTopicMembers();
+            }
+            portEXIT_CRITICAL(&linkMux);
+
+            // Reason: Every client costs a send queue; past the cap, refuse
+            // the newcomer rather than degrade everyone already playing
+            if (!link) {
+                DEBUG_PRINTF("[WS] Client limit (%d) reached, refusing #%u\n",
+                            MAX_WEBSOCKET_CLIENTS, client->id());
+                rejectedClients->inc();
+                client->close(WS_CLOSE_TRY_AGAIN, "Too many clients");
+                break;
+            }
+
+            // Tell the client where the broadcast stream stands so it can resume later
+            char hello[64];
+            portENTER_CRITICAL(&linkMux);
+            uint32_t seq = lastSeq;
+            portEXIT_CRITICAL(&linkMux);
+            snprintf(hello, sizeof(hello), "{\"type\":\"hello\",\"epoch\":%u,\"seq\":%u}", epoch, seq);
+            client->text(hello);
             break;
+        }
 
-        case WS_EVT_DISCONNECT:
+        case WS_EVT_DISCONNECT: {
             DEBUG_PRINTF("[WS] Client #%u disconnected\n", client->id());
+            portENTER_CRITICAL(&linkMux);
+            ClientLink* link = findLink(client->id(), false);
+            if (link) {
+                // Keep recording its topics for a while in case it resumes
+                lingerTopics |= link->topics;
+                lingerUntil = millis() + WS_RESUME_GRACE_MS;
+                memset(link, 0, sizeof(ClientLink));
+                rebuildTopicMembers();
+            }
+            portEXIT_CRITICAL(&linkMux);
             break;
+        }
 
         case WS_EVT_ERROR:
             DEBUG_PRINTF("[WS] Client #%u error\n", client->id());
             break;
 
-        case WS_EVT_DATA:
-            // We don't expect data from clients (broadcast only)
-            DEBUG_PRINTF("[WS] Received data from client #%u\n", client->id());
+        case WS_EVT_DATA: {
+            LOG_D(LOG_TAG_WS, "Received data from client #%u\n", client->id());
+
+            // Commands are small single-frame text messages; ignore anything else
+            AwsFrameInfo* info = (AwsFrameInfo*)arg;
+            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+                handleMessage(client, data, len);
+            }
             break;
+        }
 
         case WS_EVT_PONG:
             // Pong response
@@ -42,6 +232,10 @@ void WebSocketHandler::onEvent(AsyncWebSocket *server, AsyncWebSocketClient *cli
 }
 
 void WebSocketHandler::broadcastGameState(const char* state, uint16_t score, DifficultyLevel difficulty) {
+    if (!wantsTopic(WS_TOPIC_GAME_STATE)) {
+        return;
+    }
+
     StaticJsonDocument<256> doc;
     doc["type"] = "gameState";
     doc["state"] = state;
@@ -49,10 +243,14 @@ void WebSocketHandler::broadcastGameState(const char* state, uint16_t score, Dif
     doc["difficulty"] = getDifficultyName(difficulty);
     doc["timestamp"] = millis();
 
-    broadcast(doc);
+    broadcast(doc, WS_TOPIC_GAME_STATE);
 }
 
 void WebSocketHandler::broadcastSequence(const Color* sequence, uint8_t length) {
+    if (!wantsTopic(WS_TOPIC_SEQUENCE)) {
+        return;
+    }
+
     DynamicJsonDocument doc(512);
     doc["type"] = "sequence";
     doc["length"] = length;
@@ -62,46 +260,682 @@ void WebSocketHandler::broadcastSequence(const Color* sequence, uint8_t length)
         arr.add(colorToString(sequence[i]));
     }
 
-    broadcast(doc);
+    broadcast(doc, WS_TOPIC_SEQUENCE);
 }
 
 void WebSocketHandler::broadcastButtonPress(Color color, bool correct) {
+    if (!wantsTopic(WS_TOPIC_BUTTON_PRESS)) {
+        return;
+    }
+
     StaticJsonDocument<256> doc;
     doc["type"] = "buttonPress";
     doc["color"] = colorToString(color);
     doc["correct"] = correct;
     doc["timestamp"] = millis();
 
-    broadcast(doc);
+    broadcast(doc, WS_TOPIC_BUTTON_PRESS);
 }
 
 void WebSocketHandler::broadcastGameOver(uint16_t finalScore, bool isHighScore) {
+    if (!wantsTopic(WS_TOPIC_GAME_OVER)) {
+        return;
+    }
+
     StaticJsonDocument<256> doc;
     doc["type"] = "gameOver";
     doc["score"] = finalScore;
     doc["highScore"] = isHighScore;
     doc["timestamp"] = millis();
 
-    broadcast(doc);
+    broadcast(doc, WS_TOPIC_GAME_OVER);
 }
 
 void WebSocketHandler::broadcastPlayerChange(const String& playerId, const String& playerName) {
+    if (!wantsTopic(WS_TOPIC_PLAYER_CHANGE)) {
+        return;
+    }
+
     StaticJsonDocument<256> doc;
     doc["type"] = "playerChange";
     doc["playerId"] = playerId;
     doc["playerName"] = playerName;
 
-    broadcast(doc);
+    broadcast(doc, WS_TOPIC_PLAYER_CHANGE);
+}
+
+void WebSocketHandler::handleMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len) {
+    // Read the time first so parsing isn't counted as network delay
+    uint32_t now = millis();
+
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, data, len)) {
+        sendError(client, "Invalid JSON");
+        return;
+    }
+
+    const char* type = doc["type"] | "";
+
+    if (strcmp(type, "press") == 0) {
+        // Color by name ("red") or enum value (0-3)
+        Color color = NONE;
+        if (doc["color"].is<const char*>()) {
+            for (uint8_t i = 0; i < NUM_COLORS; i++) {
+                if (strcasecmp(doc["color"].as<const char*>(), colorToString((Color)i)) == 0) {
+                    color = (Color)i;
+                }
+            }
+        } else if (doc["color"].is<int>()) {
+            // Reason: Checked before the cast; Color is 8 bits, so 256 would
+            // wrap to a valid color
+            int value = doc["color"].as<int>();
+            if (value >= 0 && value < NUM_COLORS) {
+                color = (Color)value;
+            }
+        }
+
+        if (color >= NUM_COLORS || !buttons) {
+            sendError(client, "Invalid press");
+            return;
+        }
+
+        // Back-date the press by its network delay: exact from the client
+        // timestamp once the clock is synced, otherwise half the round trip
+        uint32_t latency = 0;
+        portENTER_CRITICAL(&linkMux);
+        ClientLink* link = findLink(client->id(), false);
+        if (link && link->synced) {
+            if (doc["t"].is<uint32_t>()) {
+                uint32_t pressedAt = doc["t"].as<uint32_t>() - link->clockOffset;
+                latency = now - pressedAt;
+            } else {
+                latency = (link->srtt8 >> 3) / 2;
+            }
+        }
+        portEXIT_CRITICAL(&linkMux);
+
+        // A client clock running slightly ahead gives a "negative" delay
+        if ((int32_t)latency < 0) {
+            latency = 0;
+        }
+        // Reason: Capped so a client can't claim unlimited extra time
+        if (latency > WS_MAX_LATENCY_COMP_MS) {
+            latency = WS_MAX_LATENCY_COMP_MS;
+        }
+
+        if (!buttons->injectPress(color, now - latency, latency)) {
+            sendError(client, "Input queue full");
+            return;
+        }
+        remotePresses->inc();
+        LOG_D(LOG_TAG_WS, "Remote %s press from #%u (-%ums)\n",
+              colorToString(color), client->id(), latency);
+
+    } else if (strcmp(type, "command") == 0) {
+        const char* cmd = doc["cmd"] | "";
+        RemoteCommand command = REMOTE_CMD_NONE;
+        if (strcmp(cmd, "start") == 0) {
+            command = REMOTE_CMD_START;
+        } else if (strcmp(cmd, "stop") == 0) {
+            command = REMOTE_CMD_STOP;
+        }
+
+        if (command == REMOTE_CMD_NONE) {
+            sendError(client, "Unknown command");
+            return;
+        }
+
+        uint8_t difficulty = doc["difficulty"] | (uint8_t)DEFAULT_DIFFICULTY;
+        portENTER_CRITICAL(&linkMux);
+        pendingCommand = command;
+        pendingDifficulty = difficulty < NUM_DIFFICULTIES ? (DifficultyLevel)difficulty : EASY;
+        pendingSeed = doc["seed"].as<uint32_t>();
+        portEXIT_CRITICAL(&linkMux);
+
+    } else if (strcmp(type, "subscribe") == 0) {
+        handleSubscribe(client, doc["topics"]);
+
+    } else if (strcmp(type, "resume") == 0) {
+        handleResume(client, doc["epoch"].as<uint32_t>(), doc["seq"].as<uint32_t>());
+
+    } else if (strcmp(type, "pong") == 0) {
+        uint32_t sentAt = doc["s"].as<uint32_t>();
+        uint32_t rtt = now - sentAt;
+        if (sentAt == 0 || rtt > WS_MAX_VALID_RTT_MS || !doc["c"].is<uint32_t>()) {
+            return;
+        }
+
+        // The client read its clock about half a round trip after "s"
+        uint32_t offset = doc["c"].as<uint32_t>() - (sentAt + rtt / 2);
+
+        uint32_t srtt = rtt;
+        uint32_t jitter = 0;
+        portENTER_CRITICAL(&linkMux);
+        ClientLink* link = findLink(client->id(), true);
+        if (link) {
+            recordPong(*link, rtt, offset, now);
+            srtt = link->srtt8 >> 3;
+            jitter = link->rttVar4 >> 2;
+        }
+        portEXIT_CRITICAL(&linkMux);
+
+        // Let the client show its own latency
+        char reply[80];
+        snprintf(reply, sizeof(reply), "{\"type\":\"latency\",\"rttMs\":%u,\"srttMs\":%u,\"jitterMs\":%u}",
+                 rtt, srtt, jitter);
+        client->text(reply);
+
+    } else {
+        sendError(client, "Unknown message type");
+    }
+}
+
+ClientLink* WebSocketHandler::findLink(uint32_t clientId, bool create) {
+    ClientLink* freeSlot = nullptr;
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (links[i].clientId == clientId) {
+            return &links[i];
+        }
+        if (!freeSlot && links[i].clientId == 0) {
+            freeSlot = &links[i];
+        }
+    }
+
+    if (create && freeSlot) {
+        memset(freeSlot, 0, sizeof(ClientLink));
+        freeSlot->clientId = clientId;
+        return freeSlot;
+    }
+    return nullptr;
+}
+
+void WebSocketHandler::recordPong(ClientLink& link, uint32_t rtt, uint32_t offset, uint32_t now) {
+    // Smoothed RTT and variation in fixed point, as in TCP (RFC 6298):
+    // srtt += (rtt - srtt) / 8, rttvar += (|srtt - rtt| - rttvar) / 4
+    if (link.samples == 0) {
+        link.srtt8 = rtt << 3;
+        link.rttVar4 = rtt << 1;
+        link.minRttMs = rtt;
+    } else {
+        int32_t err = (int32_t)rtt - (int32_t)(link.srtt8 >> 3);
+        link.srtt8 += err;
+        link.rttVar4 += (err < 0 ? -err : err) - (int32_t)(link.rttVar4 >> 2);
+        link.minRttMs++;
+    }
+    if (link.samples < 0xFFFF) {
+        link.samples++;
+    }
+    link.rttMs = rtt;
+    link.lastPongTime = now;
+
+    // Keep the offset from the fastest recent exchange; its error is at most
+    // half that round trip. The minimum ages up so clock drift is followed.
+    if (!link.synced || rtt <= link.minRttMs) {
+        link.minRttMs = rtt;
+        link.clockOffset = offset;
+    }
+    link.synced = true;
+}
+
+bool WebSocketHandler::isSlow(const ClientLink& link, uint32_t now) const {
+    // A backed-up send queue is the most direct sign
+    if (link.queueLen >= WS_CLIENT_QUEUE_DOWNGRADE) {
+        return true;
+    }
+    // Clients that never answered a ping (no clock sync) are given the benefit of the doubt
+    if (!link.synced) {
+        return false;
+    }
+    if (now - link.lastPongTime > WS_PING_INTERVAL_MS * WS_STALE_PINGS) {
+        return true;
+    }
+    return (link.srtt8 >> 3) + link.rttVar4 > WS_SLOW_CLIENT_RTT_MS;
+}
+
+void WebSocketHandler::clientsToJson(JsonDocument& doc) {
+    ClientLink snapshot[MAX_WEBSOCKET_CLIENTS];
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&linkMux);
+    memcpy(snapshot, links, sizeof(snapshot));
+    uint32_t seq = lastSeq;
+    uint8_t buffered = events.count();
+    portEXIT_CRITICAL(&linkMux);
+
+    doc["seq"] = seq;
+    doc["eventsBuffered"] = buffered;
+    doc["sseClients"] = eventSource ? eventSource->count() : 0;
+
+    JsonArray clients = doc.createNestedArray("clients");
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        const ClientLink& link = snapshot[i];
+        if (link.clientId == 0) {
+            continue;
+        }
+
+        JsonObject obj = clients.createNestedObject();
+        obj["id"] = link.clientId;
+        obj["ip"] = IPAddress(link.remoteIp).toString();
+        obj["synced"] = link.synced;
+        obj["slow"] = isSlow(link, now);
+        obj["sent"] = link.sent;
+        obj["dropped"] = link.dropped;
+        obj["coalesced"] = link.coalesced;
+        obj["queueLen"] = link.queueLen;
+        obj["peakQueueLen"] = link.peakQueueLen;
+
+        JsonArray topics = obj.createNestedArray("topics");
+        for (uint8_t topic = 0; topic < WS_NUM_TOPICS; topic++) {
+            if (link.topics & (1 << topic)) {
+                topics.add(TOPIC_NAMES[topic]);
+            }
+        }
+        if (link.synced) {
+            obj["rttMs"] = link.rttMs;
+            obj["srttMs"] = link.srtt8 >> 3;
+            obj["jitterMs"] = link.rttVar4 >> 2;
+            obj["minRttMs"] = link.minRttMs;
+            obj["clockOffsetMs"] = (int32_t)link.clockOffset;
+            obj["samples"] = link.samples;
+            obj["lastPongAgoMs"] = now - link.lastPongTime;
+        }
+    }
+}
+
+void WebSocketHandler::sendError(AsyncWebSocketClient* client, const char* message) {
+    char reply[96];
+    snprintf(reply, sizeof(reply), "{\"type\":\"error\",\"message\":\"%s\"}", message);
+    client->text(reply);
+}
+
+void WebSocketHandler::handleSubscribe(AsyncWebSocketClient* client, JsonVariantConst topics) {
+    // No list (or an empty one) means every topic
+    uint8_t mask = 0;
+    for (JsonVariantConst name : topics.as<JsonArrayConst>()) {
+        uint8_t topic = 0;
+        while (topic < WS_NUM_TOPICS && strcmp(name | "", TOPIC_NAMES[topic]) != 0) {
+            topic++;
+        }
+        if (topic == WS_NUM_TOPICS) {
+            sendError(client, "Unknown topic");
+            return;
+        }
+        mask |= 1 << topic;
+    }
+    if (mask == 0) {
+        mask = WS_ALL_TOPICS;
+    }
+
+    portENTER_CRITICAL(&linkMux);
+    ClientLink* link = findLink(client->id(), false);
+    if (link) {
+        link->topics = mask;
+        // States owed on dropped topics are no longer sent
+        for (uint8_t slot = 0; slot < WS_NUM_STATE_SLOTS; slot++) {
+            if (!(mask & (1 << SLOT_TOPICS[slot]))) {
+                link->statesOwed &= ~(1 << slot);
+            }
+        }
+        rebuildTopicMembers();
+    }
+    portEXIT_CRITICAL(&linkMux);
+
+    LOG_D(LOG_TAG_WS, "Client #%u subscribed to topics 0x%02x\n", client->id(), mask);
+}
+
+void WebSocketHandler::rebuildTopicMembers() {
+    memset(topicMembers, 0, sizeof(topicMembers));
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (links[i].clientId == 0) {
+            continue;
+        }
+        for (uint8_t topic = 0; topic < WS_NUM_TOPICS; topic++) {
+            if (links[i].topics & (1 << topic)) {
+                topicMembers[topic] |= 1 << i;
+            }
+        }
+    }
+}
+
+bool WebSocketHandler::wantsTopic(WsTopic topic) {
+    uint32_t now = millis();
+
+    // SSE clients can't subscribe, so they want everything
+    bool wanted = eventSource && eventSource->count() > 0;
+
+    portENTER_CRITICAL(&linkMux);
+    wanted = wanted || topicMembers[topic] != 0 ||
+             ((lingerTopics & (1 << topic)) && (int32_t)(lingerUntil - now) > 0);
+
+    if (!wanted) {
+        int8_t slot = stateSlot(TOPIC_CLASSES[topic]);
+        if (slot >= 0) {
+            // The stored state is about to go stale; don't hand it out later
+            lastState[slot][0] = '\0';
+        } else if (TOPIC_CLASSES[topic] == WS_MSG_EVENT) {
+            // Clients that saw nothing past this point have missed an event
+            // that was never built, so they must not be told they're caught up
+            eventSkipped = true;
+            skippedAt = lastSeq;
+        }
+    }
+    portEXIT_CRITICAL(&linkMux);
+
+    return wanted;
+}
+
+void WebSocketHandler::handleResume(AsyncWebSocketClient* client, uint32_t clientEpoch, uint32_t clientSeq) {
+    char message[WS_EVENT_MAX_LEN + WS_SEQ_TAG_LEN];
+
+    portENTER_CRITICAL(&linkMux);
+    uint32_t current = lastSeq;
+    ClientLink* link = findLink(client->id(), false);
+    uint8_t topicMask = link ? link->topics : WS_ALL_TOPICS;
+    portEXIT_CRITICAL(&linkMux);
+
+    uint16_t replayed = 0;
+    bool resumable = clientEpoch == epoch &&
+        replayEvents(clientSeq, topicMask, [client, &message](uint32_t seq, WsTopic topic, const char* payload) {
+            tagWithSeq(message, sizeof(message), seq, payload);
+            client->text(message);
+        }, replayed);
+
+    if (!resumable) {
+        // Too far behind (or the server restarted): the client starts over
+        // from the latest state and refetches anything else it shows
+        DEBUG_PRINTF("[WS] Client #%u can't resume from %u, sending snapshot\n", client->id(), clientSeq);
+        snprintf(message, sizeof(message), "{\"type\":\"snapshot\",\"epoch\":%u,\"seq\":%u}", epoch, current);
+        client->text(message);
+        sendStates(client, 0);
+        return;
+    }
+
+    sendStates(client, clientSeq);
+
+    LOG_D(LOG_TAG_WS, "Client #%u resumed from %u (%u events)\n", client->id(), clientSeq, replayed);
+    snprintf(message, sizeof(message), "{\"type\":\"resumed\",\"seq\":%u,\"replayed\":%u}", current, replayed);
+    client->text(message);
+}
+
+void WebSocketHandler::sendStates(AsyncWebSocketClient* client, uint32_t afterSeq) {
+    char message[WS_STATE_BUFFER_SIZE + WS_SEQ_TAG_LEN];
+    uint32_t clientId = client->id();
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&linkMux);
+    ClientLink* link = findLink(clientId, false);
+    uint8_t topicMask = link ? link->topics : WS_ALL_TOPICS;
+    portEXIT_CRITICAL(&linkMux);
+
+    replayStates(afterSeq, topicMask, [this, client, clientId, now, &message](uint32_t seq, WsTopic topic, const char* payload) {
+        // This counts as the client's state update for coalescing
+        int8_t slot = stateSlot(TOPIC_CLASSES[topic]);
+        portENTER_CRITICAL(&linkMux);
+        ClientLink* link = findLink(clientId, false);
+        if (link) {
+            link->lastStateTime[slot] = now;
+            link->statesOwed &= ~(1 << slot);
+        }
+        portEXIT_CRITICAL(&linkMux);
+
+        tagWithSeq(message, sizeof(message), seq, payload);
+        client->text(message);
+    });
+}
+
+bool WebSocketHandler::replayEvents(uint32_t afterSeq, uint8_t topicMask, const ReplaySink& sink, uint16_t& replayed) {
+    char payload[WS_EVENT_MAX_LEN + 1];
+
+    portENTER_CRITICAL(&linkMux);
+    bool resumable = afterSeq <= lastSeq && !(eventSkipped && afterSeq <= skippedAt);
+    portEXIT_CRITICAL(&linkMux);
+
+    // Replay missed events in order; the ring is re-checked for every step
+    // because broadcasts from the loop task may evict entries meanwhile
+    uint32_t cursor = afterSeq;
+    replayed = 0;
+    while (resumable) {
+        uint32_t seq = 0;
+        uint8_t topic = 0;
+        portENTER_CRITICAL(&linkMux);
+        resumable = events.covers(cursor);
+        bool found = resumable && events.next(cursor, topicMask, seq, topic, payload, sizeof(payload));
+        portEXIT_CRITICAL(&linkMux);
+
+        if (!found) {
+            break;
+        }
+        sink(seq, (WsTopic)topic, payload);
+        cursor = seq;
+        replayed++;
+    }
+
+    return resumable;
+}
+
+void WebSocketHandler::replayStates(uint32_t afterSeq, uint8_t topicMask, const ReplaySink& sink) {
+    for (uint8_t slot = 0; slot < WS_NUM_STATE_SLOTS; slot++) {
+        char payload[WS_STATE_BUFFER_SIZE];
+        uint32_t seq = 0;
+
+        portENTER_CRITICAL(&linkMux);
+        if ((topicMask & (1 << SLOT_TOPICS[slot])) && lastState[slot][0] != '\0' &&
+            lastStateSeq[slot] > afterSeq) {
+            seq = lastStateSeq[slot];
+            memcpy(payload, lastState[slot], sizeof(payload));
+        }
+        portEXIT_CRITICAL(&linkMux);
+
+        if (seq != 0) {
+            sink(seq, SLOT_TOPICS[slot], payload);
+        }
+    }
+}
+
+void WebSocketHandler::onEventSourceConnect(AsyncEventSourceClient* client) {
+    // The event name is the topic and the id the sequence number, so the
+    // browser sends it back as Last-Event-ID when it reconnects
+    ReplaySink sink = [client](uint32_t seq, WsTopic topic, const char* payload) {
+        client->send(payload, TOPIC_NAMES[topic], seq);
+    };
+
+    uint32_t lastId = client->lastId();
+    portENTER_CRITICAL(&linkMux);
+    uint32_t current = lastSeq;
+    portEXIT_CRITICAL(&linkMux);
+
+    char hello[64];
+    snprintf(hello, sizeof(hello), "{\"epoch\":%u,\"seq\":%u}", epoch, current);
+    client->send(hello, "hello", 0, SSE_RECONNECT_MS);
+
+    uint16_t replayed = 0;
+    if (lastId != 0 && replayEvents(lastId, WS_ALL_TOPICS, sink, replayed)) {
+        LOG_D(LOG_TAG_WS, "SSE client resumed from %u (%u events)\n", lastId, replayed);
+        replayStates(lastId, WS_ALL_TOPICS, sink);
+        return;
+    }
+
+    if (lastId != 0) {
+        DEBUG_PRINTF("[WS] SSE client can't resume from %u, sending snapshot\n", lastId);
+        client->send(hello, "snapshot", current);
+    }
+    replayStates(0, WS_ALL_TOPICS, sink);
+}
+
+void WebSocketHandler::checkBackpressure() {
+    uint32_t ids[MAX_WEBSOCKET_CLIENTS];
+    portENTER_CRITICAL(&linkMux);
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        ids[i] = links[i].closing ? 0 : links[i].clientId;
+    }
+    portEXIT_CRITICAL(&linkMux);
+
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        AsyncWebSocketClient* client = ids[i] ? webSocket->client(ids[i]) : nullptr;
+        if (!client) {
+            continue;
+        }
+
+        size_t queued = client->queueLen();
+        bool lagging = queued >= WS_CLIENT_QUEUE_DISCONNECT || client->queueIsFull();
+
+        portENTER_CRITICAL(&linkMux);
+        ClientLink* link = findLink(ids[i], false);
+        if (link) {
+            link->queueLen = queued;
+            if (queued > link->peakQueueLen) {
+                link->peakQueueLen = queued;
+            }
+            link->closing = lagging;
+        }
+        portEXIT_CRITICAL(&linkMux);
+
+        // Reason: Each queued message holds its own heap copy; a client
+        // that stopped reading must not keep accumulating them
+        if (lagging) {
+            DEBUG_PRINTF("[WS] Client #%u lagging (%u queued), disconnecting\n", ids[i], queued);
+            laggingDisconnects->inc();
+            client->close(WS_CLOSE_TRY_AGAIN, "Too slow");
+        }
+    }
+}
+
+void WebSocketHandler::flushOwedStates(uint32_t now) {
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        for (uint8_t slot = 0; slot < WS_NUM_STATE_SLOTS; slot++) {
+            char state[WS_STATE_BUFFER_SIZE + WS_SEQ_TAG_LEN];
+            uint32_t id = 0;
+
+            portENTER_CRITICAL(&linkMux);
+            ClientLink& link = links[i];
+            uint8_t bit = 1 << slot;
+            // Reason: The client may have dropped the topic since, or
+            // wantsTopic() may have blanked the slot while nobody wanted it
+            if (link.clientId != 0 && !link.closing && (link.statesOwed & bit) &&
+                (link.topics & (1 << SLOT_TOPICS[slot])) && lastState[slot][0] != '\0' &&
+                now - link.lastStateTime[slot] >= stateInterval(isSlow(link, now))) {
+                id = link.clientId;
+                link.statesOwed &= ~bit;
+                link.lastStateTime[slot] = now;
+                link.sent++;
+                tagWithSeq(state, sizeof(state), lastStateSeq[slot], lastState[slot]);
+            }
+            portEXIT_CRITICAL(&linkMux);
+
+            if (id != 0) {
+                webSocket->text(id, state, strlen(state));
+            }
+        }
+    }
 }
 
 void WebSocketHandler::cleanupClients() {
-    webSocket->cleanupClients();
+    webSocket->cleanupClients(MAX_WEBSOCKET_CLIENTS);
 }
 
-void WebSocketHandler::broadcast(const JsonDocument& doc) {
+void WebSocketHandler::broadcast(const JsonDocument& doc, WsTopic topic) {
+    ScopedLatency timer(broadcastLatency);
+
+    BroadcastClass cls = TOPIC_CLASSES[topic];
+    uint8_t topicBit = 1 << topic;
+
+    String payload;
+    serializeJson(doc, payload);
+
+    // Oversized state can't be kept for coalescing, so it goes out as an event
+    int8_t slot = stateSlot(cls);
+    if (slot >= 0 && payload.length() >= WS_STATE_BUFFER_SIZE) {
+        cls = WS_MSG_EVENT;
+        slot = -1;
+    }
+
+    checkBackpressure();
+
+    // Decide per client what to send, drop or defer
+    uint32_t now = millis();
+    uint32_t sendTo[MAX_WEBSOCKET_CLIENTS];
+    uint8_t numSend = 0;
+    uint8_t numLinked = 0;
+    uint8_t numDropped = 0;
+    uint8_t numCoalesced = 0;
+
+    // Numbering and storing happen together so the ring stays in seq order
+    // even when two tasks broadcast at once
+    portENTER_CRITICAL(&linkMux);
+    uint32_t seq = ++lastSeq;
+    if (slot >= 0) {
+        memcpy(lastState[slot], payload.c_str(), payload.length() + 1);
+        lastStateSeq[slot] = seq;
+    } else if (cls == WS_MSG_EVENT) {
+        // Transient messages are not worth replaying
+        events.push(seq, topic, payload.c_str(), payload.length());
+    }
+    for (uint8_t i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        ClientLink& link = links[i];
+        if (link.clientId == 0 || link.closing) {
+            continue;
+        }
+        numLinked++;
+
+        if (!(link.topics & topicBit)) {
+            continue;
+        }
+
+        bool slow = isSlow(link, now);
+        if (cls == WS_MSG_TRANSIENT && slow) {
+            link.dropped++;
+            numDropped++;
+            continue;
+        }
+
+        if (slot >= 0) {
+            // Within the interval this state is superseded by whatever comes
+            // next; flushOwedStates() sends the latest once the interval is up
+            uint8_t bit = 1 << slot;
+            if (now - link.lastStateTime[slot] < stateInterval(slow)) {
+                link.statesOwed |= bit;
+                link.coalesced++;
+                numCoalesced++;
+                continue;
+            }
+            link.lastStateTime[slot] = now;
+            link.statesOwed &= ~bit;
+        }
+
+        link.sent++;
+        sendTo[numSend++] = link.clientId;
+    }
+    portEXIT_CRITICAL(&linkMux);
+
     String json;
-    serializeJson(doc, json);
+    json.reserve(payload.length() + WS_SEQ_TAG_LEN);
+    json = "{\"seq\":";
+    json += seq;
+    json += ',';
+    json += payload.c_str() + 1;
+
+    LOG_D(LOG_TAG_WS, "Broadcasting: %s\n", json.c_str());
 
-    DEBUG_PRINTF("[WS] Broadcasting: %s\n", json.c_str());
-    webSocket->textAll(json);
+    // When every connected client is due, one textAll shares a single buffer
+    if (numSend > 0 && numSend == numLinked && numSend == webSocket->count()) {
+        webSocket->textAll(json);
+    } else {
+        for (uint8_t i = 0; i < numSend; i++) {
+            webSocket->text(sendTo[i], json.c_str(), json.length());
+        }
+    }
+
+    // SSE displays get the same serialized payload; "seq" travels as the event id
+    if (eventSource && eventSource->count() > 0) {
+        eventSource->send(payload.c_str(), TOPIC_NAMES[topic], seq);
+    }
+
+    if (numDropped > 0) {
+        droppedMessages->inc(numDropped);
+    }
+    if (numCoalesced > 0) {
+        coalescedMessages->inc(numCoalesced);
+    }
+    broadcastMessages->inc();
+    broadcastBytes->inc(json.length());
 }
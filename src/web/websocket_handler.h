@@ -1,7 +1,42 @@
 /**
  * WebSocket Handler for ESP32 Simon Says
  *
- * Provides real-time game state updates to all connected web clients.
+ * Provides real-time game state updates to all connected web clients, and
+ * accepts presses and game commands from them for remote play.
+ *
+ * Client -> server messages:
+ *     {"type": "press", "color": "red", "t": <client ms>}
+ *     {"type": "command", "cmd": "start", "difficulty": 1, "seed": 0}
+ *     {"type": "command", "cmd": "stop"}
+ *     {"type": "pong", "s": <echoed server ms>, "c": <client ms>}
+ *     {"type": "resume", "epoch": <from hello>, "seq": <last seen>}
+ *     {"type": "subscribe", "topics": ["gameState", "gameOver"]}
+ *
+ * The same broadcasts are streamed as Server-Sent Events (event name = topic,
+ * id = seq) for displays that can't keep a WebSocket up; a reconnecting
+ * EventSource resumes from its Last-Event-ID the same way. Both paths send
+ * the one serialized payload.
+ *
+ * Topics are the broadcast message types. A client gets every topic until
+ * it subscribes; the game asks wantsTopic() before building a message, so
+ * topics nobody listens to cost no JSON work at all.
+ *
+ * Every broadcast carries a "seq" number, increasing for the life of the
+ * server (identified by "epoch" in the hello sent on connect). Events are
+ * kept in an EventRing; a reconnecting client that sends "resume" gets the
+ * events it missed plus the latest state, or a "snapshot" marker followed by
+ * the latest state if the ring no longer reaches back that far.
+ *
+ * Each pong gives an RTT sample, smoothed per client as in TCP (RFC 6298),
+ * and a clock offset sample, kept from the lowest-RTT exchange since its
+ * error is bounded by half that round trip. Clients that turn out slow get
+ * downsampled broadcasts (see BroadcastClass).
+ *
+ * Fan-out is bounded per client: state messages are coalesced to the latest
+ * (at most one per WEBSOCKET_UPDATE_INTERVAL_MS), clients with a deep send
+ * queue are downgraded to slow, and at WS_CLIENT_QUEUE_DISCONNECT queued
+ * messages they are closed. Connections beyond MAX_WEBSOCKET_CLIENTS are
+ * refused.
  *
  * Author: Giorgio Gilestro (giorgio@gilest.ro)
  * Date: 2025-11-09
@@ -15,6 +50,85 @@
 #include "../config.h"
 #include "../hardware/gpio_config.h"
 #include "../game/difficulty_modes.h"
+#include "event_ring.h"
+#include <functional>
+
+// Forward declarations
+class Histogram;
+class Counter;
+class SimonGame;
+class ButtonHandler;
+class AsyncEventSource;
+class AsyncEventSourceClient;
+
+// State broadcast classes, one coalescing slot each
+#define WS_NUM_STATE_SLOTS 2
+
+// Disconnected clients' topics stay wanted this long, so events they miss
+// are still recorded for their resume
+#define WS_RESUME_GRACE_MS 60000
+
+/**
+ * Broadcast topics (one per message type)
+ */
+enum WsTopic : uint8_t {
+    WS_TOPIC_GAME_STATE = 0,     // "gameState"
+    WS_TOPIC_SEQUENCE,           // "sequence"
+    WS_TOPIC_BUTTON_PRESS,       // "buttonPress"
+    WS_TOPIC_MULTIPLAYER,        // "multiplayer"
+    WS_TOPIC_GAME_OVER,          // "gameOver"
+    WS_TOPIC_PLAYER_CHANGE,      // "playerChange"
+    WS_NUM_TOPICS
+};
+
+#define WS_ALL_TOPICS ((1 << WS_NUM_TOPICS) - 1)
+
+/**
+ * Link state of one connected client, from ping/pong clock sync
+ */
+struct ClientLink {
+    uint32_t clientId;       // AsyncWebSocketClient id (0 = free slot)
+    uint32_t remoteIp;       // Client address (for the admin view)
+    uint32_t srtt8;          // Smoothed RTT, ms x8
+    uint32_t rttVar4;        // RTT variation (jitter), ms x4
+    uint16_t rttMs;          // Latest round-trip time
+    uint16_t minRttMs;       // Lowest recent RTT (ages up 1 ms per sample)
+    uint32_t clockOffset;    // Client clock minus server clock (ms, wraps with millis())
+    uint32_t lastPongTime;   // millis() of the latest pong
+    uint32_t lastStateTime[WS_NUM_STATE_SLOTS];  // millis() each state was last sent
+    uint32_t sent;           // Broadcasts sent to this client
+    uint32_t dropped;        // Transient broadcasts skipped because the client was slow
+    uint32_t coalesced;      // State broadcasts superseded before they were sent
+    uint16_t samples;        // RTT samples taken
+    uint16_t queueLen;       // Messages queued in the client at the last check
+    uint16_t peakQueueLen;   // Deepest queue seen
+    uint8_t statesOwed;      // Bit per state slot with a newer state not yet sent
+    uint8_t topics;          // Bit per WsTopic the client subscribed to
+    bool synced;             // RTT/clockOffset are valid
+    bool closing;            // Disconnected for lagging; send nothing more
+};
+
+/**
+ * How a broadcast may be thinned out per client
+ */
+enum BroadcastClass : uint8_t {
+    WS_MSG_EVENT = 0,           // Always delivered (sequence, game over, ...)
+    WS_MSG_TRANSIENT,           // Cosmetic (button flashes); dropped for slow clients
+    WS_MSG_GAME_STATE,          // gameState snapshot; coalesced to the latest
+    WS_MSG_MULTIPLAYER_STATE    // multiplayer snapshot; coalesced to the latest
+};
+
+/**
+ * Game command from a client (run on the loop task by update())
+ */
+enum RemoteCommand : uint8_t {
+    REMOTE_CMD_NONE = 0,
+    REMOTE_CMD_START,
+    REMOTE_CMD_STOP
+};
+
+// Largest state payload kept for coalescing (larger ones are sent as events)
+#define WS_STATE_BUFFER_SIZE 512
 
 class WebSocketHandler {
 public:
@@ -31,6 +145,43 @@ public:
      */
     void begin();
 
+    /**
+     * Send clock-sync pings and run queued game commands (call in main loop)
+     */
+    void update();
+
+    /**
+     * Set game instance for remote commands
+     *
+     * Args:
+     *     game: Game instance
+     */
+    void setGame(SimonGame* game);
+
+    /**
+     * Set button handler that remote presses are injected into
+     *
+     * Args:
+     *     buttons: Button handler instance
+     */
+    void setButtonHandler(ButtonHandler* buttons);
+
+    /**
+     * Set Server-Sent Events source that broadcasts are mirrored to
+     *
+     * Args:
+     *     source: Event source (its onConnect must call onEventSourceConnect)
+     */
+    void setEventSource(AsyncEventSource* source);
+
+    /**
+     * Catch up a newly connected EventSource client from its Last-Event-ID
+     *
+     * Args:
+     *     client: Client that just connected
+     */
+    void onEventSourceConnect(AsyncEventSourceClient* client);
+
     /**
      * Handle WebSocket events
      */
@@ -89,13 +240,161 @@ public:
     void cleanupClients();
 
     /**
-     * Send JSON message to all clients
+     * Check whether anyone listens to a topic (call before building a message)
+     *
+     * A false answer means the message will not be built: the topic's last
+     * state is forgotten and event replay across this point is disabled.
+     *
+     * Args:
+     *     topic: Topic of the message about to be built
+     *
+     * Returns:
+     *     bool: true if a connected (or recently disconnected) client subscribes
+     */
+    bool wantsTopic(WsTopic topic);
+
+    /**
+     * Send JSON message to the clients subscribed to its topic
      *
      * Args:
      *     doc: JSON document to send
+     *     topic: Message topic (also decides how it is thinned out for slow clients)
      */
-    void broadcast(const JsonDocument& doc);
+    void broadcast(const JsonDocument& doc, WsTopic topic);
+
+    /**
+     * Write per-client link statistics (RTT, jitter, clock offset, drops)
+     *
+     * Args:
+     *     doc: Document to fill ({"clients": [...]})
+     */
+    void clientsToJson(JsonDocument& doc);
 
 private:
+    // Receives replayed messages: sequence number, topic, payload without "seq"
+    typedef std::function<void(uint32_t seq, WsTopic topic, const char* payload)> ReplaySink;
+
     AsyncWebSocket* webSocket;
+    AsyncEventSource* eventSource;
+    SimonGame* game;
+    ButtonHandler* buttons;
+
+    // Per-client clock sync (slots for MAX_WEBSOCKET_CLIENTS)
+    ClientLink links[MAX_WEBSOCKET_CLIENTS];
+    uint32_t lastPingTime;
+    uint32_t lastQueueCheck;
+
+    // Latest payload per state slot, sent to clients once their interval is up
+    // (stored without "seq"; it is added when sent)
+    char lastState[WS_NUM_STATE_SLOTS][WS_STATE_BUFFER_SIZE];
+    uint32_t lastStateSeq[WS_NUM_STATE_SLOTS];
+
+    // Broadcast sequence numbering and reconnect catch-up
+    uint32_t epoch;      // Random per boot, so clients notice a restart
+    uint32_t lastSeq;    // Sequence number of the latest broadcast
+    EventRing events;
+    bool eventSkipped;   // An event went unbuilt for lack of subscribers...
+    uint32_t skippedAt;  // ...after this sequence number
+
+    // Per-topic subscriber sets (bit per link slot)
+    uint8_t topicMembers[WS_NUM_TOPICS];
+    uint8_t lingerTopics;     // Topics of recently disconnected clients
+    uint32_t lingerUntil;
+
+    // Pending command (latest wins)
+    RemoteCommand pendingCommand;
+    DifficultyLevel pendingDifficulty;
+    uint32_t pendingSeed;
+
+    // Broadcast metrics
+    Histogram* broadcastLatency;
+    Counter* broadcastMessages;
+    Counter* broadcastBytes;
+    Counter* remotePresses;
+    Counter* droppedMessages;
+    Counter* coalescedMessages;
+    Counter* laggingDisconnects;
+    Counter* rejectedClients;
+
+    /**
+     * Handle one complete text message from a client
+     */
+    void handleMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
+
+    /**
+     * Find (or with create, claim) the link slot of a client
+     * (call inside the critical section)
+     */
+    ClientLink* findLink(uint32_t clientId, bool create);
+
+    /**
+     * Fold one pong into a link's RTT, jitter and clock offset
+     * (call inside the critical section)
+     */
+    void recordPong(ClientLink& link, uint32_t rtt, uint32_t offset, uint32_t now);
+
+    /**
+     * Set a client's topics from a subscribe message
+     */
+    void handleSubscribe(AsyncWebSocketClient* client, JsonVariantConst topics);
+
+    /**
+     * Recompute topicMembers from the links (call inside the critical section)
+     */
+    void rebuildTopicMembers();
+
+    /**
+     * Catch a reconnecting client up from the event ring
+     *
+     * Args:
+     *     client: Client that sent "resume"
+     *     clientEpoch: Epoch the client's sequence numbers belong to
+     *     clientSeq: Last sequence number the client saw
+     */
+    void handleResume(AsyncWebSocketClient* client, uint32_t clientEpoch, uint32_t clientSeq);
+
+    /**
+     * Send the latest state snapshots newer than a sequence number to one client
+     */
+    void sendStates(AsyncWebSocketClient* client, uint32_t afterSeq);
+
+    /**
+     * Replay the events after a sequence number from the ring
+     *
+     * Args:
+     *     afterSeq: Last sequence number the client saw
+     *     topicMask: Topics to replay
+     *     sink: Receives each event in order
+     *     replayed: Set to the number of events replayed
+     *
+     * Returns:
+     *     bool: false if the ring no longer covers the gap (client needs a snapshot)
+     */
+    bool replayEvents(uint32_t afterSeq, uint8_t topicMask, const ReplaySink& sink, uint16_t& replayed);
+
+    /**
+     * Replay the latest state snapshots newer than a sequence number
+     */
+    void replayStates(uint32_t afterSeq, uint8_t topicMask, const ReplaySink& sink);
+
+    /**
+     * Sample each client's send queue; close clients that fell too far behind
+     */
+    void checkBackpressure();
+
+    /**
+     * Send state updates that were coalesced while a client's interval ran
+     */
+    void flushOwedStates(uint32_t now);
+
+    /**
+     * Check whether a client should get downsampled broadcasts
+     * (call inside the critical section)
+     */
+    bool isSlow(const ClientLink& link, uint32_t now) const;
+
+    /**
+     * Send a short error message to one client
+     */
+    void sendError(AsyncWebSocketClient* client, const char* message);
 };
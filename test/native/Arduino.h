@@ -0,0 +1,296 @@
+/**
+ * Host Arduino Shim for Native Tests
+ *
+ * The subset of the Arduino-ESP32 API the tested modules use, for the
+ * [env:native] unit tests. millis() reads a virtual clock that only moves
+ * when delay() (or hostAdvance()) is called, so timing-dependent code runs
+ * instantly and deterministically.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+inline uint32_t& hostClock() {
+    static uint32_t now = 0;
+    return now;
+}
+
+inline void hostAdvance(uint32_t ms) {
+    hostClock() += ms;
+}
+
+inline unsigned long millis() {
+    return hostClock();
+}
+
+inline unsigned long micros() {
+    return hostClock() * 1000UL;
+}
+
+inline void delay(unsigned long ms) {
+    hostAdvance(ms);
+}
+
+inline void yield() {
+}
+
+// ============================================================================
+// GPIO / PWM (no hardware: inputs read idle, outputs are dropped)
+// ============================================================================
+
+inline void pinMode(uint8_t, uint8_t) {
+}
+
+// Reason: Buttons are active-low, so HIGH reads as "not pressed"
+inline int digitalRead(uint8_t) {
+    return HIGH;
+}
+
+inline void digitalWrite(uint8_t, uint8_t) {
+}
+
+inline double ledcSetup(uint8_t, double frequency, uint8_t) {
+    return frequency;
+}
+
+inline void ledcAttachPin(uint8_t, uint8_t) {
+}
+
+inline void ledcWrite(uint8_t, uint32_t) {
+}
+
+inline uint32_t esp_random() {
+    static uint32_t state = 0x9E3779B9;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// ============================================================================
+// SYSTEM (heap figures only feed the metrics, so they are fixed)
+// ============================================================================
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() const { return 200000; }
+    uint32_t getMinFreeHeap() const { return 180000; }
+    uint32_t getMaxAllocHeap() const { return 110000; }
+};
+
+static EspClass ESP;
+
+// Reason: The ESP32 toolchain has strlcpy; glibc only since 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+// ============================================================================
+// MATH
+// ============================================================================
+
+// Reason: The ESP32 core uses the std versions too, so mixed-type calls
+// fail here as they would on the device
+using std::min;
+using std::max;
+
+template<class T, class L, class H>
+T constrain(T x, L low, H high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+// ============================================================================
+// FREERTOS (single-threaded host: locks are no-ops)
+// ============================================================================
+
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef struct { int owner; } portMUX_TYPE;
+
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE 1
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    static int handle;
+    return &handle;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return xSemaphoreCreateMutex();
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) {
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) {
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t) {
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t) {
+    return pdTRUE;
+}
+
+// ============================================================================
+// STRING / PRINT / STREAM
+// ============================================================================
+
+class String {
+public:
+    String() {}
+    String(const char* text) : s(text ? text : "") {}
+    String(const std::string& text) : s(text) {}
+    String(char c) : s(1, c) {}
+    String(int value) : s(std::to_string(value)) {}
+    String(unsigned int value) : s(std::to_string(value)) {}
+    String(long value) : s(std::to_string(value)) {}
+    String(unsigned long value) : s(std::to_string(value)) {}
+
+    unsigned int length() const { return s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+    bool concat(const char* text) { s += text ? text : ""; return true; }
+    bool concat(const char* text, unsigned int n) { s.append(text, n); return true; }
+    bool concat(const String& other) { s += other.s; return true; }
+    bool concat(char c) { s += c; return true; }
+    bool concat(int value) { s += std::to_string(value); return true; }
+    bool concat(unsigned int value) { s += std::to_string(value); return true; }
+    bool concat(long value) { s += std::to_string(value); return true; }
+    bool concat(unsigned long value) { s += std::to_string(value); return true; }
+    template<class T> String& operator+=(const T& value) { concat(value); return *this; }
+
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t p = s.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int from) const { return s.substr(from); }
+    String substring(unsigned int from, unsigned int to) const { return s.substr(from, to - from); }
+    long toInt() const { return atol(s.c_str()); }
+    char operator[](unsigned int i) const { return s[i]; }
+
+    bool equals(const String& other) const { return s == other.s; }
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == (other ? other : ""); }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    bool operator<(const String& other) const { return s < other.s; }
+
+private:
+    std::string s;
+};
+
+template<class T>
+String operator+(const String& a, const T& b) {
+    String r(a);
+    r += b;
+    return r;
+}
+
+// Reason: ArduinoJson's String support names this Arduino type
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const char* text) : String(text) {}
+};
+
+inline String operator+(const char* a, const String& b) {
+    String r(a);
+    r += b;
+    return r;
+}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) {
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char* text) {
+        return write((const uint8_t*)text, strlen(text));
+    }
+    size_t print(const char* text) {
+        return write(text);
+    }
+    size_t print(char c) {
+        return write((uint8_t)c);
+    }
+    size_t printf(const char* format, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return n > 0 ? write((const uint8_t*)buffer, min((size_t)n, sizeof(buffer) - 1)) : 0;
+    }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0) {
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        return readBytes((char*)buffer, length);
+    }
+    void setTimeout(unsigned long) {}
+};
@@ -0,0 +1,24 @@
+/**
+ * AsyncWebSocket Shim for Native Tests
+ *
+ * Just the names websocket_handler.h declares its interface with. The
+ * handler itself is not built on the host (see native_stubs.h).
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+
+typedef enum {
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
@@ -0,0 +1,306 @@
+/**
+ * In-Memory LittleFS Shim for Native Tests
+ *
+ * Files live in a map, so tests can inspect and damage them directly.
+ * Two faults can be injected:
+ *
+ *     Power cut: cutPowerAfter(n) lets n more operations through and then
+ *     throws PowerCut from the next one. Every byte written counts as one
+ *     operation, as does each create, rename and remove, so a test can stop
+ *     the device at every point of a save. Bytes written before the cut
+ *     stay in the file (a torn write); renames stay atomic, as on LittleFS.
+ *
+ *     Full filesystem: setFull(true) makes writes return a short count.
+ *
+ * Directories are only names: mkdir() registers one, and opening it lists
+ * the files whose path starts with it.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Thrown when a simulated power cut hits
+ */
+struct PowerCut {};
+
+namespace fs {
+
+class FS;
+
+class File : public Stream {
+public:
+    File() : pos(0), fs(nullptr), nextEntry(0) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int available() override {
+        return data ? (int)(data->size() - pos) : 0;
+    }
+
+    int read() override {
+        return data && pos < data->size() ? (uint8_t)(*data)[pos++] : -1;
+    }
+
+    size_t read(uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && data && pos < data->size()) {
+            buffer[n++] = (uint8_t)(*data)[pos++];
+        }
+        return n;
+    }
+
+    int peek() override {
+        return data && pos < data->size() ? (uint8_t)(*data)[pos] : -1;
+    }
+
+    bool seek(uint32_t position) {
+        if (!data || position > data->size()) {
+            return false;
+        }
+        pos = position;
+        return true;
+    }
+
+    size_t size() const {
+        return data ? data->size() : 0;
+    }
+
+    size_t position() const {
+        return pos;
+    }
+
+    void close() {
+        data.reset();
+        entries.reset();
+    }
+
+    operator bool() const {
+        return (bool)data || (bool)entries;
+    }
+
+    bool isDirectory() const {
+        return (bool)entries;
+    }
+
+    /**
+     * Open the next entry of a directory (invalid File at the end)
+     */
+    File openNextFile();
+
+    /**
+     * Get the entry name (without its directory, as on the ESP32 core)
+     */
+    const char* name() const {
+        return entryName.c_str();
+    }
+
+private:
+    friend class FS;
+    std::shared_ptr<std::string> data;
+    size_t pos;
+    FS* fs;
+
+    // Directories only
+    std::shared_ptr<std::vector<std::string> > entries;
+    size_t nextEntry;
+    std::string path;
+    std::string entryName;
+};
+
+class FS {
+public:
+    FS() : budget(-1), full(false) {}
+
+    bool begin(bool formatOnFail = false) {
+        (void)formatOnFail;
+        return true;
+    }
+
+    // Size of the spiffs partition in partitions.csv
+    size_t totalBytes() const {
+        return 0x30000;
+    }
+
+    size_t usedBytes() const {
+        size_t used = 0;
+        for (std::map<std::string, std::shared_ptr<std::string> >::const_iterator it = files.begin();
+             it != files.end(); ++it) {
+            used += it->second->size();
+        }
+        return used;
+    }
+
+    File open(const String& path, const char* mode = "r") {
+        File file;
+        if (dirs.count(path.c_str())) {
+            return openDirectory(path.c_str());
+        }
+
+        if (mode[0] == 'w') {
+            tick();
+            files[path.c_str()] = std::make_shared<std::string>();
+        } else if (mode[0] == 'a' && !files.count(path.c_str())) {
+            tick();
+            files[path.c_str()] = std::make_shared<std::string>();
+        }
+
+        std::map<std::string, std::shared_ptr<std::string> >::iterator it = files.find(path.c_str());
+        if (it == files.end()) {
+            return file;
+        }
+
+        file.data = it->second;
+        file.fs = this;
+        file.pos = mode[0] == 'a' ? file.data->size() : 0;
+        file.path = path.c_str();
+        file.entryName = file.path.substr(file.path.rfind('/') + 1);
+        return file;
+    }
+
+    bool exists(const String& path) {
+        return files.count(path.c_str()) > 0 || dirs.count(path.c_str()) > 0;
+    }
+
+    bool mkdir(const String& path) {
+        dirs.insert(path.c_str());
+        return true;
+    }
+
+    bool remove(const String& path) {
+        if (!files.count(path.c_str())) {
+            return false;
+        }
+        tick();
+        files.erase(path.c_str());
+        return true;
+    }
+
+    bool rename(const String& from, const String& to) {
+        std::map<std::string, std::shared_ptr<std::string> >::iterator it = files.find(from.c_str());
+        if (it == files.end()) {
+            return false;
+        }
+        tick();
+        std::shared_ptr<std::string> data = it->second;
+        files.erase(it);
+        files[to.c_str()] = data;
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    // Host-only test controls
+    // ------------------------------------------------------------------------
+
+    /**
+     * Remove every file and clear injected faults
+     */
+    void format() {
+        files.clear();
+        dirs.clear();
+        budget = -1;
+        full = false;
+    }
+
+    /**
+     * Cut power after the given number of operations (-1 = never)
+     */
+    void cutPowerAfter(long operations) {
+        budget = operations;
+    }
+
+    /**
+     * Make writes fail as on a full filesystem
+     */
+    void setFull(bool isFull) {
+        full = isFull;
+    }
+
+    bool isFull() const {
+        return full;
+    }
+
+    /**
+     * Count one operation, throwing PowerCut once the budget is spent
+     */
+    void tick() {
+        if (budget == 0) {
+            throw PowerCut();
+        }
+        if (budget > 0) {
+            budget--;
+        }
+    }
+
+    std::map<std::string, std::shared_ptr<std::string> > files;
+    std::set<std::string> dirs;
+
+private:
+    File openDirectory(const std::string& dir) {
+        File file;
+        file.entries = std::make_shared<std::vector<std::string> >();
+        file.path = dir;
+        file.fs = this;
+
+        std::string prefix = dir + "/";
+        for (std::map<std::string, std::shared_ptr<std::string> >::iterator it = files.begin();
+             it != files.end(); ++it) {
+            if (it->first.compare(0, prefix.size(), prefix) == 0 &&
+                it->first.find('/', prefix.size()) == std::string::npos) {
+                file.entries->push_back(it->first);
+            }
+        }
+        return file;
+    }
+
+    long budget;
+    bool full;
+};
+
+inline size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!data) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        if (fs->isFull()) {
+            return i;
+        }
+        fs->tick();
+        if (pos < data->size()) {
+            (*data)[pos] = (char)buffer[i];
+        } else {
+            data->push_back((char)buffer[i]);
+        }
+        pos++;
+    }
+    return size;
+}
+
+inline File File::openNextFile() {
+    if (!entries || nextEntry >= entries->size()) {
+        return File();
+    }
+    return fs->open((*entries)[nextEntry++].c_str(), "r");
+}
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+extern FS LittleFS;
@@ -0,0 +1,40 @@
+/**
+ * Native Test Definitions
+ *
+ * Definitions the host build needs but src/ leaves to the device: the
+ * filesystem instance, a silent Logger, and inert versions of the web
+ * modules SimonGame talks to (the game only calls them through pointers
+ * the tests leave null). DataStorage is the real module, on the in-memory
+ * LittleFS. Include once per test program, from its
+ * test_main.cpp.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "system/logger.h"
+#include "web/data_storage.h"
+#include "web/websocket_handler.h"
+#include "web/reaction_analytics.h"
+
+FS LittleFS;
+
+// Reason: Tests assert on results, not log output; logger.cpp needs a
+// FreeRTOS task and the UART
+void Logger::begin() {}
+void Logger::log(uint8_t, LogTag, const char*, ...) {}
+void Logger::printf(const char*, ...) {}
+void Logger::print(const char*) {}
+void Logger::println(const char*) {}
+void Logger::println(const String&) {}
+
+// Reason: websocket_handler.cpp and reaction_analytics.cpp need the web
+// server; SimonGame with a null handler and analytics never reaches these
+bool WebSocketHandler::wantsTopic(WsTopic) { return false; }
+void WebSocketHandler::broadcast(const JsonDocument&, WsTopic) {}
+
+void ReactionAnalytics::recordPress(const char*, DifficultyLevel, bool, uint32_t) {}
@@ -0,0 +1,24 @@
+/**
+ * Host CRC-32 Shim for Native Tests
+ *
+ * Bit-by-bit version of the ESP32 ROM crc32_le() (same polynomial, same
+ * inversion), so CRCs match the ones written on the device.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
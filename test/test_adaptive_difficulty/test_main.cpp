@@ -0,0 +1,243 @@
+/**
+ * AdaptiveDifficulty Simulation Tests
+ *
+ * Plays synthetic players against the adaptive engine and checks that the
+ * round success rate settles at ADAPTIVE_TARGET_SUCCESS_PERCENT and that
+ * the pace stays in a bounded band around its equilibrium.
+ *
+ * The synthetic player misses each step with a probability that grows with
+ * the square of the playback speed (ADAPTIVE_TONE_SLOW_MS / tone duration).
+ * Games restart at length 1 after every miss, as on the device.
+ *
+ * Run with: pio test -e native -f test_adaptive_difficulty
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include <unity.h>
+#include "native_stubs.h"
+#include "game/adaptive_difficulty.h"
+
+// Rounds before measuring (the pace starts at ADAPTIVE_START_PACE)
+#define SIM_WARMUP_ROUNDS 1000
+#define SIM_MEASURE_ROUNDS 20000
+
+// Allowed distance of the measured success rate from the target (percent)
+#define SIM_SUCCESS_TOLERANCE 3.0
+
+// Upper bound on the pace standard deviation once settled
+#define SIM_MAX_PACE_STDDEV 150.0
+
+// Per-step miss probability at the slowest pace, weakest to strongest player
+// Reason: Spans the players whose equilibrium is inside the pace range; a
+// stronger one just sits at ADAPTIVE_PACE_MAX
+static const double PLAYER_SKILLS[] = {0.04, 0.02, 0.01};
+#define NUM_PLAYER_SKILLS (sizeof(PLAYER_SKILLS) / sizeof(PLAYER_SKILLS[0]))
+
+/**
+ * Small deterministic generator so runs are repeatable on every host
+ */
+class SimRandom {
+public:
+    explicit SimRandom(uint32_t seed) : state(seed) {}
+
+    // Uniform in [0, 1)
+    double next() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.0;
+    }
+
+private:
+    uint32_t state;
+};
+
+/**
+ * Summary of one simulated stretch of rounds
+ */
+struct SimResult {
+    double successPercent;
+    double paceMean;
+    double paceStddev;
+    double clampedPercent;   // Rounds spent at pace 0 or ADAPTIVE_PACE_MAX
+};
+
+/**
+ * Synthetic player and the game loop around the engine
+ */
+class SimPlayer {
+public:
+    SimPlayer(AdaptiveDifficulty& engine, double skill, uint32_t seed) :
+        engine(engine), skill(skill), random(seed), length(1) {}
+
+    void setSkill(double newSkill) {
+        skill = newSkill;
+    }
+
+    /**
+     * Play one round and report it to the engine
+     *
+     * Returns:
+     *     bool: true if the round was completed
+     */
+    bool playRound() {
+        double speed = (double)ADAPTIVE_TONE_SLOW_MS / engine.getToneDuration();
+        double miss = min(skill * speed * speed, 0.9);
+
+        for (uint16_t step = 0; step < length; step++) {
+            engine.recordPress(400 + (uint32_t)(random.next() * 200));
+            if (random.next() < miss) {
+                engine.recordRound(false, step, length);
+                length = 1;
+                return false;
+            }
+        }
+
+        engine.recordRound(true, length, length);
+        length++;
+        return true;
+    }
+
+    /**
+     * Play a number of rounds and summarize them
+     */
+    SimResult run(uint32_t rounds) {
+        uint32_t successes = 0;
+        uint32_t clamped = 0;
+        double sum = 0;
+        double sumSquares = 0;
+
+        for (uint32_t i = 0; i < rounds; i++) {
+            if (playRound()) {
+                successes++;
+            }
+            double pace = engine.getPace();
+            sum += pace;
+            sumSquares += pace * pace;
+            if (pace == 0 || pace == ADAPTIVE_PACE_MAX) {
+                clamped++;
+            }
+        }
+
+        SimResult result;
+        result.successPercent = 100.0 * successes / rounds;
+        result.paceMean = sum / rounds;
+        result.paceStddev = sqrt(max(sumSquares / rounds - result.paceMean * result.paceMean, 0.0));
+        result.clampedPercent = 100.0 * clamped / rounds;
+        return result;
+    }
+
+private:
+    AdaptiveDifficulty& engine;
+    double skill;
+    SimRandom random;
+    uint16_t length;
+};
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_success_rate_converges_to_target() {
+    for (size_t i = 0; i < NUM_PLAYER_SKILLS; i++) {
+        AdaptiveDifficulty engine;
+        SimPlayer player(engine, PLAYER_SKILLS[i], 1000 + i);
+
+        player.run(SIM_WARMUP_ROUNDS);
+        SimResult result = player.run(SIM_MEASURE_ROUNDS);
+
+        char message[96];
+        snprintf(message, sizeof(message), "skill %.3f: %.1f%% success, pace %.0f +/- %.0f",
+                 PLAYER_SKILLS[i], result.successPercent, result.paceMean, result.paceStddev);
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(SIM_SUCCESS_TOLERANCE, ADAPTIVE_TARGET_SUCCESS_PERCENT,
+                                         result.successPercent, message);
+
+        // The running estimate the UI shows agrees with the measured rate
+        TEST_ASSERT_INT_WITHIN_MESSAGE(10, ADAPTIVE_TARGET_SUCCESS_PERCENT,
+                                       engine.getSuccessPercent(), message);
+    }
+}
+
+void test_pace_oscillation_is_bounded() {
+    for (size_t i = 0; i < NUM_PLAYER_SKILLS; i++) {
+        AdaptiveDifficulty engine;
+        SimPlayer player(engine, PLAYER_SKILLS[i], 2000 + i);
+
+        player.run(SIM_WARMUP_ROUNDS);
+        SimResult result = player.run(SIM_MEASURE_ROUNDS);
+
+        char message[96];
+        snprintf(message, sizeof(message), "skill %.3f: pace %.0f +/- %.0f, %.1f%% clamped",
+                 PLAYER_SKILLS[i], result.paceMean, result.paceStddev, result.clampedPercent);
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_TRUE_MESSAGE(result.paceStddev < SIM_MAX_PACE_STDDEV, message);
+        TEST_ASSERT_TRUE_MESSAGE(result.clampedPercent < 5.0, message);
+    }
+}
+
+void test_stronger_player_settles_at_faster_pace() {
+    double previousPace = 0;
+    for (size_t i = 0; i < NUM_PLAYER_SKILLS; i++) {
+        AdaptiveDifficulty engine;
+        SimPlayer player(engine, PLAYER_SKILLS[i], 3000 + i);
+
+        player.run(SIM_WARMUP_ROUNDS);
+        SimResult result = player.run(SIM_MEASURE_ROUNDS);
+
+        // Skills are listed weakest first, so each equilibrium is faster
+        TEST_ASSERT_TRUE(result.paceMean > previousPace + 50);
+        previousPace = result.paceMean;
+    }
+}
+
+void test_reconverges_after_skill_change() {
+    AdaptiveDifficulty engine;
+    SimPlayer player(engine, PLAYER_SKILLS[0], 4000);
+
+    player.run(SIM_WARMUP_ROUNDS);
+    SimResult before = player.run(SIM_MEASURE_ROUNDS / 4);
+
+    // The player warms up: fewer misses at the same speed
+    player.setSkill(PLAYER_SKILLS[NUM_PLAYER_SKILLS - 1]);
+    player.run(SIM_WARMUP_ROUNDS);
+    SimResult after = player.run(SIM_MEASURE_ROUNDS / 4);
+
+    TEST_ASSERT_TRUE(after.paceMean > before.paceMean + 100);
+    TEST_ASSERT_FLOAT_WITHIN(SIM_SUCCESS_TOLERANCE, ADAPTIVE_TARGET_SUCCESS_PERCENT,
+                             after.successPercent);
+}
+
+void test_timing_follows_pace() {
+    AdaptiveDifficulty engine;
+
+    // Only completed rounds: pace climbs to the fastest timing and stops there
+    for (int i = 0; i < ADAPTIVE_PACE_MAX; i++) {
+        engine.recordRound(true, 1, 1);
+    }
+    TEST_ASSERT_EQUAL(ADAPTIVE_PACE_MAX, engine.getPace());
+    TEST_ASSERT_EQUAL(ADAPTIVE_TONE_FAST_MS, engine.getToneDuration());
+    TEST_ASSERT_EQUAL(ADAPTIVE_GAP_FAST_MS, engine.getToneInterval());
+
+    // Only misses: back to the slowest timing
+    for (int i = 0; i < ADAPTIVE_PACE_MAX; i++) {
+        engine.recordRound(false, 0, 1);
+    }
+    TEST_ASSERT_EQUAL(0, engine.getPace());
+    TEST_ASSERT_EQUAL(ADAPTIVE_TONE_SLOW_MS, engine.getToneDuration());
+    TEST_ASSERT_EQUAL(ADAPTIVE_GAP_SLOW_MS, engine.getToneInterval());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_success_rate_converges_to_target);
+    RUN_TEST(test_pace_oscillation_is_bounded);
+    RUN_TEST(test_stronger_player_settles_at_faster_pace);
+    RUN_TEST(test_reconverges_after_skill_change);
+    RUN_TEST(test_timing_follows_pace);
+    return UNITY_END();
+}
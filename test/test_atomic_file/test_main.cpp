@@ -0,0 +1,201 @@
+/**
+ * AtomicFile Power-Cut Tests
+ *
+ * Cuts power at every operation of a save (each byte written, each create,
+ * rename and remove) and checks that recover() always leaves the old or
+ * the new document, never a torn one.
+ *
+ * Run with: pio test -e native -f test_atomic_file
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include <unity.h>
+#include "native_stubs.h"
+#include "web/atomic_file.h"
+
+#define TEST_PATH "/test.json"
+#define TEST_TEMP_PATH "/test.json.tmp"
+#define TEST_BAD_PATH "/test.json.bad"
+
+// Safety bound on cut points (a save is well under this many operations)
+#define MAX_CUT_POINTS 10000
+
+/**
+ * Save a small document whose fields identify its version
+ */
+static size_t saveVersion(int version) {
+    StaticJsonDocument<256> doc;
+    doc["version"] = version;
+    doc["name"] = "power cut test";
+    doc["padding"] = version % 2 ? "odd version, longer text" : "even";
+    return AtomicFile::write(TEST_PATH, doc);
+}
+
+/**
+ * Read back the version of the live file (-1 if unreadable)
+ */
+static int loadVersion() {
+    File file;
+    AtomicFile::Status status = AtomicFile::open(TEST_PATH, file);
+    if (status != AtomicFile::OK && status != AtomicFile::LEGACY) {
+        return -1;
+    }
+
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        return -1;
+    }
+    return doc["version"] | -1;
+}
+
+/**
+ * Run a save of version 2 over version 1, cut after the given operations
+ *
+ * Returns:
+ *     bool: true if the save finished before the cut
+ */
+static bool saveWithCut(long operations) {
+    LittleFS.format();
+    TEST_ASSERT_TRUE(saveVersion(1) > 0);
+
+    LittleFS.cutPowerAfter(operations);
+    bool finished = true;
+    try {
+        saveVersion(2);
+    } catch (const PowerCut&) {
+        finished = false;
+    }
+    LittleFS.cutPowerAfter(-1);
+    return finished;
+}
+
+void setUp() {
+    LittleFS.format();
+}
+
+void tearDown() {
+}
+
+void test_save_round_trip() {
+    TEST_ASSERT_TRUE(saveVersion(7) > 0);
+    TEST_ASSERT_EQUAL(AtomicFile::OK, AtomicFile::verify(TEST_PATH));
+    TEST_ASSERT_EQUAL(7, loadVersion());
+    TEST_ASSERT_FALSE(LittleFS.exists(TEST_TEMP_PATH));
+}
+
+void test_power_cut_during_write() {
+    long cut = 0;
+    for (; cut < MAX_CUT_POINTS; cut++) {
+        bool finished = saveWithCut(cut);
+
+        // Reason: Until the rename the live file is untouched, so an
+        // unfinished save must come back as the old version
+        AtomicFile::Status status = AtomicFile::recover(TEST_PATH);
+        TEST_ASSERT_EQUAL_MESSAGE(AtomicFile::OK, status, "live file not OK after recover");
+        TEST_ASSERT_EQUAL_MESSAGE(finished ? 2 : 1, loadVersion(), "wrong version after recover");
+        TEST_ASSERT_FALSE_MESSAGE(LittleFS.exists(TEST_TEMP_PATH), "temp file left behind");
+
+        // The next save must work from whatever state the cut left
+        TEST_ASSERT_TRUE(saveVersion(3) > 0);
+        TEST_ASSERT_EQUAL(3, loadVersion());
+
+        if (finished) {
+            break;
+        }
+    }
+
+    // Every operation of the save was cut at least once
+    TEST_ASSERT_TRUE(cut > 0 && cut < MAX_CUT_POINTS);
+}
+
+void test_power_cut_during_recover() {
+    // Cut the save at every point, then cut the recovery of each torn state
+    // at every point too; a second, uninterrupted recover must still settle
+    for (long saveCut = 0; saveCut < MAX_CUT_POINTS; saveCut++) {
+        bool finished = false;
+        for (long recoverCut = 0; recoverCut < MAX_CUT_POINTS; recoverCut++) {
+            finished = saveWithCut(saveCut);
+
+            LittleFS.cutPowerAfter(recoverCut);
+            bool recovered = true;
+            try {
+                AtomicFile::recover(TEST_PATH);
+            } catch (const PowerCut&) {
+                recovered = false;
+            }
+            LittleFS.cutPowerAfter(-1);
+
+            TEST_ASSERT_EQUAL(AtomicFile::OK, AtomicFile::recover(TEST_PATH));
+            TEST_ASSERT_EQUAL(finished ? 2 : 1, loadVersion());
+            TEST_ASSERT_FALSE(LittleFS.exists(TEST_TEMP_PATH));
+
+            if (recovered) {
+                break;
+            }
+        }
+        if (finished) {
+            break;
+        }
+    }
+}
+
+void test_torn_temp_with_missing_live_file() {
+    // A complete temp file is promoted when the live file is gone
+    TEST_ASSERT_TRUE(saveVersion(4) > 0);
+    LittleFS.rename(TEST_PATH, TEST_TEMP_PATH);
+    TEST_ASSERT_EQUAL(AtomicFile::OK, AtomicFile::recover(TEST_PATH));
+    TEST_ASSERT_EQUAL(4, loadVersion());
+
+    // A torn one is dropped
+    LittleFS.rename(TEST_PATH, TEST_TEMP_PATH);
+    LittleFS.files[TEST_TEMP_PATH]->resize(10);
+    TEST_ASSERT_EQUAL(AtomicFile::MISSING, AtomicFile::recover(TEST_PATH));
+    TEST_ASSERT_FALSE(LittleFS.exists(TEST_TEMP_PATH));
+}
+
+void test_full_filesystem_keeps_live_file() {
+    TEST_ASSERT_TRUE(saveVersion(1) > 0);
+
+    LittleFS.setFull(true);
+    TEST_ASSERT_EQUAL(0, saveVersion(2));
+    LittleFS.setFull(false);
+
+    TEST_ASSERT_EQUAL(1, loadVersion());
+    TEST_ASSERT_FALSE(LittleFS.exists(TEST_TEMP_PATH));
+}
+
+void test_corrupt_file_moved_aside() {
+    TEST_ASSERT_TRUE(saveVersion(5) > 0);
+
+    // Flip one byte of the JSON so the CRC no longer matches
+    (*LittleFS.files[TEST_PATH])[2] ^= 0x01;
+    TEST_ASSERT_EQUAL(AtomicFile::CORRUPT, AtomicFile::recover(TEST_PATH));
+    TEST_ASSERT_FALSE(LittleFS.exists(TEST_PATH));
+    TEST_ASSERT_TRUE(LittleFS.exists(TEST_BAD_PATH));
+
+    TEST_ASSERT_TRUE(saveVersion(6) > 0);
+    TEST_ASSERT_EQUAL(6, loadVersion());
+}
+
+void test_legacy_file_without_trailer() {
+    const char* legacy = "{\"version\":8}";
+    LittleFS.files[TEST_PATH] = std::make_shared<std::string>(legacy);
+    TEST_ASSERT_EQUAL(AtomicFile::LEGACY, AtomicFile::recover(TEST_PATH));
+    TEST_ASSERT_EQUAL(8, loadVersion());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_save_round_trip);
+    RUN_TEST(test_power_cut_during_write);
+    RUN_TEST(test_power_cut_during_recover);
+    RUN_TEST(test_torn_temp_with_missing_live_file);
+    RUN_TEST(test_full_filesystem_keeps_live_file);
+    RUN_TEST(test_corrupt_file_moved_aside);
+    RUN_TEST(test_legacy_file_without_trailer);
+    return UNITY_END();
+}
@@ -0,0 +1,232 @@
+/**
+ * Replay Regression Tests
+ *
+ * Records scripted games as replays, stores them in ReplayStore, reads
+ * them back and feeds them through SimonGame with ReplayDriver. The game
+ * must reach the recorded score; a tampered replay must not.
+ *
+ * Run with: pio test -e native -f test_replay
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include <unity.h>
+#include "native_stubs.h"
+#include "game/simon_game.h"
+#include "game/replay_driver.h"
+#include "game/sequence_rng.h"
+#include "web/atomic_file.h"
+#include "web/replay_store.h"
+
+// Reaction time of the scripted player (inside every difficulty's window)
+#define SCRIPT_PRESS_MS 450
+
+static LEDController leds;
+static ButtonHandler buttons;
+static AudioController audio;
+static SimonGame game(&leds, &buttons, &audio);
+static ReplayStore store;
+static GameReplay replay;
+
+/**
+ * Record a game that completes the given number of rounds and then ends
+ *
+ * Args:
+ *     seed: Sequence seed
+ *     difficulty: Difficulty level
+ *     rounds: Rounds completed (the score)
+ *     endWithTimeout: End by letting the window run out instead of a wrong press
+ */
+static void recordScript(uint32_t seed, DifficultyLevel difficulty, uint16_t rounds, bool endWithTimeout) {
+    SequenceRng rng(seed);
+    std::vector<Color> sequence;
+
+    replay.begin(seed, difficulty);
+    for (uint16_t length = 1; length <= rounds + 1; length++) {
+        sequence.push_back(rng.nextColor());
+        replay.recordRound(length);
+
+        // The last round is played up to its final step, then missed
+        uint16_t steps = length <= rounds ? length : length - 1;
+        for (uint16_t step = 0; step < steps; step++) {
+            replay.recordPress(sequence[step], SCRIPT_PRESS_MS + step * 7);
+        }
+    }
+
+    if (endWithTimeout) {
+        replay.recordTimeout(DIFF_EASY_WINDOW + 1);
+    } else {
+        Color wrong = (Color)((sequence.back() + 1) % NUM_COLORS);
+        replay.recordPress(wrong, SCRIPT_PRESS_MS);
+    }
+
+    replay.finish(rounds, rounds * 5000, 0);
+}
+
+/**
+ * Save the scripted replay, load it back and play it through the game
+ */
+static bool storeAndPlay(ReplayDriver& driver, uint32_t* replayId = nullptr) {
+    uint32_t id = store.save(replay);
+    TEST_ASSERT_TRUE(id > 0);
+    if (replayId) {
+        *replayId = id;
+    }
+
+    ReplayHeader header;
+    std::vector<ReplayEvent> events;
+    TEST_ASSERT_TRUE(store.load(id, header, events));
+    TEST_ASSERT_EQUAL(replay.getHeader().numEvents, events.size());
+    TEST_ASSERT_EQUAL(0, memcmp(&header, &replay.getHeader(), sizeof(header)));
+
+    return driver.play(header, events.data());
+}
+
+void setUp() {
+    LittleFS.format();
+    store = ReplayStore();
+    TEST_ASSERT_TRUE(store.begin());
+}
+
+void tearDown() {
+}
+
+void test_replay_reaches_recorded_score() {
+    ReplayDriver driver(&game, &buttons);
+    const uint32_t seeds[] = {1, 42, 0xDEADBEEF, 0xFFFFFFFF};
+
+    for (uint8_t d = EASY; d < NUM_DIFFICULTIES; d++) {
+        for (size_t i = 0; i < sizeof(seeds) / sizeof(seeds[0]); i++) {
+            uint16_t rounds = 3 + d * 4 + i;
+            recordScript(seeds[i], (DifficultyLevel)d, rounds, false);
+            TEST_ASSERT_EQUAL(0, replay.getHeader().flags);
+
+            TEST_ASSERT_TRUE(storeAndPlay(driver));
+            TEST_ASSERT_EQUAL(rounds, driver.getScore());
+            TEST_ASSERT_EQUAL(GAME_OVER, game.getState());
+        }
+    }
+}
+
+void test_replay_ending_in_timeout() {
+    ReplayDriver driver(&game, &buttons);
+
+    recordScript(7, MEDIUM, 6, true);
+    TEST_ASSERT_TRUE(storeAndPlay(driver));
+    TEST_ASSERT_EQUAL(6, driver.getScore());
+    TEST_ASSERT_EQUAL(GAME_OVER, game.getState());
+}
+
+void test_tampered_replay_diverges() {
+    ReplayDriver driver(&game, &buttons);
+
+    // Change one press in round 4: the game must end there
+    recordScript(99, EASY, 8, false);
+    ReplayEvent* events = const_cast<ReplayEvent*>(replay.getEvents());
+    uint16_t index = 0;
+    for (uint16_t round = 0; index < replay.getHeader().numEvents; index++) {
+        if (events[index].type == REPLAY_ROUND && ++round == 4) {
+            break;
+        }
+    }
+    events[index + 2].color = (events[index + 2].color + 1) % NUM_COLORS;
+
+    TEST_ASSERT_FALSE(storeAndPlay(driver));
+    TEST_ASSERT_EQUAL(3, driver.getScore());
+    TEST_ASSERT_TRUE(driver.getEventsPlayed() < replay.getHeader().numEvents);
+}
+
+void test_slow_press_times_out() {
+    ReplayDriver driver(&game, &buttons);
+
+    // A press slower than the Expert window is a timeout when replayed
+    recordScript(5, EXPERT, 4, false);
+    ReplayEvent* events = const_cast<ReplayEvent*>(replay.getEvents());
+    events[1].value = DIFF_EXPERT_WINDOW + 100;
+
+    TEST_ASSERT_FALSE(storeAndPlay(driver));
+    TEST_ASSERT_EQUAL(0, driver.getScore());
+}
+
+void test_store_evicts_oldest() {
+    uint32_t firstId = 0;
+    uint32_t lastId = 0;
+    for (uint8_t i = 0; i < REPLAY_MAX_FILES + 3; i++) {
+        recordScript(1000 + i, EASY, 2, false);
+        lastId = store.save(replay);
+        TEST_ASSERT_TRUE(lastId > 0);
+        if (i == 0) {
+            firstId = lastId;
+        }
+    }
+
+    std::vector<ReplayHeader> headers = store.list();
+    TEST_ASSERT_EQUAL(REPLAY_MAX_FILES, headers.size());
+    TEST_ASSERT_EQUAL(lastId, headers.front().id);
+    TEST_ASSERT_FALSE(store.exists(firstId));
+
+    ReplayHeader header;
+    std::vector<ReplayEvent> events;
+    TEST_ASSERT_FALSE(store.load(firstId, header, events));
+    TEST_ASSERT_TRUE(store.load(lastId, header, events));
+
+    // A restarted store continues after the highest stored ID
+    TEST_ASSERT_TRUE(store.flush());
+    TEST_ASSERT_FALSE(LittleFS.exists(store.pathFor(firstId)));
+    ReplayStore reopened;
+    TEST_ASSERT_TRUE(reopened.begin());
+    recordScript(2000, EASY, 2, false);
+    TEST_ASSERT_EQUAL(lastId + 1, reopened.save(replay));
+}
+
+void test_truncated_file_is_rejected() {
+    recordScript(11, HARD, 5, false);
+    uint32_t id = store.save(replay);
+    TEST_ASSERT_TRUE(id > 0);
+    TEST_ASSERT_TRUE(store.flush());
+
+    LittleFS.files[store.pathFor(id).c_str()]->resize(sizeof(ReplayHeader) + 6);
+
+    ReplayHeader header;
+    std::vector<ReplayEvent> events;
+    TEST_ASSERT_FALSE(store.load(id, header, events));
+}
+
+void test_queued_replay_is_written_when_quiet() {
+    recordScript(21, MEDIUM, 3, false);
+    uint32_t id = store.save(replay);
+    TEST_ASSERT_TRUE(id > 0);
+
+    // Readable straight away, but nothing written while a game runs
+    ReplayHeader header;
+    std::vector<ReplayEvent> events;
+    TEST_ASSERT_TRUE(store.load(id, header, events));
+    hostAdvance(STORAGE_FLUSH_QUIET_MS);
+    store.update(true);
+    TEST_ASSERT_FALSE(LittleFS.exists(store.pathFor(id)));
+
+    store.update(false);
+    TEST_ASSERT_EQUAL(AtomicFile::OK, AtomicFile::verify(store.pathFor(id).c_str()));
+
+    ReplayHeader stored;
+    std::vector<ReplayEvent> storedEvents;
+    TEST_ASSERT_TRUE(store.load(id, stored, storedEvents));
+    TEST_ASSERT_EQUAL(0, memcmp(&header, &stored, sizeof(header)));
+    TEST_ASSERT_EQUAL(events.size(), storedEvents.size());
+    TEST_ASSERT_EQUAL(0, memcmp(events.data(), storedEvents.data(), events.size() * sizeof(ReplayEvent)));
+}
+
+int main(int argc, char** argv) {
+    game.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_reaches_recorded_score);
+    RUN_TEST(test_replay_ending_in_timeout);
+    RUN_TEST(test_tampered_replay_diverges);
+    RUN_TEST(test_slow_press_times_out);
+    RUN_TEST(test_store_evicts_oldest);
+    RUN_TEST(test_truncated_file_is_rejected);
+    RUN_TEST(test_queued_replay_is_written_when_quiet);
+    return UNITY_END();
+}
@@ -0,0 +1,62 @@
+/**
+ * Browser SequenceRng Golden Vector Check
+ *
+ * Loads data/app.js with just enough of a browser around it and checks
+ * its SequenceRng, generateSequence() and dailySeed() against
+ * sequence_rng_vectors.h, the same vectors the firmware test uses.
+ *
+ * Run with: node test/test_sequence_rng/check_app_js.js
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+'use strict';
+
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+
+const root = path.join(__dirname, '..', '..');
+const header = fs.readFileSync(path.join(__dirname, 'sequence_rng_vectors.h'), 'utf8');
+
+// { 0xSEED, { 0xN0, 0xN1, 0xN2, 0xN3 }, "COLORS" }
+const vectorPattern = /\{\s*(0x[0-9A-Fa-f]+),\s*\{([^}]*)\},\s*"([0-3]+)"\s*\}/g;
+const vectors = [];
+let match;
+while ((match = vectorPattern.exec(header)) !== null) {
+    vectors.push({
+        seed: parseInt(match[1], 16),
+        next: match[2].split(',').map((n) => parseInt(n, 16)),
+        colors: match[3].split('').map(Number)
+    });
+}
+const dailyDate = /SEQUENCE_RNG_DAILY_DATE\s+"([^"]+)"/.exec(header)[1];
+const dailySeedValue = parseInt(/SEQUENCE_RNG_DAILY_SEED\s+(0x[0-9A-Fa-f]+)/.exec(header)[1], 16);
+assert(vectors.length > 0, 'no vectors parsed from sequence_rng_vectors.h');
+
+// Reason: app.js touches window and document at load; the generator does not
+const context = vm.createContext({
+    window: { location: { origin: '' } },
+    document: { addEventListener: () => {} }
+});
+vm.runInContext(fs.readFileSync(path.join(root, 'data', 'app.js'), 'utf8'), context);
+const app = vm.runInContext(
+    '({ SequenceRng, generateSequence, dailySeed, SEQUENCE_COLORS })', context);
+
+for (const vector of vectors) {
+    const rng = new app.SequenceRng(vector.seed);
+    const next = vector.next.map(() => rng.next());
+    assert.deepStrictEqual(next, vector.next, `next() for seed 0x${vector.seed.toString(16)}`);
+
+    // Reason: Arrays from the vm context have their own prototype
+    const colors = Array.from(app.generateSequence(vector.seed, vector.colors.length),
+        (color) => app.SEQUENCE_COLORS.indexOf(color));
+    assert.deepStrictEqual(colors, vector.colors, `colors for seed 0x${vector.seed.toString(16)}`);
+}
+
+assert.strictEqual(app.dailySeed(new Date(`${dailyDate}T12:00:00Z`)), dailySeedValue,
+    `dailySeed for ${dailyDate}`);
+
+console.log(`${vectors.length} vectors and the daily seed match the firmware`);
@@ -0,0 +1,34 @@
+/**
+ * SequenceRng Golden Vectors
+ *
+ * Expected outputs of SequenceRng, shared by the firmware test
+ * (test_main.cpp) and the browser port check (check_app_js.js), which
+ * parses this file. Change them only together with both generators.
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Daily challenge seed of dailySeed() in data/app.js (FNV-1a of the date)
+#define SEQUENCE_RNG_DAILY_DATE "2025-11-09"
+#define SEQUENCE_RNG_DAILY_SEED 0x7A66C3F5
+
+struct SequenceRngVector {
+    uint32_t seed;
+    uint32_t next[4];       // First raw next() outputs
+    const char* colors;     // First nextColor() values of a fresh generator (0 = RED .. 3 = YELLOW)
+};
+
+static const SequenceRngVector SEQUENCE_RNG_VECTORS[] = {
+    { 0x00000001, { 0x9190299E, 0xC1017B27, 0xE3AF522F, 0x7D71FB05 }, "2331131213232112" },
+    { 0x0000002A, { 0xA91E1CAC, 0x207B36E9, 0x1C987FFA, 0xD09FDE9E }, "2003000131013333" },
+    { 0xDEADBEEF, { 0x897AD89D, 0x998F30DF, 0x4A8BBA06, 0xA0E20CE0 }, "2212220320310230" },
+    { 0xFFFFFFFF, { 0x31D28326, 0x728481F8, 0x8C70D5D1, 0x7066BAF4 }, "0121003233123311" },
+    { 0x7A66C3F5, { 0x06CE393D, 0x7C675207, 0x509B80B1, 0x87C89BF9 }, "0112113330111111" },
+};
+
+#define SEQUENCE_RNG_VECTOR_COUNT (sizeof(SEQUENCE_RNG_VECTORS) / sizeof(SEQUENCE_RNG_VECTORS[0]))
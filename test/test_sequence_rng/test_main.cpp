@@ -0,0 +1,73 @@
+/**
+ * SequenceRng Golden Vector Tests
+ *
+ * Pins the firmware generator to sequence_rng_vectors.h. The browser port
+ * in data/app.js is checked against the same file by check_app_js.js, so
+ * a seed shared between the two (replays, daily challenge) always gives
+ * the same colors.
+ *
+ * Run with: pio test -e native -f test_sequence_rng
+ *           node test/test_sequence_rng/check_app_js.js
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include <unity.h>
+#include "native_stubs.h"
+#include "game/sequence_rng.h"
+#include "sequence_rng_vectors.h"
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_next_matches_vectors() {
+    for (size_t v = 0; v < SEQUENCE_RNG_VECTOR_COUNT; v++) {
+        const SequenceRngVector& vector = SEQUENCE_RNG_VECTORS[v];
+        SequenceRng rng(vector.seed);
+        for (uint8_t i = 0; i < 4; i++) {
+            TEST_ASSERT_EQUAL_HEX32(vector.next[i], rng.next());
+        }
+    }
+}
+
+void test_colors_match_vectors() {
+    for (size_t v = 0; v < SEQUENCE_RNG_VECTOR_COUNT; v++) {
+        const SequenceRngVector& vector = SEQUENCE_RNG_VECTORS[v];
+        SequenceRng rng(vector.seed);
+        for (const char* c = vector.colors; *c; c++) {
+            TEST_ASSERT_EQUAL(*c - '0', rng.nextColor());
+        }
+    }
+}
+
+void test_reseed_restarts_stream() {
+    const SequenceRngVector& vector = SEQUENCE_RNG_VECTORS[0];
+    SequenceRng rng(SEQUENCE_RNG_DAILY_SEED);
+    rng.next();
+    rng.seed(vector.seed);
+    TEST_ASSERT_EQUAL_HEX32(vector.seed, rng.getSeed());
+    TEST_ASSERT_EQUAL_HEX32(vector.next[0], rng.next());
+}
+
+void test_daily_seed_has_vector() {
+    // Reason: The device only receives the browser's daily seed, so its
+    // sequence must be pinned too
+    bool found = false;
+    for (size_t v = 0; v < SEQUENCE_RNG_VECTOR_COUNT; v++) {
+        found |= SEQUENCE_RNG_VECTORS[v].seed == SEQUENCE_RNG_DAILY_SEED;
+    }
+    TEST_ASSERT_TRUE(found);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_next_matches_vectors);
+    RUN_TEST(test_colors_match_vectors);
+    RUN_TEST(test_reseed_restarts_stream);
+    RUN_TEST(test_daily_seed_has_vector);
+    return UNITY_END();
+}
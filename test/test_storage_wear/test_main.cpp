@@ -0,0 +1,176 @@
+/**
+ * DataStorage Flash Wear Tests
+ *
+ * Plays games through the real DataStorage on the in-memory LittleFS and
+ * reads back its own wear counters (the recordWrite() figures shown by
+ * /api/storage), so the erase cost of a game is measured, not estimated.
+ * Every game is flushed on its own, as when players pause between games.
+ * A restart then checks that the checkpointed files plus the history log
+ * give back the same player stats and score ranks.
+ *
+ * Run with: pio test -e native -f test_storage_wear
+ *
+ * Author: Giorgio Gilestro (giorgio@gilest.ro)
+ * Date: 2025-11-09
+ */
+
+#include <unity.h>
+#include <unistd.h>
+#include "native_stubs.h"
+#include "web/data_storage.h"
+
+#define TEST_PLAYERS 4
+
+// Several players.json / ranks.json checkpoints and history segments
+#define TEST_GAMES 200
+
+// 2025-11-09 00:00 UTC
+#define TEST_EPOCH 1762646400UL
+
+// Budget per game on LittleFS: the log append (1), plus the players.json
+// and ranks.json checkpoints (1 each per STORAGE_PLAYERS_CHECKPOINT_GAMES)
+// and the odd archive and wear counter save
+#define MAX_ERASES_PER_GAME 1.1f
+
+static String playerIds[TEST_PLAYERS];
+
+/**
+ * Erase counts read from wearToJson()
+ */
+struct WearTotals {
+    uint32_t littleFs;      // Every LittleFS file
+    uint32_t snapshot;      // Snapshot partition (outside the LittleFS budget)
+    uint32_t history;
+    uint32_t players;
+    uint32_t ranks;
+};
+
+static uint32_t fileErases(JsonArray files, const char* name) {
+    for (JsonVariant f : files) {
+        if (strcmp(f["file"] | "", name) == 0) {
+            return f["erases"].as<uint32_t>();
+        }
+    }
+    return 0;
+}
+
+static WearTotals readWear(DataStorage& storage) {
+    DynamicJsonDocument doc(4096);
+    storage.wearToJson(doc.to<JsonObject>());
+    JsonArray files = doc["files"];
+
+    WearTotals wear;
+    wear.littleFs = doc["erases"].as<uint32_t>();
+    wear.snapshot = fileErases(files, "snapshot");
+    wear.history = fileErases(files, "history");
+    wear.players = fileErases(files, "players");
+    wear.ranks = fileErases(files, "ranks");
+    return wear;
+}
+
+/**
+ * Record one game and let the storage flush it once things are quiet
+ */
+static void playGame(DataStorage& storage, uint16_t n, uint16_t score) {
+    GameSession game;
+    PlayerId::parse(playerIds[n % TEST_PLAYERS].c_str(), game.playerId);
+    game.score = score;
+    game.difficulty = (DifficultyLevel)(n % 3);
+    game.duration = 60;
+    game.seed = 1000 + n;
+    game.replayId = 0;
+    TEST_ASSERT_TRUE(storage.recordGame(game));
+
+    hostAdvance(STORAGE_FLUSH_QUIET_MS);
+    storage.update(false);
+}
+
+void setUp() {
+    LittleFS.format();
+    unlink(SNAPSHOT_HOST_FILE);
+}
+
+void tearDown() {
+}
+
+void test_game_costs_about_one_erase() {
+    DataStorage storage;
+    TEST_ASSERT_TRUE(storage.begin());
+    storage.setTimeOffset(TEST_EPOCH);
+    for (uint8_t i = 0; i < TEST_PLAYERS; i++) {
+        playerIds[i] = storage.createPlayer(String("Player ") + String((int)i));
+        TEST_ASSERT_TRUE(playerIds[i].length() > 0);
+    }
+    // Reason: A full high-score table of better games, as after a while
+    // of play; games that make the table also rewrite /scores.json
+    uint16_t n = 0;
+    for (; n < MAX_HIGH_SCORES_TOTAL * NUM_DIFFICULTIES; n++) {
+        playGame(storage, n, 40);
+    }
+    TEST_ASSERT_TRUE(storage.flush(true));
+
+    WearTotals before = readWear(storage);
+    for (uint16_t i = 0; i < TEST_GAMES; i++, n++) {
+        playGame(storage, n, 3 + (n * 7) % 11);
+    }
+    TEST_ASSERT_TRUE(storage.flush(true));
+    WearTotals after = readWear(storage);
+
+    float perGame = (float)(after.littleFs - before.littleFs) / TEST_GAMES;
+    char message[160];
+    snprintf(message, sizeof(message),
+             "LittleFS erases/game %.3f (history %u, players %u, ranks %u), snapshot erases %u",
+             perGame, after.history - before.history, after.players - before.players,
+             after.ranks - before.ranks, after.snapshot - before.snapshot);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_TRUE(perGame <= MAX_ERASES_PER_GAME);
+    TEST_ASSERT_TRUE(after.players - before.players <= TEST_GAMES / STORAGE_PLAYERS_CHECKPOINT_GAMES + 1);
+    TEST_ASSERT_TRUE(after.ranks - before.ranks <= TEST_GAMES / STORAGE_PLAYERS_CHECKPOINT_GAMES + 1);
+    // Reason: Rebuilt only with players.json and the high scores, not per game
+    TEST_ASSERT_TRUE(after.snapshot - before.snapshot <= after.players - before.players);
+}
+
+void test_restart_restores_stats_and_ranks() {
+    std::vector<Player> players;
+    ScoreRank ranks[3];
+    {
+        DataStorage storage;
+        TEST_ASSERT_TRUE(storage.begin());
+        storage.setTimeOffset(TEST_EPOCH);
+        for (uint8_t i = 0; i < TEST_PLAYERS; i++) {
+            playerIds[i] = storage.createPlayer(String("Player ") + String((int)i));
+        }
+        // Reason: Ends between checkpoints, so both files lag the log
+        for (uint16_t n = 0; n < STORAGE_PLAYERS_CHECKPOINT_GAMES + 7; n++) {
+            playGame(storage, n, 3 + (n * 7) % 11);
+        }
+        TEST_ASSERT_TRUE(storage.flush(true));
+        players = storage.getAllPlayers();
+        for (uint8_t d = 0; d < 3; d++) {
+            ranks[d] = storage.getScoreRank((DifficultyLevel)d, 8);
+        }
+    }
+
+    DataStorage restarted;
+    TEST_ASSERT_TRUE(restarted.begin());
+    std::vector<Player> reloaded = restarted.getAllPlayers();
+    TEST_ASSERT_EQUAL(players.size(), reloaded.size());
+    for (size_t i = 0; i < players.size(); i++) {
+        TEST_ASSERT_EQUAL(players[i].gamesPlayed, reloaded[i].gamesPlayed);
+        TEST_ASSERT_EQUAL(players[i].totalScore, reloaded[i].totalScore);
+        TEST_ASSERT_EQUAL(players[i].bestScore, reloaded[i].bestScore);
+    }
+    for (uint8_t d = 0; d < 3; d++) {
+        ScoreRank rank = restarted.getScoreRank((DifficultyLevel)d, 8);
+        TEST_ASSERT_EQUAL(ranks[d].total, rank.total);
+        TEST_ASSERT_EQUAL(ranks[d].rank, rank.rank);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_game_costs_about_one_erase);
+    RUN_TEST(test_restart_restores_stats_and_ranks);
+    return UNITY_END();
+}